@@ -7,6 +7,8 @@
 #include "Logging/Logger.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxPipelineState.h"
+#include "Graphics/GfxResidencyManager.h"
 #include "Rendering/Renderer.h"
 #include "Rendering/Camera.h"
 #include "Rendering/EntityLoader.h"
@@ -79,7 +81,11 @@ namespace adria
 				model_params.Find<bool>("use_ccw", triangle_ccw);
 				bool force_mask = false;
 				model_params.Find<bool>("force_alpha_mask", force_mask);
-				config.scene_models.emplace_back(path, tex_path, transform, triangle_ccw, force_mask);
+				ModelParameters& scene_model = config.scene_models.emplace_back(path, tex_path, transform, triangle_ccw, force_mask);
+
+				float lod_ratios[MESH_LOD_COUNT - 1];
+				if (model_params.FindArray("lod_ratios", lod_ratios)) scene_model.lod_ratios.assign(std::begin(lod_ratios), std::end(lod_ratios));
+				model_params.Find<float>("lod_error", scene_model.lod_target_error);
 			}
 
 			for (auto&& light_json : lights)
@@ -229,6 +235,7 @@ namespace adria
 		g_ThreadPool.Initialize();
 		GfxShaderCompiler::Initialize();
 		gfx = std::make_unique<GfxDevice>(window, init.gfx_options);
+		g_GfxResidencyManager.Initialize(gfx.get());
 		ShaderManager::Initialize();
 		g_TextureManager.Initialize(gfx.get(), 1000);
 		renderer = std::make_unique<Renderer>(reg, gfx.get(), window->Width(), window->Height());
@@ -252,10 +259,12 @@ namespace adria
 
 	Engine::~Engine()
 	{
+		GfxPipelineState::CancelPendingRebuilds();
 		g_TextureManager.Destroy();
 		ShaderManager::Destroy();
 		GfxShaderCompiler::Destroy();
 		g_ThreadPool.Destroy();
+		g_GfxResidencyManager.Destroy();
 	}
 
 	void Engine::OnWindowEvent(WindowEventData const& msg_data)
@@ -275,6 +284,7 @@ namespace adria
 
 	void Engine::Update(float dt)
 	{
+		ShaderManager::Update();
 		camera->Tick(dt);
 		renderer->NewFrame(camera.get());
 		renderer->Update(dt);
@@ -282,6 +292,7 @@ namespace adria
 	void Engine::Render()
 	{
 		gfx->BeginFrame();
+		g_TextureManager.Update();
 		renderer->Render();
 		gfx->EndFrame();
 	}
@@ -320,7 +331,7 @@ namespace adria
 		camera = std::make_unique<Camera>(config.camera_params);
 		entity_loader->LoadSkybox(config.skybox_params);
 
-		for (auto const& model : config.scene_models) entity_loader->ImportModel_GLTF(model);
+		entity_loader->ImportModels_GLTF(config.scene_models);
 		for (auto const& light : config.scene_lights) entity_loader->LoadLight(light);
 
 		auto ray_tracing_view = reg.view<Mesh, RayTracing>();
@@ -29,6 +29,10 @@ namespace adria
 
 	std::string const paths::ShaderCacheDir = SavedDir + "ShaderCache/";
 
+	std::string const paths::MeshCacheDir = SavedDir + "MeshCache/";
+
+	std::string const paths::TextureCacheDir = SavedDir + "TextureCache/";
+
 	std::string const paths::ShaderPDBDir = SavedDir + "ShaderPDB/";
 
 	std::string const paths::IniDir = SavedDir + "Ini/";
@@ -19,6 +19,8 @@ namespace adria::paths
 	extern std::string const PixCapturesDir;
 	extern std::string const RenderGraphDir;
 	extern std::string const ShaderCacheDir;
+	extern std::string const MeshCacheDir;
+	extern std::string const TextureCacheDir;
 	extern std::string const ShaderPDBDir;
 	extern std::string const IniDir;
 	extern std::string const ScenesDir;
@@ -19,6 +19,7 @@
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxRingDescriptorAllocator.h"
 #include "Graphics/GfxProfiler.h"
+#include "Graphics/GfxResidencyManager.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Utilities/FilesUtil.h"
 #include "Utilities/StringUtil.h"
@@ -32,26 +33,6 @@ namespace adria
 {
 	extern bool dump_render_graph;
 
-	struct ProfilerState
-	{
-		bool  show_average = false;
-		struct AccumulatedTimeStamp
-		{
-			float sum;
-			float minimum;
-			float maximum;
-
-			AccumulatedTimeStamp()
-				: sum(0.0f), minimum(FLT_MAX), maximum(0)
-			{}
-		};
-
-		std::vector<AccumulatedTimeStamp> displayed_timestamps;
-		std::vector<AccumulatedTimeStamp> accumulating_timestamps;
-		double last_reset_time = 0.0;
-		uint32 accumulating_frame_count = 0;
-	};
-
 	Editor::Editor() = default;
 	Editor::~Editor() = default;
 	void Editor::Init(EditorInit&& init)
@@ -91,7 +72,6 @@ namespace adria
 
 		if (reload_shaders)
 		{
-			gfx->WaitForGPU();
 			ShaderManager::CheckIfShadersHaveChanged();
 			reload_shaders = false;
 		}
@@ -239,7 +219,7 @@ namespace adria
 				if (ImGui::MenuItem(ICON_FA_FOLDER_OPEN" Load Model"))
 				{
 					nfdchar_t* file_path = NULL;
-					const nfdchar_t* filter_list = "gltf";
+					const nfdchar_t* filter_list = "gltf,glb";
 					nfdresult_t result = NFD_OpenDialog(filter_list, NULL, &file_path);
 					if (result == NFD_OKAY)
 					{
@@ -431,6 +411,8 @@ namespace adria
 				auto const& picking_data = engine->renderer->GetPickingData();
 				ImGui::Text("Picked Position: %f %f %f", picking_data.position.x, picking_data.position.y, picking_data.position.z);
 				ImGui::Text("Picked Normal: %f %f %f", picking_data.normal.x, picking_data.normal.y, picking_data.normal.z);
+				auto const& picking_hit = engine->renderer->GetPickingHit();
+				if (picking_hit.entity != entt::null) ImGui::Text("Picked Entity: %u, Submesh: %u", entt::to_integral(picking_hit.entity), picking_hit.submesh_index);
 				if (ImGui::Button("Load Decal"))
 				{
 					params.position = Vector3(picking_data.position);
@@ -655,7 +637,7 @@ namespace adria
 						nfdresult_t result = NFD_OpenDialog(filter_list, NULL, &file_path);
 						if (result == NFD_OKAY)
 						{
-							material->metallic_roughness_texture = g_TextureManager.LoadTexture(file_path);
+							material->metallic_roughness_texture = g_TextureManager.LoadTexture(file_path, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE);
 							free(file_path);
 						}
 					}
@@ -683,7 +665,7 @@ namespace adria
 						nfdresult_t result = NFD_OpenDialog(filter_list, NULL, &file_path);
 						if (result == NFD_OKAY)
 						{
-							material->emissive_texture = g_TextureManager.LoadTexture(file_path);
+							material->emissive_texture = g_TextureManager.LoadTexture(file_path, DEFAULT_BLACK_TEXTURE_HANDLE);
 							free(file_path);
 						}
 					}
@@ -751,7 +733,7 @@ namespace adria
 						nfdresult_t result = NFD_OpenDialog(filter_list, NULL, &file_path);
 						if (result == NFD_OKAY)
 						{
-							decal->normal_decal_texture = g_TextureManager.LoadTexture(file_path);
+							decal->normal_decal_texture = g_TextureManager.LoadTexture(file_path, DEFAULT_NORMAL_TEXTURE_HANDLE);
 							free(file_path);
 						}
 					}
@@ -771,6 +753,7 @@ namespace adria
 						if (result == NFD_OKAY)
 						{
 							skybox->cubemap_texture = g_TextureManager.LoadTexture(file_path);
+							g_TextureManager.WaitForTexture(skybox->cubemap_texture);
 							free(file_path);
 						}
 					}
@@ -977,13 +960,13 @@ namespace adria
 				static constexpr uint64 NUM_FRAMES = 128;
 				static constexpr int32 FRAME_TIME_GRAPH_MAX_FPS[] = { 800, 240, 120, 90, 65, 45, 30, 15, 10, 5, 4, 3, 2, 1 };
 
-				static ProfilerState state{};
+				static bool show_statistics = false;
 				static float FrameTimeArray[NUM_FRAMES] = { 0 };
 				static float RecentHighestFrameTime = 0.0f;
 				static float FrameTimeGraphMaxValues[ARRAYSIZE(FRAME_TIME_GRAPH_MAX_FPS)] = { 0 };
 				for (uint64 i = 0; i < ARRAYSIZE(FrameTimeGraphMaxValues); ++i) { FrameTimeGraphMaxValues[i] = 1000.f / FRAME_TIME_GRAPH_MAX_FPS[i]; }
 
-				std::vector<GfxTimestamp> time_stamps = g_GfxProfiler.GetResults();
+				GfxProfilerFrame const* profiler_frame = g_GfxProfiler.GetLatestFrame();
 				FrameTimeArray[NUM_FRAMES - 1] = 1000.0f / io.Framerate;
 				for (uint32 i = 0; i < NUM_FRAMES - 1; i++) FrameTimeArray[i] = FrameTimeArray[i + 1];
 				RecentHighestFrameTime = std::max(RecentHighestFrameTime, FrameTimeArray[NUM_FRAMES - 1]);
@@ -993,7 +976,13 @@ namespace adria
 				ImGui::Text("FPS        : %d (%.2f ms)", fps, frame_time_ms);
 				if (ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen))
 				{
-					ImGui::Checkbox("Show Avg/Min/Max", &state.show_average);
+					ImGui::Checkbox("Show Statistics", &show_statistics);
+					ImGui::SameLine();
+					if (ImGui::Button("Export Trace"))
+					{
+						std::string trace_file = paths::SavedDir + "gpu_trace.json";
+						if (g_GfxProfiler.ExportTrace(trace_file.c_str())) ADRIA_LOG(INFO, "GPU trace exported to %s", trace_file.c_str());
+					}
 					ImGui::Spacing();
 
 					uint64 max_i = 0;
@@ -1007,79 +996,46 @@ namespace adria
 					}
 					ImGui::PlotLines("", FrameTimeArray, NUM_FRAMES, 0, "GPU frame time (ms)", 0.0f, FrameTimeGraphMaxValues[max_i], ImVec2(0, 80));
 
-					constexpr uint32 avg_timestamp_update_interval = 1000;
-					static auto MillisecondsNow = []()
-					{
-						static LARGE_INTEGER s_frequency;
-						static BOOL s_use_qpc = QueryPerformanceFrequency(&s_frequency);
-						double milliseconds = 0;
-						if (s_use_qpc)
-						{
-							LARGE_INTEGER now;
-							QueryPerformanceCounter(&now);
-							milliseconds = double(1000.0 * now.QuadPart) / s_frequency.QuadPart;
-						}
-						else milliseconds = double(GetTickCount64());
-						return milliseconds;
-					};
-					const double current_time = MillisecondsNow();
-
-					bool reset_accumulating_state = false;
-					if ((state.accumulating_frame_count > 1) &&
-						((current_time - state.last_reset_time) > avg_timestamp_update_interval))
-					{
-						std::swap(state.displayed_timestamps, state.accumulating_timestamps);
-						for (uint32 i = 0; i < state.displayed_timestamps.size(); i++)
-						{
-							state.displayed_timestamps[i].sum /= state.accumulating_frame_count;
-						}
-						reset_accumulating_state = true;
-					}
-
-					reset_accumulating_state |= (state.accumulating_timestamps.size() != time_stamps.size());
-					if (reset_accumulating_state)
-					{
-						state.accumulating_timestamps.resize(0);
-						state.accumulating_timestamps.resize(time_stamps.size());
-						state.last_reset_time = current_time;
-						state.accumulating_frame_count = 0;
-					}
+					static GfxProfilerStatistics statistics[GFX_PROFILER_MAX_SCOPES];
+					if (show_statistics) g_GfxProfiler.GetStatistics(statistics);
 
 					float total_time_ms = 0.0f;
-					ImGui::BeginTable("Profiler", 2, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg);
+					uint32 const scope_count = profiler_frame ? profiler_frame->scope_count : 0;
+					ImGui::BeginTable("Profiler", show_statistics ? 6 : 2, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg);
 					ImGui::TableSetupColumn("Pass");
 					ImGui::TableSetupColumn("Time");
-					for (uint64 i = 0; i < time_stamps.size(); i++)
+					if (show_statistics)
 					{
+						ImGui::TableSetupColumn("Avg");
+						ImGui::TableSetupColumn("Min");
+						ImGui::TableSetupColumn("Max");
+						ImGui::TableSetupColumn("P95");
+					}
+					ImGui::TableHeadersRow();
+					for (uint32 i = 0; i < scope_count; i++)
+					{
+						GfxProfilerScope const& scope = profiler_frame->scopes[i];
 						ImGui::TableNextRow();
 
 						ImGui::TableSetColumnIndex(0);
-						ImGui::Text("%s", time_stamps[i].name.c_str());
+						ImGui::Text("%*s%s", scope.depth * 2, "", scope.name);
 						ImGui::TableSetColumnIndex(1);
-						ImGui::Text("%.2f ms", time_stamps[i].time_in_ms);
-						
-						if (state.show_average)
+						ImGui::Text("%.2f ms", scope.time_in_ms);
+						if (show_statistics)
 						{
-							if (state.displayed_timestamps.size() == time_stamps.size())
-							{
-								ImGui::SameLine();
-								ImGui::Text("  avg: %.2f ms", state.displayed_timestamps[i].sum);
-								ImGui::SameLine();	 
-								ImGui::Text("  min: %.2f ms", state.displayed_timestamps[i].minimum);
-								ImGui::SameLine();	 
-								ImGui::Text("  max: %.2f ms", state.displayed_timestamps[i].maximum);
-							}
-						
-							ProfilerState::AccumulatedTimeStamp* accumulating_timestamp = &state.accumulating_timestamps[i];
-							accumulating_timestamp->sum += time_stamps[i].time_in_ms;
-							accumulating_timestamp->minimum = std::min<float>(accumulating_timestamp->minimum, time_stamps[i].time_in_ms);
-							accumulating_timestamp->maximum = std::max<float>(accumulating_timestamp->maximum, time_stamps[i].time_in_ms);
+							ImGui::TableSetColumnIndex(2);
+							ImGui::Text("%.2f ms", statistics[i].avg_ms);
+							ImGui::TableSetColumnIndex(3);
+							ImGui::Text("%.2f ms", statistics[i].min_ms);
+							ImGui::TableSetColumnIndex(4);
+							ImGui::Text("%.2f ms", statistics[i].max_ms);
+							ImGui::TableSetColumnIndex(5);
+							ImGui::Text("%.2f ms", statistics[i].p95_ms);
 						}
-						total_time_ms += time_stamps[i].time_in_ms;
+						if (scope.parent < 0) total_time_ms += scope.time_in_ms;
 					}
 					ImGui::EndTable();
 					ImGui::Text("Total: %7.2f %s", total_time_ms, "ms");
-					state.accumulating_frame_count++;
 				}
 			}
 			static bool display_vram_usage = false;
@@ -1094,6 +1050,17 @@ namespace adria
 				else ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 255, 255, 255));
 				ImGui::TextWrapped(vram_display_string.c_str());
 				ImGui::PopStyleColor();
+
+				static constexpr char const* category_names[] = { "Textures", "Geometry", "Render Graph", "Other" };
+				static_assert(ARRAYSIZE(category_names) == (uint64)GfxMemoryCategory::Count);
+				for (uint32 i = 0; i < (uint32)GfxMemoryCategory::Count; ++i)
+				{
+					ImGui::Text("%-12s: %llu MB", category_names[i], g_GfxResidencyManager.GetCategoryUsage((GfxMemoryCategory)i) / 1024 / 1024);
+				}
+				if (g_TextureManager.HasStreamedTextures())
+				{
+					ImGui::Text("%-12s: %llu MB / %llu MB requested", "Streaming", g_TextureManager.GetStreamingResidentSize() / 1024 / 1024, g_TextureManager.GetStreamingRequestedSize() / 1024 / 1024);
+				}
 			}
 		}
 		ImGui::End();
@@ -1104,6 +1071,7 @@ namespace adria
 		if (ImGui::Begin(ICON_FA_FIRE" Shader Hot Reload", &visibility_flags[Flag_HotReload]))
 		{
 			if (ImGui::Button("Compile Changed Shaders")) reload_shaders = true;
+			if (ShaderManager::IsReloadInProgress()) ImGui::Text("Recompiling shaders...");
 		}
 		ImGui::End();
 	}
@@ -65,6 +65,10 @@ namespace adria
 		);
 		GFX_CHECK_HR(hr);
 		allocation.reset(alloc);
+		if (desc.resource_usage == GfxResourceUsage::Default)
+		{
+			residency_handle = g_GfxResidencyManager.Track(resource.Get(), allocation->GetSize());
+		}
 
 		if (desc.resource_usage == GfxResourceUsage::Readback)
 		{
@@ -106,6 +110,7 @@ namespace adria
 
 	GfxBuffer::~GfxBuffer()
 	{
+		g_GfxResidencyManager.Untrack(residency_handle);
 		if (mapped_data != nullptr)
 		{
 			ADRIA_ASSERT(resource != nullptr);
@@ -1,5 +1,6 @@
 #pragma once
 #include "GfxResourceCommon.h"
+#include "GfxResidencyManager.h"
 
 namespace adria
 {
@@ -58,12 +59,14 @@ namespace adria
 		void Update(T const& src_data);
 
 		void SetName(char const* name);
+		GfxResidencyHandle GetResidencyHandle() const { return residency_handle; }
 
 	private:
 		GfxDevice* gfx;
 		Ref<ID3D12Resource> resource;
 		GfxBufferDesc desc;
 		ReleasablePtr<D3D12MA::Allocation> allocation = nullptr;
+		GfxResidencyHandle residency_handle = INVALID_RESIDENCY_HANDLE;
 		void* mapped_data = nullptr;
 	};
 
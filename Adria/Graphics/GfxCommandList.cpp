@@ -10,12 +10,17 @@
 #include "GfxLinearDynamicAllocator.h"
 #include "GfxRayTracingShaderTable.h"
 #include "GfxStateObject.h"
+#include "Core/ConsoleManager.h"
 #include "Utilities/StringUtil.h"
 
 namespace adria
 {
+	static TAutoConsoleVariable<bool> FilterRedundantState("rhi.FilterRedundantState", true, "0: Every state change reaches the native command list. 1: Redundant state changes are dropped.");
+
 	namespace
 	{
+		constexpr uint64 INVALID_GPU_ADDRESS = UINT64_MAX;
+
 		constexpr D3D_PRIMITIVE_TOPOLOGY ToD3D12PrimitiveTopology(GfxPrimitiveTopology topology)
 		{
 			switch (topology)
@@ -144,6 +149,7 @@ namespace adria
 	void GfxCommandList::Begin()
 	{
 		cmd_list->Reset(cmd_allocator.Get(), nullptr);
+		stats = {};
 		ResetState();
 	}
 
@@ -200,6 +206,7 @@ namespace adria
 		current_state_object = nullptr;
 		current_rt_table.reset();
 		current_context = Context::Invalid;
+		InvalidateBoundState();
 
 		if (type == GfxCommandListType::Graphics || type == GfxCommandListType::Compute)
 		{
@@ -289,6 +296,20 @@ namespace adria
 		++command_count;
 	}
 
+	void GfxCommandList::DrawBatchesIndirect(GfxBuffer const& buffer, uint64 offset, uint32 count)
+	{
+		ADRIA_ASSERT(current_context == Context::Graphics);
+		if (count == 0) return;
+
+		DrawBatchIndirectSignature& signature = gfx->GetDrawBatchIndirectSignature();
+		cmd_list->ExecuteIndirect(signature, count, buffer.GetNative(), offset, nullptr, 0);
+		++command_count;
+
+		uint32 const slot = signature.GetRootParameterIndex();
+		if (slot < MAX_ROOT_PARAMETERS) graphics_root_args.root_constants_mask[slot] = 0;
+		ia_state.index_buffer_location = INVALID_GPU_ADDRESS;
+	}
+
 	void GfxCommandList::DispatchRays(uint32 dispatch_width, uint32 dispatch_height, uint32 dispatch_depth /*= 1*/)
 	{
 		D3D12_DISPATCH_RAYS_DESC dispatch_desc{};
@@ -610,9 +631,10 @@ namespace adria
 
 	void GfxCommandList::SetPipelineState(GfxPipelineState* state)
 	{
-		if (state != current_pso)
+		if (!FilterCall(state == current_pso))
 		{
 			current_pso = state;
+			current_state_object = nullptr;
 			if (state == nullptr)
 			{
 				cmd_list->SetPipelineState(nullptr);
@@ -631,6 +653,7 @@ namespace adria
 	{
 		if (state_object->d3d12_so != current_state_object)
 		{
+			current_pso = nullptr;
 			current_state_object = state_object->d3d12_so;
 			cmd_list->SetPipelineState1(state_object->d3d12_so.Get());
 			current_context = state_object->d3d12_so ? Context::Compute : Context::Invalid;
@@ -651,6 +674,8 @@ namespace adria
 
 	void GfxCommandList::SetTopology(GfxPrimitiveTopology topology)
 	{
+		if (FilterCall(ia_state.topology == topology)) return;
+		ia_state.topology = topology;
 		cmd_list->IASetPrimitiveTopology(ToD3D12PrimitiveTopology(topology));
 	}
 
@@ -658,6 +683,15 @@ namespace adria
 	{
 		ADRIA_ASSERT(current_context == Context::Graphics);
 
+		uint64 const buffer_location = index_buffer_view ? index_buffer_view->buffer_location : 0;
+		uint32 const size_in_bytes = index_buffer_view ? index_buffer_view->size_in_bytes : 0;
+		GfxFormat const format = index_buffer_view ? index_buffer_view->format : GfxFormat::UNKNOWN;
+		bool const redundant = ia_state.index_buffer_location == buffer_location && ia_state.index_buffer_size == size_in_bytes && ia_state.index_buffer_format == format;
+		if (FilterCall(redundant)) return;
+		ia_state.index_buffer_location = buffer_location;
+		ia_state.index_buffer_size = size_in_bytes;
+		ia_state.index_buffer_format = format;
+
 		if (index_buffer_view)
 		{
 			D3D12_INDEX_BUFFER_VIEW ibv{};
@@ -674,6 +708,8 @@ namespace adria
 
 	void GfxCommandList::SetVertexBuffer(GfxVertexBufferView const& vertex_buffer_view, uint32 start_slot /*= 0*/)
 	{
+		if (FilterCall(FilterVertexBuffers(&vertex_buffer_view, 1, start_slot))) return;
+
 		D3D12_VERTEX_BUFFER_VIEW vbv{};
 		vbv.BufferLocation = vertex_buffer_view.buffer_location;
 		vbv.SizeInBytes = vertex_buffer_view.size_in_bytes;
@@ -684,6 +720,7 @@ namespace adria
 	void GfxCommandList::SetVertexBuffers(std::span<GfxVertexBufferView const> vertex_buffer_views, uint32 start_slot /*= 0*/)
 	{
 		ADRIA_ASSERT(current_context == Context::Graphics);
+		if (FilterCall(FilterVertexBuffers(vertex_buffer_views.data(), (uint32)vertex_buffer_views.size(), start_slot))) return;
 
 		std::vector<D3D12_VERTEX_BUFFER_VIEW> vbs(vertex_buffer_views.size());
 		for (uint64 i = 0; i < vertex_buffer_views.size(); ++i)
@@ -715,6 +752,7 @@ namespace adria
 	void GfxCommandList::SetRootConstant(uint32 slot, uint32 data, uint32 offset)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (FilterCall(FilterRootConstants(slot, &data, 1, offset))) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -729,6 +767,7 @@ namespace adria
 	void GfxCommandList::SetRootConstants(uint32 slot, void const* data, uint32 data_size, uint32 offset)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (FilterCall(FilterRootConstants(slot, static_cast<uint32 const*>(data), data_size / sizeof(uint32), offset))) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -747,6 +786,8 @@ namespace adria
 		auto dynamic_allocator = gfx->GetDynamicAllocator();
 		GfxDynamicAllocation alloc = dynamic_allocator->Allocate(data_size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
 		alloc.Update(data, data_size);
+		std::ignore = FilterRootView(slot, alloc.gpu_address);
+		++stats.issued_calls;
 
 		if (current_context == Context::Graphics)
 		{
@@ -760,6 +801,8 @@ namespace adria
 
 	void GfxCommandList::SetRootCBV(uint32 slot, uint64 gpu_address)
 	{
+		if (FilterCall(FilterRootView(slot, gpu_address))) return;
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRootConstantBufferView(slot, gpu_address);
@@ -773,6 +816,7 @@ namespace adria
 	void GfxCommandList::SetRootSRV(uint32 slot, uint64 gpu_address)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (FilterCall(FilterRootView(slot, gpu_address))) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -787,6 +831,7 @@ namespace adria
 	void GfxCommandList::SetRootUAV(uint32 slot, uint64 gpu_address)
 	{
 		ADRIA_ASSERT(current_context != Context::Invalid);
+		if (FilterCall(FilterRootView(slot, gpu_address))) return;
 
 		if (current_context == Context::Graphics)
 		{
@@ -800,6 +845,9 @@ namespace adria
 
 	void GfxCommandList::SetRootDescriptorTable(uint32 slot, GfxDescriptor base_descriptor)
 	{
+		D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle = base_descriptor;
+		if (FilterCall(FilterRootView(slot, gpu_handle.ptr))) return;
+
 		if (current_context == Context::Graphics)
 		{
 			cmd_list->SetGraphicsRootDescriptorTable(slot, base_descriptor);
@@ -827,6 +875,12 @@ namespace adria
 		cmd_list->ClearDepthStencilView(dsv, d3d12_clear_flags, depth, stencil, 0, nullptr);
 	}
 
+	void GfxCommandList::ClearDepth(GfxDescriptor dsv, uint32 x, uint32 y, uint32 width, uint32 height, float depth /*= 1.0f*/)
+	{
+		D3D12_RECT rect = { (LONG)x, (LONG)y, LONG(x + width), LONG(y + height) };
+		cmd_list->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 1, &rect);
+	}
+
 	void GfxCommandList::SetRenderTargets(std::span<GfxDescriptor const> rtvs, GfxDescriptor const* dsv /*= nullptr*/, bool single_rt /*= false*/)
 	{
 		D3D12_CPU_DESCRIPTOR_HANDLE* d3d12_dsv = nullptr;
@@ -845,5 +899,72 @@ namespace adria
 		current_context = ctx;
 	}
 
+	void GfxCommandList::InvalidateBoundState()
+	{
+		for (RootArguments* root_args : { &graphics_root_args, &compute_root_args })
+		{
+			std::fill(std::begin(root_args->root_views), std::end(root_args->root_views), INVALID_GPU_ADDRESS);
+			std::fill(std::begin(root_args->root_constants_mask), std::end(root_args->root_constants_mask), uint8(0));
+		}
+		ia_state.topology = GfxPrimitiveTopology::Undefined;
+		ia_state.index_buffer_location = INVALID_GPU_ADDRESS;
+		ia_state.index_buffer_size = 0;
+		ia_state.index_buffer_format = GfxFormat::UNKNOWN;
+		std::fill(std::begin(ia_state.vertex_buffer_locations), std::end(ia_state.vertex_buffer_locations), INVALID_GPU_ADDRESS);
+	}
+
+	bool GfxCommandList::FilterRootView(uint32 slot, uint64 gpu_address)
+	{
+		if (slot >= MAX_ROOT_PARAMETERS) return false;
+		uint64& bound_address = GetRootArguments().root_views[slot];
+		if (bound_address == gpu_address) return true;
+		bound_address = gpu_address;
+		return false;
+	}
+
+	bool GfxCommandList::FilterRootConstants(uint32 slot, uint32 const* data, uint32 count, uint32 offset)
+	{
+		if (slot >= MAX_ROOT_PARAMETERS || offset + count > MAX_ROOT_CONSTANTS) return false;
+		RootArguments& root_args = GetRootArguments();
+		uint8 const range_mask = uint8(((1u << count) - 1) << offset);
+		bool redundant = (root_args.root_constants_mask[slot] & range_mask) == range_mask &&
+						 memcmp(&root_args.root_constants[slot][offset], data, count * sizeof(uint32)) == 0;
+		if (redundant) return true;
+		memcpy(&root_args.root_constants[slot][offset], data, count * sizeof(uint32));
+		root_args.root_constants_mask[slot] |= range_mask;
+		return false;
+	}
+
+	bool GfxCommandList::FilterVertexBuffers(GfxVertexBufferView const* views, uint32 count, uint32 start_slot)
+	{
+		if (start_slot + count > MAX_VERTEX_BUFFERS) return false;
+		bool redundant = true;
+		for (uint32 i = 0; i < count; ++i)
+		{
+			uint32 const slot = start_slot + i;
+			if (ia_state.vertex_buffer_locations[slot] != views[i].buffer_location ||
+				ia_state.vertex_buffer_sizes[slot] != views[i].size_in_bytes ||
+				ia_state.vertex_buffer_strides[slot] != views[i].stride_in_bytes)
+			{
+				redundant = false;
+				ia_state.vertex_buffer_locations[slot] = views[i].buffer_location;
+				ia_state.vertex_buffer_sizes[slot] = views[i].size_in_bytes;
+				ia_state.vertex_buffer_strides[slot] = views[i].stride_in_bytes;
+			}
+		}
+		return redundant;
+	}
+
+	bool GfxCommandList::FilterCall(bool redundant)
+	{
+		if (redundant && FilterRedundantState.Get())
+		{
+			++stats.filtered_calls;
+			return true;
+		}
+		++stats.issued_calls;
+		return false;
+	}
+
 }
 
@@ -27,8 +27,18 @@ namespace adria
 		Copy
 	};
 
+	struct GfxCommandListStats
+	{
+		uint32 issued_calls = 0;
+		uint32 filtered_calls = 0;
+	};
+
 	class GfxCommandList
 	{
+		static constexpr uint32 MAX_ROOT_PARAMETERS = 8;
+		static constexpr uint32 MAX_ROOT_CONSTANTS = 8;
+		static constexpr uint32 MAX_VERTEX_BUFFERS = 8;
+
 	public:
 		enum class Context
 		{
@@ -67,6 +77,7 @@ namespace adria
 		void DrawIndexedIndirect(GfxBuffer const& buffer, uint32 offset);
 		void DispatchIndirect(GfxBuffer const& buffer, uint32 offset);
 		void DispatchMeshIndirect(GfxBuffer const& buffer, uint32 offset);
+		void DrawBatchesIndirect(GfxBuffer const& buffer, uint64 offset, uint32 count);
 		void DispatchRays(uint32 dispatch_width, uint32 dispatch_height, uint32 dispatch_depth = 1);
 
 		void TextureBarrier(GfxTexture const& texture, GfxResourceState flags_before, GfxResourceState flags_after, uint32 subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
@@ -123,9 +134,26 @@ namespace adria
 
 		void ClearRenderTarget(GfxDescriptor rtv, float const* clear_color);
 		void ClearDepth(GfxDescriptor dsv, float depth = 1.0f, uint8 stencil = 0, bool clear_stencil = false);
+		void ClearDepth(GfxDescriptor dsv, uint32 x, uint32 y, uint32 width, uint32 height, float depth = 1.0f);
 		void SetRenderTargets(std::span<GfxDescriptor const> rtvs, GfxDescriptor const* dsv = nullptr, bool single_rt = false);
 
 		void SetContext(Context ctx);
+		GfxCommandListStats const& GetStats() const { return stats; }
+
+	private:
+		struct RootArguments
+		{
+			uint64 root_views[MAX_ROOT_PARAMETERS];
+			uint32 root_constants[MAX_ROOT_PARAMETERS][MAX_ROOT_CONSTANTS];
+			uint8  root_constants_mask[MAX_ROOT_PARAMETERS];
+		};
+
+		void InvalidateBoundState();
+		RootArguments& GetRootArguments() { return current_context == Context::Graphics ? graphics_root_args : compute_root_args; }
+		bool FilterRootView(uint32 slot, uint64 gpu_address);
+		bool FilterRootConstants(uint32 slot, uint32 const* data, uint32 count, uint32 offset);
+		bool FilterVertexBuffers(GfxVertexBufferView const* views, uint32 count, uint32 start_slot);
+		bool FilterCall(bool redundant);
 
 	private:
 		GfxDevice* gfx = nullptr;
@@ -143,6 +171,21 @@ namespace adria
 
 		Context current_context = Context::Invalid;
 
+		struct InputAssemblerState
+		{
+			GfxPrimitiveTopology topology;
+			uint64 index_buffer_location;
+			uint32 index_buffer_size;
+			GfxFormat index_buffer_format;
+			uint64 vertex_buffer_locations[MAX_VERTEX_BUFFERS];
+			uint32 vertex_buffer_sizes[MAX_VERTEX_BUFFERS];
+			uint32 vertex_buffer_strides[MAX_VERTEX_BUFFERS];
+		};
+		RootArguments graphics_root_args;
+		RootArguments compute_root_args;
+		InputAssemblerState ia_state;
+		GfxCommandListStats stats;
+
 		std::vector<std::pair<GfxFence&, uint64>> pending_waits;
 		std::vector<std::pair<GfxFence&, uint64>> pending_signals;
 
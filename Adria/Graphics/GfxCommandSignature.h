@@ -68,4 +68,44 @@ namespace adria
 	using DrawIndexedIndirectSignature	= IndirectCommandSignature<IndirectCommandType::DrawIndexed>;
 	using DispatchIndirectSignature		= IndirectCommandSignature<IndirectCommandType::Dispatch>;
 	using DispatchMeshIndirectSignature = IndirectCommandSignature<IndirectCommandType::DispatchMesh>;
+
+	#pragma pack(push, 4)
+	struct DrawBatchIndirectArgs
+	{
+		uint32 instance_offset;
+		D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+		D3D12_DRAW_INDEXED_ARGUMENTS draw_args;
+	};
+	#pragma pack(pop)
+
+	class DrawBatchIndirectSignature
+	{
+	public:
+		DrawBatchIndirectSignature(ID3D12Device* device, ID3D12RootSignature* root_signature, uint32 root_parameter_index, uint32 root_constant_offset)
+			: root_parameter_index(root_parameter_index)
+		{
+			D3D12_INDIRECT_ARGUMENT_DESC argument_descs[3]{};
+			argument_descs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			argument_descs[0].Constant.RootParameterIndex = root_parameter_index;
+			argument_descs[0].Constant.DestOffsetIn32BitValues = root_constant_offset;
+			argument_descs[0].Constant.Num32BitValuesToSet = 1;
+			argument_descs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+			argument_descs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+			D3D12_COMMAND_SIGNATURE_DESC desc{};
+			desc.NumArgumentDescs = ARRAYSIZE(argument_descs);
+			desc.pArgumentDescs = argument_descs;
+			desc.ByteStride = sizeof(DrawBatchIndirectArgs);
+			GFX_CHECK_HR(device->CreateCommandSignature(&desc, root_signature, IID_PPV_ARGS(cmd_signature.GetAddressOf())));
+		}
+		operator ID3D12CommandSignature* () const
+		{
+			return cmd_signature.Get();
+		}
+		uint32 GetRootParameterIndex() const { return root_parameter_index; }
+
+	private:
+		Ref<ID3D12CommandSignature> cmd_signature;
+		uint32 root_parameter_index;
+	};
 }
\ No newline at end of file
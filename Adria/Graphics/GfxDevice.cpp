@@ -368,6 +368,7 @@ namespace adria
 
 		SetInfoQueue();
 		CreateCommonRootSignature();
+		draw_batch_indirect_signature = std::make_unique<DrawBatchIndirectSignature>(device.Get(), global_root_signature.Get(), 1, 0);
 
 		std::atexit(ReportLiveObjects);
 		if (options.dred) dred = std::make_unique<DRED>(this);
@@ -413,6 +414,8 @@ namespace adria
 			dynamic_allocator_on_init.reset();
 		}
 
+		g_GfxResidencyManager.Update();
+
 		uint32 backbuffer_index = swapchain->GetBackbufferIndex();
 		gpu_descriptor_allocator->ReleaseCompletedFrames(frame_index);
 		dynamic_allocators[backbuffer_index]->Clear();
@@ -742,6 +745,11 @@ namespace adria
 	{
 		frequency = graphics_queue.GetTimestampFrequency();
 	}
+	void GfxDevice::GetClockCalibration(uint64& gpu_timestamp, uint64& cpu_timestamp) const
+	{
+		ID3D12CommandQueue* queue = graphics_queue;
+		GFX_CHECK_HR(queue->GetClockCalibration(&gpu_timestamp, &cpu_timestamp));
+	}
 	GPUMemoryUsage GfxDevice::GetMemoryUsage() const
 	{
 		GPUMemoryUsage gpu_memory_usage{};
@@ -170,12 +170,14 @@ namespace adria
 			GfxDescriptorHeapType type = GfxDescriptorHeapType::CBV_SRV_UAV);
 
 		void GetTimestampFrequency(uint64& frequency) const;
+		void GetClockCalibration(uint64& gpu_timestamp, uint64& cpu_timestamp) const;
 		GPUMemoryUsage GetMemoryUsage() const;
 
 		DrawIndirectSignature& GetDrawIndirectSignature() const { return *draw_indirect_signature;}
 		DrawIndexedIndirectSignature& GetDrawIndexedIndirectSignature() const { return *draw_indexed_indirect_signature;}
 		DispatchIndirectSignature& GetDispatchIndirectSignature() const { return *dispatch_indirect_signature;}
 		DispatchMeshIndirectSignature& GetDispatchMeshIndirectSignature() const { return *dispatch_mesh_indirect_signature;}
+		DrawBatchIndirectSignature& GetDrawBatchIndirectSignature() const { return *draw_batch_indirect_signature;}
 
 		static constexpr uint32 GetBackbufferCount()
 		{
@@ -238,6 +240,7 @@ namespace adria
 		std::unique_ptr<DrawIndexedIndirectSignature> draw_indexed_indirect_signature;
 		std::unique_ptr<DispatchIndirectSignature> dispatch_indirect_signature;
 		std::unique_ptr<DispatchMeshIndirectSignature> dispatch_mesh_indirect_signature;
+		std::unique_ptr<DrawBatchIndirectSignature> draw_batch_indirect_signature;
 
 		struct DRED
 		{
@@ -64,6 +64,7 @@ namespace adria
 		desc.size = page_size;
 		desc.resource_usage = GfxResourceUsage::Upload;
 		desc.bind_flags = GfxBindFlag::ShaderResource;
+		desc.misc_flags = GfxBufferMiscFlag::BufferRaw;
 
 		buffer = gfx->CreateBuffer(desc);
 		ADRIA_ASSERT(buffer->IsMapped());
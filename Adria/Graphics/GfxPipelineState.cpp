@@ -5,7 +5,9 @@
 #include "GfxShader.h"
 #include "GfxResourceCommon.h"
 #include "Rendering/ShaderManager.h"
+#include "Logging/Logger.h"
 #include "Utilities/HashUtil.h"
+#include "Utilities/ThreadPool.h"
 
 namespace adria
 {
@@ -325,14 +327,91 @@ namespace adria
 		}
 	}
 
+	namespace
+	{
+		//shader reloads can touch hundreds of pipelines, the rest of the pool is left to the per frame jobs
+		constexpr uint32 MAX_REBUILDS_IN_FLIGHT = 4;
+
+		std::vector<GfxPipelineState*> pending_rebuilds;
+	}
+
 	GfxPipelineState::operator ID3D12PipelineState* () const
 	{
 		return pso.Get();
 	}
 
+	bool GfxPipelineState::HasPendingRebuilds()
+	{
+		return !pending_rebuilds.empty();
+	}
+
+	void GfxPipelineState::SubmitPendingRebuilds()
+	{
+		uint32 rebuilds_in_flight = (uint32)std::count_if(pending_rebuilds.begin(), pending_rebuilds.end(), [](GfxPipelineState* pipeline_state) { return pipeline_state->pending_pso.valid(); });
+		for (GfxPipelineState* pipeline_state : pending_rebuilds)
+		{
+			if (rebuilds_in_flight == MAX_REBUILDS_IN_FLIGHT) break;
+			if (!pipeline_state->queued_build || pipeline_state->pending_pso.valid()) continue;
+			pipeline_state->pending_pso = g_ThreadPool.Submit(std::move(pipeline_state->queued_build));
+			pipeline_state->queued_build = nullptr;
+			++rebuilds_in_flight;
+		}
+	}
+
+	void GfxPipelineState::CommitPendingRebuilds()
+	{
+		bool rebuilds_done = true;
+		for (GfxPipelineState* pipeline_state : pending_rebuilds)
+		{
+			if (pipeline_state->pending_pso.valid() && pipeline_state->pending_pso.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				//failed builds keep the last good pipeline
+				if (Ref<ID3D12PipelineState> new_pso = pipeline_state->pending_pso.get()) pipeline_state->rebuilt_pso = std::move(new_pso);
+			}
+			if (pipeline_state->pending_pso.valid() || pipeline_state->queued_build) rebuilds_done = false;
+		}
+		SubmitPendingRebuilds();
+		if (!rebuilds_done) return;
+
+		//all pipelines of a reload are swapped in the same frame
+		for (GfxPipelineState* pipeline_state : pending_rebuilds)
+		{
+			if (!pipeline_state->rebuilt_pso) continue;
+			if (pipeline_state->pso) pipeline_state->gfx->AddToReleaseQueue(pipeline_state->pso.Detach());
+			pipeline_state->pso = std::move(pipeline_state->rebuilt_pso);
+		}
+		pending_rebuilds.clear();
+	}
+
+	void GfxPipelineState::CancelPendingRebuilds()
+	{
+		for (GfxPipelineState* pipeline_state : pending_rebuilds)
+		{
+			if (pipeline_state->pending_pso.valid()) pipeline_state->pending_pso.wait();
+			pipeline_state->pending_pso = {};
+			pipeline_state->queued_build = nullptr;
+			pipeline_state->rebuilt_pso = nullptr;
+		}
+		pending_rebuilds.clear();
+	}
+
+	GfxPipelineState::~GfxPipelineState()
+	{
+		std::erase(pending_rebuilds, this);
+	}
+
+	void GfxPipelineState::RebuildAsync(std::function<Ref<ID3D12PipelineState>()>&& build)
+	{
+		//a build that is already in flight may have read the old shaders, so the new one runs after it
+		if (std::find(pending_rebuilds.begin(), pending_rebuilds.end(), this) == pending_rebuilds.end()) pending_rebuilds.push_back(this);
+		queued_build = std::move(build);
+		SubmitPendingRebuilds();
+	}
+
 	GfxGraphicsPipelineState::GfxGraphicsPipelineState(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::Graphics), desc(desc)
 	{
-		Create(desc);
+		bool const result = Create(gfx, desc, pso);
+		ADRIA_ASSERT(result);
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxGraphicsPipelineState::OnShaderRecompiled, *this);
 	}
 	GfxGraphicsPipelineState::~GfxGraphicsPipelineState()
@@ -346,12 +425,17 @@ namespace adria
 		{
 			if (s == shaders[i])
 			{
-				Create(desc);
+				RebuildAsync([gfx = gfx, desc = desc]()
+					{
+						Ref<ID3D12PipelineState> new_pso;
+						std::ignore = Create(gfx, desc, new_pso);
+						return new_pso;
+					});
 				return;
 			}
 		}
 	}
-	void GfxGraphicsPipelineState::Create(GfxGraphicsPipelineStateDesc const& desc)
+	bool GfxGraphicsPipelineState::Create(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso)
 	{
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC d3d12_desc{};
 		d3d12_desc.pRootSignature = gfx->GetCommonRootSignature();
@@ -377,12 +461,18 @@ namespace adria
 		d3d12_desc.SampleMask = desc.sample_mask;
 		if (d3d12_desc.DSVFormat == DXGI_FORMAT_UNKNOWN) d3d12_desc.DepthStencilState.DepthEnable = false;
 		HRESULT hr = gfx->GetDevice()->CreateGraphicsPipelineState(&d3d12_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf()));
-		GFX_CHECK_HR(hr);
+		if (FAILED(hr))
+		{
+			ADRIA_LOG(ERROR, "CreateGraphicsPipelineState failed, keeping the previous pipeline state!");
+			return false;
+		}
+		return true;
 	}
 
 	GfxComputePipelineState::GfxComputePipelineState(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::Compute), desc(desc)
 	{
-		Create(desc);
+		bool const result = Create(gfx, desc, pso);
+		ADRIA_ASSERT(result);
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxComputePipelineState::OnShaderRecompiled, *this);
 	}
 	GfxComputePipelineState::~GfxComputePipelineState()
@@ -391,19 +481,34 @@ namespace adria
 	}
 	void GfxComputePipelineState::OnShaderRecompiled(GfxShaderKey const& s)
 	{
-		if (s == desc.CS) Create(desc);
+		if (s == desc.CS)
+		{
+			RebuildAsync([gfx = gfx, desc = desc]()
+				{
+					Ref<ID3D12PipelineState> new_pso;
+					std::ignore = Create(gfx, desc, new_pso);
+					return new_pso;
+				});
+		}
 	}
-	void GfxComputePipelineState::Create(GfxComputePipelineStateDesc const& desc)
+	bool GfxComputePipelineState::Create(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso)
 	{
 		D3D12_COMPUTE_PIPELINE_STATE_DESC d3d12_desc{};
 		d3d12_desc.pRootSignature = gfx->GetCommonRootSignature();
 		d3d12_desc.CS = GetGfxShader(desc.CS);
-		GFX_CHECK_HR(gfx->GetDevice()->CreateComputePipelineState(&d3d12_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf())));
+		HRESULT hr = gfx->GetDevice()->CreateComputePipelineState(&d3d12_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ADRIA_LOG(ERROR, "CreateComputePipelineState failed, keeping the previous pipeline state!");
+			return false;
+		}
+		return true;
 	}
 
 	GfxMeshShaderPipelineState::GfxMeshShaderPipelineState(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc) : GfxPipelineState(gfx, GfxPipelineStateType::MeshShader), desc(desc)
 	{
-		Create(desc);
+		bool const result = Create(gfx, desc, pso);
+		ADRIA_ASSERT(result);
 		event_handle = ShaderManager::GetShaderRecompiledEvent().AddMember(&GfxMeshShaderPipelineState::OnShaderRecompiled, *this);
 	}
 	GfxMeshShaderPipelineState::~GfxMeshShaderPipelineState()
@@ -412,9 +517,17 @@ namespace adria
 	}
 	void GfxMeshShaderPipelineState::OnShaderRecompiled(GfxShaderKey const& s)
 	{
-		if (s == desc.AS || s == desc.MS || s == desc.PS) Create(desc);
+		if (s == desc.AS || s == desc.MS || s == desc.PS)
+		{
+			RebuildAsync([gfx = gfx, desc = desc]()
+				{
+					Ref<ID3D12PipelineState> new_pso;
+					std::ignore = Create(gfx, desc, new_pso);
+					return new_pso;
+				});
+		}
 	}
-	void GfxMeshShaderPipelineState::Create(GfxMeshShaderPipelineStateDesc const& desc)
+	bool GfxMeshShaderPipelineState::Create(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso)
 	{
 		D3DX12_MESH_SHADER_PIPELINE_STATE_DESC d3d12_desc{};
 
@@ -441,7 +554,13 @@ namespace adria
 		stream_desc.pPipelineStateSubobjectStream = &pso_stream;
 		stream_desc.SizeInBytes = sizeof(pso_stream);
 
-		GFX_CHECK_HR(gfx->GetDevice()->CreatePipelineState(&stream_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf())));
+		HRESULT hr = gfx->GetDevice()->CreatePipelineState(&stream_desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ADRIA_LOG(ERROR, "CreatePipelineState failed, keeping the previous pipeline state!");
+			return false;
+		}
+		return true;
 	}
 
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <future>
 #include "GfxStates.h"
 #include "GfxShaderKey.h"
 #include "GfxInputLayout.h"
@@ -27,14 +28,28 @@ namespace adria
 		operator ID3D12PipelineState*() const;
 		GfxPipelineStateType GetType() const { return type; }
 
+		static bool HasPendingRebuilds();
+		static void CommitPendingRebuilds();
+		//waits for the rebuilds on the thread pool and drops them, call before the device and the shaders go away
+		static void CancelPendingRebuilds();
+
 	protected:
 		GfxPipelineState(GfxDevice* gfx, GfxPipelineStateType type) : gfx(gfx), type(type) {}
+		~GfxPipelineState();
+
+		void RebuildAsync(std::function<Ref<ID3D12PipelineState>()>&& build);
+
+	private:
+		static void SubmitPendingRebuilds();
 
 	protected:
 		GfxDevice* gfx;
 		Ref<ID3D12PipelineState> pso;
 		GfxPipelineStateType type;
 		DelegateHandle event_handle;
+		std::function<Ref<ID3D12PipelineState>()> queued_build;	//waiting for a free slot or for the build in flight, which read stale shaders
+		std::future<Ref<ID3D12PipelineState>> pending_pso;
+		Ref<ID3D12PipelineState> rebuilt_pso;
 	};
 
 	struct GfxGraphicsPipelineStateDesc
@@ -65,7 +80,7 @@ namespace adria
 		GfxGraphicsPipelineStateDesc desc;
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxGraphicsPipelineStateDesc const& desc);
+		static bool Create(GfxDevice* gfx, GfxGraphicsPipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso);
 	};
 
 	struct GfxComputePipelineStateDesc
@@ -84,7 +99,7 @@ namespace adria
 		
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxComputePipelineStateDesc const& desc);
+		static bool Create(GfxDevice* gfx, GfxComputePipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso);
 	};
 
 	struct GfxMeshShaderPipelineStateDesc
@@ -113,6 +128,6 @@ namespace adria
 
 	private:
 		void OnShaderRecompiled(GfxShaderKey const&);
-		void Create(GfxMeshShaderPipelineStateDesc const& desc);
+		static bool Create(GfxDevice* gfx, GfxMeshShaderPipelineStateDesc const& desc, Ref<ID3D12PipelineState>& pso);
 	};
 }
\ No newline at end of file
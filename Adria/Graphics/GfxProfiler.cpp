@@ -2,6 +2,7 @@
 #include <memory>
 #include <array>
 #include <string>
+#include <fstream>
 #if GFX_MULTITHREADED
 #include <mutex>
 #endif
@@ -11,34 +12,85 @@
 #include "GfxCommandList.h"
 #include "GfxQueryHeap.h"
 #include "GfxBuffer.h"
+#include "Utilities/HashUtil.h"
+#include "Logging/Logger.h"
 
 
 namespace adria
 {
+	namespace
+	{
+		double QueryCpuTimeMicroseconds()
+		{
+			static LARGE_INTEGER frequency = []() { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f; }();
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			return double(now.QuadPart) * 1000000.0 / double(frequency.QuadPart);
+		}
+
+		void WriteJsonString(std::ofstream& out, char const* str)
+		{
+			out << '"';
+			for (char const* c = str; *c; ++c)
+			{
+				if (*c == '"' || *c == '\\') out << '\\';
+				out << *c;
+			}
+			out << '"';
+		}
+
+		float Percentile(std::span<float> sorted_samples, float percentile)
+		{
+			uint64 index = uint64(percentile * (sorted_samples.size() - 1) + 0.5f);
+			return sorted_samples[index];
+		}
+	}
+
 	struct GfxProfiler::Impl
 	{
 		static constexpr uint64 FRAME_COUNT = GFX_BACKBUFFER_COUNT;
-		static constexpr uint64 MAX_PROFILES = 256;
+		static constexpr uint64 MAX_PROFILES = GFX_PROFILER_MAX_SCOPES;
+		static constexpr uint64 HISTORY_FRAMES = GFX_PROFILER_HISTORY_FRAMES;
 
 		struct QueryData
 		{
+			char name[GFX_PROFILER_MAX_NAME_LENGTH];
+			uint64 name_hash = 0;
+			int32 parent = -1;
+			uint32 depth = 0;
 			bool query_started = false;
 			bool query_finished = false;
 			GfxCommandList* cmd_list = nullptr;
 		};
 
+		struct PendingFrame
+		{
+			std::array<QueryData, MAX_PROFILES> query_data;
+			uint32 scope_count = 0;
+			uint64 frame_number = 0;
+			double cpu_begin_us = 0.0;
+			uint64 gpu_calibration = 0;
+			double cpu_calibration_us = 0.0;
+		};
+
 		GfxDevice* gfx = nullptr;
 		std::unique_ptr<GfxQueryHeap> query_heap;
 		std::unique_ptr<GfxBuffer> query_readback_buffer;
 
-		std::array<QueryData, MAX_PROFILES> query_data;
-		std::unordered_map<std::string, uint32> name_to_index_map;
+		std::array<PendingFrame, FRAME_COUNT> pending_frames;
+		PendingFrame* current_frame = nullptr;
+		uint64 current_slot = 0;
+		uint64 frame_number = 0;
+
+		std::unique_ptr<GfxProfilerFrame[]> history;
+		uint32 history_head = 0;
+		uint32 history_count = 0;
+
+		uint64 gpu_frequency = 0;
+		uint64 cpu_frequency = 0;
 
 #if GFX_MULTITHREADED
-		mutable std::mutex map_mutex;
-		std::atomic_uint scope_counter = 0;
-#else
-		uint32 scope_counter = 0;
+		mutable std::mutex scope_mutex;
 #endif
 
 		void Init(GfxDevice* _gfx)
@@ -50,101 +102,229 @@ namespace adria
 			query_heap_desc.count = MAX_PROFILES * 2;
 			query_heap_desc.type = GfxQueryType::Timestamp;
 			query_heap = gfx->CreateQueryHeap(query_heap_desc);
+
+			history = std::make_unique<GfxProfilerFrame[]>(HISTORY_FRAMES);
+			gfx->GetTimestampFrequency(gpu_frequency);
+			LARGE_INTEGER qpc_frequency;
+			QueryPerformanceFrequency(&qpc_frequency);
+			cpu_frequency = qpc_frequency.QuadPart;
 		}
 		void Destroy()
 		{
 			query_heap.reset();
 			query_readback_buffer.reset();
+			history.reset();
+			current_frame = nullptr;
 			gfx = nullptr;
 		}
 		void NewFrame()
 		{
-			for (auto& profile_data : query_data)
+			current_slot = gfx->GetBackbufferIndex();
+			PendingFrame& pending_frame = pending_frames[current_slot];
+			if (pending_frame.scope_count > 0)
 			{
+				ResolveFrame(pending_frame, current_slot);
+			}
+
+			for (uint32 i = 0; i < pending_frame.scope_count; ++i)
+			{
+				QueryData& profile_data = pending_frame.query_data[i];
 				profile_data.query_started = profile_data.query_finished = false;
 				profile_data.cmd_list = nullptr;
 			}
-			name_to_index_map.clear();
-			scope_counter = 0;
+			pending_frame.scope_count = 0;
+			pending_frame.frame_number = frame_number++;
+			pending_frame.cpu_begin_us = QueryCpuTimeMicroseconds();
+
+			uint64 cpu_calibration = 0;
+			gfx->GetClockCalibration(pending_frame.gpu_calibration, cpu_calibration);
+			pending_frame.cpu_calibration_us = double(cpu_calibration) * 1000000.0 / double(cpu_frequency);
+			current_frame = &pending_frame;
 		}
 		void BeginProfileScope(GfxCommandList* cmd_list, char const* name)
 		{
-			uint32 profile_index = scope_counter++;
 #if GFX_MULTITHREADED
+			std::lock_guard lock(scope_mutex);
+#endif
+			PendingFrame& frame = *current_frame;
+			if (frame.scope_count >= MAX_PROFILES)
 			{
-				std::scoped_lock(map_mutex);
-				name_to_index_map[name] = profile_index;
+				ADRIA_LOG(WARNING, "GPU profiler scope limit (%u) reached, scope %s is not profiled", (uint32)MAX_PROFILES, name);
+				return;
 			}
-#else
-			name_to_index_map[name] = profile_index;
-#endif
-			QueryData& profile_data = query_data[profile_index];
+
+			uint32 profile_index = frame.scope_count++;
+			QueryData& profile_data = frame.query_data[profile_index];
 			ADRIA_ASSERT(profile_data.query_started == false);
 			ADRIA_ASSERT(profile_data.query_finished == false);
+
+			strncpy_s(profile_data.name, name, _TRUNCATE);
+			profile_data.name_hash = crc64(name, strlen(name));
+			profile_data.parent = FindOpenScope(frame, profile_index, [cmd_list](QueryData const& data) { return data.cmd_list == cmd_list; });
+			profile_data.depth = profile_data.parent >= 0 ? frame.query_data[profile_data.parent].depth + 1 : 0;
+			profile_data.cmd_list = cmd_list;
+			profile_data.query_started = true;
+
 			uint32 begin_query_index = uint32(profile_index * 2);
 			cmd_list->BeginQuery(*query_heap, begin_query_index);
-			profile_data.query_started = true;
-			profile_data.cmd_list = cmd_list;
 		}
 		void EndProfileScope(char const* name)
 		{
-			uint32 profile_index = -1;
 #if GFX_MULTITHREADED
-			{
-				std::scoped_lock(map_mutex);
-				profile_index = name_to_index_map[name];
-			}
-#else
-			profile_index = name_to_index_map[name];
+			std::lock_guard lock(scope_mutex);
 #endif
-			ADRIA_ASSERT(profile_index != uint32(-1));
-			QueryData& profile_data = query_data[profile_index];
+			PendingFrame& frame = *current_frame;
+			uint64 const name_hash = crc64(name, strlen(name));
+			int32 const profile_index = FindOpenScope(frame, frame.scope_count, [name_hash](QueryData const& data) { return data.name_hash == name_hash; });
+			if (profile_index < 0) return;
+
+			QueryData& profile_data = frame.query_data[profile_index];
 			ADRIA_ASSERT(profile_data.query_started == true);
 			ADRIA_ASSERT(profile_data.query_finished == false);
 			uint32 begin_query_index = uint32(profile_index * 2);
 			uint32 end_query_index = uint32(profile_index * 2 + 1);
 			profile_data.cmd_list->EndQuery(*query_heap, end_query_index);
+
+			uint64 readback_offset = ((current_slot * MAX_PROFILES * 2) + begin_query_index) * sizeof(uint64);
+			profile_data.cmd_list->ResolveQueryData(*query_heap, begin_query_index, 2, *query_readback_buffer, readback_offset);
 			profile_data.query_finished = true;
 		}
-		std::vector<GfxTimestamp> GetResults()
+
+		GfxProfilerFrame const* GetFrame(uint32 frames_ago) const
+		{
+			if (frames_ago >= history_count) return nullptr;
+			uint32 index = (history_head + HISTORY_FRAMES - 1 - frames_ago) % HISTORY_FRAMES;
+			return &history[index];
+		}
+
+		void GetStatistics(std::span<GfxProfilerStatistics> statistics) const
 		{
-			uint64 gpu_frequency = 0;
-			gfx->GetTimestampFrequency(gpu_frequency);
-			uint64 current_backbuffer_index = gfx->GetBackbufferIndex();
-			for (auto const& [_, index] : name_to_index_map)
+			GfxProfilerFrame const* latest_frame = GetFrame(0);
+			if (!latest_frame) return;
+
+			std::array<float, HISTORY_FRAMES> samples{};
+			uint32 const scope_count = std::min<uint32>(latest_frame->scope_count, (uint32)statistics.size());
+			for (uint32 i = 0; i < scope_count; ++i)
 			{
-				ADRIA_ASSERT(index < MAX_PROFILES);
-				QueryData& profile_data = query_data[index];
-				if (profile_data.query_started && profile_data.query_finished)
+				GfxProfilerScope const& scope = latest_frame->scopes[i];
+				uint32 sample_count = 0;
+				for (uint32 j = 0; j < history_count; ++j)
 				{
-					uint32 begin_query_index = uint32(index * 2);
-					uint32 end_query_index = uint32(index * 2 + 1);
-					uint64 readback_offset = ((current_backbuffer_index * MAX_PROFILES * 2) + begin_query_index) * sizeof(uint64);
-					ADRIA_ASSERT(profile_data.cmd_list);
-					profile_data.cmd_list->ResolveQueryData(*query_heap, begin_query_index, 2, *query_readback_buffer, readback_offset);
+					GfxProfilerFrame const* frame = GetFrame(j);
+					int32 const match = FindScope(*frame, scope, i);
+					if (match >= 0) samples[sample_count++] = frame->scopes[match].time_in_ms;
 				}
+
+				std::span<float> scope_samples(samples.data(), sample_count);
+				std::sort(scope_samples.begin(), scope_samples.end());
+				float sum = 0.0f;
+				for (float sample : scope_samples) sum += sample;
+
+				GfxProfilerStatistics& scope_statistics = statistics[i];
+				scope_statistics.sample_count = sample_count;
+				scope_statistics.min_ms = scope_samples.front();
+				scope_statistics.max_ms = scope_samples.back();
+				scope_statistics.avg_ms = sum / sample_count;
+				scope_statistics.p50_ms = Percentile(scope_samples, 0.50f);
+				scope_statistics.p95_ms = Percentile(scope_samples, 0.95f);
+				scope_statistics.p99_ms = Percentile(scope_samples, 0.99f);
 			}
-			uint64 const* query_timestamps = query_readback_buffer->GetMappedData<uint64>();
-			uint64 const* frame_query_timestamps = query_timestamps + (current_backbuffer_index * MAX_PROFILES * 2);
+		}
 
-			std::vector<GfxTimestamp> results{};
-			results.reserve(name_to_index_map.size());
-			for (auto const& [name, index] : name_to_index_map)
+		bool ExportTrace(char const* trace_file) const
+		{
+			std::ofstream out(trace_file);
+			if (!out)
 			{
-				ADRIA_ASSERT(index < MAX_PROFILES);
-				QueryData& profile_data = query_data[index];
-				if (profile_data.query_started && profile_data.query_finished)
-				{
-					uint64 start_time = frame_query_timestamps[index * 2 + 0];
-					uint64 end_time = frame_query_timestamps[index * 2 + 1];
+				ADRIA_LOG(WARNING, "Could not open %s for writing the GPU trace", trace_file);
+				return false;
+			}
+
+			GfxProfilerFrame const* oldest_frame = GetFrame(history_count - 1);
+			double const base_us = oldest_frame ? oldest_frame->cpu_begin_us : 0.0;
 
-					uint64 delta = end_time - start_time;
-					float frequency = float(gpu_frequency);
-					float time_ms = (delta / frequency) * 1000.0f;
-					results.emplace_back(time_ms, name);
+			out << "{\"traceEvents\":[\n";
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU Frame\"}},\n";
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+			for (uint32 j = history_count; j-- > 0;)
+			{
+				GfxProfilerFrame const* frame = GetFrame(j);
+				GfxProfilerFrame const* next_frame = j > 0 ? GetFrame(j - 1) : nullptr;
+				if (next_frame)
+				{
+					out << ",\n{\"name\":\"Frame " << frame->frame_number << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << frame->cpu_begin_us - base_us
+						<< ",\"dur\":" << next_frame->cpu_begin_us - frame->cpu_begin_us << "}";
 				}
+				for (uint32 i = 0; i < frame->scope_count; ++i)
+				{
+					GfxProfilerScope const& scope = frame->scopes[i];
+					out << ",\n{\"name\":";
+					WriteJsonString(out, scope.name);
+					out << ",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":" << scope.begin_us - base_us << ",\"dur\":" << scope.end_us - scope.begin_us
+						<< ",\"args\":{\"frame\":" << frame->frame_number << "}}";
+				}
+			}
+			out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+			return true;
+		}
+
+	private:
+		template<typename PredicateT>
+		int32 FindOpenScope(PendingFrame const& frame, uint32 scope_count, PredicateT&& predicate) const
+		{
+			for (int32 i = int32(scope_count) - 1; i >= 0; --i)
+			{
+				QueryData const& data = frame.query_data[i];
+				if (data.query_started && !data.query_finished && predicate(data)) return i;
+			}
+			return -1;
+		}
+
+		static int32 FindScope(GfxProfilerFrame const& frame, GfxProfilerScope const& scope, uint32 hint)
+		{
+			auto Matches = [&scope](GfxProfilerScope const& other) { return other.name_hash == scope.name_hash && other.depth == scope.depth; };
+			if (hint < frame.scope_count && Matches(frame.scopes[hint])) return int32(hint);
+			for (uint32 i = 0; i < frame.scope_count; ++i)
+			{
+				if (Matches(frame.scopes[i])) return int32(i);
 			}
-			return results;
+			return -1;
+		}
+
+		void ResolveFrame(PendingFrame const& pending_frame, uint64 slot)
+		{
+			uint64 const* query_timestamps = query_readback_buffer->GetMappedData<uint64>();
+			uint64 const* frame_query_timestamps = query_timestamps + (slot * MAX_PROFILES * 2);
+
+			GfxProfilerFrame& frame = history[history_head];
+			frame.frame_number = pending_frame.frame_number;
+			frame.cpu_begin_us = pending_frame.cpu_begin_us;
+			frame.scope_count = 0;
+
+			std::array<int32, MAX_PROFILES> remap;
+			double const ticks_to_us = 1000000.0 / double(gpu_frequency);
+			for (uint32 i = 0; i < pending_frame.scope_count; ++i)
+			{
+				QueryData const& profile_data = pending_frame.query_data[i];
+				remap[i] = -1;
+				if (!profile_data.query_started || !profile_data.query_finished) continue;
+
+				uint64 start_time = frame_query_timestamps[i * 2 + 0];
+				uint64 end_time = frame_query_timestamps[i * 2 + 1];
+
+				remap[i] = int32(frame.scope_count);
+				GfxProfilerScope& scope = frame.scopes[frame.scope_count++];
+				memcpy(scope.name, profile_data.name, sizeof(scope.name));
+				scope.name_hash = profile_data.name_hash;
+				scope.parent = profile_data.parent >= 0 ? remap[profile_data.parent] : -1;
+				scope.depth = profile_data.depth;
+				scope.begin_us = pending_frame.cpu_calibration_us + double(int64(start_time - pending_frame.gpu_calibration)) * ticks_to_us;
+				scope.end_us = pending_frame.cpu_calibration_us + double(int64(end_time - pending_frame.gpu_calibration)) * ticks_to_us;
+				scope.time_in_ms = float(double(end_time - start_time) * ticks_to_us / 1000.0);
+			}
+
+			history_head = (history_head + 1) % HISTORY_FRAMES;
+			history_count = std::min<uint32>(history_count + 1, HISTORY_FRAMES);
 		}
 	};
 
@@ -175,9 +355,24 @@ namespace adria
 		pimpl->EndProfileScope(name);
 	}
 
-	std::vector<GfxTimestamp> GfxProfiler::GetResults()
+	uint32 GfxProfiler::GetFrameCount() const
+	{
+		return pimpl->history_count;
+	}
+
+	GfxProfilerFrame const* GfxProfiler::GetFrame(uint32 frames_ago) const
+	{
+		return pimpl->GetFrame(frames_ago);
+	}
+
+	void GfxProfiler::GetStatistics(std::span<GfxProfilerStatistics> statistics) const
+	{
+		pimpl->GetStatistics(statistics);
+	}
+
+	bool GfxProfiler::ExportTrace(char const* trace_file) const
 	{
-		return pimpl->GetResults();
+		return pimpl->ExportTrace(trace_file);
 	}
 
 	GfxProfiler::GfxProfiler() {}
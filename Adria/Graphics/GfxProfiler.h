@@ -1,15 +1,44 @@
 #pragma once
 #include <memory>
+#include <span>
 #include "GfxDefines.h"
 #include "Utilities/Singleton.h"
 
 
 namespace adria
 {
-	struct GfxTimestamp
+	inline constexpr uint32 GFX_PROFILER_MAX_SCOPES = 256;
+	inline constexpr uint32 GFX_PROFILER_HISTORY_FRAMES = 128;
+	inline constexpr uint32 GFX_PROFILER_MAX_NAME_LENGTH = 64;
+
+	struct GfxProfilerScope
 	{
+		char name[GFX_PROFILER_MAX_NAME_LENGTH];
+		uint64 name_hash;
+		int32 parent;
+		uint32 depth;
 		float time_in_ms;
-		std::string name;
+		double begin_us;
+		double end_us;
+	};
+
+	struct GfxProfilerFrame
+	{
+		uint64 frame_number;
+		double cpu_begin_us;
+		uint32 scope_count;
+		GfxProfilerScope scopes[GFX_PROFILER_MAX_SCOPES];
+	};
+
+	struct GfxProfilerStatistics
+	{
+		float min_ms;
+		float max_ms;
+		float avg_ms;
+		float p50_ms;
+		float p95_ms;
+		float p99_ms;
+		uint32 sample_count;
 	};
 
 	class GfxDevice;
@@ -30,7 +59,12 @@ namespace adria
 		void NewFrame();
 		void BeginProfileScope(GfxCommandList* cmd_list, char const* name);
 		void EndProfileScope(char const* name);
-		std::vector<GfxTimestamp> GetResults();
+
+		uint32 GetFrameCount() const;
+		GfxProfilerFrame const* GetFrame(uint32 frames_ago) const;
+		GfxProfilerFrame const* GetLatestFrame() const { return GetFrame(0); }
+		void GetStatistics(std::span<GfxProfilerStatistics> statistics) const;
+		bool ExportTrace(char const* trace_file) const;
 
 	private:
 		std::unique_ptr<Impl> pimpl;
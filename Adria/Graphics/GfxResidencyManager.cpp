@@ -0,0 +1,201 @@
+#include "GfxResidencyManager.h"
+#include "GfxDevice.h"
+#include "Core/ConsoleManager.h"
+#include "Logging/Logger.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<int> MemoryBudget("rhi.MemoryBudget", 0, "GPU memory budget in MB, 0 uses the budget reported by the OS");
+
+	namespace
+	{
+		constexpr D3D12_RESIDENCY_PRIORITY ToD3D12ResidencyPriority(GfxResidencyPriority priority)
+		{
+			switch (priority)
+			{
+			case GfxResidencyPriority::Minimum: return D3D12_RESIDENCY_PRIORITY_MINIMUM;
+			case GfxResidencyPriority::Low:		return D3D12_RESIDENCY_PRIORITY_LOW;
+			case GfxResidencyPriority::Normal:	return D3D12_RESIDENCY_PRIORITY_NORMAL;
+			case GfxResidencyPriority::High:	return D3D12_RESIDENCY_PRIORITY_HIGH;
+			case GfxResidencyPriority::Maximum: return D3D12_RESIDENCY_PRIORITY_MAXIMUM;
+			}
+			return D3D12_RESIDENCY_PRIORITY_NORMAL;
+		}
+		constexpr char const* ToString(GfxMemoryPressure pressure)
+		{
+			switch (pressure)
+			{
+			case GfxMemoryPressure::None:	  return "None";
+			case GfxMemoryPressure::Moderate: return "Moderate";
+			case GfxMemoryPressure::Critical: return "Critical";
+			}
+			return "Unknown";
+		}
+	}
+
+	void GfxResidencyManager::Initialize(GfxDevice* _gfx)
+	{
+		gfx = _gfx;
+		MemoryBudget->AddOnChanged(ConsoleVariableDelegate::CreateLambda([this](IConsoleVariable* cvar)
+			{
+				SetBudget(uint64(std::max(cvar->GetInt(), 0)) * 1024 * 1024);
+			}));
+	}
+
+	void GfxResidencyManager::Destroy()
+	{
+		std::lock_guard lock(allocation_mutex);
+		allocations.clear();
+		memset(category_usage, 0, sizeof(category_usage));
+		memory_pressure_event.RemoveAll();
+		gfx = nullptr;
+	}
+
+	GfxResidencyHandle GfxResidencyManager::Track(ID3D12Pageable* pageable, uint64 size)
+	{
+		std::lock_guard lock(allocation_mutex);
+		GfxResidencyHandle handle = ++current_handle;
+		Allocation& allocation = allocations[handle];
+		allocation.pageable = pageable;
+		allocation.size = size;
+		allocation.last_used_frame = frame_index;
+		category_usage[(uint32)allocation.category] += size;
+		return handle;
+	}
+
+	void GfxResidencyManager::Untrack(GfxResidencyHandle handle)
+	{
+		std::lock_guard lock(allocation_mutex);
+		if (auto it = allocations.find(handle); it != allocations.end())
+		{
+			category_usage[(uint32)it->second.category] -= it->second.size;
+			allocations.erase(it);
+		}
+	}
+
+	void GfxResidencyManager::SetCategory(GfxResidencyHandle handle, GfxMemoryCategory category)
+	{
+		std::lock_guard lock(allocation_mutex);
+		if (auto it = allocations.find(handle); it != allocations.end())
+		{
+			Allocation& allocation = it->second;
+			category_usage[(uint32)allocation.category] -= allocation.size;
+			category_usage[(uint32)category] += allocation.size;
+			allocation.category = category;
+		}
+	}
+
+	void GfxResidencyManager::SetPriority(GfxResidencyHandle handle, GfxResidencyPriority priority)
+	{
+		std::lock_guard lock(allocation_mutex);
+		if (auto it = allocations.find(handle); it != allocations.end())
+		{
+			it->second.priority = priority;
+			ApplyResidencyPriority(it->second);
+		}
+	}
+
+	void GfxResidencyManager::SetEvictionCallback(GfxResidencyHandle handle, GfxEvictionCallback&& callback)
+	{
+		std::lock_guard lock(allocation_mutex);
+		if (auto it = allocations.find(handle); it != allocations.end())
+		{
+			it->second.eviction_callback = std::move(callback);
+			it->second.eviction_requested = false;
+		}
+	}
+
+	void GfxResidencyManager::Touch(GfxResidencyHandle handle)
+	{
+		std::lock_guard lock(allocation_mutex);
+		if (auto it = allocations.find(handle); it != allocations.end())
+		{
+			it->second.last_used_frame = frame_index;
+			it->second.eviction_requested = false;
+		}
+	}
+
+	void GfxResidencyManager::Update()
+	{
+		if (!gfx) return;
+		Update(gfx->GetMemoryUsage());
+	}
+
+	void GfxResidencyManager::Update(GPUMemoryUsage const& memory_usage)
+	{
+		++frame_index;
+		current_budget = budget_override > 0 ? budget_override : memory_usage.budget;
+		if (current_budget == 0) return;
+
+		uint64 usage = memory_usage.usage;
+		GfxMemoryPressure new_memory_pressure = GfxMemoryPressure::None;
+		if (usage > current_budget) new_memory_pressure = GfxMemoryPressure::Critical;
+		else if (usage > uint64(current_budget * MODERATE_PRESSURE_THRESHOLD)) new_memory_pressure = GfxMemoryPressure::Moderate;
+
+		if (new_memory_pressure != GfxMemoryPressure::None)
+		{
+			uint64 const target_usage = uint64(current_budget * EVICTION_TARGET);
+			uint64 const evicted_bytes = EvictAllocations(usage - target_usage);
+			if (evicted_bytes > 0)
+			{
+				ADRIA_LOG(INFO, "Memory usage %llu MB is over the budget target, requested eviction of %llu MB", usage / (1024 * 1024), evicted_bytes / (1024 * 1024));
+			}
+		}
+
+		if (new_memory_pressure != memory_pressure)
+		{
+			if (new_memory_pressure > memory_pressure)
+			{
+				ADRIA_LOG(WARNING, "GPU memory pressure changed to %s (%llu MB / %llu MB)", ToString(new_memory_pressure), usage / (1024 * 1024), current_budget / (1024 * 1024));
+			}
+			memory_pressure = new_memory_pressure;
+			memory_pressure_event.Broadcast(memory_pressure);
+		}
+	}
+
+	void GfxResidencyManager::ApplyResidencyPriority(Allocation const& allocation)
+	{
+		if (!gfx || !allocation.pageable) return;
+		ID3D12Pageable* pageable = allocation.pageable;
+		D3D12_RESIDENCY_PRIORITY priority = ToD3D12ResidencyPriority(allocation.priority);
+		gfx->GetDevice()->SetResidencyPriority(1, &pageable, &priority);
+	}
+
+	uint64 GfxResidencyManager::EvictAllocations(uint64 bytes_to_free)
+	{
+		std::vector<std::pair<uint64, GfxEvictionCallback>> evicted_allocations;
+		{
+			std::lock_guard lock(allocation_mutex);
+			std::vector<Allocation*> candidates;
+			for (auto& [handle, allocation] : allocations)
+			{
+				if (!allocation.eviction_callback || allocation.eviction_requested) continue;
+				if (allocation.last_used_frame + MIN_IDLE_FRAMES_FOR_EVICTION > frame_index) continue;
+				candidates.push_back(&allocation);
+			}
+			std::sort(candidates.begin(), candidates.end(), [](Allocation const* a, Allocation const* b)
+				{
+					if (a->priority != b->priority) return a->priority < b->priority;
+					if (a->last_used_frame != b->last_used_frame) return a->last_used_frame < b->last_used_frame;
+					return a->size > b->size;
+				});
+
+			uint64 freed_bytes = 0;
+			for (Allocation* allocation : candidates)
+			{
+				if (freed_bytes >= bytes_to_free) break;
+				allocation->eviction_requested = true;
+				evicted_allocations.emplace_back(allocation->size, allocation->eviction_callback);
+				freed_bytes += allocation->size;
+			}
+		}
+
+		uint64 evicted_bytes = 0;
+		for (auto& [size, callback] : evicted_allocations)
+		{
+			evicted_bytes += size;
+			callback();
+		}
+		return evicted_bytes;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <mutex>
+#include "Utilities/Singleton.h"
+#include "Utilities/Delegate.h"
+
+namespace adria
+{
+	class GfxDevice;
+	struct GPUMemoryUsage;
+
+	enum class GfxMemoryCategory : uint8
+	{
+		Texture,
+		Geometry,
+		RenderGraph,
+		Other,
+		Count
+	};
+
+	enum class GfxResidencyPriority : uint8
+	{
+		Minimum,
+		Low,
+		Normal,
+		High,
+		Maximum
+	};
+
+	enum class GfxMemoryPressure : uint8
+	{
+		None,
+		Moderate,
+		Critical
+	};
+
+	using GfxResidencyHandle = uint64;
+	inline constexpr GfxResidencyHandle INVALID_RESIDENCY_HANDLE = 0;
+	using GfxEvictionCallback = std::function<void()>;
+
+	DECLARE_MULTICAST_DELEGATE(GfxMemoryPressureEvent, GfxMemoryPressure)
+
+	class GfxResidencyManager : public Singleton<GfxResidencyManager>
+	{
+		friend class Singleton<GfxResidencyManager>;
+
+		struct Allocation
+		{
+			ID3D12Pageable* pageable = nullptr;
+			uint64 size = 0;
+			uint64 last_used_frame = 0;
+			GfxMemoryCategory category = GfxMemoryCategory::Other;
+			GfxResidencyPriority priority = GfxResidencyPriority::Normal;
+			GfxEvictionCallback eviction_callback = nullptr;
+			bool eviction_requested = false;
+		};
+
+	public:
+		static constexpr float MODERATE_PRESSURE_THRESHOLD = 0.9f;
+		static constexpr float EVICTION_TARGET = 0.85f;
+		static constexpr uint64 MIN_IDLE_FRAMES_FOR_EVICTION = 3;
+
+		void Initialize(GfxDevice* gfx);
+		void Destroy();
+
+		GfxResidencyHandle Track(ID3D12Pageable* pageable, uint64 size);
+		void Untrack(GfxResidencyHandle handle);
+
+		void SetCategory(GfxResidencyHandle handle, GfxMemoryCategory category);
+		void SetPriority(GfxResidencyHandle handle, GfxResidencyPriority priority);
+		void SetEvictionCallback(GfxResidencyHandle handle, GfxEvictionCallback&& callback);
+		void Touch(GfxResidencyHandle handle);
+
+		void Update();
+		void Update(GPUMemoryUsage const& memory_usage);
+
+		void SetBudget(uint64 budget_in_bytes) { budget_override = budget_in_bytes; }
+		uint64 GetBudget() const { return current_budget; }
+		uint64 GetCategoryUsage(GfxMemoryCategory category) const { return category_usage[(uint32)category]; }
+		GfxMemoryPressure GetMemoryPressure() const { return memory_pressure; }
+		GfxMemoryPressureEvent& GetMemoryPressureEvent() { return memory_pressure_event; }
+
+	private:
+		GfxDevice* gfx = nullptr;
+		mutable std::mutex allocation_mutex;
+		std::unordered_map<GfxResidencyHandle, Allocation> allocations;
+		GfxResidencyHandle current_handle = INVALID_RESIDENCY_HANDLE;
+		uint64 category_usage[(uint32)GfxMemoryCategory::Count] = {};
+		uint64 frame_index = 0;
+		uint64 budget_override = 0;
+		uint64 current_budget = 0;
+		GfxMemoryPressure memory_pressure = GfxMemoryPressure::None;
+		GfxMemoryPressureEvent memory_pressure_event;
+
+	private:
+		GfxResidencyManager() = default;
+		~GfxResidencyManager() = default;
+
+		void ApplyResidencyPriority(Allocation const& allocation);
+		uint64 EvictAllocations(uint64 bytes_to_free);
+	};
+	#define g_GfxResidencyManager GfxResidencyManager::Get()
+}
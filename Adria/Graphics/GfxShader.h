@@ -16,7 +16,8 @@ namespace adria
 	{
 		ShaderCompilerFlag_None = 0,
 		ShaderCompilerFlag_Debug = 1 << 0,
-		ShaderCompilerFlag_DisableOptimization = 1 << 1
+		ShaderCompilerFlag_DisableOptimization = 1 << 1,
+		ShaderCompilerFlag_NoErrorDialog = 1 << 2
 	};
 	using GfxShaderCompilerFlags = uint32;
 	struct GfxShaderDesc
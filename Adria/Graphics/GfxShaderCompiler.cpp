@@ -19,10 +19,27 @@ namespace adria
 {
 	namespace
 	{
-		Ref<IDxcLibrary> library = nullptr;
-		Ref<IDxcCompiler3> compiler = nullptr;
-		Ref<IDxcUtils> utils = nullptr;
-		Ref<IDxcIncludeHandler> include_handler = nullptr;
+		//dxc objects are not thread-safe, every thread that compiles shaders gets its own set
+		struct DxcContext
+		{
+			Ref<IDxcLibrary> library = nullptr;
+			Ref<IDxcCompiler3> compiler = nullptr;
+			Ref<IDxcUtils> utils = nullptr;
+			Ref<IDxcIncludeHandler> include_handler = nullptr;
+		};
+		thread_local DxcContext dxc;
+
+		DxcContext& GetDxcContext()
+		{
+			if (!dxc.compiler)
+			{
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(dxc.library.GetAddressOf())));
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(dxc.compiler.GetAddressOf())));
+				GFX_CHECK_HR(dxc.library->CreateIncludeHandler(dxc.include_handler.GetAddressOf()));
+				GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(dxc.utils.GetAddressOf())));
+			}
+			return dxc;
+		}
 	}
 	class GfxIncludeHandler : public IDxcIncludeHandler
 	{
@@ -52,13 +69,13 @@ namespace adria
 			if (already_included)
 			{
 				static const char nullStr[] = " ";
-				utils->CreateBlob(nullStr, ARRAYSIZE(nullStr), CP_UTF8, encoding.GetAddressOf());
+				GetDxcContext().utils->CreateBlob(nullStr, ARRAYSIZE(nullStr), CP_UTF8, encoding.GetAddressOf());
 				*ppIncludeSource = encoding.Detach();
 				return S_OK;
 			}
 
 			std::wstring winclude_file = ToWideString(include_file);
-			HRESULT hr = utils->LoadFile(winclude_file.c_str(), nullptr, encoding.GetAddressOf());
+			HRESULT hr = GetDxcContext().utils->LoadFile(winclude_file.c_str(), nullptr, encoding.GetAddressOf());
 			if (SUCCEEDED(hr))
 			{
 				include_files.push_back(include_file);
@@ -70,7 +87,7 @@ namespace adria
 		}
 		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void __RPC_FAR* __RPC_FAR* ppvObject) override
 		{
-			return include_handler->QueryInterface(riid, ppvObject);
+			return GetDxcContext().include_handler->QueryInterface(riid, ppvObject);
 		}
 
 		ULONG STDMETHODCALLTYPE AddRef(void) override { return 1; }
@@ -195,19 +212,16 @@ namespace adria
 
 		void Initialize()
 		{
-			GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(library.GetAddressOf())));
-			GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(compiler.GetAddressOf())));
-			GFX_CHECK_HR(library->CreateIncludeHandler(include_handler.GetAddressOf()));
-			GFX_CHECK_HR(DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.GetAddressOf())));
+			GetDxcContext();
 
 			std::filesystem::create_directory(paths::ShaderPDBDir);
 		}
 		void Destroy()
 		{
-			include_handler.Reset();
-			compiler.Reset();
-			library.Reset();
-			utils.Reset();
+			dxc.include_handler.Reset();
+			dxc.compiler.Reset();
+			dxc.library.Reset();
+			dxc.utils.Reset();
 		}
 		bool CompileShader(GfxShaderCompileInput const& input, GfxShaderCompileOutput& output, bool bypass_cache)
 		{
@@ -226,12 +240,13 @@ namespace adria
 			if (!bypass_cache && CheckCache(cache_path, input, output)) return true;
 			ADRIA_LOG(INFO, "Shader '%s.%s' not found in cache. Compiling...", input.file.c_str(), input.entry_point.c_str());
 
+			DxcContext& ctx = GetDxcContext();
 			compile:
 			uint32 code_page = CP_UTF8;
 			Ref<IDxcBlobEncoding> source_blob;
 
 			std::wstring shader_source = ToWideString(input.file);
-			HRESULT hr = library->CreateBlobFromFile(shader_source.data(), &code_page, source_blob.GetAddressOf());
+			HRESULT hr = ctx.library->CreateBlobFromFile(shader_source.data(), &code_page, source_blob.GetAddressOf());
 			GFX_CHECK_HR(hr);
 
 			std::wstring name = ToWideString(GetFilenameWithoutExtension(input.file));
@@ -290,7 +305,7 @@ namespace adria
 			GfxIncludeHandler custom_include_handler{};
 
 			Ref<IDxcResult> result;
-			hr = compiler->Compile(
+			hr = ctx.compiler->Compile(
 				&source_buffer,
 				compile_args.data(), (uint32)compile_args.size(),
 				&custom_include_handler,
@@ -303,6 +318,7 @@ namespace adria
 				{
 					char const* err_msg = errors->GetStringPointer();
 					ADRIA_LOG(ERROR, "%s", err_msg);
+					if (input.flags & ShaderCompilerFlag_NoErrorDialog) return false;
 					std::string msg = "Click OK after you fixed the following errors: \n";
 					msg += err_msg;
 					int32 result = MessageBoxA(NULL, msg.c_str(), NULL, MB_OKCANCEL);
@@ -321,7 +337,7 @@ namespace adria
 				if (SUCCEEDED(result->GetOutput(DXC_OUT_PDB, IID_PPV_ARGS(pdb_blob.GetAddressOf()), pdb_path_utf16.GetAddressOf())))
 				{
 					Ref<IDxcBlobUtf8> pdb_path_utf8;
-					if (SUCCEEDED(utils->GetBlobAsUtf8(pdb_path_utf16.Get(), pdb_path_utf8.GetAddressOf())))
+					if (SUCCEEDED(ctx.utils->GetBlobAsUtf8(pdb_path_utf16.Get(), pdb_path_utf8.GetAddressOf())))
 					{
 						char pdb_path[256];
 						sprintf_s(pdb_path, "%s%s", paths::ShaderPDBDir.c_str(), pdb_path_utf8->GetStringPointer());
@@ -354,7 +370,7 @@ namespace adria
 			std::wstring wide_filename = ToWideString(filename);
 			uint32 code_page = CP_UTF8;
 			Ref<IDxcBlobEncoding> source_blob;
-			HRESULT hr = library->CreateBlobFromFile(wide_filename.data(), &code_page, source_blob.GetAddressOf());
+			HRESULT hr = GetDxcContext().library->CreateBlobFromFile(wide_filename.data(), &code_page, source_blob.GetAddressOf());
 			GFX_CHECK_HR(hr);
 			blob.resize(source_blob->GetBufferSize());
 			memcpy(blob.data(), source_blob->GetBufferPointer(), source_blob->GetBufferSize());
@@ -170,6 +170,10 @@ namespace adria
 		}
 		GFX_CHECK_HR(hr);
 		allocation.reset(alloc);
+		if (desc.heap_type == GfxResourceUsage::Default)
+		{
+			residency_handle = g_GfxResidencyManager.Track(resource.Get(), allocation->GetSize());
+		}
 
 		if (desc.heap_type == GfxResourceUsage::Readback)
 		{
@@ -231,6 +235,7 @@ namespace adria
 			resource->Unmap(0, nullptr);
 			mapped_data = nullptr;
 		}
+		g_GfxResidencyManager.Untrack(residency_handle);
 		if (!is_backbuffer)
 		{
 			gfx->AddToReleaseQueue(resource.Detach());
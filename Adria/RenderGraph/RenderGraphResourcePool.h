@@ -27,13 +27,27 @@ namespace adria
 			{
 				PooledTexture& resource = texture_pool[i].first;
 				bool active = texture_pool[i].second;
-				if (!active && resource.last_used_frame + 4 < frame_index)
+				bool evicted = evicted_resources.contains(resource.texture.get());
+				if (!active && (evicted || resource.last_used_frame + 4 < frame_index))
 				{
+					evicted_resources.erase(resource.texture.get());
 					std::swap(texture_pool[i], texture_pool.back());
 					texture_pool.pop_back();
 				}
 				else ++i;
 			}
+			for (uint64 i = 0; i < buffer_pool.size();)
+			{
+				PooledBuffer& resource = buffer_pool[i].first;
+				bool active = buffer_pool[i].second;
+				if (!active && evicted_resources.contains(resource.buffer.get()))
+				{
+					evicted_resources.erase(resource.buffer.get());
+					std::swap(buffer_pool[i], buffer_pool.back());
+					buffer_pool.pop_back();
+				}
+				else ++i;
+			}
 			++frame_index;
 		}
 
@@ -45,10 +59,13 @@ namespace adria
 				{
 					pool_texture.last_used_frame = frame_index;
 					active = true;
+					evicted_resources.erase(pool_texture.texture.get());
+					g_GfxResidencyManager.Touch(pool_texture.texture->GetResidencyHandle());
 					return pool_texture.texture.get();
 				}
 			}
 			auto& texture = texture_pool.emplace_back(std::pair{ PooledTexture{ std::make_unique<GfxTexture>(device, desc), frame_index}, true }).first.texture;
+			TrackPooledResource(texture.get(), texture->GetResidencyHandle());
 			return texture.get();
 		}
 		void ReleaseTexture(GfxTexture* texture)
@@ -71,10 +88,13 @@ namespace adria
 				{
 					pool_buffer.last_used_frame = frame_index;
 					active = true;
+					evicted_resources.erase(pool_buffer.buffer.get());
+					g_GfxResidencyManager.Touch(pool_buffer.buffer->GetResidencyHandle());
 					return pool_buffer.buffer.get();
 				}
 			}
 			auto& buffer = buffer_pool.emplace_back(std::pair{ PooledBuffer{ std::make_unique<GfxBuffer>(device, desc), frame_index}, true }).first.buffer;
+			TrackPooledResource(buffer.get(), buffer->GetResidencyHandle());
 			return buffer.get();
 		}
 		void ReleaseBuffer(GfxBuffer* buffer)
@@ -96,6 +116,15 @@ namespace adria
 		uint64 frame_index = 0;
 		std::vector<std::pair<PooledTexture, bool>> texture_pool;
 		std::vector<std::pair<PooledBuffer, bool>>  buffer_pool;
+		std::unordered_set<void const*> evicted_resources;
+
+	private:
+		void TrackPooledResource(void const* resource, GfxResidencyHandle residency_handle)
+		{
+			g_GfxResidencyManager.SetCategory(residency_handle, GfxMemoryCategory::RenderGraph);
+			g_GfxResidencyManager.SetPriority(residency_handle, GfxResidencyPriority::Low);
+			g_GfxResidencyManager.SetEvictionCallback(residency_handle, [this, resource]() { evicted_resources.insert(resource); });
+		}
 	};
 	using RGResourcePool = RenderGraphResourcePool;
 
@@ -117,6 +117,20 @@ namespace adria
 
 			}, RGPassType::Compute, RGPassFlags::None);
 
+		AddLightingPass(rendergraph, GfxDescriptor{}, GfxDescriptor{});
+	}
+
+	void ClusteredDeferredLightingPass::AddPass(RenderGraph& rendergraph, GfxDescriptor light_grid, GfxDescriptor light_index_list)
+	{
+		ADRIA_ASSERT(light_grid.IsValid() && light_index_list.IsValid());
+		AddLightingPass(rendergraph, light_grid, light_index_list);
+	}
+
+	void ClusteredDeferredLightingPass::AddLightingPass(RenderGraph& rendergraph, GfxDescriptor cpu_light_grid, GfxDescriptor cpu_light_index_list)
+	{
+		FrameBlackboardData const& frame_data = rendergraph.GetBlackboard().Get<FrameBlackboardData>();
+		bool const cpu_light_lists = cpu_light_grid.IsValid();
+
 		struct ClusteredDeferredLightingPassData
 		{
 			RGBufferReadOnlyId light_grid;
@@ -141,8 +155,16 @@ namespace adria
 				data.gbuffer_normal = builder.ReadTexture(RG_NAME(GBufferNormal), ReadAccess_PixelShader);
 				data.gbuffer_albedo = builder.ReadTexture(RG_NAME(GBufferAlbedo), ReadAccess_PixelShader);
 				data.depth = builder.ReadTexture(RG_NAME(DepthStencil), ReadAccess_PixelShader);
-				data.light_grid = builder.ReadBuffer(RG_NAME(LightGrid), ReadAccess_PixelShader);
-				data.light_list = builder.ReadBuffer(RG_NAME(LightList), ReadAccess_PixelShader);
+				if (cpu_light_lists)
+				{
+					data.light_grid.Invalidate();
+					data.light_list.Invalidate();
+				}
+				else
+				{
+					data.light_grid = builder.ReadBuffer(RG_NAME(LightGrid), ReadAccess_PixelShader);
+					data.light_list = builder.ReadBuffer(RG_NAME(LightList), ReadAccess_PixelShader);
+				}
 				data.gbuffer_emissive = builder.ReadTexture(RG_NAME(GBufferEmissive), ReadAccess_NonPixelShader);
 
 				if (builder.IsTextureDeclared(RG_NAME(AmbientOcclusion)))
@@ -155,8 +177,7 @@ namespace adria
 			{
 				GfxDevice* gfx = cmd_list->GetDevice();
 
-				GfxDescriptor src_handles[] = { context.GetReadOnlyBuffer(data.light_list), context.GetReadOnlyBuffer(data.light_grid),
-												context.GetReadOnlyTexture(data.gbuffer_normal), context.GetReadOnlyTexture(data.gbuffer_albedo), 
+				GfxDescriptor src_handles[] = { context.GetReadOnlyTexture(data.gbuffer_normal), context.GetReadOnlyTexture(data.gbuffer_albedo), 
 												context.GetReadOnlyTexture(data.depth),  context.GetReadOnlyTexture(data.gbuffer_emissive),
 												data.ambient_occlusion.IsValid() ? context.GetReadOnlyTexture(data.ambient_occlusion) : gfxcommon::GetCommonView(GfxCommonViewType::WhiteTexture2D_SRV),
 												context.GetReadWriteTexture(data.output) };
@@ -164,6 +185,17 @@ namespace adria
 				uint32 i = dst_handle.GetIndex();
 				gfx->CopyDescriptors(dst_handle, src_handles);
 
+				uint32 light_index_list_idx = cpu_light_index_list.GetIndex();
+				uint32 light_grid_idx = cpu_light_grid.GetIndex();
+				if (!cpu_light_lists)
+				{
+					GfxDescriptor light_handles[] = { context.GetReadOnlyBuffer(data.light_list), context.GetReadOnlyBuffer(data.light_grid) };
+					GfxDescriptor light_dst_handle = gfx->AllocateDescriptorsGPU(ARRAYSIZE(light_handles));
+					gfx->CopyDescriptors(light_dst_handle, light_handles);
+					light_index_list_idx = light_dst_handle.GetIndex();
+					light_grid_idx = light_dst_handle.GetIndex() + 1;
+				}
+
 				float clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 				cmd_list->ClearUAV(context.GetTexture(*data.output), gfx->GetDescriptorGPU(i + 5),
 					context.GetReadWriteTexture(data.output), clear);
@@ -180,8 +212,8 @@ namespace adria
 					uint32 output_idx;
 				} constants = 
 				{
-					.light_index_list_idx = i, .light_grid_idx = i + 1, .normal_idx = i + 2, .diffuse_idx = i + 3,
-					.depth_idx = i + 4, .emissive_idx = i + 5, .ao_idx = i + 6, .output_idx = i + 7
+					.light_index_list_idx = light_index_list_idx, .light_grid_idx = light_grid_idx, .normal_idx = i, .diffuse_idx = i + 1,
+					.depth_idx = i + 2, .emissive_idx = i + 3, .ao_idx = i + 4, .output_idx = i + 5
 				};
 
 				cmd_list->SetPipelineState(clustered_lighting_pso.get());
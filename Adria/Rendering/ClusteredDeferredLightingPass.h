@@ -21,6 +21,8 @@ namespace adria
 		ClusteredDeferredLightingPass(entt::registry& reg, GfxDevice* gfx, uint32 w, uint32 h);
 
 		void AddPass(RenderGraph& rendergraph, bool recreate_clusters);
+		//lights a frame with light lists binned on the CPU, the descriptors are shader visible LightGrid and light index buffers
+		void AddPass(RenderGraph& rendergraph, GfxDescriptor light_grid, GfxDescriptor light_index_list);
 
 		void OnResize(uint32 w, uint32 h)
 		{
@@ -42,6 +44,7 @@ namespace adria
 
 	private:
 		void CreatePSOs();
+		void AddLightingPass(RenderGraph& rendergraph, GfxDescriptor cpu_light_grid, GfxDescriptor cpu_light_index_list);
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include <bit>
+#include <xmmintrin.h>
+#include "ClusteredLightBinning.h"
+#include "Components.h"
+#include "Graphics/GfxFormat.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Timer.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr uint32 CLUSTER_SLICE_SIZE = ClusteredLightBinning::CLUSTER_SIZE_X * ClusteredLightBinning::CLUSTER_SIZE_Y;
+		constexpr uint32 CLUSTER_ENTRY_LIGHT_BITS = 24;
+		constexpr uint32 CLUSTER_ENTRY_LIGHT_MASK = (1u << CLUSTER_ENTRY_LIGHT_BITS) - 1;
+		static_assert(CLUSTER_SLICE_SIZE <= (1u << (32 - CLUSTER_ENTRY_LIGHT_BITS)), "Slice local cluster index has to fit above the light index");
+		static_assert(ClusteredLightBinning::CLUSTER_SIZE_X % 4 == 0, "Cluster rows are tested four at a time");
+	}
+
+	ClusteredLightBinning::ClusteredLightBinning()
+	{
+		for (std::vector<float>* cluster_data : { &cluster_min_x, &cluster_min_y, &cluster_min_z, &cluster_max_x, &cluster_max_y, &cluster_max_z,
+												  &cluster_center_x, &cluster_center_y, &cluster_center_z, &cluster_radius })
+		{
+			cluster_data->resize(CLUSTER_COUNT);
+		}
+		light_grid.resize(CLUSTER_COUNT);
+	}
+
+	void ClusteredLightBinning::Bin(entt::registry const& reg, Matrix const& view, Matrix const& projection, float near_plane, float far_plane, uint32 width, uint32 height)
+	{
+		Timer timer;
+		stats = {};
+
+		ClusterParameters const parameters
+		{
+			.width = std::max(width, 1u), .height = std::max(height, 1u),
+			.near_plane = std::min(near_plane, far_plane), .far_plane = std::max(near_plane, far_plane),
+			.projection_x = projection._11, .projection_y = projection._22
+		};
+		if (!(parameters == cluster_parameters)) BuildClusters(parameters);
+
+		//same tiling as the lighting shader, a tile spans ceil(resolution / 16) pixels
+		float const tile_scale_x = float(parameters.width) / DivideAndRoundUp(parameters.width, CLUSTER_SIZE_X);
+		float const tile_scale_y = float(parameters.height) / DivideAndRoundUp(parameters.height, CLUSTER_SIZE_Y);
+		float const slice_scale = CLUSTER_SIZE_Z / std::log2(parameters.far_plane / parameters.near_plane);
+		auto SliceIndex = [&](float z)
+		{
+			float const slice = (std::log2(std::max(z, parameters.near_plane)) - std::log2(parameters.near_plane)) * slice_scale;
+			return (uint8)std::clamp(slice, 0.0f, CLUSTER_SIZE_Z - 1.0f);
+		};
+		auto TileIndex = [](float uv, float tile_scale, uint32 tile_count)
+		{
+			return (uint8)std::clamp(uv * tile_scale, 0.0f, tile_count - 1.0f);
+		};
+
+		//side planes of the view frustum pass through the eye, inside points have negative distance
+		Vector3 const side_planes[] =
+		{
+			Vector3(parameters.projection_x, 0.0f, -1.0f), Vector3(-parameters.projection_x, 0.0f, -1.0f),
+			Vector3(0.0f, parameters.projection_y, -1.0f), Vector3(0.0f, -parameters.projection_y, -1.0f)
+		};
+
+		lights.clear();
+		auto light_view = reg.view<Light>();
+		for (entt::entity light_entity : light_view)
+		{
+			Light const& light = light_view.get<Light>(light_entity);
+			++stats.light_count;
+			if (!light.active) continue;
+			ADRIA_ASSERT(light.light_index <= CLUSTER_ENTRY_LIGHT_MASK);
+
+			BinnedLight binned_light{};
+			binned_light.light_index = light.light_index;
+			binned_light.type = (uint8)light.type;
+			if (light.type == LightType::Directional)
+			{
+				binned_light.slice_max = CLUSTER_SIZE_Z - 1;
+				binned_light.tile_max_x = CLUSTER_SIZE_X - 1;
+				binned_light.tile_max_y = CLUSTER_SIZE_Y - 1;
+				lights.push_back(binned_light);
+				continue;
+			}
+
+			binned_light.position = Vector3::Transform(Vector3(light.position), view);
+			binned_light.range = light.range;
+
+			//spot lights are culled with the bounding sphere of their cone, wide cones fall back to the range sphere
+			Vector3 bounds_center = binned_light.position;
+			float bounds_radius = light.range;
+			if (light.type == LightType::Spot)
+			{
+				binned_light.direction = Vector3::TransformNormal(Vector3(light.direction), view);
+				binned_light.direction.Normalize();
+				binned_light.cone_cosine = std::clamp(light.outer_cosine, -1.0f, 1.0f);
+				binned_light.cone_sine = std::sqrt(1.0f - binned_light.cone_cosine * binned_light.cone_cosine);
+				if (binned_light.cone_cosine >= 0.70710678f)
+				{
+					bounds_radius = light.range / (2.0f * binned_light.cone_cosine);
+					bounds_center = binned_light.position + binned_light.direction * bounds_radius;
+				}
+				else if (binned_light.cone_cosine > 0.0f)
+				{
+					bounds_radius = light.range * binned_light.cone_sine;
+					bounds_center = binned_light.position + binned_light.direction * (light.range * binned_light.cone_cosine);
+				}
+			}
+
+			if (bounds_center.z + bounds_radius < parameters.near_plane || bounds_center.z - bounds_radius > parameters.far_plane) continue;
+			bool outside = false;
+			for (Vector3 const& plane : side_planes) outside |= plane.Dot(bounds_center) > bounds_radius * plane.Length();
+			if (outside) continue;
+
+			binned_light.slice_min = SliceIndex(bounds_center.z - bounds_radius);
+			binned_light.slice_max = SliceIndex(bounds_center.z + bounds_radius);
+			binned_light.tile_max_x = CLUSTER_SIZE_X - 1;
+			binned_light.tile_max_y = CLUSTER_SIZE_Y - 1;
+			float const min_z = bounds_center.z - bounds_radius;
+			if (min_z > parameters.near_plane)
+			{
+				//x / z over the bounds is extremal at the corners once the bounds are in front of the eye
+				float const max_z = bounds_center.z + bounds_radius;
+				float const min_x = bounds_center.x - bounds_radius, max_x = bounds_center.x + bounds_radius;
+				float const min_y = bounds_center.y - bounds_radius, max_y = bounds_center.y + bounds_radius;
+				float const ndc_min_x = std::min(min_x / min_z, min_x / max_z) * parameters.projection_x;
+				float const ndc_max_x = std::max(max_x / min_z, max_x / max_z) * parameters.projection_x;
+				float const ndc_min_y = std::min(min_y / min_z, min_y / max_z) * parameters.projection_y;
+				float const ndc_max_y = std::max(max_y / min_z, max_y / max_z) * parameters.projection_y;
+				binned_light.tile_min_x = TileIndex(ndc_min_x * 0.5f + 0.5f, tile_scale_x, CLUSTER_SIZE_X);
+				binned_light.tile_max_x = TileIndex(ndc_max_x * 0.5f + 0.5f, tile_scale_x, CLUSTER_SIZE_X);
+				binned_light.tile_min_y = TileIndex(0.5f - ndc_max_y * 0.5f, tile_scale_y, CLUSTER_SIZE_Y);
+				binned_light.tile_max_y = TileIndex(0.5f - ndc_min_y * 0.5f, tile_scale_y, CLUSTER_SIZE_Y);
+			}
+			lights.push_back(binned_light);
+		}
+		stats.visible_light_count = (uint32)lights.size();
+
+		//slices own disjoint clusters, so each one is binned on its own thread and the lists are compacted afterwards
+		ParallelFor(CLUSTER_SIZE_Z, [this](uint64 slice) { BinSlice((uint32)slice); });
+
+		uint32 offset = 0;
+		for (ClusterLightRange& cluster : light_grid)
+		{
+			cluster.offset = offset;
+			offset += cluster.light_count;
+			stats.max_cluster_lights = std::max(stats.max_cluster_lights, cluster.light_count);
+		}
+		light_index_list.resize(offset);
+		stats.light_index_count = offset;
+
+		ParallelFor(CLUSTER_SIZE_Z, [this](uint64 slice)
+			{
+				std::array<uint32, CLUSTER_SLICE_SIZE> write_offsets;
+				for (uint32 i = 0; i < CLUSTER_SLICE_SIZE; ++i) write_offsets[i] = light_grid[slice * CLUSTER_SLICE_SIZE + i].offset;
+				for (uint32 entry : slice_entries[slice]) light_index_list[write_offsets[entry >> CLUSTER_ENTRY_LIGHT_BITS]++] = entry & CLUSTER_ENTRY_LIGHT_MASK;
+			});
+		stats.bin_time = timer.Elapsed() / 1000.0f;
+	}
+
+	void ClusteredLightBinning::BuildClusters(ClusterParameters const& parameters)
+	{
+		cluster_parameters = parameters;
+		for (uint32 z = 0; z <= CLUSTER_SIZE_Z; ++z)
+		{
+			slice_depths[z] = parameters.near_plane * std::pow(parameters.far_plane / parameters.near_plane, float(z) / CLUSTER_SIZE_Z);
+		}
+
+		float const tile_width = float(DivideAndRoundUp(parameters.width, CLUSTER_SIZE_X)) / parameters.width;
+		float const tile_height = float(DivideAndRoundUp(parameters.height, CLUSTER_SIZE_Y)) / parameters.height;
+		for (uint32 z = 0; z < CLUSTER_SIZE_Z; ++z)
+		{
+			float const near_z = slice_depths[z];
+			float const far_z = slice_depths[z + 1];
+			for (uint32 y = 0; y < CLUSTER_SIZE_Y; ++y)
+			{
+				//view space slopes of the tile edges, screen v grows downwards
+				float const slope_max_y = (1.0f - 2.0f * std::min(y * tile_height, 1.0f)) / parameters.projection_y;
+				float const slope_min_y = (1.0f - 2.0f * std::min((y + 1) * tile_height, 1.0f)) / parameters.projection_y;
+				for (uint32 x = 0; x < CLUSTER_SIZE_X; ++x)
+				{
+					float const slope_min_x = (2.0f * std::min(x * tile_width, 1.0f) - 1.0f) / parameters.projection_x;
+					float const slope_max_x = (2.0f * std::min((x + 1) * tile_width, 1.0f) - 1.0f) / parameters.projection_x;
+
+					uint32 const cluster = x + y * CLUSTER_SIZE_X + z * CLUSTER_SLICE_SIZE;
+					cluster_min_x[cluster] = std::min(slope_min_x * near_z, slope_min_x * far_z);
+					cluster_max_x[cluster] = std::max(slope_max_x * near_z, slope_max_x * far_z);
+					cluster_min_y[cluster] = std::min(slope_min_y * near_z, slope_min_y * far_z);
+					cluster_max_y[cluster] = std::max(slope_max_y * near_z, slope_max_y * far_z);
+					cluster_min_z[cluster] = near_z;
+					cluster_max_z[cluster] = far_z;
+
+					Vector3 const min_point(cluster_min_x[cluster], cluster_min_y[cluster], near_z);
+					Vector3 const max_point(cluster_max_x[cluster], cluster_max_y[cluster], far_z);
+					Vector3 const center = (min_point + max_point) * 0.5f;
+					cluster_center_x[cluster] = center.x;
+					cluster_center_y[cluster] = center.y;
+					cluster_center_z[cluster] = center.z;
+					cluster_radius[cluster] = Vector3::Distance(center, max_point);
+				}
+			}
+		}
+	}
+
+	void ClusteredLightBinning::BinSlice(uint32 slice)
+	{
+		std::vector<uint32>& entries = slice_entries[slice];
+		entries.clear();
+		ClusterLightRange* slice_grid = light_grid.data() + slice * CLUSTER_SLICE_SIZE;
+		for (uint32 i = 0; i < CLUSTER_SLICE_SIZE; ++i) slice_grid[i].light_count = 0;
+
+		__m128 const zero = _mm_setzero_ps();
+		for (BinnedLight const& light : lights)
+		{
+			if (slice < light.slice_min || slice > light.slice_max) continue;
+			if (light.type == (uint8)LightType::Directional)
+			{
+				for (uint32 i = 0; i < CLUSTER_SLICE_SIZE; ++i)
+				{
+					entries.push_back((i << CLUSTER_ENTRY_LIGHT_BITS) | light.light_index);
+					++slice_grid[i].light_count;
+				}
+				continue;
+			}
+
+			bool const spot = light.type == (uint8)LightType::Spot;
+			__m128 const light_x = _mm_set1_ps(light.position.x);
+			__m128 const light_y = _mm_set1_ps(light.position.y);
+			__m128 const light_z = _mm_set1_ps(light.position.z);
+			__m128 const range = _mm_set1_ps(light.range);
+			__m128 const range_squared = _mm_set1_ps(light.range * light.range);
+			__m128 const direction_x = _mm_set1_ps(light.direction.x);
+			__m128 const direction_y = _mm_set1_ps(light.direction.y);
+			__m128 const direction_z = _mm_set1_ps(light.direction.z);
+			__m128 const cone_cosine = _mm_set1_ps(light.cone_cosine);
+			__m128 const cone_sine = _mm_set1_ps(light.cone_sine);
+			for (uint32 y = light.tile_min_y; y <= light.tile_max_y; ++y)
+			{
+				uint32 const row = y * CLUSTER_SIZE_X;
+				for (uint32 x = light.tile_min_x & ~3u; x <= light.tile_max_x; x += 4)
+				{
+					uint32 const cluster = slice * CLUSTER_SLICE_SIZE + row + x;
+
+					//squared distance from the light to the cluster box
+					__m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&cluster_min_x[cluster]), light_x), _mm_sub_ps(light_x, _mm_loadu_ps(&cluster_max_x[cluster])));
+					__m128 dy = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&cluster_min_y[cluster]), light_y), _mm_sub_ps(light_y, _mm_loadu_ps(&cluster_max_y[cluster])));
+					__m128 dz = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&cluster_min_z[cluster]), light_z), _mm_sub_ps(light_z, _mm_loadu_ps(&cluster_max_z[cluster])));
+					dx = _mm_max_ps(dx, zero);
+					dy = _mm_max_ps(dy, zero);
+					dz = _mm_max_ps(dz, zero);
+					__m128 const distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					__m128 inside = _mm_cmple_ps(distance_squared, range_squared);
+
+					if (spot)
+					{
+						//cone against the bounding sphere of the cluster
+						__m128 const radius = _mm_loadu_ps(&cluster_radius[cluster]);
+						__m128 const vx = _mm_sub_ps(_mm_loadu_ps(&cluster_center_x[cluster]), light_x);
+						__m128 const vy = _mm_sub_ps(_mm_loadu_ps(&cluster_center_y[cluster]), light_y);
+						__m128 const vz = _mm_sub_ps(_mm_loadu_ps(&cluster_center_z[cluster]), light_z);
+						__m128 const length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+						__m128 const axis_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, direction_x), _mm_mul_ps(vy, direction_y)), _mm_mul_ps(vz, direction_z));
+						__m128 const radial_distance = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(length_squared, _mm_mul_ps(axis_distance, axis_distance)), zero));
+						__m128 const cone_distance = _mm_sub_ps(_mm_mul_ps(cone_cosine, radial_distance), _mm_mul_ps(axis_distance, cone_sine));
+						__m128 culled = _mm_cmpgt_ps(cone_distance, radius);
+						culled = _mm_or_ps(culled, _mm_cmpgt_ps(axis_distance, _mm_add_ps(radius, range)));
+						culled = _mm_or_ps(culled, _mm_cmplt_ps(axis_distance, _mm_sub_ps(zero, radius)));
+						inside = _mm_andnot_ps(culled, inside);
+					}
+
+					uint32 const first_lane = light.tile_min_x > x ? light.tile_min_x - x : 0;
+					uint32 const last_lane = std::min<uint32>(light.tile_max_x - x, 3);
+					uint32 lanes = (uint32)_mm_movemask_ps(inside) & ((1u << (last_lane + 1)) - 1) & ~((1u << first_lane) - 1);
+					while (lanes)
+					{
+						uint32 const local_cluster = row + x + std::countr_zero(lanes);
+						lanes &= lanes - 1;
+						entries.push_back((local_cluster << CLUSTER_ENTRY_LIGHT_BITS) | light.light_index);
+						++slice_grid[local_cluster].light_count;
+					}
+				}
+			}
+		}
+	}
+}
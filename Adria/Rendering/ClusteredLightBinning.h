@@ -0,0 +1,87 @@
+#pragma once
+#include <span>
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	//matches LightGrid in the clustered shaders
+	struct ClusterLightRange
+	{
+		uint32 offset;
+		uint32 light_count;
+	};
+
+	struct ClusteredLightBinningStats
+	{
+		uint32 light_count;
+		uint32 visible_light_count;
+		uint32 light_index_count;
+		uint32 max_cluster_lights;
+		float  bin_time;
+	};
+
+	//CPU reference of the clustered light culling. Active lights are frustum culled in view space and then binned into the same 16x16x16
+	//froxels ClusteredDeferredLighting.hlsl looks up, spot lights are additionally tested with their cone. The output is a compact index list
+	//per cluster, sorted by light index, that forward passes can use directly or upload in place of the compute culling result
+	class ClusteredLightBinning
+	{
+	public:
+		static constexpr uint32 CLUSTER_SIZE_X = 16;
+		static constexpr uint32 CLUSTER_SIZE_Y = 16;
+		static constexpr uint32 CLUSTER_SIZE_Z = 16;
+		static constexpr uint32 CLUSTER_COUNT = CLUSTER_SIZE_X * CLUSTER_SIZE_Y * CLUSTER_SIZE_Z;
+
+	private:
+		struct BinnedLight
+		{
+			Vector3 position;
+			float range;
+			Vector3 direction;
+			float cone_cosine;
+			float cone_sine;
+			uint32 light_index;
+			uint8 type;
+			uint8 slice_min, slice_max;
+			uint8 tile_min_x, tile_max_x;
+			uint8 tile_min_y, tile_max_y;
+		};
+
+		struct ClusterParameters
+		{
+			uint32 width, height;
+			float near_plane, far_plane;
+			float projection_x, projection_y;
+			bool operator==(ClusterParameters const&) const = default;
+		};
+
+	public:
+		ClusteredLightBinning();
+
+		void Bin(entt::registry const& reg, Matrix const& view, Matrix const& projection, float near_plane, float far_plane, uint32 width, uint32 height);
+
+		std::span<ClusterLightRange const> GetLightGrid() const { return light_grid; }
+		std::span<uint32 const> GetLightIndexList() const { return light_index_list; }
+		std::span<uint32 const> GetClusterLights(uint32 cluster) const
+		{
+			return std::span<uint32 const>(light_index_list).subspan(light_grid[cluster].offset, light_grid[cluster].light_count);
+		}
+		ClusteredLightBinningStats const& GetStats() const { return stats; }
+
+	private:
+		ClusterParameters cluster_parameters{};
+		std::vector<float> cluster_min_x, cluster_min_y, cluster_min_z;
+		std::vector<float> cluster_max_x, cluster_max_y, cluster_max_z;
+		std::vector<float> cluster_center_x, cluster_center_y, cluster_center_z, cluster_radius;
+		std::array<float, CLUSTER_SIZE_Z + 1> slice_depths{};
+
+		std::vector<BinnedLight> lights;
+		std::array<std::vector<uint32>, CLUSTER_SIZE_Z> slice_entries;
+		std::vector<ClusterLightRange> light_grid;
+		std::vector<uint32> light_index_list;
+		ClusteredLightBinningStats stats{};
+
+	private:
+		void BuildClusters(ClusterParameters const& parameters);
+		void BinSlice(uint32 slice);
+	};
+}
@@ -6,6 +6,8 @@
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxStates.h"
 #include "TextureManager.h"
+#include "TransformHierarchy.h"
+#include "MeshLOD.h"
 #include "entt/entity/entity.hpp"
 
 #define COMPONENT
@@ -13,6 +15,8 @@
 namespace adria
 {
 	class GfxCommandList;
+	class TriangleBVH;
+	struct OccluderMesh;
 
 	enum class LightType : int32
 	{
@@ -130,6 +134,16 @@ namespace adria
 	struct COMPONENT Ocean {};
 	struct COMPONENT Deferred {};
 
+	struct SubMeshLOD
+	{
+		uint32 indices_offset;
+		uint32 indices_count;
+
+		uint32 meshlet_offset;
+		uint32 meshlet_vertices_offset;
+		uint32 meshlet_triangles_offset;
+		uint32 meshlet_count;
+	};
 	struct SubMeshGPU
 	{
 		uint64 buffer_address;
@@ -150,12 +164,19 @@ namespace adria
 
 		uint32 material_index;
 		DirectX::BoundingBox bounding_box;
+		float uv_world_scale;	//object space length of one uv unit for texture streaming, 0 if unknown
 		GfxPrimitiveTopology topology;
+
+		//the first LOD is the base mesh above, all LODs share its vertex streams
+		std::array<SubMeshLOD, MESH_LOD_COUNT> lods;
+		std::array<float, MESH_LOD_COUNT> lod_errors;
+		uint32 lod_count;
 	};
 	struct SubMeshInstance
 	{
 		entt::entity parent;
 		uint32 submesh_index;
+		uint32 transform_node;
 		Matrix world_transform;
 	};
 	struct COMPONENT Mesh
@@ -164,17 +185,15 @@ namespace adria
 		std::vector<Material> materials;
 		std::vector<SubMeshGPU> submeshes;
 		std::vector<SubMeshInstance> instances;
-	};
-
-	struct COMPONENT Batch
-	{
-		uint32   instance_id;
-		SubMeshGPU*  submesh;
-		MaterialAlphaMode alpha_mode;
-		Matrix world_transform;
-		BoundingBox bounding_box;
-
-		bool camera_visibility = true;
+		std::vector<std::shared_ptr<TriangleBVH>> triangle_bvhs;
+		std::vector<std::shared_ptr<OccluderMesh>> occluders;
+		TransformHierarchy transform_hierarchy;
+
+		uint32 geometry_buffer_slot = uint32(-1);
+		uint32 instance_offset = 0;
+		uint32 submesh_offset = 0;
+		uint32 material_offset = 0;
+		bool dirty = true;
 	};
 
 	void Draw(SubMesh const& submesh, GfxCommandList* cmd_list, bool override_topology = false, GfxPrimitiveTopology new_topology = GfxPrimitiveTopology::Undefined);
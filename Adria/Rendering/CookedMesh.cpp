@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include "CookedMesh.h"
+#include "EntityLoader.h"
+#include "TriangleBVH.h"
+#include "SoftwareOcclusion.h"
+#include "GLBFile.h"
+#include "Meshlet.h"
+#include "Core/Paths.h"
+#include "Logging/Logger.h"
+#include "Utilities/FilesUtil.h"
+#include "Utilities/HashUtil.h"
+#include "Utilities/AllocatorUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace adria
+{
+	namespace
+	{
+		class CookedMeshLayout
+		{
+		public:
+			CookedMeshLayout() : current_offset(Align(sizeof(CookedMeshHeader), 16)) {}
+
+			template<typename T>
+			CookedArray Add(uint64 count)
+			{
+				CookedArray array{ current_offset, count };
+				current_offset += Align(count * sizeof(T), 16);
+				return array;
+			}
+			uint64 GetSize() const { return current_offset; }
+
+		private:
+			uint64 current_offset;
+		};
+
+		template<typename T>
+		bool IsArrayInFile(CookedArray const& array, uint64 file_size)
+		{
+			if (array.offset % alignof(T) != 0 || array.offset > file_size) return false;
+			return array.count <= (file_size - array.offset) / sizeof(T);
+		}
+
+		bool IsRangeInGeometry(uint64 offset, uint64 size, uint64 geometry_size)
+		{
+			return offset <= geometry_size && size <= geometry_size - offset;
+		}
+	}
+
+	uint64 ComputeCookedMeshKey(ModelParameters const& params)
+	{
+		MappedFile source;
+		if (!source.Open(params.model_path)) return 0;
+
+		std::string_view source_text(reinterpret_cast<char const*>(source.GetData()), source.GetSize());
+		GLBChunks glb_chunks{};
+		bool const is_binary = ParseGLB(source.GetSpan(), glb_chunks);
+		if (is_binary) source_text = std::string_view(reinterpret_cast<char const*>(glb_chunks.json.data()), glb_chunks.json.size());
+		uint64 key = crc64(source_text.data(), source_text.size());
+		if (is_binary)
+		{
+			//hashing the binary chunk would cost about as much as parsing it, its size and the file write time stand in for its contents
+			HashCombine(key, glb_chunks.bin.size());
+			HashCombine(key, GetFileLastWriteTime(params.model_path));
+		}
+
+		//external buffers are only looked up by name, a change shows up in their write time
+		std::string base_path = GetParentPath(params.model_path);
+		if (!base_path.empty()) base_path += "/";
+		for (uint64 pos = source_text.find(".bin\""); pos != std::string_view::npos; pos = source_text.find(".bin\"", pos + 1))
+		{
+			uint64 uri_begin = source_text.rfind('"', pos);
+			std::string buffer_path = base_path + std::string(source_text.substr(uri_begin + 1, pos + 4 - uri_begin - 1));
+			if (FileExists(buffer_path)) HashCombine(key, GetFileLastWriteTime(buffer_path));
+		}
+
+		HashCombine(key, COOKED_MESH_VERSION);
+		HashCombine(key, params.textures_path);
+		HashCombine(key, params.triangle_ccw);
+		HashCombine(key, params.force_mask_alpha_usage);
+		for (float lod_ratio : params.lod_ratios) HashCombine(key, lod_ratio);
+		HashCombine(key, params.lod_target_error);
+		HashCombine(key, MESHLET_MAX_VERTICES);
+		HashCombine(key, MESHLET_MAX_TRIANGLES);
+		HashCombine(key, OCCLUDER_MAX_TRIANGLES);
+		HashCombine(key, sizeof(SubMeshGPU));
+		HashCombine(key, sizeof(Material));
+		return key;
+	}
+
+	std::string GetCookedMeshPath(ModelParameters const& params, uint64 key)
+	{
+		char cooked_path[512];
+		sprintf_s(cooked_path, "%s%s_%llx.admesh", paths::MeshCacheDir.c_str(), GetFilenameWithoutExtension(params.model_path).c_str(), key);
+		return cooked_path;
+	}
+
+	bool WriteCookedMesh(std::string const& path, uint64 key, Mesh const& mesh, std::span<std::string const> texture_paths,
+						 std::span<GeometryBufferRange const> geometry, uint64 geometry_size)
+	{
+		ADRIA_ASSERT(texture_paths.size() == mesh.materials.size() * 4);
+		ADRIA_ASSERT(mesh.triangle_bvhs.size() == mesh.submeshes.size() && mesh.occluders.size() == mesh.submeshes.size());
+
+		std::string texture_path_chars;
+		for (std::string const& texture_path : texture_paths)
+		{
+			texture_path_chars += texture_path;
+			texture_path_chars.push_back('\0');
+		}
+
+		TransformHierarchy const& transform_hierarchy = mesh.transform_hierarchy;
+		std::vector<CookedNode> nodes;
+		nodes.reserve(transform_hierarchy.GetNodeCount());
+		for (uint32 node = 1; node < transform_hierarchy.GetNodeCount(); ++node)
+		{
+			nodes.push_back(CookedNode{ transform_hierarchy.GetParent(node), transform_hierarchy.GetLocalTransform(node) });
+		}
+		std::vector<CookedInstance> instances;
+		instances.reserve(mesh.instances.size());
+		for (SubMeshInstance const& instance : mesh.instances) instances.push_back(CookedInstance{ instance.submesh_index, instance.transform_node });
+
+		CookedMeshLayout layout;
+		CookedMeshHeader header{};
+		header.magic = COOKED_MESH_MAGIC;
+		header.version = COOKED_MESH_VERSION;
+		header.key = key;
+		header.texture_paths = layout.Add<char>(texture_path_chars.size());
+		header.materials = layout.Add<Material>(mesh.materials.size());
+		header.submeshes = layout.Add<SubMeshGPU>(mesh.submeshes.size());
+		header.submesh_data = layout.Add<CookedSubMeshData>(mesh.submeshes.size());
+		header.nodes = layout.Add<CookedNode>(nodes.size());
+		header.instances = layout.Add<CookedInstance>(instances.size());
+
+		std::vector<CookedSubMeshData> submesh_data(mesh.submeshes.size());
+		for (uint64 i = 0; i < mesh.submeshes.size(); ++i)
+		{
+			CookedSubMeshData& data = submesh_data[i];
+			if (TriangleBVH const* triangle_bvh = mesh.triangle_bvhs[i].get())
+			{
+				data.bvh_nodes = layout.Add<SceneBVHNode>(triangle_bvh->GetNodes().size());
+				data.bvh_vertices = layout.Add<Vector3>(triangle_bvh->GetVertices().size());
+				data.bvh_triangles = layout.Add<uint32>(triangle_bvh->GetTriangles().size());
+			}
+			if (OccluderMesh const* occluder = mesh.occluders[i].get())
+			{
+				data.occluder_positions = layout.Add<Vector3>(occluder->positions.size());
+				data.occluder_indices = layout.Add<uint32>(occluder->indices.size());
+			}
+		}
+		header.geometry = layout.Add<uint8>(geometry_size);
+		header.file_size = layout.GetSize();
+
+		fs::create_directories(paths::MeshCacheDir);
+		std::string temporary_path = path + ".tmp";
+		{
+			std::ofstream os(temporary_path, std::ios::binary);
+			if (!os) return false;
+
+			auto Write = [&os](CookedArray const& array, void const* data, uint64 size)
+			{
+				os.seekp(array.offset);
+				os.write(reinterpret_cast<char const*>(data), size);
+			};
+			Write(CookedArray{}, &header, sizeof(header));
+			Write(header.texture_paths, texture_path_chars.data(), texture_path_chars.size());
+			Write(header.materials, mesh.materials.data(), mesh.materials.size() * sizeof(Material));
+			Write(header.submeshes, mesh.submeshes.data(), mesh.submeshes.size() * sizeof(SubMeshGPU));
+			Write(header.submesh_data, submesh_data.data(), submesh_data.size() * sizeof(CookedSubMeshData));
+			Write(header.nodes, nodes.data(), nodes.size() * sizeof(CookedNode));
+			Write(header.instances, instances.data(), instances.size() * sizeof(CookedInstance));
+			for (uint64 i = 0; i < mesh.submeshes.size(); ++i)
+			{
+				CookedSubMeshData const& data = submesh_data[i];
+				if (TriangleBVH const* triangle_bvh = mesh.triangle_bvhs[i].get())
+				{
+					Write(data.bvh_nodes, triangle_bvh->GetNodes().data(), triangle_bvh->GetNodes().size_bytes());
+					Write(data.bvh_vertices, triangle_bvh->GetVertices().data(), triangle_bvh->GetVertices().size_bytes());
+					Write(data.bvh_triangles, triangle_bvh->GetTriangles().data(), triangle_bvh->GetTriangles().size_bytes());
+				}
+				if (OccluderMesh const* occluder = mesh.occluders[i].get())
+				{
+					Write(data.occluder_positions, occluder->positions.data(), occluder->positions.size() * sizeof(Vector3));
+					Write(data.occluder_indices, occluder->indices.data(), occluder->indices.size() * sizeof(uint32));
+				}
+			}
+			for (GeometryBufferRange const& range : geometry)
+			{
+				Write(CookedArray{ header.geometry.offset + range.offset, range.size }, range.data, range.size);
+			}
+			//sections are padded to 16 bytes, the file has to end at file_size even if the last one wasn't written up to it
+			os.seekp(0, std::ios::end);
+			if ((uint64)os.tellp() < header.file_size)
+			{
+				os.seekp(header.file_size - 1);
+				os.put('\0');
+			}
+			if (!os) return false;
+		}
+
+		std::error_code error;
+		fs::rename(temporary_path, path, error);
+		if (error)
+		{
+			fs::remove(temporary_path, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool CookedMesh::Open(std::string const& path, uint64 key)
+	{
+		Close();
+		if (!FileExists(path) || !file.Open(path)) return false;
+		header = reinterpret_cast<CookedMeshHeader const*>(file.GetData());
+		if (!Validate(key))
+		{
+			ADRIA_LOG(WARNING, "Cooked mesh %s is invalid, the model will be imported from source", path.c_str());
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void CookedMesh::Close()
+	{
+		file.Close();
+		header = nullptr;
+	}
+
+	void CookedMesh::GetTexturePaths(std::vector<std::string>& texture_paths) const
+	{
+		std::span<char const> texture_path_chars = GetArray<char>(header->texture_paths);
+		for (uint64 begin = 0; begin < texture_path_chars.size();)
+		{
+			std::string_view texture_path(texture_path_chars.data() + begin);
+			texture_paths.emplace_back(texture_path);
+			begin += texture_path.size() + 1;
+		}
+	}
+
+	bool CookedMesh::Validate(uint64 key) const
+	{
+		uint64 const file_size = file.GetSize();
+		if (file_size < sizeof(CookedMeshHeader)) return false;
+		if (header->magic != COOKED_MESH_MAGIC || header->version != COOKED_MESH_VERSION || header->key != key || header->file_size != file_size) return false;
+
+		if (!IsArrayInFile<char>(header->texture_paths, file_size) || !IsArrayInFile<Material>(header->materials, file_size) ||
+			!IsArrayInFile<SubMeshGPU>(header->submeshes, file_size) || !IsArrayInFile<CookedSubMeshData>(header->submesh_data, file_size) ||
+			!IsArrayInFile<CookedNode>(header->nodes, file_size) || !IsArrayInFile<CookedInstance>(header->instances, file_size) ||
+			!IsArrayInFile<uint8>(header->geometry, file_size)) return false;
+
+		std::span<char const> texture_path_chars = GetArray<char>(header->texture_paths);
+		if (!texture_path_chars.empty() && texture_path_chars.back() != '\0') return false;
+		if ((uint64)std::count(texture_path_chars.begin(), texture_path_chars.end(), '\0') != header->materials.count * 4) return false;
+		if (header->submesh_data.count != header->submeshes.count) return false;
+
+		uint64 const geometry_size = header->geometry.count;
+		for (SubMeshGPU const& submesh : GetSubMeshes())
+		{
+			if (submesh.lod_count == 0 || submesh.lod_count > MESH_LOD_COUNT) return false;
+			if (!IsRangeInGeometry(submesh.positions_offset, submesh.vertices_count * sizeof(Vector3), geometry_size)) return false;
+			for (uint32 lod = 0; lod < submesh.lod_count; ++lod)
+			{
+				if (!IsRangeInGeometry(submesh.lods[lod].indices_offset, submesh.lods[lod].indices_count * sizeof(uint32), geometry_size)) return false;
+			}
+		}
+		for (CookedSubMeshData const& data : GetSubMeshData())
+		{
+			if (!IsArrayInFile<SceneBVHNode>(data.bvh_nodes, file_size) || !IsArrayInFile<Vector3>(data.bvh_vertices, file_size) ||
+				!IsArrayInFile<uint32>(data.bvh_triangles, file_size) || !IsArrayInFile<Vector3>(data.occluder_positions, file_size) ||
+				!IsArrayInFile<uint32>(data.occluder_indices, file_size)) return false;
+		}
+
+		std::span<CookedNode const> nodes = GetNodes();
+		for (uint64 i = 0; i < nodes.size(); ++i)
+		{
+			//node i + 1 in the hierarchy, parents always come first
+			if (nodes[i].parent > i) return false;
+		}
+		for (CookedInstance const& instance : GetInstances())
+		{
+			if (instance.submesh_index >= header->submeshes.count || instance.transform_node > nodes.size()) return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <span>
+#include "Components.h"
+#include "SceneBVH.h"
+#include "Utilities/MappedFile.h"
+
+namespace adria
+{
+	struct ModelParameters;
+
+	inline constexpr uint32 COOKED_MESH_MAGIC = 0x4D434441; //ADCM
+	inline constexpr uint32 COOKED_MESH_VERSION = 3;
+
+	//bytes of the geometry buffer at offset, the ranges of a mesh are disjoint and 16 byte aligned
+	struct GeometryBufferRange
+	{
+		void const* data;
+		uint64 size;
+		uint64 offset;
+	};
+
+	//offset in bytes from the start of the file, count in elements
+	struct CookedArray
+	{
+		uint64 offset;
+		uint64 count;
+	};
+
+	struct CookedNode
+	{
+		uint32 parent;
+		Matrix local_transform;
+	};
+
+	struct CookedInstance
+	{
+		uint32 submesh_index;
+		uint32 transform_node;
+	};
+
+	//per submesh CPU side data, the arrays are empty for non triangle list submeshes
+	struct CookedSubMeshData
+	{
+		CookedArray bvh_nodes;
+		CookedArray bvh_vertices;
+		CookedArray bvh_triangles;
+		CookedArray occluder_positions;
+		CookedArray occluder_indices;
+	};
+
+	struct CookedMeshHeader
+	{
+		uint32 magic;
+		uint32 version;
+		uint64 key;
+		uint64 file_size;
+		CookedArray texture_paths;	//null terminated strings, four per material in albedo, metallic roughness, normal, emissive order
+		CookedArray materials;		//texture handles are not meaningful
+		CookedArray submeshes;
+		CookedArray submesh_data;
+		CookedArray nodes;			//transform hierarchy without the root, node i is hierarchy node i + 1
+		CookedArray instances;
+		CookedArray geometry;		//geometry buffer contents, uploaded as is
+	};
+
+	//hash of the source file, the external buffers it references and the import parameters that change the cooked result. 0 if the source can't be read
+	uint64 ComputeCookedMeshKey(ModelParameters const& params);
+	std::string GetCookedMeshPath(ModelParameters const& params, uint64 key);
+	bool WriteCookedMesh(std::string const& path, uint64 key, Mesh const& mesh, std::span<std::string const> texture_paths,
+						 std::span<GeometryBufferRange const> geometry, uint64 geometry_size);
+
+	//memory mapped cooked mesh, the spans point into the mapping and stay valid while the object is alive
+	class CookedMesh
+	{
+	public:
+		bool Open(std::string const& path, uint64 key);
+		void Close();
+
+		void GetTexturePaths(std::vector<std::string>& texture_paths) const;
+		std::span<Material const> GetMaterials() const { return GetArray<Material>(header->materials); }
+		std::span<SubMeshGPU const> GetSubMeshes() const { return GetArray<SubMeshGPU>(header->submeshes); }
+		std::span<CookedSubMeshData const> GetSubMeshData() const { return GetArray<CookedSubMeshData>(header->submesh_data); }
+		std::span<CookedNode const> GetNodes() const { return GetArray<CookedNode>(header->nodes); }
+		std::span<CookedInstance const> GetInstances() const { return GetArray<CookedInstance>(header->instances); }
+		std::span<uint8 const> GetGeometry() const { return GetArray<uint8>(header->geometry); }
+
+		template<typename T>
+		std::span<T const> GetArray(CookedArray const& array) const
+		{
+			return std::span<T const>(reinterpret_cast<T const*>(file.GetData() + array.offset), array.count);
+		}
+
+	private:
+		MappedFile file;
+		CookedMeshHeader const* header = nullptr;
+
+	private:
+		bool Validate(uint64 key) const;
+	};
+}
@@ -0,0 +1,49 @@
+#include <bit>
+#include "DrawKeyList.h"
+#include "Utilities/RadixSort.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr uint64 DRAW_KEY_DEPTH_MASK = (1ull << 20) - 1;
+		constexpr uint64 DRAW_KEY_MATERIAL_MASK = (1ull << 20) - 1;
+		constexpr uint64 DRAW_KEY_GEOMETRY_MASK = (1ull << 16) - 1;
+	}
+
+	uint64 MakeDrawKey(uint32 bucket, GfxPrimitiveTopology topology, float view_distance, DrawKeyOrder order, uint32 material_index, uint32 geometry_buffer_slot)
+	{
+		ADRIA_ASSERT(bucket < 16);
+		//bits of a non negative float are ordered like the float itself, dropping the low mantissa bits quantizes it logarithmically
+		uint64 depth = std::bit_cast<uint32>(std::max(view_distance, 0.0f)) >> 11;
+		if (order == DrawKeyOrder::BackToFront) depth = DRAW_KEY_DEPTH_MASK - depth;
+
+		return (uint64(bucket) << 60) |
+			   ((uint64(topology) & 0xf) << 56) |
+			   ((depth & DRAW_KEY_DEPTH_MASK) << 36) |
+			   ((uint64(material_index) & DRAW_KEY_MATERIAL_MASK) << 16) |
+			   (uint64(geometry_buffer_slot) & DRAW_KEY_GEOMETRY_MASK);
+	}
+
+	void DrawKeyList::Clear()
+	{
+		keys.clear();
+		proxies.clear();
+	}
+
+	void DrawKeyList::Add(uint64 key, uint32 proxy)
+	{
+		keys.push_back(key);
+		proxies.push_back(proxy);
+	}
+
+	void DrawKeyList::Sort()
+	{
+		if (scratch_keys.size() < keys.size())
+		{
+			scratch_keys.resize(keys.size());
+			scratch_proxies.resize(proxies.size());
+		}
+		RadixSort(keys, proxies, scratch_keys, scratch_proxies);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	enum class GfxPrimitiveTopology : uint8;
+
+	enum class DrawKeyOrder : uint8
+	{
+		FrontToBack,
+		BackToFront
+	};
+
+	//bucket:4 | topology:4 | depth:20 | material:20 | geometry buffer:16
+	//depth comes before the state bits since draws are bindless and indirect, so ordering for early z matters more than state grouping
+	uint64 MakeDrawKey(uint32 bucket, GfxPrimitiveTopology topology, float view_distance, DrawKeyOrder order, uint32 material_index, uint32 geometry_buffer_slot);
+	inline uint32 GetDrawKeyBucket(uint64 key) { return uint32(key >> 60); }
+
+	class DrawKeyList
+	{
+	public:
+		void Clear();
+		void Add(uint64 key, uint32 proxy);
+		void Sort();
+
+		uint32 GetCount() const { return (uint32)keys.size(); }
+		uint64 GetKey(uint32 i) const { return keys[i]; }
+		uint32 GetProxy(uint32 i) const { return proxies[i]; }
+
+	private:
+		std::vector<uint64> keys;
+		std::vector<uint32> proxies;
+		std::vector<uint64> scratch_keys;
+		std::vector<uint32> scratch_proxies;
+	};
+}
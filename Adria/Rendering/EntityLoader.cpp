@@ -9,14 +9,21 @@
 #include "EntityLoader.h"
 #include "Components.h"
 #include "Meshlet.h"
+#include "TriangleBVH.h"
+#include "SoftwareOcclusion.h"
+#include "CookedMesh.h"
+#include "GLBFile.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxLinearDynamicAllocator.h"
 #include "Logging/Logger.h"
 #include "Math/BoundingVolumeUtil.h"
 #include "Core/Paths.h"
+#include "Core/ConsoleManager.h"
 #include "Utilities/StringUtil.h"
 #include "Utilities/FilesUtil.h"
 #include "Utilities/Heightmap.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Timer.h"
 
 
 using namespace DirectX;
@@ -24,6 +31,635 @@ using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<bool> MeshCache("r.MeshCache", true, "Import glTF models from cooked meshes in Saved/MeshCache when they are up to date, and cook them after importing from source");
+	static TAutoConsoleVariable<int> TextureCache("r.TextureCache", 1, "0 - load glTF material textures from their source images, 1 - load them from cooked DDS files in Saved/TextureCache when there are any, 2 - also cook the missing ones");
+
+	namespace
+	{
+		void BuildMeshlets(std::vector<uint32> const& indices, std::vector<Vector3> const& positions,
+			std::vector<Meshlet>& out_meshlets, std::vector<uint32>& out_meshlet_vertices, std::vector<MeshletTriangle>& out_meshlet_triangles)
+		{
+			uint64 const max_meshlets = meshopt_buildMeshletsBound(indices.size(), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+			out_meshlets.resize(max_meshlets);
+			out_meshlet_vertices.resize(max_meshlets * MESHLET_MAX_VERTICES);
+
+			std::vector<unsigned char> meshlet_triangles(max_meshlets * MESHLET_MAX_TRIANGLES * 3);
+			std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+
+			uint64 meshlet_count = meshopt_buildMeshlets(meshlets.data(), out_meshlet_vertices.data(), meshlet_triangles.data(),
+				indices.data(), indices.size(), &positions[0].x, positions.size(), sizeof(Vector3),
+				MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, 0);
+
+			meshopt_Meshlet const& last = meshlets[meshlet_count - 1];
+			meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
+			meshlets.resize(meshlet_count);
+
+			out_meshlets.resize(meshlet_count);
+			out_meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
+			out_meshlet_triangles.resize(meshlet_triangles.size() / 3);
+
+			uint32 triangle_offset = 0;
+			for (uint64 i = 0; i < meshlet_count; ++i)
+			{
+				meshopt_Meshlet const& m = meshlets[i];
+				meshopt_Bounds meshopt_bounds = meshopt_computeMeshletBounds(&out_meshlet_vertices[m.vertex_offset], &meshlet_triangles[m.triangle_offset],
+					m.triangle_count, reinterpret_cast<float const*>(positions.data()), positions.size(), sizeof(Vector3));
+
+				unsigned char* src_triangles = meshlet_triangles.data() + m.triangle_offset;
+				for (uint32 triangle_idx = 0; triangle_idx < m.triangle_count; ++triangle_idx)
+				{
+					MeshletTriangle& tri = out_meshlet_triangles[triangle_idx + triangle_offset];
+					tri.V0 = *src_triangles++;
+					tri.V1 = *src_triangles++;
+					tri.V2 = *src_triangles++;
+				}
+
+				Meshlet& meshlet = out_meshlets[i];
+				std::memcpy(meshlet.center, meshopt_bounds.center, sizeof(float) * 3);
+
+				meshlet.radius = meshopt_bounds.radius;
+				meshlet.vertex_count = m.vertex_count;
+				meshlet.triangle_count = m.triangle_count;
+				meshlet.vertex_offset = m.vertex_offset;
+				meshlet.triangle_offset = triangle_offset;
+				triangle_offset += m.triangle_count;
+
+			}
+			out_meshlet_triangles.resize(triangle_offset);
+		}
+
+		struct MeshData
+		{
+			DirectX::BoundingBox bounding_box;
+			float uv_world_scale = 0.0f;
+			int32 material_index = -1;
+			GfxPrimitiveTopology topology = GfxPrimitiveTopology::TriangleList;
+
+			std::vector<Vector3> positions_stream;
+			std::vector<Vector3> normals_stream;
+			std::vector<Vector4> tangents_stream;
+			std::vector<Vector2> uvs_stream;
+			std::vector<uint32>   indices;
+
+			std::vector<Meshlet>		 meshlets;
+			std::vector<uint32>			 meshlet_vertices;
+			std::vector<MeshletTriangle> meshlet_triangles;
+
+			struct LODData
+			{
+				std::vector<uint32>			 indices;
+				float						 error;
+				std::vector<Meshlet>		 meshlets;
+				std::vector<uint32>			 meshlet_vertices;
+				std::vector<MeshletTriangle> meshlet_triangles;
+			};
+			std::vector<LODData> lods;
+
+			std::shared_ptr<TriangleBVH>  triangle_bvh;
+			std::shared_ptr<OccluderMesh> occluder;
+		};
+
+		//where the bytes of a glTF buffer are and, if they come from a file, where that file keeps them
+		struct ModelBuffer
+		{
+			std::span<uint8 const> data;
+			std::string file_path;
+			uint64 file_offset = 0;
+		};
+
+		struct ModelData
+		{
+			MappedFile source_file;
+			tinygltf::Model model;
+			std::vector<ModelBuffer> buffers;
+			std::vector<MeshData> mesh_datas;
+			std::vector<std::vector<int32>> mesh_primitives; //mesh index -> primitive indices
+			uint64 texture_paths_offset = 0;
+			uint64 cooked_key = 0;
+			CookedMesh cooked_mesh;
+			bool cooked = false;
+			bool loaded = false;
+		};
+
+		bool ReadModel_GLTF(ModelParameters const& params, ModelData& model_data)
+		{
+			tinygltf::TinyGLTF loader;
+			tinygltf::Model& model = model_data.model;
+			std::string err;
+			std::string warn;
+
+			//images are decoded later by the texture manager, straight from their files or buffer views
+			loader.SetImageLoader([](tinygltf::Image*, int, std::string*, std::string*, int, int, unsigned char const*, int, void*) { return true; }, nullptr);
+
+			std::string base_path = GetParentPath(params.model_path);
+			if (!base_path.empty()) base_path += "/";
+
+			bool const is_binary = ToLower(GetExtension(params.model_path)) == ".glb";
+			GLBChunks glb_chunks{};
+			bool ret = false;
+			if (is_binary)
+			{
+				//the whole file is mapped once, the json is parsed from the mapping
+				if (!model_data.source_file.Open(params.model_path) || !ParseGLB(model_data.source_file.GetSpan(), glb_chunks))
+				{
+					ADRIA_LOG(ERROR, "%s is not a valid binary glTF file", params.model_path.c_str());
+					return false;
+				}
+				ret = loader.LoadBinaryFromMemory(&model, &err, &warn, model_data.source_file.GetData(), (uint32)model_data.source_file.GetSize(), base_path);
+			}
+			else
+			{
+				ret = loader.LoadASCIIFromFile(&model, &err, &warn, params.model_path);
+			}
+			if (!warn.empty())
+			{
+				ADRIA_LOG(WARNING, warn.c_str());
+			}
+			if (!err.empty())
+			{
+				ADRIA_LOG(ERROR, err.c_str());
+				return false;
+			}
+			if (!ret)
+			{
+				ADRIA_LOG(ERROR, "Failed to load model %s", GetFilename(params.model_path).c_str());
+				return false;
+			}
+
+			//tinygltf keeps its own copy of the glb binary chunk, it is dropped and accessors read from the mapping instead
+			model_data.buffers.resize(model.buffers.size());
+			for (uint64 i = 0; i < model.buffers.size(); ++i)
+			{
+				tinygltf::Buffer& buffer = model.buffers[i];
+				ModelBuffer& model_buffer = model_data.buffers[i];
+				if (is_binary && i == 0 && buffer.uri.empty())
+				{
+					model_buffer.data = glb_chunks.bin.first(std::min<uint64>(glb_chunks.bin.size(), buffer.data.size()));
+					model_buffer.file_path = params.model_path;
+					model_buffer.file_offset = glb_chunks.bin.data() - model_data.source_file.GetData();
+					std::vector<unsigned char>().swap(buffer.data);
+				}
+				else
+				{
+					model_buffer.data = buffer.data;
+					if (!buffer.uri.empty() && buffer.uri.rfind("data:", 0) != 0) model_buffer.file_path = base_path + buffer.uri;
+				}
+			}
+
+			int32 primitive_count = 0;
+			model_data.mesh_primitives.resize(model.meshes.size());
+			for (int32 i = 0; i < model.meshes.size(); ++i)
+			{
+				std::vector<int32>& primitives = model_data.mesh_primitives[i];
+				auto const& gltf_mesh = model.meshes[i];
+				for (auto const& gltf_primitive : gltf_mesh.primitives)
+				{
+					ADRIA_ASSERT(gltf_primitive.indices >= 0);
+					tinygltf::Accessor const& index_accessor = model.accessors[gltf_primitive.indices];
+					tinygltf::BufferView const& buffer_view = model.bufferViews[index_accessor.bufferView];
+					ModelBuffer const& buffer = model_data.buffers[buffer_view.buffer];
+
+					MeshData& mesh_data = model_data.mesh_datas.emplace_back();
+					mesh_data.material_index = gltf_primitive.material;
+
+					mesh_data.indices.reserve(index_accessor.count);
+					auto AddIndices = [&]<typename T>()
+					{
+						T* data = (T*)(buffer.data.data() + index_accessor.byteOffset + buffer_view.byteOffset);
+						uint32 triangle_cw[]   = { 0, 1, 2 };
+						uint32 triangle_ccw[]  = { 0, 2, 1 };
+						uint32* order = params.triangle_ccw ? triangle_ccw : triangle_cw;
+						for (uint64 i = 0; i < index_accessor.count; i += 3)
+						{
+							mesh_data.indices.push_back(data[i + order[0]]);
+							mesh_data.indices.push_back(data[i + order[1]]);
+							mesh_data.indices.push_back(data[i + order[2]]);
+						}
+					};
+					int stride = index_accessor.ByteStride(buffer_view);
+					switch (stride)
+					{
+					case 1:
+						AddIndices.template operator()<uint8>();
+						break;
+					case 2:
+						AddIndices.template operator()<uint16>();
+						break;
+					case 4:
+						AddIndices.template operator()<uint32>();
+						break;
+					default:
+						ADRIA_ASSERT(false);
+					}
+					switch (gltf_primitive.mode)
+					{
+					case TINYGLTF_MODE_POINTS:
+						mesh_data.topology = GfxPrimitiveTopology::PointList;
+						break;
+					case TINYGLTF_MODE_LINE:
+						mesh_data.topology = GfxPrimitiveTopology::LineList;
+						break;
+					case TINYGLTF_MODE_LINE_STRIP:
+						mesh_data.topology = GfxPrimitiveTopology::LineStrip;
+						break;
+					case TINYGLTF_MODE_TRIANGLES:
+						mesh_data.topology = GfxPrimitiveTopology::TriangleList;
+						break;
+					case TINYGLTF_MODE_TRIANGLE_STRIP:
+						mesh_data.topology = GfxPrimitiveTopology::TriangleStrip;
+						break;
+					default:
+						ADRIA_ASSERT(false);
+					}
+
+					for (auto const& attr : gltf_primitive.attributes)
+					{
+						std::string const& attr_name = attr.first;
+						int attr_data = attr.second;
+
+						const tinygltf::Accessor& accessor = model.accessors[attr_data];
+						const tinygltf::BufferView& buffer_view = model.bufferViews[accessor.bufferView];
+						ModelBuffer const& buffer = model_data.buffers[buffer_view.buffer];
+
+						int stride = accessor.ByteStride(buffer_view);
+						uint64 count = accessor.count;
+						const unsigned char* data = buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
+
+						auto ReadAttributeData = [&]<typename T>(std::vector<T>&stream, const char* stream_name)
+						{
+							if (!attr_name.compare(stream_name))
+							{
+								stream.reserve(count);
+								for (uint64 i = 0; i < count; ++i)
+								{
+									stream.push_back(*(T*)((uint64)data + i * stride));
+								}
+							}
+						};
+						ReadAttributeData(mesh_data.positions_stream, "POSITION");
+						ReadAttributeData(mesh_data.normals_stream, "NORMAL");
+						ReadAttributeData(mesh_data.tangents_stream, "TANGENT");
+						ReadAttributeData(mesh_data.uvs_stream, "TEXCOORD_0");
+					}
+					primitives.push_back(primitive_count++);
+				}
+			}
+			return true;
+		}
+
+		//object space length of one uv unit from the summed triangle areas, 0 for meshes without a uv mapping
+		float ComputeUVWorldScale(std::span<uint32 const> indices, std::span<Vector3 const> positions, std::span<Vector2 const> uvs)
+		{
+			double position_area = 0.0, uv_area = 0.0;
+			for (uint64 i = 0; i + 2 < indices.size(); i += 3)
+			{
+				Vector3 const& p0 = positions[indices[i]];
+				position_area += (positions[indices[i + 1]] - p0).Cross(positions[indices[i + 2]] - p0).Length();
+				Vector2 const uv_edge1 = uvs[indices[i + 1]] - uvs[indices[i]];
+				Vector2 const uv_edge2 = uvs[indices[i + 2]] - uvs[indices[i]];
+				uv_area += std::abs(uv_edge1.x * uv_edge2.y - uv_edge1.y * uv_edge2.x);
+			}
+			return uv_area > 0.0 ? float(std::sqrt(position_area / uv_area)) : 0.0f;
+		}
+
+		//only touches mesh_data so primitives can be processed concurrently
+		void ProcessMeshData(MeshData& mesh_data, ModelParameters const& params)
+		{
+			uint64 vertex_count = mesh_data.positions_stream.size();
+
+			bool has_tangents = !mesh_data.tangents_stream.empty();
+			if (mesh_data.normals_stream.size() != vertex_count) mesh_data.normals_stream.resize(vertex_count);
+			if (mesh_data.uvs_stream.size() != vertex_count) mesh_data.uvs_stream.resize(vertex_count);
+			if (mesh_data.tangents_stream.size() != vertex_count) mesh_data.tangents_stream.resize(vertex_count);
+
+			if (!has_tangents)
+			{
+				ComputeTangentFrame(mesh_data.indices.data(), mesh_data.indices.size(), mesh_data.positions_stream.data(),
+					mesh_data.normals_stream.data(), mesh_data.uvs_stream.data(), vertex_count, mesh_data.tangents_stream.data());
+			}
+
+			meshopt_optimizeVertexCache(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
+			meshopt_optimizeOverdraw(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3), 1.05f);
+			std::vector<uint32> remap(vertex_count);
+			meshopt_optimizeVertexFetchRemap(&remap[0], mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
+			meshopt_remapIndexBuffer(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &remap[0]);
+			meshopt_remapVertexBuffer(mesh_data.positions_stream.data(), mesh_data.positions_stream.data(), vertex_count, sizeof(Vector3), &remap[0]);
+			meshopt_remapVertexBuffer(mesh_data.normals_stream.data(), mesh_data.normals_stream.data(), mesh_data.normals_stream.size(), sizeof(Vector3), &remap[0]);
+			meshopt_remapVertexBuffer(mesh_data.tangents_stream.data(), mesh_data.tangents_stream.data(), mesh_data.tangents_stream.size(), sizeof(Vector4), &remap[0]);
+			meshopt_remapVertexBuffer(mesh_data.uvs_stream.data(), mesh_data.uvs_stream.data(), mesh_data.uvs_stream.size(), sizeof(Vector2), &remap[0]);
+
+			BuildMeshlets(mesh_data.indices, mesh_data.positions_stream, mesh_data.meshlets, mesh_data.meshlet_vertices, mesh_data.meshlet_triangles);
+
+			if (mesh_data.topology == GfxPrimitiveTopology::TriangleList)
+			{
+				std::span<float const> lod_ratios(params.lod_ratios.data(), std::min<uint64>(params.lod_ratios.size(), MESH_LOD_COUNT - 1));
+				for (MeshLODLevel& lod_level : BuildMeshLODs(mesh_data.indices, mesh_data.positions_stream, lod_ratios, params.lod_target_error))
+				{
+					auto& lod = mesh_data.lods.emplace_back();
+					lod.indices = std::move(lod_level.indices);
+					lod.error = lod_level.error;
+					BuildMeshlets(lod.indices, mesh_data.positions_stream, lod.meshlets, lod.meshlet_vertices, lod.meshlet_triangles);
+				}
+				mesh_data.uv_world_scale = ComputeUVWorldScale(mesh_data.indices, mesh_data.positions_stream, mesh_data.uvs_stream);
+				mesh_data.triangle_bvh = std::make_shared<TriangleBVH>(mesh_data.positions_stream, mesh_data.indices);
+				mesh_data.occluder = std::make_shared<OccluderMesh>(BuildOccluderMesh(mesh_data.indices, mesh_data.positions_stream));
+			}
+			mesh_data.bounding_box = AABBFromPositions(mesh_data.positions_stream);
+		}
+
+		//replaces material texture paths with the cooked DDS files of the texture cache, texture_paths has four paths per material
+		void UseCookedTextures(std::vector<std::string>& texture_paths, bool cook_missing)
+		{
+			static constexpr TextureUsage material_texture_usages[] = { TextureUsage::Albedo, TextureUsage::MetallicRoughness, TextureUsage::Normal, TextureUsage::Emissive };
+			auto FindCookedMaterialTexture = [&texture_paths](uint64 i, bool cook)
+			{
+				return texture_paths[i].empty() ? std::string{} : FindCookedTexture(texture_paths[i], TextureCookParameters{ .usage = material_texture_usages[i % 4] }, cook);
+			};
+
+			//lookups only hash the sources so they run in parallel, cooking is parallel internally and runs one texture at a time
+			std::vector<std::string> cooked_paths(texture_paths.size());
+			ParallelFor(texture_paths.size(), [&](uint64 i) { cooked_paths[i] = FindCookedMaterialTexture(i, false); });
+			for (uint64 i = 0; i < texture_paths.size(); ++i)
+			{
+				if (cooked_paths[i].empty() && cook_missing) cooked_paths[i] = FindCookedMaterialTexture(i, true);
+				if (!cooked_paths[i].empty()) texture_paths[i] = std::move(cooked_paths[i]);
+			}
+		}
+
+		//four paths per material in albedo, metallic roughness, normal, emissive order, empty if the material has no such texture.
+		//images stored in buffer views get a path to their bytes inside the buffer's file
+		void AddMaterialTexturePaths(ModelData const& model_data, std::string const& textures_path, std::vector<std::string>& texture_paths)
+		{
+			tinygltf::Model const& model = model_data.model;
+			auto AddTexturePath = [&](int texture_index)
+			{
+				if (texture_index < 0 || model.textures[texture_index].source < 0)
+				{
+					texture_paths.emplace_back();
+					return;
+				}
+
+				tinygltf::Image const& image = model.images[model.textures[texture_index].source];
+				if (image.bufferView >= 0)
+				{
+					tinygltf::BufferView const& buffer_view = model.bufferViews[image.bufferView];
+					ModelBuffer const& buffer = model_data.buffers[buffer_view.buffer];
+					if (!buffer.file_path.empty())
+					{
+						texture_paths.push_back(MakeEmbeddedTexturePath(buffer.file_path, buffer.file_offset + buffer_view.byteOffset, buffer_view.byteLength));
+						return;
+					}
+				}
+				else if (!image.uri.empty() && image.uri.rfind("data:", 0) != 0)
+				{
+					texture_paths.push_back(textures_path + image.uri);
+					return;
+				}
+				ADRIA_LOG(WARNING, "Image %s is embedded as a data uri which is not supported, using a default texture", image.name.c_str());
+				texture_paths.emplace_back();
+			};
+			for (auto const& gltf_material : model.materials)
+			{
+				AddTexturePath(gltf_material.pbrMetallicRoughness.baseColorTexture.index);
+				AddTexturePath(gltf_material.pbrMetallicRoughness.metallicRoughnessTexture.index);
+				AddTexturePath(gltf_material.normalTexture.index);
+				AddTexturePath(gltf_material.emissiveTexture.index);
+			}
+		}
+
+		//everything but the textures and the geometry buffer, geometry receives the byte layout of the buffer
+		void BuildMeshFromSource(Mesh& mesh, ModelParameters const& params, ModelData& model_data, std::vector<GeometryBufferRange>& geometry, uint64& geometry_size)
+		{
+			tinygltf::Model const& model = model_data.model;
+			std::vector<MeshData>& mesh_datas = model_data.mesh_datas;
+
+			mesh.materials.reserve(model.materials.size());
+			for (uint64 material_index = 0; material_index < model.materials.size(); ++material_index)
+			{
+				tinygltf::Material const& gltf_material = model.materials[material_index];
+				Material& material = mesh.materials.emplace_back();
+				material.alpha_cutoff = (float)gltf_material.alphaCutoff;
+				material.double_sided = gltf_material.doubleSided;
+
+				if (params.force_mask_alpha_usage)
+				{
+					material.alpha_mode = MaterialAlphaMode::Mask;
+				}
+				if (gltf_material.alphaMode == "OPAQUE")
+				{
+					material.alpha_mode = MaterialAlphaMode::Opaque;
+				}
+				else if (gltf_material.alphaMode == "BLEND")
+				{
+					material.alpha_mode = MaterialAlphaMode::Blend;
+				}
+				else if (gltf_material.alphaMode == "MASK")
+				{
+					material.alpha_mode = MaterialAlphaMode::Mask;
+				}
+				tinygltf::PbrMetallicRoughness pbr_metallic_roughness = gltf_material.pbrMetallicRoughness;
+				material.base_color[0] = (float)pbr_metallic_roughness.baseColorFactor[0];
+				material.base_color[1] = (float)pbr_metallic_roughness.baseColorFactor[1];
+				material.base_color[2] = (float)pbr_metallic_roughness.baseColorFactor[2];
+				material.metallic_factor = (float)pbr_metallic_roughness.metallicFactor;
+				material.roughness_factor = (float)pbr_metallic_roughness.roughnessFactor;
+				material.emissive_factor = (float)gltf_material.emissiveFactor[0];
+			}
+
+			//only the layout is decided here, the ranges are copied into the staging buffer later
+			auto AddCopy = [&geometry, &geometry_size]<typename T>(std::vector<T> const& _data)
+			{
+				uint64 current_copy_size = _data.size() * sizeof(T);
+				geometry.push_back(GeometryBufferRange{ _data.data(), current_copy_size, geometry_size });
+				uint32 current_offset = (uint32)geometry_size;
+				geometry_size += Align(current_copy_size, 16);
+				return current_offset;
+			};
+
+			mesh.submeshes.reserve(mesh_datas.size());
+			mesh.triangle_bvhs.reserve(mesh_datas.size());
+			mesh.occluders.reserve(mesh_datas.size());
+			for (uint64 i = 0; i < mesh_datas.size(); ++i)
+			{
+				auto& mesh_data = mesh_datas[i];
+
+				SubMeshGPU& submesh = mesh.submeshes.emplace_back();
+
+				submesh.indices_offset = AddCopy(mesh_data.indices);
+				submesh.indices_count = (uint32)mesh_data.indices.size();
+
+				submesh.vertices_count = (uint32)mesh_data.positions_stream.size();
+				submesh.positions_offset = AddCopy(mesh_data.positions_stream);
+				submesh.uvs_offset = AddCopy(mesh_data.uvs_stream);
+				submesh.normals_offset = AddCopy(mesh_data.normals_stream);
+				submesh.tangents_offset = AddCopy(mesh_data.tangents_stream);
+
+				submesh.meshlet_offset = AddCopy(mesh_data.meshlets);
+				submesh.meshlet_vertices_offset = AddCopy(mesh_data.meshlet_vertices);
+				submesh.meshlet_triangles_offset = AddCopy(mesh_data.meshlet_triangles);
+				submesh.meshlet_count = (uint32)mesh_data.meshlets.size();
+
+				submesh.lods[0] = SubMeshLOD
+				{
+					.indices_offset = submesh.indices_offset, .indices_count = submesh.indices_count,
+					.meshlet_offset = submesh.meshlet_offset, .meshlet_vertices_offset = submesh.meshlet_vertices_offset,
+					.meshlet_triangles_offset = submesh.meshlet_triangles_offset, .meshlet_count = submesh.meshlet_count
+				};
+				submesh.lod_errors.fill(0.0f);
+				submesh.lod_count = 1;
+				for (auto const& lod_data : mesh_data.lods)
+				{
+					SubMeshLOD& lod = submesh.lods[submesh.lod_count];
+					lod.indices_offset = AddCopy(lod_data.indices);
+					lod.indices_count = (uint32)lod_data.indices.size();
+					lod.meshlet_offset = AddCopy(lod_data.meshlets);
+					lod.meshlet_vertices_offset = AddCopy(lod_data.meshlet_vertices);
+					lod.meshlet_triangles_offset = AddCopy(lod_data.meshlet_triangles);
+					lod.meshlet_count = (uint32)lod_data.meshlets.size();
+					submesh.lod_errors[submesh.lod_count] = lod_data.error;
+					++submesh.lod_count;
+				}
+
+				submesh.bounding_box = mesh_data.bounding_box;
+				submesh.uv_world_scale = mesh_data.uv_world_scale;
+				submesh.topology = mesh_data.topology;
+				submesh.material_index = mesh_data.material_index;
+
+				mesh.triangle_bvhs.push_back(std::move(mesh_data.triangle_bvh));
+				mesh.occluders.push_back(std::move(mesh_data.occluder));
+			}
+
+			//nodes are visited breadth first so the transform hierarchy is built in level order, the model matrix becomes its root
+			TransformHierarchy& transform_hierarchy = mesh.transform_hierarchy;
+			uint32 const root_node = transform_hierarchy.AddNode(TransformHierarchy::INVALID_NODE, params.model_matrix);
+
+			tinygltf::Scene const& scene = model.scenes[std::max(0, model.defaultScene)];
+			std::vector<std::pair<int, uint32>> node_queue;
+			for (int scene_node : scene.nodes) node_queue.emplace_back(scene_node, root_node);
+			for (uint64 queue_index = 0; queue_index < node_queue.size(); ++queue_index)
+			{
+				auto [node_index, parent_node] = node_queue[queue_index];
+				if (node_index < 0) continue;
+				auto& node = model.nodes[node_index];
+				struct Transforms
+				{
+					Vector4 rotation_local = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+					Vector3 scale_local = Vector3(1.0f, 1.0f, 1.0f);
+					Vector3 translation_local = Vector3(0.0f, 0.0f, 0.0f);
+					Matrix world = Matrix::Identity;
+					bool update = true;
+					void Update()
+					{
+						if (update)
+						{
+								world = Matrix::CreateScale(scale_local) *
+								Matrix::CreateFromQuaternion(rotation_local) *
+								Matrix::CreateTranslation(translation_local);
+						}
+					}
+				} transforms;
+
+				if (!node.scale.empty())
+				{
+					transforms.scale_local = Vector3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
+				}
+				if (!node.rotation.empty())
+				{
+					transforms.rotation_local = Vector4((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]);
+				}
+				if (!node.translation.empty())
+				{
+					transforms.translation_local = Vector3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
+				}
+				if (!node.matrix.empty())
+				{
+					transforms.world._11 = (float)node.matrix[0];
+					transforms.world._12 = (float)node.matrix[1];
+					transforms.world._13 = (float)node.matrix[2];
+					transforms.world._14 = (float)node.matrix[3];
+					transforms.world._21 = (float)node.matrix[4];
+					transforms.world._22 = (float)node.matrix[5];
+					transforms.world._23 = (float)node.matrix[6];
+					transforms.world._24 = (float)node.matrix[7];
+					transforms.world._31 = (float)node.matrix[8];
+					transforms.world._32 = (float)node.matrix[9];
+					transforms.world._33 = (float)node.matrix[10];
+					transforms.world._34 = (float)node.matrix[11];
+					transforms.world._41 = (float)node.matrix[12];
+					transforms.world._42 = (float)node.matrix[13];
+					transforms.world._43 = (float)node.matrix[14];
+					transforms.world._44 = (float)node.matrix[15];
+					transforms.update = false;
+				}
+				transforms.Update();
+
+				uint32 const transform_node = transform_hierarchy.AddNode(parent_node, transforms.world);
+				if (node.mesh >= 0)
+				{
+					for (auto primitive : model_data.mesh_primitives[node.mesh])
+					{
+						SubMeshInstance& instance = mesh.instances.emplace_back();
+						instance.submesh_index = primitive;
+						instance.transform_node = transform_node;
+					}
+				}
+				for (int child : node.children) node_queue.emplace_back(child, transform_node);
+			}
+		}
+
+		void BuildMeshFromCooked(Mesh& mesh, ModelParameters const& params, CookedMesh const& cooked_mesh, std::vector<GeometryBufferRange>& geometry, uint64& geometry_size)
+		{
+			std::span<Material const> materials = cooked_mesh.GetMaterials();
+			std::span<SubMeshGPU const> submeshes = cooked_mesh.GetSubMeshes();
+			mesh.materials.assign(materials.begin(), materials.end());
+			mesh.submeshes.assign(submeshes.begin(), submeshes.end());
+
+			mesh.triangle_bvhs.reserve(submeshes.size());
+			mesh.occluders.reserve(submeshes.size());
+			for (CookedSubMeshData const& submesh_data : cooked_mesh.GetSubMeshData())
+			{
+				std::shared_ptr<TriangleBVH> triangle_bvh = nullptr;
+				if (submesh_data.bvh_nodes.count > 0)
+				{
+					triangle_bvh = std::make_shared<TriangleBVH>(cooked_mesh.GetArray<SceneBVHNode>(submesh_data.bvh_nodes),
+						cooked_mesh.GetArray<Vector3>(submesh_data.bvh_vertices), cooked_mesh.GetArray<uint32>(submesh_data.bvh_triangles));
+				}
+				mesh.triangle_bvhs.push_back(std::move(triangle_bvh));
+
+				std::shared_ptr<OccluderMesh> occluder = nullptr;
+				if (submesh_data.occluder_indices.count > 0)
+				{
+					std::span<Vector3 const> occluder_positions = cooked_mesh.GetArray<Vector3>(submesh_data.occluder_positions);
+					std::span<uint32 const> occluder_indices = cooked_mesh.GetArray<uint32>(submesh_data.occluder_indices);
+					occluder = std::make_shared<OccluderMesh>();
+					occluder->positions.assign(occluder_positions.begin(), occluder_positions.end());
+					occluder->indices.assign(occluder_indices.begin(), occluder_indices.end());
+				}
+				mesh.occluders.push_back(std::move(occluder));
+			}
+
+			TransformHierarchy& transform_hierarchy = mesh.transform_hierarchy;
+			transform_hierarchy.AddNode(TransformHierarchy::INVALID_NODE, params.model_matrix);
+			for (CookedNode const& node : cooked_mesh.GetNodes()) transform_hierarchy.AddNode(node.parent, node.local_transform);
+
+			mesh.instances.reserve(cooked_mesh.GetInstances().size());
+			for (CookedInstance const& cooked_instance : cooked_mesh.GetInstances())
+			{
+				SubMeshInstance& instance = mesh.instances.emplace_back();
+				instance.submesh_index = cooked_instance.submesh_index;
+				instance.transform_node = cooked_instance.transform_node;
+			}
+
+			//the mapping is copied in slices so the page faults are spread over the thread pool
+			static constexpr uint64 GEOMETRY_SLICE_SIZE = 1 << 22;
+			std::span<uint8 const> cooked_geometry = cooked_mesh.GetGeometry();
+			for (uint64 offset = 0; offset < cooked_geometry.size(); offset += GEOMETRY_SLICE_SIZE)
+			{
+				geometry.push_back(GeometryBufferRange{ cooked_geometry.data() + offset, std::min(GEOMETRY_SLICE_SIZE, cooked_geometry.size() - offset), offset });
+			}
+			geometry_size = cooked_geometry.size();
+		}
+	}
 
 	std::vector<entt::entity> EntityLoader::LoadGrid(GridParameters const& params)
 	{
@@ -322,7 +958,12 @@ namespace adria
         Skybox sky{};
         sky.active = true;
 
-        if (params.cubemap.has_value()) sky.cubemap_texture = g_TextureManager.LoadTexture(params.cubemap.value());
+        if (params.cubemap.has_value())
+        {
+            //the sky pass imports the cubemap into the render graph so it can't wait for a background load
+            sky.cubemap_texture = g_TextureManager.LoadTexture(params.cubemap.value());
+            g_TextureManager.WaitForTexture(sky.cubemap_texture);
+        }
         else sky.cubemap_texture = g_TextureManager.LoadCubemap(params.cubemap_textures);
 
         reg.emplace<Skybox>(skybox, sky);
@@ -451,8 +1092,8 @@ namespace adria
 		g_TextureManager.EnableMipMaps(false);
 		if (!params.albedo_texture_path.empty()) decal.albedo_decal_texture = g_TextureManager.LoadTexture(params.albedo_texture_path);
 		else decal.albedo_decal_texture = g_TextureManager.LoadTexture(paths::TexturesDir + "Decals/Decal_00_Albedo.tga");
-		if (!params.normal_texture_path.empty()) decal.normal_decal_texture = g_TextureManager.LoadTexture(params.normal_texture_path);
-		else decal.normal_decal_texture = g_TextureManager.LoadTexture(paths::TexturesDir + "Decals/Decal_00_Normal.tga");
+		if (!params.normal_texture_path.empty()) decal.normal_decal_texture = g_TextureManager.LoadTexture(params.normal_texture_path, DEFAULT_NORMAL_TEXTURE_HANDLE);
+		else decal.normal_decal_texture = g_TextureManager.LoadTexture(paths::TexturesDir + "Decals/Decal_00_Normal.tga", DEFAULT_NORMAL_TEXTURE_HANDLE);
 		g_TextureManager.EnableMipMaps(true);
 
 		Vector3 P = params.position;
@@ -488,449 +1129,121 @@ namespace adria
 
 	entt::entity EntityLoader::ImportModel_GLTF(ModelParameters const& params)
 	{
-		tinygltf::TinyGLTF loader;
-		tinygltf::Model model;
-		std::string err;
-		std::string warn;
-		bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, params.model_path);
-		std::string model_name = GetFilename(params.model_path);
-		if (!warn.empty())
-		{
-			ADRIA_LOG(WARNING, warn.c_str());
-		}
-		if (!err.empty())
-		{
-			ADRIA_LOG(ERROR, err.c_str());
-			return {};
-		}
-		if (!ret)
-		{
-			ADRIA_LOG(ERROR, "Failed to load model %s", model_name.c_str());
-			return {};
-		}
-		entt::entity mesh_entity = reg.create();
-		Mesh mesh{};
-
-		//process the materials
-		mesh.materials.reserve(model.materials.size());
-		for (auto const& gltf_material : model.materials)
-		{
-			Material& material = mesh.materials.emplace_back();
-			material.alpha_cutoff = (float)gltf_material.alphaCutoff;
-			material.double_sided = gltf_material.doubleSided;
-
-			if (params.force_mask_alpha_usage)
-			{
-				material.alpha_mode = MaterialAlphaMode::Mask;
-			}
-			if (gltf_material.alphaMode == "OPAQUE")
-			{
-				material.alpha_mode = MaterialAlphaMode::Opaque;
-			}
-			else if (gltf_material.alphaMode == "BLEND")
-			{
-				material.alpha_mode = MaterialAlphaMode::Blend;
-			}
-			else if (gltf_material.alphaMode == "MASK")
-			{
-				material.alpha_mode = MaterialAlphaMode::Mask;
-			}
-			tinygltf::PbrMetallicRoughness pbr_metallic_roughness = gltf_material.pbrMetallicRoughness;
-			material.base_color[0] = (float)pbr_metallic_roughness.baseColorFactor[0];
-			material.base_color[1] = (float)pbr_metallic_roughness.baseColorFactor[1];
-			material.base_color[2] = (float)pbr_metallic_roughness.baseColorFactor[2];
-			material.metallic_factor = (float)pbr_metallic_roughness.metallicFactor;
-			material.roughness_factor = (float)pbr_metallic_roughness.roughnessFactor;
-			material.emissive_factor = (float)gltf_material.emissiveFactor[0];
-
-			if (pbr_metallic_roughness.baseColorTexture.index >= 0)
-			{
-				tinygltf::Texture const& base_texture = model.textures[pbr_metallic_roughness.baseColorTexture.index];
-				tinygltf::Image const& base_image = model.images[base_texture.source];
-				std::string texbase = params.textures_path + base_image.uri;
-				material.albedo_texture = g_TextureManager.LoadTexture(texbase);
-			}
-			else
-			{
-				material.albedo_texture = DEFAULT_WHITE_TEXTURE_HANDLE;
-			}
-
-			if (pbr_metallic_roughness.metallicRoughnessTexture.index >= 0)
-			{
-				tinygltf::Texture const& metallic_roughness_texture = model.textures[pbr_metallic_roughness.metallicRoughnessTexture.index];
-				tinygltf::Image const& metallic_roughness_image = model.images[metallic_roughness_texture.source];
-				std::string texmetallicroughness = params.textures_path + metallic_roughness_image.uri;
-				material.metallic_roughness_texture = g_TextureManager.LoadTexture(texmetallicroughness);
-			}
-			else
-			{
-				material.metallic_roughness_texture = DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE;
-			}
+		return ImportModels_GLTF(std::span<ModelParameters const>(&params, 1))[0];
+	}
 
-			if (gltf_material.normalTexture.index >= 0)
-			{
-				tinygltf::Texture const& normal_texture = model.textures[gltf_material.normalTexture.index];
-				tinygltf::Image const& normal_image = model.images[normal_texture.source];
-				std::string texnormal = params.textures_path + normal_image.uri;
-				material.normal_texture = g_TextureManager.LoadTexture(texnormal);
-			}
-			else
-			{
-				material.normal_texture = DEFAULT_NORMAL_TEXTURE_HANDLE;
-			}
+	std::vector<entt::entity> EntityLoader::ImportModels_GLTF(std::span<ModelParameters const> models)
+	{
+		Timer import_timer;
 
-			if (gltf_material.emissiveTexture.index >= 0)
-			{
-				tinygltf::Texture const& emissive_texture = model.textures[gltf_material.emissiveTexture.index];
-				tinygltf::Image const& emissive_image = model.images[emissive_texture.source];
-				std::string texemissive = params.textures_path + emissive_image.uri;
-				material.emissive_texture = g_TextureManager.LoadTexture(texemissive);
-			}
-			else
+		//up to date cooked meshes are mapped instead of parsed, their primitives skip the processing below
+		std::vector<ModelData> model_datas(models.size());
+		ParallelFor(models.size(), [&](uint64 i)
+		{
+			ModelData& model_data = model_datas[i];
+			if (MeshCache.Get())
 			{
-				material.emissive_texture = DEFAULT_BLACK_TEXTURE_HANDLE;
+				model_data.cooked_key = ComputeCookedMeshKey(models[i]);
+				model_data.cooked = model_data.cooked_key != 0 && model_data.cooked_mesh.Open(GetCookedMeshPath(models[i], model_data.cooked_key), model_data.cooked_key);
 			}
-		}
-
-		std::unordered_map<int32, std::vector<int32>> mesh_primitives_map; //mesh index -> vector of primitive indices
-		int32 primitive_count = 0;
+			model_data.loaded = model_data.cooked || ReadModel_GLTF(models[i], model_data);
+		});
 
-		struct MeshData
-		{
-			DirectX::BoundingBox bounding_box;
-			int32 material_index = -1;
-			GfxPrimitiveTopology topology = GfxPrimitiveTopology::TriangleList;
-
-			std::vector<Vector3> positions_stream;
-			std::vector<Vector3> normals_stream;
-			std::vector<Vector4> tangents_stream;
-			std::vector<Vector2> uvs_stream;
-			std::vector<uint32>   indices;
-
-			std::vector<Meshlet>		 meshlets;
-			std::vector<uint32>			 meshlet_vertices;
-			std::vector<MeshletTriangle> meshlet_triangles;
-		};
-		std::vector<MeshData> mesh_datas{};
-		for (int32 i = 0; i < model.meshes.size(); ++i)
+		//largest primitives go first so a big one doesn't end up alone at the tail
+		std::vector<std::pair<MeshData*, ModelParameters const*>> primitives;
+		for (uint64 i = 0; i < models.size(); ++i)
 		{
-			std::vector<int32>& primitives = mesh_primitives_map[i];
-			auto const& gltf_mesh = model.meshes[i];
-			for (auto const& gltf_primitive : gltf_mesh.primitives)
-			{
-				ADRIA_ASSERT(gltf_primitive.indices >= 0);
-				tinygltf::Accessor const& index_accessor = model.accessors[gltf_primitive.indices];
-				tinygltf::BufferView const& buffer_view = model.bufferViews[index_accessor.bufferView];
-				tinygltf::Buffer const& buffer = model.buffers[buffer_view.buffer];
-
-				MeshData& mesh_data = mesh_datas.emplace_back();
-				mesh_data.material_index = gltf_primitive.material;
-
-				mesh_data.indices.reserve(index_accessor.count);
-				auto AddIndices = [&]<typename T>()
-				{
-					T* data = (T*)(buffer.data.data() + index_accessor.byteOffset + buffer_view.byteOffset);
-					uint32 triangle_cw[]   = { 0, 1, 2 };
-					uint32 triangle_ccw[]  = { 0, 2, 1 };
-					uint32* order = params.triangle_ccw ? triangle_ccw : triangle_cw;
-					for (uint64 i = 0; i < index_accessor.count; i += 3)
-					{
-						mesh_data.indices.push_back(data[i + order[0]]);
-						mesh_data.indices.push_back(data[i + order[1]]);
-						mesh_data.indices.push_back(data[i + order[2]]);
-					}
-				};
-				int stride = index_accessor.ByteStride(buffer_view);
-				switch (stride)
-				{
-				case 1:
-					AddIndices.template operator()<uint8>();
-					break;
-				case 2:
-					AddIndices.template operator()<uint16>();
-					break;
-				case 4:
-					AddIndices.template operator()<uint32>();
-					break;
-				default:
-					ADRIA_ASSERT(false);
-				}
-				switch (gltf_primitive.mode)
-				{
-				case TINYGLTF_MODE_POINTS:
-					mesh_data.topology = GfxPrimitiveTopology::PointList;
-					break;
-				case TINYGLTF_MODE_LINE:
-					mesh_data.topology = GfxPrimitiveTopology::LineList;
-					break;
-				case TINYGLTF_MODE_LINE_STRIP:
-					mesh_data.topology = GfxPrimitiveTopology::LineStrip;
-					break;
-				case TINYGLTF_MODE_TRIANGLES:
-					mesh_data.topology = GfxPrimitiveTopology::TriangleList;
-					break;
-				case TINYGLTF_MODE_TRIANGLE_STRIP:
-					mesh_data.topology = GfxPrimitiveTopology::TriangleStrip;
-					break;
-				default:
-					ADRIA_ASSERT(false);
-				}
-
-				for (auto const& attr : gltf_primitive.attributes)
-				{
-					std::string const& attr_name = attr.first;
-					int attr_data = attr.second;
-
-					const tinygltf::Accessor& accessor = model.accessors[attr_data];
-					const tinygltf::BufferView& buffer_view = model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = model.buffers[buffer_view.buffer];
-
-					int stride = accessor.ByteStride(buffer_view);
-					uint64 count = accessor.count;
-					const unsigned char* data = buffer.data.data() + accessor.byteOffset + buffer_view.byteOffset;
-
-					auto ReadAttributeData = [&]<typename T>(std::vector<T>&stream, const char* stream_name)
-					{
-						if (!attr_name.compare(stream_name))
-						{
-							stream.reserve(count);
-							for (uint64 i = 0; i < count; ++i)
-							{
-								stream.push_back(*(T*)((uint64)data + i * stride));
-							}
-						}
-					};
-					ReadAttributeData(mesh_data.positions_stream, "POSITION");
-					ReadAttributeData(mesh_data.normals_stream, "NORMAL");
-					ReadAttributeData(mesh_data.tangents_stream, "TANGENT");
-					ReadAttributeData(mesh_data.uvs_stream, "TEXCOORD_0");
-				}
-				primitives.push_back(primitive_count++);
-			}
+			for (MeshData& mesh_data : model_datas[i].mesh_datas) primitives.emplace_back(&mesh_data, &models[i]);
 		}
+		std::sort(primitives.begin(), primitives.end(), [](auto const& a, auto const& b) { return a.first->indices.size() > b.first->indices.size(); });
+		ParallelFor(primitives.size(), [&](uint64 i) { ProcessMeshData(*primitives[i].first, *primitives[i].second); });
 
-		uint64 total_buffer_size = 0;
-		for (auto& mesh_data : mesh_datas)
+		std::vector<std::string> texture_paths;
+		for (uint64 i = 0; i < models.size(); ++i)
 		{
-			std::vector<uint32> const& indices = mesh_data.indices;
-			uint64 vertex_count = mesh_data.positions_stream.size();
-
-			bool has_tangents = !mesh_data.tangents_stream.empty();
-			if (mesh_data.normals_stream.size() != vertex_count) mesh_data.normals_stream.resize(vertex_count);
-			if (mesh_data.uvs_stream.size() != vertex_count) mesh_data.uvs_stream.resize(vertex_count);
-			if (mesh_data.tangents_stream.size() != vertex_count) mesh_data.tangents_stream.resize(vertex_count);
-
-			if (!has_tangents)
-			{
-				ComputeTangentFrame(mesh_data.indices.data(), mesh_data.indices.size(), mesh_data.positions_stream.data(),
-					mesh_data.normals_stream.data(), mesh_data.uvs_stream.data(), vertex_count, mesh_data.tangents_stream.data());
-			}
-
-			meshopt_optimizeVertexCache(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
-			meshopt_optimizeOverdraw(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, vertex_count, sizeof(Vector3), 1.05f);
-			std::vector<uint32> remap(vertex_count);
-			meshopt_optimizeVertexFetchRemap(&remap[0], mesh_data.indices.data(), mesh_data.indices.size(), vertex_count);
-			meshopt_remapIndexBuffer(mesh_data.indices.data(), mesh_data.indices.data(), mesh_data.indices.size(), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.positions_stream.data(), mesh_data.positions_stream.data(), vertex_count, sizeof(Vector3), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.normals_stream.data(), mesh_data.normals_stream.data(), mesh_data.normals_stream.size(), sizeof(Vector3), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.tangents_stream.data(), mesh_data.tangents_stream.data(), mesh_data.tangents_stream.size(), sizeof(Vector4), &remap[0]);
-			meshopt_remapVertexBuffer(mesh_data.uvs_stream.data(), mesh_data.uvs_stream.data(), mesh_data.uvs_stream.size(), sizeof(Vector2), &remap[0]);
-
-			uint64 const max_meshlets = meshopt_buildMeshletsBound(mesh_data.indices.size(), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
-			mesh_data.meshlets.resize(max_meshlets);
-			mesh_data.meshlet_vertices.resize(max_meshlets * MESHLET_MAX_VERTICES);
-
-			std::vector<unsigned char> meshlet_triangles(max_meshlets * MESHLET_MAX_TRIANGLES * 3);
-			std::vector<meshopt_Meshlet> meshlets(max_meshlets);
-
-			uint64 meshlet_count = meshopt_buildMeshlets(meshlets.data(), mesh_data.meshlet_vertices.data(), meshlet_triangles.data(),
-				mesh_data.indices.data(), mesh_data.indices.size(), &mesh_data.positions_stream[0].x, mesh_data.positions_stream.size(), sizeof(Vector3),
-				MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, 0);
-
-			meshopt_Meshlet const& last = meshlets[meshlet_count - 1];
-			meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
-			meshlets.resize(meshlet_count);
-
-			mesh_data.meshlets.resize(meshlet_count);
-			mesh_data.meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
-			mesh_data.meshlet_triangles.resize(meshlet_triangles.size() / 3);
-
-			uint32 triangle_offset = 0;
-			for (uint64 i = 0; i < meshlet_count; ++i)
-			{
-				meshopt_Meshlet const& m = meshlets[i];
-				meshopt_Bounds meshopt_bounds = meshopt_computeMeshletBounds(&mesh_data.meshlet_vertices[m.vertex_offset], &meshlet_triangles[m.triangle_offset],
-					m.triangle_count, reinterpret_cast<float const*>(mesh_data.positions_stream.data()), vertex_count, sizeof(Vector3));
-
-				unsigned char* src_triangles = meshlet_triangles.data() + m.triangle_offset;
-				for (uint32 triangle_idx = 0; triangle_idx < m.triangle_count; ++triangle_idx)
-				{
-					MeshletTriangle& tri = mesh_data.meshlet_triangles[triangle_idx + triangle_offset];
-					tri.V0 = *src_triangles++;
-					tri.V1 = *src_triangles++;
-					tri.V2 = *src_triangles++;
-				}
-
-				Meshlet& meshlet = mesh_data.meshlets[i];
-				std::memcpy(meshlet.center, meshopt_bounds.center, sizeof(float) * 3);
-
-				meshlet.radius = meshopt_bounds.radius;
-				meshlet.vertex_count = m.vertex_count;
-				meshlet.triangle_count = m.triangle_count;
-				meshlet.vertex_offset = m.vertex_offset;
-				meshlet.triangle_offset = triangle_offset;
-				triangle_offset += m.triangle_count;
-
-			}
-			mesh_data.meshlet_triangles.resize(triangle_offset);
-
-			total_buffer_size += Align(mesh_data.indices.size() * sizeof(uint32), 16);
-			total_buffer_size += Align(mesh_data.positions_stream.size() * sizeof(Vector3), 16);
-			total_buffer_size += Align(mesh_data.uvs_stream.size() * sizeof(Vector2), 16);
-			total_buffer_size += Align(mesh_data.normals_stream.size() * sizeof(Vector3), 16);
-			total_buffer_size += Align(mesh_data.tangents_stream.size() * sizeof(Vector4), 16);
-			total_buffer_size += Align(mesh_data.meshlets.size() * sizeof(Meshlet), 16);
-			total_buffer_size += Align(mesh_data.meshlet_vertices.size() * sizeof(uint32), 16);
-			total_buffer_size += Align(mesh_data.meshlet_triangles.size() * sizeof(MeshletTriangle), 16);
-
-			mesh_data.bounding_box = AABBFromPositions(mesh_data.positions_stream);
+			ModelData& model_data = model_datas[i];
+			model_data.texture_paths_offset = texture_paths.size();
+			if (model_data.cooked) model_data.cooked_mesh.GetTexturePaths(texture_paths);
+			else if (model_data.loaded) AddMaterialTexturePaths(model_data, models[i].textures_path, texture_paths);
 		}
-
-		GfxDynamicAllocation staging_buffer = gfx->GetDynamicAllocator()->Allocate(total_buffer_size, 16);
-
-		uint32 current_offset = 0;
-		auto CopyData = [&staging_buffer, &current_offset]<typename T>(std::vector<T> const& _data)
+		std::vector<TextureHandle> texture_defaults(texture_paths.size());
+		for (uint64 i = 0; i < texture_paths.size(); ++i)
 		{
-			uint64 current_copy_size = _data.size() * sizeof(T);
-			staging_buffer.Update(_data.data(), current_copy_size, current_offset);
-			current_offset += (uint32)Align(current_copy_size, 16);
-		};
+			static constexpr TextureHandle material_texture_defaults[] = { DEFAULT_WHITE_TEXTURE_HANDLE, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE, DEFAULT_NORMAL_TEXTURE_HANDLE, DEFAULT_BLACK_TEXTURE_HANDLE };
+			texture_defaults[i] = material_texture_defaults[i % 4];
+		}
+		std::vector<std::string> texture_load_paths = texture_paths;
+		if (TextureCache.Get() > 0) UseCookedTextures(texture_load_paths, TextureCache.Get() > 1);
+		std::vector<TextureHandle> texture_handles = g_TextureManager.LoadTextures(texture_load_paths, texture_defaults, true);
 
-		mesh.submeshes.reserve(mesh_datas.size());
-		for (uint64 i = 0; i < mesh_datas.size(); ++i)
+		//everything touching the device or the registry runs here, in model order
+		std::vector<entt::entity> mesh_entities(models.size(), entt::null);
+		for (uint64 model_index = 0; model_index < models.size(); ++model_index)
 		{
-			auto const& mesh_data = mesh_datas[i];
-
-			SubMeshGPU& submesh = mesh.submeshes.emplace_back();
-
-			submesh.indices_offset = current_offset;
-			submesh.indices_count = (uint32)mesh_data.indices.size();
-			CopyData(mesh_data.indices);
+			ModelParameters const& params = models[model_index];
+			ModelData& model_data = model_datas[model_index];
+			if (!model_data.loaded) continue;
 
-			submesh.vertices_count = (uint32)mesh_data.positions_stream.size();
-			submesh.positions_offset = current_offset;
-			CopyData(mesh_data.positions_stream);
+			entt::entity mesh_entity = reg.create();
+			Mesh mesh{};
 
-			submesh.uvs_offset = current_offset;
-			CopyData(mesh_data.uvs_stream);
+			std::vector<GeometryBufferRange> geometry;
+			uint64 geometry_size = 0;
+			if (model_data.cooked) BuildMeshFromCooked(mesh, params, model_data.cooked_mesh, geometry, geometry_size);
+			else BuildMeshFromSource(mesh, params, model_data, geometry, geometry_size);
 
-			submesh.normals_offset = current_offset;
-			CopyData(mesh_data.normals_stream);
-
-			submesh.tangents_offset = current_offset;
-			CopyData(mesh_data.tangents_stream);
-
-			submesh.meshlet_offset = current_offset;
-			CopyData(mesh_data.meshlets);
-
-			submesh.meshlet_vertices_offset = current_offset;
-			CopyData(mesh_data.meshlet_vertices);
-
-			submesh.meshlet_triangles_offset = current_offset;
-			CopyData(mesh_data.meshlet_triangles);
-
-			submesh.meshlet_count = (uint32)mesh_data.meshlets.size();
-
-			submesh.bounding_box = mesh_data.bounding_box;
-			submesh.topology = mesh_data.topology;
-			submesh.material_index = mesh_data.material_index;
-		}
-		mesh.geometry_buffer_handle = g_GeometryBufferCache.CreateAndInitializeGeometryBuffer(staging_buffer.buffer, total_buffer_size, staging_buffer.offset);
-
-		std::function<void(int, Matrix const&)> LoadNode;
-		LoadNode = [&](int node_index, Matrix const& parent_transform)
-		{
-			if (node_index < 0) return;
-			auto& node = model.nodes[node_index];
-			struct Transforms
-			{
-				Vector4 rotation_local = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
-				Vector3 scale_local = Vector3(1.0f, 1.0f, 1.0f);
-				Vector3 translation_local = Vector3(0.0f, 0.0f, 0.0f);
-				Matrix world = Matrix::Identity;
-				bool update = true;
-				void Update()
-				{
-					if (update)
-					{
-							world = Matrix::CreateScale(scale_local) *
-							Matrix::CreateFromQuaternion(rotation_local) *
-							Matrix::CreateTranslation(translation_local);
-					}
-				}
-			} transforms;
-
-			if (!node.scale.empty())
+			std::span<TextureHandle const> material_texture_handles = std::span<TextureHandle const>(texture_handles).subspan(model_data.texture_paths_offset, mesh.materials.size() * 4);
+			auto MaterialTexture = [&material_texture_handles](uint64 slot, TextureHandle default_handle)
 			{
-				transforms.scale_local = Vector3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]);
-			}
-			if (!node.rotation.empty())
+				return material_texture_handles[slot] != INVALID_TEXTURE_HANDLE ? material_texture_handles[slot] : default_handle;
+			};
+			for (uint64 material_index = 0; material_index < mesh.materials.size(); ++material_index)
 			{
-				transforms.rotation_local = Vector4((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]);
+				Material& material = mesh.materials[material_index];
+				material.albedo_texture = MaterialTexture(material_index * 4 + 0, DEFAULT_WHITE_TEXTURE_HANDLE);
+				material.metallic_roughness_texture = MaterialTexture(material_index * 4 + 1, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE);
+				material.normal_texture = MaterialTexture(material_index * 4 + 2, DEFAULT_NORMAL_TEXTURE_HANDLE);
+				material.emissive_texture = MaterialTexture(material_index * 4 + 3, DEFAULT_BLACK_TEXTURE_HANDLE);
 			}
-			if (!node.translation.empty())
+
+			//the ranges are disjoint, so they are copied into the staging buffer on the thread pool
+			GfxDynamicAllocation staging_buffer = gfx->GetDynamicAllocator()->Allocate(geometry_size, 16);
+			ParallelFor(geometry.size(), [&](uint64 i)
 			{
-				transforms.translation_local = Vector3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]);
-			}
-			if (!node.matrix.empty())
-			{
-				transforms.world._11 = (float)node.matrix[0];
-				transforms.world._12 = (float)node.matrix[1];
-				transforms.world._13 = (float)node.matrix[2];
-				transforms.world._14 = (float)node.matrix[3];
-				transforms.world._21 = (float)node.matrix[4];
-				transforms.world._22 = (float)node.matrix[5];
-				transforms.world._23 = (float)node.matrix[6];
-				transforms.world._24 = (float)node.matrix[7];
-				transforms.world._31 = (float)node.matrix[8];
-				transforms.world._32 = (float)node.matrix[9];
-				transforms.world._33 = (float)node.matrix[10];
-				transforms.world._34 = (float)node.matrix[11];
-				transforms.world._41 = (float)node.matrix[12];
-				transforms.world._42 = (float)node.matrix[13];
-				transforms.world._43 = (float)node.matrix[14];
-				transforms.world._44 = (float)node.matrix[15];
-				transforms.update = false;
-			}
-			transforms.Update();
+				GeometryBufferRange const& range = geometry[i];
+				staging_buffer.Update(range.data, range.size, range.offset);
+			});
+			mesh.geometry_buffer_handle = g_GeometryBufferCache.CreateAndInitializeGeometryBuffer(staging_buffer.buffer, geometry_size, staging_buffer.offset);
 
-			if (node.mesh >= 0)
+			if (!model_data.cooked && model_data.cooked_key != 0)
 			{
-				Matrix model_matrix = transforms.world * parent_transform;
-				for (auto primitive : mesh_primitives_map[node.mesh])
+				std::span<std::string const> model_texture_paths = std::span<std::string const>(texture_paths).subspan(model_data.texture_paths_offset, mesh.materials.size() * 4);
+				std::string cooked_path = GetCookedMeshPath(params, model_data.cooked_key);
+				if (!WriteCookedMesh(cooked_path, model_data.cooked_key, mesh, model_texture_paths, geometry, geometry_size))
 				{
-					SubMeshInstance& instance = mesh.instances.emplace_back();
-					instance.submesh_index = primitive;
-					instance.world_transform = model_matrix;
-					instance.parent = mesh_entity;
+					ADRIA_LOG(WARNING, "Failed to write cooked mesh %s", cooked_path.c_str());
 				}
 			}
 
-			for (int child : node.children) LoadNode(child, transforms.world * parent_transform);
-		};
-
-		tinygltf::Scene const& scene = model.scenes[std::max(0, model.defaultScene)];
-		for (uint64 i = 0; i < scene.nodes.size(); ++i)
-		{
-			LoadNode(scene.nodes[i], params.model_matrix);
-		}
+			TransformHierarchy& transform_hierarchy = mesh.transform_hierarchy;
+			transform_hierarchy.Update();
+			for (SubMeshInstance& instance : mesh.instances)
+			{
+				instance.parent = mesh_entity;
+				instance.world_transform = transform_hierarchy.GetWorldTransform(instance.transform_node);
+			}
 
-		reg.emplace<Mesh>(mesh_entity, mesh);
-		reg.emplace<Tag>(mesh_entity, model_name + " mesh");
+			reg.emplace<Mesh>(mesh_entity, mesh);
+			reg.emplace<Transform>(mesh_entity, params.model_matrix);
+			reg.emplace<Tag>(mesh_entity, GetFilename(params.model_path) + " mesh");
 
-		if (gfx->GetCapabilities().SupportsRayTracing()) reg.emplace<RayTracing>(mesh_entity);
+			if (gfx->GetCapabilities().SupportsRayTracing()) reg.emplace<RayTracing>(mesh_entity);
 
-		ADRIA_LOG(INFO, "GLTF Mesh %s successfully loaded!", params.model_path.c_str());
-		return mesh_entity;
+			ADRIA_LOG(INFO, "GLTF Mesh %s successfully loaded%s!", params.model_path.c_str(), model_data.cooked ? " from the mesh cache" : "");
+			mesh_entities[model_index] = mesh_entity;
+			model_data = ModelData{};
+		}
+		ADRIA_LOG(INFO, "Imported %llu GLTF models in %.2f s", (uint64)models.size(), import_timer.ElapsedInSeconds());
+		return mesh_entities;
 	}
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <array>
 #include <vector>
 #include <string>
+#include <span>
 #include "Components.h"
 #include "Math/NormalsUtil.h"
 #include "Utilities/Heightmap.h"
@@ -24,6 +25,8 @@ namespace adria
 		Matrix model_matrix;
 		bool triangle_ccw = true;
 		bool force_mask_alpha_usage = false;
+		std::vector<float> lod_ratios = { 0.5f, 0.25f, 0.125f };	//index count of each LOD relative to the base mesh
+		float lod_target_error = 0.01f;								//relative to the mesh extents
     };
     struct SkyboxParameters
     {
@@ -84,6 +87,7 @@ namespace adria
 		ADRIA_MAYBE_UNUSED std::vector<entt::entity> LoadOcean(OceanParameters const&);
 		ADRIA_MAYBE_UNUSED entt::entity LoadDecal(DecalParameters const&);
 		ADRIA_MAYBE_UNUSED entt::entity ImportModel_GLTF(ModelParameters const&);
+		ADRIA_MAYBE_UNUSED std::vector<entt::entity> ImportModels_GLTF(std::span<ModelParameters const>);
 	private:
         entt::registry& reg;
         GfxDevice* gfx;
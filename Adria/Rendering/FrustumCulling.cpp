@@ -0,0 +1,155 @@
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+#include "FrustumCulling.h"
+#include "Utilities/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace adria
+{
+	namespace
+	{
+#if defined(__AVX2__)
+		constexpr uint32 CULLING_LANES = 8;
+
+		uint32 CullLanes(CullingFrustum const& frustum, CullingBoxes const& boxes, uint32 i)
+		{
+			__m256 const cx = _mm256_loadu_ps(boxes.center_x + i);
+			__m256 const cy = _mm256_loadu_ps(boxes.center_y + i);
+			__m256 const cz = _mm256_loadu_ps(boxes.center_z + i);
+			__m256 const ex = _mm256_loadu_ps(boxes.extent_x + i);
+			__m256 const ey = _mm256_loadu_ps(boxes.extent_y + i);
+			__m256 const ez = _mm256_loadu_ps(boxes.extent_z + i);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (uint32 p = 0; p < frustum.plane_count; ++p)
+			{
+				Vector4 const& plane = frustum.planes[p];
+				__m256 const nx = _mm256_set1_ps(plane.x);
+				__m256 const ny = _mm256_set1_ps(plane.y);
+				__m256 const nz = _mm256_set1_ps(plane.z);
+				__m256 const d = _mm256_set1_ps(plane.w);
+				__m256 const anx = _mm256_set1_ps(std::abs(plane.x));
+				__m256 const any = _mm256_set1_ps(std::abs(plane.y));
+				__m256 const anz = _mm256_set1_ps(std::abs(plane.z));
+
+				__m256 const distance = _mm256_fmadd_ps(nx, cx, _mm256_fmadd_ps(ny, cy, _mm256_fmadd_ps(nz, cz, d)));
+				__m256 const radius = _mm256_fmadd_ps(anx, ex, _mm256_fmadd_ps(any, ey, _mm256_mul_ps(anz, ez)));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, radius, _CMP_GT_OQ));
+			}
+			return ~(uint32)_mm256_movemask_ps(outside) & 0xff;
+		}
+#else
+		constexpr uint32 CULLING_LANES = 4;
+
+		uint32 CullLanes(CullingFrustum const& frustum, CullingBoxes const& boxes, uint32 i)
+		{
+			__m128 const cx = _mm_loadu_ps(boxes.center_x + i);
+			__m128 const cy = _mm_loadu_ps(boxes.center_y + i);
+			__m128 const cz = _mm_loadu_ps(boxes.center_z + i);
+			__m128 const ex = _mm_loadu_ps(boxes.extent_x + i);
+			__m128 const ey = _mm_loadu_ps(boxes.extent_y + i);
+			__m128 const ez = _mm_loadu_ps(boxes.extent_z + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (uint32 p = 0; p < frustum.plane_count; ++p)
+			{
+				Vector4 const& plane = frustum.planes[p];
+				__m128 const distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+				__m128 const radius = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+					_mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, radius));
+			}
+			return ~(uint32)_mm_movemask_ps(outside) & 0xf;
+		}
+#endif
+
+		bool CullBox(CullingFrustum const& frustum, CullingBoxes const& boxes, uint32 i)
+		{
+			for (uint32 p = 0; p < frustum.plane_count; ++p)
+			{
+				Vector4 const& plane = frustum.planes[p];
+				float const distance = plane.x * boxes.center_x[i] + plane.y * boxes.center_y[i] + plane.z * boxes.center_z[i] + plane.w;
+				float const radius = std::abs(plane.x) * boxes.extent_x[i] + std::abs(plane.y) * boxes.extent_y[i] + std::abs(plane.z) * boxes.extent_z[i];
+				if (distance > radius) return false;
+			}
+			return true;
+		}
+	}
+
+	CullingFrustum MakeCullingFrustum(BoundingFrustum const& frustum)
+	{
+		XMVECTOR planes[CullingFrustum::MAX_PLANES];
+		frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+		CullingFrustum culling_frustum{};
+		for (uint32 i = 0; i < CullingFrustum::MAX_PLANES; ++i) culling_frustum.planes[i] = planes[i];
+		culling_frustum.plane_count = CullingFrustum::MAX_PLANES;
+		return culling_frustum;
+	}
+
+	CullingFrustum MakeCullingFrustum(Matrix const& view_projection)
+	{
+		//row vector convention, clip = p * M. Planes are negated so that inside points have negative distance
+		Matrix const m = view_projection.Transpose();
+		Vector4 const r0(m._11, m._12, m._13, m._14);
+		Vector4 const r1(m._21, m._22, m._23, m._24);
+		Vector4 const r2(m._31, m._32, m._33, m._34);
+		Vector4 const r3(m._41, m._42, m._43, m._44);
+
+		CullingFrustum culling_frustum{};
+		Vector4 const planes[] = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2 };
+		for (uint32 i = 0; i < CullingFrustum::MAX_PLANES; ++i)
+		{
+			culling_frustum.planes[i] = -XMPlaneNormalize(planes[i]);
+		}
+		culling_frustum.plane_count = CullingFrustum::MAX_PLANES;
+		return culling_frustum;
+	}
+
+	void CullBoxes(CullingFrustum const& frustum, CullingBoxes const& boxes, uint32 begin, uint32 end, uint64* visibility)
+	{
+		ADRIA_ASSERT(begin % 64 == 0);
+		end = std::min(end, boxes.count);
+		for (uint32 word_begin = begin; word_begin < end; word_begin += 64)
+		{
+			uint32 const word_end = std::min(word_begin + 64, end);
+			uint64 word = 0;
+			uint32 i = word_begin;
+			for (; i + CULLING_LANES <= word_end; i += CULLING_LANES)
+			{
+				word |= uint64(CullLanes(frustum, boxes, i)) << (i - word_begin);
+			}
+			for (; i < word_end; ++i)
+			{
+				if (CullBox(frustum, boxes, i)) word |= 1ull << (i - word_begin);
+			}
+			visibility[word_begin / 64] = word;
+		}
+	}
+
+	void CullBoxesParallel(CullingFrustum const& frustum, CullingBoxes const& boxes, std::span<uint64> visibility)
+	{
+		ADRIA_ASSERT(visibility.size() * 64 >= boxes.count);
+		static_assert(CULLING_CHUNK_SIZE % 512 == 0, "Culling chunks need to cover whole cache lines of the visibility bitset");
+
+		uint32 const chunk_count = (boxes.count + CULLING_CHUNK_SIZE - 1) / CULLING_CHUNK_SIZE;
+		if (chunk_count <= 1)
+		{
+			CullBoxes(frustum, boxes, 0, boxes.count, visibility.data());
+			return;
+		}
+
+		ParallelFor(chunk_count, [&](uint64 chunk)
+			{
+				uint32 const begin = uint32(chunk) * CULLING_CHUNK_SIZE;
+				CullBoxes(frustum, boxes, begin, begin + CULLING_CHUNK_SIZE, visibility.data());
+			});
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	struct CullingFrustum
+	{
+		static constexpr uint32 MAX_PLANES = 6;
+		Vector4 planes[MAX_PLANES];
+		uint32 plane_count = 0;
+	};
+	CullingFrustum MakeCullingFrustum(BoundingFrustum const& frustum);
+	CullingFrustum MakeCullingFrustum(Matrix const& view_projection);
+
+	struct CullingBoxes
+	{
+		float const* center_x;
+		float const* center_y;
+		float const* center_z;
+		float const* extent_x;
+		float const* extent_y;
+		float const* extent_z;
+		uint32 count;
+	};
+
+	inline constexpr uint32 CULLING_CHUNK_SIZE = 4096;
+
+	//[begin, end) has to start at a multiple of 64 so that each visibility word is written by a single call.
+	//CullBoxesParallel expects visibility to start on a cache line so its chunks don't share lines
+	void CullBoxes(CullingFrustum const& frustum, CullingBoxes const& boxes, uint32 begin, uint32 end, uint64* visibility);
+	void CullBoxesParallel(CullingFrustum const& frustum, CullingBoxes const& boxes, std::span<uint64> visibility);
+}
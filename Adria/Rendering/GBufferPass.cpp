@@ -4,22 +4,30 @@
 #include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
+#include "IndirectDrawList.h"
+#include "DrawKeyList.h"
+#include "RenderProxyTable.h"
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxTracyProfiler.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
 #include "entt/entity/registry.hpp"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<float> MeshLODThreshold("r.MeshLOD.ErrorThreshold", 1.0f, "Largest projected simplification error in pixels for picking a coarser mesh LOD, 0 always draws the base mesh");
 
 	GBufferPass::GBufferPass(entt::registry& reg, GfxDevice* gfx, uint32 w, uint32 h) :
 		reg{ reg }, gfx{ gfx }, width{ w }, height{ h }
 	{
 		CreatePSOs();
+		draw_list = std::make_unique<IndirectDrawList>(GBUFFER_PSO_COUNT);
+		draw_list->SetInstancing(GBUFFER_PSO_BLEND, false);
+		draw_keys = std::make_unique<DrawKeyList>();
 	}
 
 	GBufferPass::~GBufferPass() = default;
@@ -58,44 +66,75 @@ namespace adria
 				GfxDevice* gfx = cmd_list->GetDevice();
 				
 				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-				auto GetPSO = [this](MaterialAlphaMode alpha_mode)
+
+				auto GetPSOIndex = [this](MaterialAlphaMode alpha_mode) -> uint32
 				{
+					if (use_rain_pso) return GBUFFER_PSO_RAIN;
 					switch (alpha_mode)
 					{
-					case MaterialAlphaMode::Opaque: return gbuffer_psos->Get<0>();
-					case MaterialAlphaMode::Mask: return gbuffer_psos->Get<1>();
-					case MaterialAlphaMode::Blend: return gbuffer_psos->Get<3>();
+					case MaterialAlphaMode::Opaque: return GBUFFER_PSO_OPAQUE;
+					case MaterialAlphaMode::Mask: return GBUFFER_PSO_MASK;
+					case MaterialAlphaMode::Blend: return GBUFFER_PSO_BLEND;
 					}
-					return gbuffer_psos->Get<0>();
+					return GBUFFER_PSO_OPAQUE;
 				};
 
-				cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-
-				reg.sort<Batch>([](Batch const& lhs, Batch const& rhs) { return lhs.alpha_mode < rhs.alpha_mode; });
-				auto batch_view = reg.view<Batch>();
-				for (auto batch_entity : batch_view)
+				RenderProxyTable const& render_proxies = reg.ctx().get<RenderProxyTable>();
+				Vector3 const camera_position(frame_data.camera_position);
+				draw_keys->Clear();
+				for (uint32 proxy = 0; proxy < render_proxies.GetCount(); ++proxy)
 				{
-					Batch& batch = batch_view.get<Batch>(batch_entity);
-					if (!batch.camera_visibility) continue;
+					if (!render_proxies.IsVisible(proxy)) continue;
+					MaterialAlphaMode const alpha_mode = render_proxies.GetAlphaMode(proxy);
+					float const view_distance = Vector3::Distance(Vector3(render_proxies.GetBoundingBox(proxy).Center), camera_position);
+					draw_keys->Add(MakeDrawKey(GetPSOIndex(alpha_mode), render_proxies.GetSubMesh(proxy)->topology, view_distance,
+						alpha_mode == MaterialAlphaMode::Blend ? DrawKeyOrder::BackToFront : DrawKeyOrder::FrontToBack,
+						render_proxies.GetMaterialIndex(proxy), render_proxies.GetGeometryBufferSlot(proxy)), proxy);
+				}
+				draw_keys->Sort();
 
-					GfxPipelineState* pso = GetPSO(batch.alpha_mode);
-					if (use_rain_pso) pso = gbuffer_psos->Get<4>();
-					cmd_list->SetPipelineState(pso);
+				float const lod_pixel_scale = XMVectorGetY(frame_data.camera_proj.r[1]) * height * 0.5f;
+				draw_list->Reset();
+				lod_stats.Reset();
+				for (uint32 i = 0; i < draw_keys->GetCount(); ++i)
+				{
+					uint32 const proxy = draw_keys->GetProxy(i);
+					SubMeshGPU const& submesh = *render_proxies.GetSubMesh(proxy);
+					BoundingBox const bounding_box = render_proxies.GetBoundingBox(proxy);
+					float const view_distance = Vector3::Distance(Vector3(bounding_box.Center), camera_position) - Vector3(bounding_box.Extents).Length();
+					float const lod_error_scale = MeshLODErrorScale(render_proxies.GetWorldScale(proxy), lod_pixel_scale, view_distance, true);
+					uint32 const lod = SelectMeshLOD(std::span(submesh.lod_errors.data(), submesh.lod_count), lod_error_scale, MeshLODThreshold.Get());
+					lod_stats.Add(lod, submesh.lods[lod].indices_count / 3, submesh.indices_count / 3);
+					draw_list->Add(GetDrawKeyBucket(draw_keys->GetKey(i)), render_proxies.GetInstanceId(proxy), submesh, lod);
+				}
+				draw_list->Upload(gfx);
 
-					struct GBufferConstants
-					{
-						uint32 instance_id;
-					} constants { .instance_id = batch.instance_id };
-					cmd_list->SetRootConstants(1, constants);
-
-					GfxIndexBufferView ibv(batch.submesh->buffer_address + batch.submesh->indices_offset, batch.submesh->indices_count);
-					cmd_list->SetTopology(batch.submesh->topology);
-					cmd_list->SetIndexBuffer(&ibv);
-					cmd_list->DrawIndexed(batch.submesh->indices_count);
+				for (uint32 pso_index = 0; pso_index < GBUFFER_PSO_COUNT; ++pso_index)
+				{
+					if (draw_list->GetDrawCount(pso_index) == 0) continue;
+					cmd_list->SetPipelineState(gbuffer_psos->Get(pso_index));
+					cmd_list->SetRootConstant(1, draw_list->GetInstanceBufferIndex(), 1);
+					draw_list->Draw(cmd_list, pso_index);
 				}
 			}, RGPassType::Graphics, RGPassFlags::None);
 	}
 
+	void GBufferPass::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNode("GBuffer"))
+				{
+					uint32 const draw_count = draw_list->GetTotalDrawCount();
+					uint32 const instance_count = draw_list->GetTotalInstanceCount();
+					ImGui::Text("Draws: %u, Instances: %u (draws saved: %u)", draw_count, instance_count, instance_count - draw_count);
+					ImGui::Text("Mesh LODs: %u / %u / %u / %u", lod_stats.GetInstanceCount(0), lod_stats.GetInstanceCount(1), lod_stats.GetInstanceCount(2), lod_stats.GetInstanceCount(3));
+					ImGui::Text("Triangles: %llu (%.1f%% fewer than base LODs)", lod_stats.GetTriangleCount(), 100.0f * lod_stats.GetTriangleReduction());
+					ImGui::TreePop();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
 	void GBufferPass::OnResize(uint32 w, uint32 h)
 	{
 		width = w, height = h;
@@ -118,12 +157,12 @@ namespace adria
 		gbuffer_pso_desc.rtv_formats[2] = GfxFormat::R8G8B8A8_UNORM;
 		gbuffer_pso_desc.dsv_format = GfxFormat::D32_FLOAT;
 
-		gbuffer_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(5, gbuffer_pso_desc);
-		gbuffer_psos->AddDefine<PS, 1>("MASK", "1");
-		gbuffer_psos->AddDefine<PS, 2>("MASK", "1");
-		gbuffer_psos->SetCullMode<2>(GfxCullMode::None);
-		gbuffer_psos->SetCullMode<3>(GfxCullMode::None);
-		gbuffer_psos->AddDefine<PS, 4>("RAIN", "1");
+		gbuffer_psos = std::make_unique<GfxGraphicsPipelineStatePermutations>(GBUFFER_PSO_COUNT, gbuffer_pso_desc);
+		gbuffer_psos->AddDefine<PS, GBUFFER_PSO_MASK>("MASK", "1");
+		gbuffer_psos->AddDefine<PS, GBUFFER_PSO_MASK_NO_CULL>("MASK", "1");
+		gbuffer_psos->SetCullMode<GBUFFER_PSO_MASK_NO_CULL>(GfxCullMode::None);
+		gbuffer_psos->SetCullMode<GBUFFER_PSO_BLEND>(GfxCullMode::None);
+		gbuffer_psos->AddDefine<PS, GBUFFER_PSO_RAIN>("RAIN", "1");
 		gbuffer_psos->Finalize(gfx);
 	}
 
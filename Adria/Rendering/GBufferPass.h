@@ -1,20 +1,31 @@
 #pragma once
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
 #include "RenderGraph/RenderGraphResourceId.h"
+#include "MeshLOD.h"
 #include "entt/entity/fwd.hpp"
 
 namespace adria
 {
 	class GfxDevice;
 	class RenderGraph;
+	class IndirectDrawList;
+	class DrawKeyList;
 
 	class GBufferPass
 	{
+		static constexpr uint32 GBUFFER_PSO_OPAQUE = 0;
+		static constexpr uint32 GBUFFER_PSO_MASK = 1;
+		static constexpr uint32 GBUFFER_PSO_MASK_NO_CULL = 2;
+		static constexpr uint32 GBUFFER_PSO_BLEND = 3;
+		static constexpr uint32 GBUFFER_PSO_RAIN = 4;
+		static constexpr uint32 GBUFFER_PSO_COUNT = 5;
+
 	public:
 		GBufferPass(entt::registry& reg, GfxDevice* gfx, uint32 w, uint32 h);
 		~GBufferPass();
 
 		void AddPass(RenderGraph& rendergraph);
+		void GUI();
 		void OnResize(uint32 w, uint32 h);
 
 		void OnRainEvent(bool enabled)
@@ -28,6 +39,9 @@ namespace adria
 		uint32 width, height;
 		bool use_rain_pso = false;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> gbuffer_psos;
+		std::unique_ptr<IndirectDrawList> draw_list;
+		std::unique_ptr<DrawKeyList> draw_keys;
+		MeshLODStats lod_stats;
 
 	private:
 		void CreatePSOs();
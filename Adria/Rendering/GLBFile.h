@@ -0,0 +1,44 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	//chunks of a binary glTF file, the spans point into the file data
+	struct GLBChunks
+	{
+		std::span<uint8 const> json;
+		std::span<uint8 const> bin;
+	};
+
+	inline bool ParseGLB(std::span<uint8 const> file_data, GLBChunks& chunks)
+	{
+		static constexpr uint32 GLB_MAGIC = 0x46546C67;
+		static constexpr uint32 GLB_CHUNK_JSON = 0x4E4F534A;
+		static constexpr uint32 GLB_CHUNK_BIN = 0x004E4942;
+
+		auto ReadUint32 = [&file_data](uint64 offset)
+		{
+			uint32 value = 0;
+			memcpy(&value, file_data.data() + offset, sizeof(uint32));
+			return value;
+		};
+
+		if (file_data.size() < 20 || ReadUint32(0) != GLB_MAGIC || ReadUint32(4) != 2) return false;
+		uint64 const file_length = std::min<uint64>(ReadUint32(8), file_data.size());
+
+		chunks = {};
+		for (uint64 offset = 12; offset + 8 <= file_length;)
+		{
+			uint64 const chunk_length = ReadUint32(offset);
+			uint32 const chunk_type = ReadUint32(offset + 4);
+			offset += 8;
+			if (chunk_length > file_length - offset) return false;
+
+			std::span<uint8 const> chunk = file_data.subspan(offset, chunk_length);
+			if (chunk_type == GLB_CHUNK_JSON && chunks.json.empty()) chunks.json = chunk;
+			else if (chunk_type == GLB_CHUNK_BIN && chunks.bin.empty()) chunks.bin = chunk;
+			offset += (chunk_length + 3) & ~3ull;
+		}
+		return !chunks.json.empty();
+	}
+}
@@ -3,6 +3,7 @@
 #include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
+#include "RenderProxyTable.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "entt/entity/registry.hpp"
@@ -325,7 +326,7 @@ namespace adria
 				gfx->CopyDescriptors(dst_handle, src_handles);
 				uint32 i = dst_handle.GetIndex();
 
-				uint32 const num_instances = (uint32)reg.view<Batch>().size();
+				uint32 const num_instances = reg.ctx().get<RenderProxyTable>().GetCount();
 				struct CullInstances1stPhaseConstants
 				{
 					uint32 num_instances;
@@ -1035,7 +1036,7 @@ namespace adria
 				ADRIA_ASSERT(debug_buffer.IsMapped());
 				uint32* buffer_data = debug_buffer.GetMappedData<uint32>();
 				buffer_data += 6 * backbuffer_index;
-				uint32 num_instances = (uint32)reg.view<Batch>().size();
+				uint32 num_instances = reg.ctx().get<RenderProxyTable>().GetCount();
 				debug_stats[backbuffer_index].occluded_instances = buffer_data[0];
 				debug_stats[backbuffer_index].num_instances = num_instances;
 				debug_stats[backbuffer_index].visible_instances = num_instances - buffer_data[0];
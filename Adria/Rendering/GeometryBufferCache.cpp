@@ -26,6 +26,9 @@ namespace adria
 
 		++current_handle;
 		buffer_map[current_handle] = gfx->CreateBuffer(desc);
+		GfxResidencyHandle residency_handle = buffer_map[current_handle]->GetResidencyHandle();
+		g_GfxResidencyManager.SetCategory(residency_handle, GfxMemoryCategory::Geometry);
+		g_GfxResidencyManager.SetPriority(residency_handle, GfxResidencyPriority::High);
 		if(staging_buffer) gfx->GetCommandList()->CopyBuffer(*buffer_map[current_handle], 0, *staging_buffer, src_offset, total_buffer_size);
 		buffer_srv_map[current_handle] = gfx->CreateBufferSRV(buffer_map[current_handle].get());
 		return current_handle;
@@ -0,0 +1,163 @@
+#include "IndirectDrawList.h"
+#include "Components.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+#include "Core/ConsoleManager.h"
+
+namespace adria
+{
+	static TAutoConsoleVariable<bool> AutoInstancing("r.AutoInstancing", true, "Merge visible instances of the same submesh into one instanced draw");
+
+	IndirectDrawList::IndirectDrawList(uint32 bucket_count) : buckets(bucket_count) {}
+
+	void IndirectDrawList::Reset()
+	{
+		for (Bucket& bucket : buckets)
+		{
+			bucket.args.clear();
+			bucket.topologies.clear();
+			bucket.runs.clear();
+			bucket.instance_ids.clear();
+			bucket.instance_draws.clear();
+			bucket.submesh_draws.clear();
+		}
+		args_buffer = nullptr;
+		instance_buffer_index = 0;
+		total_draw_count = 0;
+		total_instance_count = 0;
+		upload_size = 0;
+	}
+
+	void IndirectDrawList::Reset(uint32 bucket_count)
+	{
+		buckets.resize(bucket_count);
+		Reset();
+	}
+
+	void IndirectDrawList::SetInstancing(uint32 bucket, bool enabled)
+	{
+		ADRIA_ASSERT(bucket < buckets.size());
+		buckets[bucket].instancing = enabled;
+	}
+
+	void IndirectDrawList::Add(uint32 bucket_index, uint32 instance_id, SubMeshGPU const& submesh, uint32 lod)
+	{
+		ADRIA_ASSERT(bucket_index < buckets.size());
+		ADRIA_ASSERT(lod < submesh.lod_count);
+		Bucket& bucket = buckets[bucket_index];
+
+		uint32 const draw_index = (uint32)bucket.args.size();
+		if (bucket.instancing && AutoInstancing.Get())
+		{
+			//the LOD goes into the low bits of the submesh address, which are always zero
+			static_assert(alignof(SubMeshGPU) >= MESH_LOD_COUNT);
+			uint64 const submesh_key = reinterpret_cast<uint64>(&submesh) | lod;
+
+			//the draw keeps the position of its first instance, so sorted order is kept for the nearest instance of each submesh
+			auto [it, inserted] = bucket.submesh_draws.try_emplace(submesh_key, draw_index);
+			if (!inserted)
+			{
+				++bucket.args[it->second].draw_args.InstanceCount;
+				bucket.instance_ids.push_back(instance_id);
+				bucket.instance_draws.push_back(it->second);
+				return;
+			}
+		}
+
+		DrawBatchIndirectArgs& args = bucket.args.emplace_back();
+		args.instance_offset = 0;
+		SubMeshLOD const& submesh_lod = submesh.lods[lod];
+		args.index_buffer_view.BufferLocation = submesh.buffer_address + submesh_lod.indices_offset;
+		args.index_buffer_view.SizeInBytes = submesh_lod.indices_count * sizeof(uint32);
+		args.index_buffer_view.Format = DXGI_FORMAT_R32_UINT;
+		args.draw_args.IndexCountPerInstance = submesh_lod.indices_count;
+		args.draw_args.InstanceCount = 1;
+		args.draw_args.StartIndexLocation = 0;
+		args.draw_args.BaseVertexLocation = 0;
+		args.draw_args.StartInstanceLocation = 0;
+		bucket.topologies.push_back(submesh.topology);
+		bucket.instance_ids.push_back(instance_id);
+		bucket.instance_draws.push_back(draw_index);
+	}
+
+	void IndirectDrawList::Upload(GfxDevice* gfx)
+	{
+		total_draw_count = 0;
+		total_instance_count = 0;
+		for (Bucket const& bucket : buckets)
+		{
+			total_draw_count += (uint32)bucket.args.size();
+			total_instance_count += (uint32)bucket.instance_ids.size();
+		}
+		upload_size = 0;
+		if (total_draw_count == 0) return;
+
+		//lay out the instance ids of each draw contiguously, in the order they were added
+		instance_upload.resize(total_instance_count);
+		uint32 instance_offset = 0;
+		for (Bucket& bucket : buckets)
+		{
+			draw_cursors.resize(bucket.args.size());
+			for (uint32 i = 0; i < bucket.args.size(); ++i)
+			{
+				bucket.args[i].instance_offset = instance_offset;
+				draw_cursors[i] = instance_offset;
+				instance_offset += bucket.args[i].draw_args.InstanceCount;
+			}
+			for (uint32 i = 0; i < bucket.instance_ids.size(); ++i)
+			{
+				instance_upload[draw_cursors[bucket.instance_draws[i]]++] = bucket.instance_ids[i];
+			}
+		}
+
+		GfxLinearDynamicAllocator* dynamic_allocator = gfx->GetDynamicAllocator();
+		uint64 const instances_size = total_instance_count * sizeof(uint32);
+		GfxDynamicAllocation instance_allocation = dynamic_allocator->Allocate(instances_size, 16);
+		instance_allocation.Update(instance_upload.data(), instances_size);
+
+		GfxBufferDescriptorDesc instance_srv_desc{};
+		instance_srv_desc.offset = instance_allocation.offset;
+		instance_srv_desc.size = instances_size;
+		GfxDescriptor instance_srv = gfx->CreateBufferSRV(instance_allocation.buffer, &instance_srv_desc);
+		GfxDescriptor instance_srv_gpu = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, instance_srv_gpu, instance_srv);
+		gfx->FreeDescriptorCPU(instance_srv, GfxDescriptorHeapType::CBV_SRV_UAV);
+		instance_buffer_index = instance_srv_gpu.GetIndex();
+
+		uint64 const args_size = total_draw_count * sizeof(DrawBatchIndirectArgs);
+		GfxDynamicAllocation allocation = dynamic_allocator->Allocate(args_size, 16);
+		args_buffer = allocation.buffer;
+		upload_size = args_size + instances_size;
+
+		uint64 offset = 0;
+		for (Bucket& bucket : buckets)
+		{
+			if (bucket.args.empty()) continue;
+			uint64 const bucket_size = bucket.args.size() * sizeof(DrawBatchIndirectArgs);
+			allocation.Update(bucket.args.data(), bucket_size, offset);
+
+			for (uint32 i = 0; i < bucket.args.size(); ++i)
+			{
+				if (bucket.runs.empty() || bucket.runs.back().topology != bucket.topologies[i])
+				{
+					bucket.runs.push_back(DrawRun{ .topology = bucket.topologies[i], .offset = allocation.offset + offset + i * sizeof(DrawBatchIndirectArgs), .count = 0 });
+				}
+				++bucket.runs.back().count;
+			}
+			offset += bucket_size;
+		}
+	}
+
+	void IndirectDrawList::Draw(GfxCommandList* cmd_list, uint32 bucket) const
+	{
+		ADRIA_ASSERT(bucket < buckets.size());
+		for (DrawRun const& run : buckets[bucket].runs)
+		{
+			cmd_list->SetTopology(run.topology);
+			cmd_list->DrawBatchesIndirect(*args_buffer, run.offset, run.count);
+		}
+	}
+
+}
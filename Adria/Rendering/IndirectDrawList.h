@@ -0,0 +1,61 @@
+#pragma once
+#include "Graphics/GfxCommandSignature.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxCommandList;
+	struct SubMeshGPU;
+	enum class GfxPrimitiveTopology : uint8;
+
+	//draws of the same submesh LOD within a bucket are merged into one instanced draw. The root constant of each draw is the offset
+	//of its first instance in the instance id buffer, shaders fetch the instance id with that offset plus SV_InstanceID
+	class IndirectDrawList
+	{
+		struct DrawRun
+		{
+			GfxPrimitiveTopology topology;
+			uint64 offset;
+			uint32 count;
+		};
+
+		struct Bucket
+		{
+			std::vector<DrawBatchIndirectArgs> args;
+			std::vector<GfxPrimitiveTopology> topologies;
+			std::vector<DrawRun> runs;
+			std::vector<uint32> instance_ids;
+			std::vector<uint32> instance_draws;
+			std::unordered_map<uint64, uint32> submesh_draws;
+			bool instancing = true;
+		};
+
+	public:
+		explicit IndirectDrawList(uint32 bucket_count);
+
+		void Reset();
+		void Reset(uint32 bucket_count);
+		void SetInstancing(uint32 bucket, bool enabled);
+		void Add(uint32 bucket, uint32 instance_id, SubMeshGPU const& submesh, uint32 lod = 0);
+		void Upload(GfxDevice* gfx);
+		void Draw(GfxCommandList* cmd_list, uint32 bucket) const;
+
+		uint32 GetDrawCount(uint32 bucket) const { return (uint32)buckets[bucket].args.size(); }
+		uint32 GetInstanceCount(uint32 bucket) const { return (uint32)buckets[bucket].instance_ids.size(); }
+		uint32 GetTotalDrawCount() const { return total_draw_count; }
+		uint32 GetTotalInstanceCount() const { return total_instance_count; }
+		uint32 GetInstanceBufferIndex() const { return instance_buffer_index; }
+		uint64 GetUploadSize() const { return upload_size; }
+
+	private:
+		std::vector<Bucket> buckets;
+		std::vector<uint32> instance_upload;
+		std::vector<uint32> draw_cursors;
+		GfxBuffer* args_buffer = nullptr;
+		uint32 instance_buffer_index = 0;
+		uint32 total_draw_count = 0;
+		uint32 total_instance_count = 0;
+		uint64 upload_size = 0;
+	};
+}
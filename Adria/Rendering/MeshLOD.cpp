@@ -0,0 +1,46 @@
+#include "MeshLOD.h"
+#include "meshoptimizer.h"
+
+namespace adria
+{
+	namespace
+	{
+		//a level has to drop at least this fraction of its source indices to be kept
+		constexpr float MIN_LOD_REDUCTION = 0.05f;
+	}
+
+	std::vector<MeshLODLevel> BuildMeshLODs(std::span<uint32 const> indices, std::span<Vector3 const> positions, std::span<float const> ratios, float target_error)
+	{
+		std::vector<MeshLODLevel> lods;
+		if (indices.empty() || positions.empty()) return lods;
+		lods.reserve(ratios.size());
+
+		float const* vertex_positions = &positions[0].x;
+		float const error_scale = meshopt_simplifyScale(vertex_positions, positions.size(), sizeof(Vector3));
+		std::span<uint32 const> source = indices;
+		float source_error = 0.0f;
+		for (float ratio : ratios)
+		{
+			uint64 const target_index_count = uint64(indices.size() * ratio) / 3 * 3;
+			if (target_index_count < 3 || target_index_count >= source.size()) break;
+
+			std::vector<uint32> lod_indices(source.size());
+			float lod_error = 0.0f;
+			uint64 lod_index_count = meshopt_simplify(lod_indices.data(), source.data(), source.size(), vertex_positions, positions.size(), sizeof(Vector3),
+				target_index_count, target_error, 0, &lod_error);
+			if (lod_index_count > target_index_count + target_index_count / 2)
+			{
+				lod_index_count = meshopt_simplifySloppy(lod_indices.data(), source.data(), source.size(), vertex_positions, positions.size(), sizeof(Vector3),
+					target_index_count, FLT_MAX, &lod_error);
+			}
+			if (lod_index_count == 0 || lod_index_count > source.size() * (1.0f - MIN_LOD_REDUCTION)) break;
+
+			lod_indices.resize(lod_index_count);
+			meshopt_optimizeVertexCache(lod_indices.data(), lod_indices.data(), lod_indices.size(), positions.size());
+			source_error += lod_error * error_scale;
+			lods.push_back(MeshLODLevel{ .indices = std::move(lod_indices), .error = source_error });
+			source = lods.back().indices;
+		}
+		return lods;
+	}
+}
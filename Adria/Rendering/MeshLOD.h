@@ -0,0 +1,65 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	inline constexpr uint32 MESH_LOD_COUNT = 4;
+
+	struct MeshLODLevel
+	{
+		std::vector<uint32> indices;
+		float error;	//object space distance to the base mesh, accumulated over the chain
+	};
+
+	//each level is simplified from the previous one, ratios are relative to the base index count and have to be decreasing.
+	//levels that meshopt_simplify can not bring near the target are retried with meshopt_simplifySloppy, the chain stops once a level stops shrinking
+	std::vector<MeshLODLevel> BuildMeshLODs(std::span<uint32 const> indices, std::span<Vector3 const> positions, std::span<float const> ratios, float target_error);
+
+	//factor that converts an object space error into pixels, pixel_scale is the projection's y scale times half the view height in pixels
+	inline float MeshLODErrorScale(float world_scale, float pixel_scale, float view_distance, bool perspective)
+	{
+		return perspective ? world_scale * pixel_scale / std::max(view_distance, 1e-4f) : world_scale * pixel_scale;
+	}
+
+	//largest axis scale of a world transform, LOD errors are measured in object space
+	inline float MeshLODWorldScale(Matrix const& world)
+	{
+		return std::sqrt(std::max({ world.Right().LengthSquared(), world.Up().LengthSquared(), world.Backward().LengthSquared() }));
+	}
+
+	//coarsest level whose projected error stays within the threshold, errors have to be increasing with the first one being the base mesh
+	inline uint32 SelectMeshLOD(std::span<float const> lod_errors, float error_scale, float pixel_threshold)
+	{
+		uint32 lod = 0;
+		while (lod + 1 < lod_errors.size() && lod_errors[lod + 1] * error_scale <= pixel_threshold) ++lod;
+		return lod;
+	}
+
+	class MeshLODStats
+	{
+	public:
+		void Reset()
+		{
+			instance_counts.fill(0);
+			triangle_count = 0;
+			base_triangle_count = 0;
+		}
+		void Add(uint32 lod, uint32 triangles, uint32 base_triangles)
+		{
+			ADRIA_ASSERT(lod < MESH_LOD_COUNT);
+			++instance_counts[lod];
+			triangle_count += triangles;
+			base_triangle_count += base_triangles;
+		}
+
+		uint32 GetInstanceCount(uint32 lod) const { return instance_counts[lod]; }
+		uint64 GetTriangleCount() const { return triangle_count; }
+		uint64 GetBaseTriangleCount() const { return base_triangle_count; }
+		float GetTriangleReduction() const { return base_triangle_count ? 1.0f - float(triangle_count) / base_triangle_count : 0.0f; }
+
+	private:
+		std::array<uint32, MESH_LOD_COUNT> instance_counts{};
+		uint64 triangle_count = 0;
+		uint64 base_triangle_count = 0;
+	};
+}
@@ -3,6 +3,7 @@
 #include "Components.h"
 #include "BlackboardData.h"
 #include "ShaderManager.h"
+#include "RenderProxyTable.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxPipelineState.h"
@@ -73,22 +74,22 @@ namespace adria
 				};
 				cmd_list->SetRootCBV(2, rain_constants);
 
-				auto batch_view = reg.view<Batch>();
-				for (auto batch_entity : batch_view)
+				RenderProxyTable const& render_proxies = reg.ctx().get<RenderProxyTable>();
+				for (uint32 proxy = 0; proxy < render_proxies.GetCount(); ++proxy)
 				{
-					Batch& batch = batch_view.get<Batch>(batch_entity);
+					SubMeshGPU const* submesh = render_proxies.GetSubMesh(proxy);
 					cmd_list->SetPipelineState(rain_blocker_pso.get());
 
 					struct GBufferConstants
 					{
 						uint32 instance_id;
-					} constants{ .instance_id = batch.instance_id };
+					} constants{ .instance_id = render_proxies.GetInstanceId(proxy) };
 					cmd_list->SetRootConstants(1, constants);
 
-					GfxIndexBufferView ibv(batch.submesh->buffer_address + batch.submesh->indices_offset, batch.submesh->indices_count);
-					cmd_list->SetTopology(batch.submesh->topology);
+					GfxIndexBufferView ibv(submesh->buffer_address + submesh->indices_offset, submesh->indices_count);
+					cmd_list->SetTopology(submesh->topology);
 					cmd_list->SetIndexBuffer(&ibv);
-					cmd_list->DrawIndexed(batch.submesh->indices_count);
+					cmd_list->DrawIndexed(submesh->indices_count);
 				}
 
 			}, RGPassType::Graphics, RGPassFlags::ForceNoCull);
@@ -0,0 +1,74 @@
+#include "RenderProxyTable.h"
+#include "Components.h"
+
+namespace adria
+{
+
+	void RenderProxyTable::Clear()
+	{
+		center_x.clear(); center_y.clear(); center_z.clear();
+		extent_x.clear(); extent_y.clear(); extent_z.clear();
+		instance_ids.clear();
+		submeshes.clear();
+		alpha_modes.clear();
+		material_indices.clear();
+		geometry_buffer_slots.clear();
+		world_scales.clear();
+		camera_visibility.clear();
+		owners.clear();
+		bounds_versions.clear();
+	}
+
+	void RenderProxyTable::Reserve(uint32 count)
+	{
+		center_x.reserve(count); center_y.reserve(count); center_z.reserve(count);
+		extent_x.reserve(count); extent_y.reserve(count); extent_z.reserve(count);
+		instance_ids.reserve(count);
+		submeshes.reserve(count);
+		alpha_modes.reserve(count);
+		material_indices.reserve(count);
+		geometry_buffer_slots.reserve(count);
+		world_scales.reserve(count);
+		camera_visibility.reserve((count + 63) / 64);
+		owners.reserve(count);
+		bounds_versions.reserve((count + 63) / 64);
+	}
+
+	uint32 RenderProxyTable::Add(entt::entity owner, uint32 instance_id, SubMeshGPU const* submesh, MaterialAlphaMode alpha_mode, uint32 material_index, uint32 geometry_buffer_slot, DirectX::BoundingBox const& world_bounding_box, float world_scale)
+	{
+		uint32 const proxy = GetCount();
+		center_x.push_back(world_bounding_box.Center.x);
+		center_y.push_back(world_bounding_box.Center.y);
+		center_z.push_back(world_bounding_box.Center.z);
+		extent_x.push_back(world_bounding_box.Extents.x);
+		extent_y.push_back(world_bounding_box.Extents.y);
+		extent_z.push_back(world_bounding_box.Extents.z);
+		instance_ids.push_back(instance_id);
+		submeshes.push_back(submesh);
+		alpha_modes.push_back(alpha_mode);
+		material_indices.push_back(material_index);
+		geometry_buffer_slots.push_back(geometry_buffer_slot);
+		world_scales.push_back(world_scale);
+		if (proxy % 64 == 0)
+		{
+			camera_visibility.push_back(0);
+			bounds_versions.push_back(0);
+		}
+		camera_visibility.back() |= 1ull << (proxy % 64);
+		owners.push_back(owner);
+		return proxy;
+	}
+
+	void RenderProxyTable::SetBounds(uint32 proxy, DirectX::BoundingBox const& world_bounding_box, float world_scale)
+	{
+		ADRIA_ASSERT(proxy < GetCount());
+		center_x[proxy] = world_bounding_box.Center.x;
+		center_y[proxy] = world_bounding_box.Center.y;
+		center_z[proxy] = world_bounding_box.Center.z;
+		extent_x[proxy] = world_bounding_box.Extents.x;
+		extent_y[proxy] = world_bounding_box.Extents.y;
+		extent_z[proxy] = world_bounding_box.Extents.z;
+		world_scales[proxy] = world_scale;
+		++bounds_versions[proxy / 64];
+	}
+}
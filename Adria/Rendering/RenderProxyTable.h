@@ -0,0 +1,68 @@
+#pragma once
+#include <DirectXCollision.h>
+#include "FrustumCulling.h"
+#include "Utilities/AllocatorUtil.h"
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	struct SubMeshGPU;
+	enum class MaterialAlphaMode : uint8;
+
+	class RenderProxyTable
+	{
+	public:
+		void Clear();
+		void Reserve(uint32 count);
+		uint32 Add(entt::entity owner, uint32 instance_id, SubMeshGPU const* submesh, MaterialAlphaMode alpha_mode, uint32 material_index, uint32 geometry_buffer_slot, DirectX::BoundingBox const& world_bounding_box, float world_scale);
+		void SetBounds(uint32 proxy, DirectX::BoundingBox const& world_bounding_box, float world_scale);
+
+		uint32 GetCount() const { return (uint32)instance_ids.size(); }
+		uint32 GetRebuildCount() const { return rebuild_count; }
+		void MarkRebuilt() { ++rebuild_count; }
+		//bumped by SetBounds, one version per 64 proxy visibility word
+		uint32 GetBoundsVersion(uint32 word) const { return bounds_versions[word]; }
+
+		entt::entity GetOwner(uint32 proxy) const { return owners[proxy]; }
+		uint32 GetInstanceId(uint32 proxy) const { return instance_ids[proxy]; }
+		SubMeshGPU const* GetSubMesh(uint32 proxy) const { return submeshes[proxy]; }
+		MaterialAlphaMode GetAlphaMode(uint32 proxy) const { return alpha_modes[proxy]; }
+		uint32 GetMaterialIndex(uint32 proxy) const { return material_indices[proxy]; }
+		uint32 GetGeometryBufferSlot(uint32 proxy) const { return geometry_buffer_slots[proxy]; }
+		float GetWorldScale(uint32 proxy) const { return world_scales[proxy]; }
+		DirectX::BoundingBox GetBoundingBox(uint32 proxy) const
+		{
+			return DirectX::BoundingBox(
+				DirectX::XMFLOAT3(center_x[proxy], center_y[proxy], center_z[proxy]),
+				DirectX::XMFLOAT3(extent_x[proxy], extent_y[proxy], extent_z[proxy]));
+		}
+
+		bool IsVisible(uint32 proxy) const { return (camera_visibility[proxy / 64] >> (proxy % 64)) & 1ull; }
+		std::span<uint64> GetVisibility() { return camera_visibility; }
+
+		CullingBoxes GetCullingBoxes() const
+		{
+			return CullingBoxes
+			{
+				.center_x = center_x.data(), .center_y = center_y.data(), .center_z = center_z.data(),
+				.extent_x = extent_x.data(), .extent_y = extent_y.data(), .extent_z = extent_z.data(),
+				.count = GetCount()
+			};
+		}
+
+	private:
+		std::vector<float> center_x, center_y, center_z;
+		std::vector<float> extent_x, extent_y, extent_z;
+		std::vector<uint32> instance_ids;
+		std::vector<SubMeshGPU const*> submeshes;
+		std::vector<MaterialAlphaMode> alpha_modes;
+		std::vector<uint32> material_indices;
+		std::vector<uint32> geometry_buffer_slots;
+		std::vector<float> world_scales;
+		//cache line aligned so that culling chunks of whole lines never share one
+		std::vector<uint64, AlignedAllocator<uint64, 64>> camera_visibility;
+		std::vector<entt::entity> owners;
+		std::vector<uint32> bounds_versions;
+		uint32 rebuild_count = 0;
+	};
+}
@@ -32,11 +32,14 @@ namespace adria
 {
 	static TAutoConsoleVariable<int>  LightingPath("r.LightingPath", 0, "0 - Deferred, 1 - Tiled Deferred, 2 - Clustered Deferred, 3 - Path Tracing");
 	static TAutoConsoleVariable<int>  VolumetricPath("r.VolumetricPath", 1, "0 - None, 1 - 2D Raymarching, 2 - Fog Volume");
+	static TAutoConsoleVariable<bool> PickingCPU("r.Picking.CPU", true, "0 - Read back the GPU picking buffer, 1 - Ray cast the scene BVH on the CPU");
+	static TAutoConsoleVariable<bool> ClusteredLightingCPUBinning("r.ClusteredLighting.CPUBinning", false, "Bin lights into clusters on the CPU instead of the cluster culling compute pass");
+	static TAutoConsoleVariable<float> SceneBVHRebuildThreshold("r.SceneBVH.RebuildThreshold", 1.5f, "Rebuild the scene BVH in the background once refits raise its SAH cost by this factor");
 
 	Renderer::Renderer(entt::registry& reg, GfxDevice* gfx, uint32 width, uint32 height) : reg(reg), gfx(gfx), resource_pool(gfx),
 		accel_structure(gfx), camera(nullptr), display_width(width), display_height(height), render_width(width), render_height(height),
 		backbuffer_count(gfx->GetBackbufferCount()), backbuffer_index(gfx->GetBackbufferIndex()), final_texture(nullptr),
-		frame_cbuffer(gfx, backbuffer_count), gpu_driven_renderer(reg, gfx, width, height),
+		frame_cbuffer(gfx, backbuffer_count), render_proxies(reg.ctx().emplace<RenderProxyTable>()), scene_bvh(reg.ctx().emplace<SceneBVH>()), gpu_driven_renderer(reg, gfx, width, height),
 		gbuffer_pass(reg, gfx, width, height),
 		sky_pass(reg, gfx, width, height), deferred_lighting_pass(gfx, width, height), 
 		volumetric_lighting_pass(gfx, width, height), volumetric_fog_pass(gfx, reg, width, height),
@@ -48,6 +51,12 @@ namespace adria
 		path_tracer(gfx, width, height), ddgi(gfx, reg, width, height), gpu_debug_printer(gfx)
 	{
 		ray_tracing_supported = gfx->GetCapabilities().SupportsRayTracing();
+		scene_buffers[SceneBuffer_Light].Initialize(gfx, sizeof(LightGPU));
+		scene_buffers[SceneBuffer_Mesh].Initialize(gfx, sizeof(MeshGPU));
+		scene_buffers[SceneBuffer_Material].Initialize(gfx, sizeof(MaterialGPU));
+		scene_buffers[SceneBuffer_Instance].Initialize(gfx, sizeof(InstanceGPU));
+		scene_buffers[SceneBuffer_LightGrid].Initialize(gfx, sizeof(ClusterLightRange));
+		scene_buffers[SceneBuffer_LightList].Initialize(gfx, sizeof(uint32));
 
 		g_DebugRenderer.Initialize(gfx, width, height);
 		g_GfxProfiler.Initialize(gfx);
@@ -75,6 +84,8 @@ namespace adria
 		g_GfxProfiler.Destroy();
 		gfx->WaitForGPU();
 		reg.clear();
+		reg.ctx().erase<SceneBVH>();
+		reg.ctx().erase<RenderProxyTable>();
 		gfxcommon::Destroy();
 	}
 
@@ -102,9 +113,17 @@ namespace adria
 		UpdateSceneBuffers();
 		UpdateFrameConstants(dt);
 		CameraFrustumCulling();
+		RequestTextureMips();
+		BinLights();
+		if (update_picking_data && PickingCPU.Get()) PickScene();
 	}
 	void Renderer::Render()
 	{
+		UploadSceneBuffers();
+		//texture streaming commits its clamp buffer after the frame constants are filled
+		frame_cbuf_data.texture_mip_clamps_idx = g_TextureManager.GetMipClampsIndex();
+		frame_cbuffer.Update(frame_cbuf_data, backbuffer_index);
+
 		RenderGraph render_graph(resource_pool);
 		RGBlackboard& rg_blackboard = render_graph.GetBlackboard();
 		FrameBlackboardData frame_data{};
@@ -240,19 +259,19 @@ namespace adria
 	void Renderer::UpdateSceneBuffers()
 	{
 		volumetric_lights = 0;
-		for (auto e : reg.view<Batch>()) reg.destroy(e);
-		reg.clear<Batch>();
 
-		std::vector<LightGPU> hlsl_lights{};
+		auto light_view = reg.view<Light>();
+		SceneBuffer& light_buffer = scene_buffers[SceneBuffer_Light];
+		light_buffer.Resize((uint32)light_view.size());
+
 		uint32 light_index = 0;
 		Matrix light_transform = lighting_path == LightingPathType::PathTracing ? Matrix::Identity : camera->View();
-		for (auto light_entity : reg.view<Light>())
+		for (auto light_entity : light_view)
 		{
-			Light& light = reg.get<Light>(light_entity);
+			Light& light = light_view.get<Light>(light_entity);
 			light.light_index = light_index;
-			++light_index;
 
-			LightGPU& hlsl_light = hlsl_lights.emplace_back();
+			LightGPU hlsl_light{};
 			hlsl_light.color = light.color * light.intensity;
 			hlsl_light.position = Vector4::Transform(light.position, light_transform);
 			hlsl_light.direction = Vector4::Transform(light.direction, light_transform);
@@ -268,52 +287,118 @@ namespace adria
 			hlsl_light.shadow_mask_index = light.ray_traced_shadows ? light.shadow_mask_index : -1;
 			hlsl_light.use_cascades = light.use_cascades;
 			if (light.volumetric) ++volumetric_lights;
+
+			light_buffer.Update(light_index, hlsl_light);
+			++light_index;
+		}
+
+		auto mesh_view = reg.view<Mesh>();
+		uint32 mesh_count = 0, instance_count = 0, submesh_count = 0, material_count = 0;
+		bool transforms_moved = false;
+		for (auto mesh_entity : mesh_view)
+		{
+			Mesh& mesh = mesh_view.get<Mesh>(mesh_entity);
+			TransformHierarchy& transform_hierarchy = mesh.transform_hierarchy;
+			if (Transform const* transform = reg.try_get<Transform>(mesh_entity); transform && transform_hierarchy.GetNodeCount() > 0 &&
+				transform->current_transform != transform_hierarchy.GetLocalTransform(0))
+			{
+				transform_hierarchy.SetLocalTransform(0, transform->current_transform);
+			}
+			if (transform_hierarchy.Update())
+			{
+				for (SubMeshInstance& instance : mesh.instances)
+				{
+					if (transform_hierarchy.WasUpdated(instance.transform_node)) instance.world_transform = transform_hierarchy.GetWorldTransform(instance.transform_node);
+				}
+				transforms_moved = true;
+			}
+
+			if (mesh.geometry_buffer_slot != mesh_count || mesh.instance_offset != instance_count ||
+				mesh.submesh_offset != submesh_count || mesh.material_offset != material_count)
+			{
+				mesh.geometry_buffer_slot = mesh_count;
+				mesh.instance_offset = instance_count;
+				mesh.submesh_offset = submesh_count;
+				mesh.material_offset = material_count;
+				mesh.dirty = true;
+			}
+			++mesh_count;
+			instance_count += (uint32)mesh.instances.size();
+			submesh_count += (uint32)mesh.submeshes.size();
+			material_count += (uint32)mesh.materials.size();
+		}
+		bool rebuild_proxies = mesh_count != render_proxies_mesh_count || instance_count != render_proxies_instance_count;
+		for (auto mesh_entity : mesh_view) rebuild_proxies |= mesh_view.get<Mesh>(mesh_entity).dirty;
+		if (rebuild_proxies)
+		{
+			render_proxies.Clear();
+			render_proxies.Reserve(instance_count);
+			render_proxies.MarkRebuilt();
+			render_proxies_mesh_count = mesh_count;
+			render_proxies_instance_count = instance_count;
 		}
 
-		std::vector<MeshGPU> meshes;
-		std::vector<InstanceGPU> instances;
-		std::vector<MaterialGPU> materials;
-		uint32 instanceID = 0;
+		scene_buffers[SceneBuffer_Instance].Resize(instance_count);
+		scene_buffers[SceneBuffer_Mesh].Resize(submesh_count);
+		scene_buffers[SceneBuffer_Material].Resize(material_count);
 
-		for (auto mesh_entity : reg.view<Mesh>())
+		mesh_buffers_gpu = mesh_count > 0 ? gfx->AllocateDescriptorsGPU(mesh_count) : GfxDescriptor{};
+		for (auto mesh_entity : mesh_view)
 		{
-			Mesh& mesh = reg.get<Mesh>(mesh_entity);
+			Mesh& mesh = mesh_view.get<Mesh>(mesh_entity);
 
-			GfxBuffer* mesh_buffer = g_GeometryBufferCache.GetGeometryBuffer(mesh.geometry_buffer_handle);
 			GfxDescriptor mesh_buffer_srv = g_GeometryBufferCache.GetGeometryBufferSRV(mesh.geometry_buffer_handle);
-			GfxDescriptor mesh_buffer_online_srv = gfx->AllocateDescriptorsGPU();
-			gfx->CopyDescriptors(1, mesh_buffer_online_srv, mesh_buffer_srv);
+			gfx->CopyDescriptors(1, gfx->GetDescriptorGPU(mesh_buffers_gpu.GetIndex() + mesh.geometry_buffer_slot), mesh_buffer_srv);
 
-			for (auto const& instance : mesh.instances)
+			if (rebuild_proxies)
 			{
-				SubMeshGPU& submesh = mesh.submeshes[instance.submesh_index];
-				Material& material = mesh.materials[submesh.material_index];
+				for (uint32 i = 0; i < mesh.instances.size(); ++i)
+				{
+					SubMeshInstance const& instance = mesh.instances[i];
+					SubMeshGPU const& submesh = mesh.submeshes[instance.submesh_index];
+					Material const& material = mesh.materials[submesh.material_index];
+
+					BoundingBox world_bounding_box;
+					submesh.bounding_box.Transform(world_bounding_box, instance.world_transform);
+					render_proxies.Add(mesh_entity, mesh.instance_offset + i, &submesh, material.alpha_mode, mesh.material_offset + submesh.material_index, mesh.geometry_buffer_slot,
+						world_bounding_box, MeshLODWorldScale(instance.world_transform));
+				}
+			}
+			if (!mesh.dirty && !mesh.transform_hierarchy.HasUpdates()) continue;
 
+			GfxBuffer* mesh_buffer = g_GeometryBufferCache.GetGeometryBuffer(mesh.geometry_buffer_handle);
+			for (uint32 i = 0; i < mesh.instances.size(); ++i)
+			{
+				SubMeshInstance const& instance = mesh.instances[i];
+				if (!mesh.dirty && !mesh.transform_hierarchy.WasUpdated(instance.transform_node)) continue;
+
+				SubMeshGPU& submesh = mesh.submeshes[instance.submesh_index];
 				submesh.buffer_address = mesh_buffer->GetGpuAddress();
+				if (!rebuild_proxies)
+				{
+					//proxies are added in instance order, so an instance id is also its proxy index
+					BoundingBox world_bounding_box;
+					submesh.bounding_box.Transform(world_bounding_box, instance.world_transform);
+					render_proxies.SetBounds(mesh.instance_offset + i, world_bounding_box, MeshLODWorldScale(instance.world_transform));
+				}
 
-				entt::entity batch_entity = reg.create();
-				Batch& batch = reg.emplace<Batch>(batch_entity);
-				batch.instance_id = instanceID;
-				batch.alpha_mode = material.alpha_mode;
-				batch.submesh = &submesh;
-				batch.world_transform = instance.world_transform;
-				submesh.bounding_box.Transform(batch.bounding_box, batch.world_transform);
-
-				InstanceGPU& instance_hlsl = instances.emplace_back();
-				instance_hlsl.instance_id = instanceID;
-				instance_hlsl.material_idx = static_cast<uint32>(materials.size() + submesh.material_index);
-				instance_hlsl.mesh_index = static_cast<uint32>(meshes.size() + instance.submesh_index);
+				InstanceGPU instance_hlsl{};
+				instance_hlsl.instance_id = mesh.instance_offset + i;
+				instance_hlsl.material_idx = mesh.material_offset + submesh.material_index;
+				instance_hlsl.mesh_index = mesh.submesh_offset + instance.submesh_index;
 				instance_hlsl.world_matrix = instance.world_transform;
 				instance_hlsl.inverse_world_matrix = XMMatrixInverse(nullptr, instance.world_transform);
 				instance_hlsl.bb_origin = submesh.bounding_box.Center;
 				instance_hlsl.bb_extents = submesh.bounding_box.Extents;
-
-				++instanceID;
+				scene_buffers[SceneBuffer_Instance].Update(instance_hlsl.instance_id, instance_hlsl);
 			}
-			for (auto const& submesh : mesh.submeshes)
+			if (!mesh.dirty) continue;
+
+			for (uint32 i = 0; i < mesh.submeshes.size(); ++i)
 			{
-				MeshGPU& mesh_hlsl = meshes.emplace_back();
-				mesh_hlsl.buffer_idx = mesh_buffer_online_srv.GetIndex();
+				SubMeshGPU const& submesh = mesh.submeshes[i];
+				MeshGPU mesh_hlsl{};
+				mesh_hlsl.buffer_idx = mesh.geometry_buffer_slot;
 				mesh_hlsl.indices_offset = submesh.indices_offset;
 				mesh_hlsl.positions_offset = submesh.positions_offset;
 				mesh_hlsl.normals_offset = submesh.normals_offset;
@@ -324,11 +409,12 @@ namespace adria
 				mesh_hlsl.meshlet_vertices_offset = submesh.meshlet_vertices_offset;
 				mesh_hlsl.meshlet_triangles_offset = submesh.meshlet_triangles_offset;
 				mesh_hlsl.meshlet_count = submesh.meshlet_count;
+				scene_buffers[SceneBuffer_Mesh].Update(mesh.submesh_offset + i, mesh_hlsl);
 			}
-
-			for (auto const& material : mesh.materials)
+			for (uint32 i = 0; i < mesh.materials.size(); ++i)
 			{
-				MaterialGPU& material_hlsl = materials.emplace_back();
+				Material const& material = mesh.materials[i];
+				MaterialGPU material_hlsl{};
 				material_hlsl.diffuse_idx = (uint32)material.albedo_texture;
 				material_hlsl.normal_idx = (uint32)material.normal_texture;
 				material_hlsl.roughness_metallic_idx = (uint32)material.metallic_roughness_texture;
@@ -338,27 +424,30 @@ namespace adria
 				material_hlsl.metallic_factor = material.metallic_factor;
 				material_hlsl.roughness_factor = material.roughness_factor;
 				material_hlsl.alpha_cutoff = material.alpha_cutoff;
+				scene_buffers[SceneBuffer_Material].Update(mesh.material_offset + i, material_hlsl);
 			}
+			mesh.dirty = false;
 		}
 
-		auto CopyBuffer = [&]<typename T>(std::vector<T> const& data, SceneBuffer& scene_buffer)
+		if (rebuild_proxies)
 		{
-			if (data.empty()) return;
-			if (!scene_buffer.buffer || scene_buffer.buffer->GetCount() < data.size())
-			{
-				scene_buffer.buffer = gfx->CreateBuffer(StructuredBufferDesc<T>(data.size(), false, true));
-				scene_buffer.buffer_srv = gfx->CreateBufferSRV(scene_buffer.buffer.get());
-			}
-			scene_buffer.buffer->Update(data.data(), data.size() * sizeof(T));
-			scene_buffer.buffer_srv_gpu = gfx->AllocateDescriptorsGPU();
-			gfx->CopyDescriptors(1, scene_buffer.buffer_srv_gpu, scene_buffer.buffer_srv);
-		};
-		CopyBuffer(hlsl_lights, scene_buffers[SceneBuffer_Light]);
-		CopyBuffer(meshes, scene_buffers[SceneBuffer_Mesh]);
-		CopyBuffer(instances, scene_buffers[SceneBuffer_Instance]);
-		CopyBuffer(materials, scene_buffers[SceneBuffer_Material]);
+			if (scene_bvh.GetProxyCount() == render_proxies.GetCount()) scene_bvh.Refit(render_proxies.GetCullingBoxes());
+			else scene_bvh.Build(render_proxies.GetCullingBoxes());
+		}
+		else if (transforms_moved)
+		{
+			scene_bvh.Refit(render_proxies.GetCullingBoxes());
+		}
+		scene_bvh.Update(render_proxies.GetCullingBoxes(), SceneBVHRebuildThreshold.Get());
 
-		uint64 count = reg.size();
+		for (SceneBuffer& scene_buffer : scene_buffers) scene_buffer.Commit();
+	}
+
+	void Renderer::UploadSceneBuffers()
+	{
+		GfxCommandList* cmd_list = gfx->GetCommandList();
+		scene_buffers_upload_size = 0;
+		for (SceneBuffer& scene_buffer : scene_buffers) scene_buffers_upload_size += scene_buffer.Upload(cmd_list);
 	}
 
 	void Renderer::UpdateFrameConstants(float dt)
@@ -394,10 +483,11 @@ namespace adria
 		frame_cbuf_data.mouse_normalized_coords_x = (viewport_data.mouse_position_x - viewport_data.scene_viewport_pos_x) / viewport_data.scene_viewport_size_x;
 		frame_cbuf_data.mouse_normalized_coords_y = (viewport_data.mouse_position_y - viewport_data.scene_viewport_pos_y) / viewport_data.scene_viewport_size_y;
 		frame_cbuf_data.env_map_idx = sky_pass.GetSkyIndex();
-		frame_cbuf_data.meshes_idx = (int32)scene_buffers[SceneBuffer_Mesh].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.materials_idx = (int32)scene_buffers[SceneBuffer_Material].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.instances_idx = (int32)scene_buffers[SceneBuffer_Instance].buffer_srv_gpu.GetIndex();
-		frame_cbuf_data.lights_idx = (int32)scene_buffers[SceneBuffer_Light].buffer_srv_gpu.GetIndex();
+		frame_cbuf_data.meshes_idx = (int32)scene_buffers[SceneBuffer_Mesh].GetSRV().GetIndex();
+		frame_cbuf_data.materials_idx = (int32)scene_buffers[SceneBuffer_Material].GetSRV().GetIndex();
+		frame_cbuf_data.instances_idx = (int32)scene_buffers[SceneBuffer_Instance].GetSRV().GetIndex();
+		frame_cbuf_data.lights_idx = (int32)scene_buffers[SceneBuffer_Light].GetSRV().GetIndex();
+		frame_cbuf_data.mesh_buffers_idx = (int32)mesh_buffers_gpu.GetIndex();
 		shadow_renderer.FillFrameCBuffer(frame_cbuf_data);
 		frame_cbuf_data.ddgi_volumes_idx = ddgi.IsEnabled() ? ddgi.GetDDGIVolumeIndex() : -1;
 		frame_cbuf_data.printf_buffer_idx = gpu_debug_printer.GetPrintfBufferIndex();
@@ -435,17 +525,76 @@ namespace adria
 	}
 	void Renderer::CameraFrustumCulling()
 	{
-		BoundingFrustum camera_frustum = camera->Frustum();
-		auto batch_view = reg.view<Batch>();
-		auto light_view = reg.view<Light>();
-		for (auto e : batch_view)
+		CullingFrustum camera_frustum = MakeCullingFrustum(camera->Frustum());
+		CullBoxesParallel(camera_frustum, render_proxies.GetCullingBoxes(), render_proxies.GetVisibility());
+		//the GPU driven path culls against the HZB, shadow casters only use the light frusta since camera occluded objects still cast shadows
+		if (!gpu_driven_renderer.IsEnabled()) software_occlusion.Cull(reg, render_proxies, camera->ViewProj(), camera->AspectRatio());
+	}
+
+	void Renderer::RequestTextureMips()
+	{
+		if (!g_TextureManager.HasStreamedTextures()) return;
+
+		float const pixel_scale = camera->Proj()._22 * render_height * 0.5f;
+		Vector3 const camera_position = camera->Position();
+		for (uint32 proxy = 0; proxy < render_proxies.GetCount(); ++proxy)
 		{
-			Batch& batch = batch_view.get<Batch>(e);
-			auto& aabb = batch.bounding_box;
-			batch.camera_visibility = camera_frustum.Intersects(aabb);
+			if (!render_proxies.IsVisible(proxy)) continue;
+			SubMeshGPU const& submesh = *render_proxies.GetSubMesh(proxy);
+			Material const& material = reg.get<Mesh>(render_proxies.GetOwner(proxy)).materials[submesh.material_index];
+
+			//pixels covered by one uv unit at the closest point of the bounds, camera inside the bounds asks for full detail
+			BoundingBox const bounding_box = render_proxies.GetBoundingBox(proxy);
+			float const view_distance = Vector3::Distance(Vector3(bounding_box.Center), camera_position) - Vector3(bounding_box.Extents).Length();
+			float const pixels_per_uv = submesh.uv_world_scale * render_proxies.GetWorldScale(proxy) * pixel_scale / std::max(view_distance, 1e-4f);
+			for (TextureHandle texture : { material.albedo_texture, material.normal_texture, material.metallic_roughness_texture, material.emissive_texture })
+			{
+				g_TextureManager.RequestTextureMip(texture, pixels_per_uv);
+			}
 		}
 	}
 
+	void Renderer::BinLights()
+	{
+		cpu_light_lists = lighting_path == LightingPathType::ClusteredDeferred && ClusteredLightingCPUBinning.Get();
+		if (!cpu_light_lists) return;
+
+		light_binning.Bin(reg, camera->View(), camera->Proj(), camera->Near(), camera->Far(), render_width, render_height);
+		std::span<ClusterLightRange const> light_grid = light_binning.GetLightGrid();
+		std::span<uint32 const> light_index_list = light_binning.GetLightIndexList();
+
+		SceneBuffer& light_grid_buffer = scene_buffers[SceneBuffer_LightGrid];
+		light_grid_buffer.Resize((uint32)light_grid.size());
+		light_grid_buffer.Update(0, light_grid.data(), (uint32)light_grid.size());
+		light_grid_buffer.Commit();
+
+		//an empty list still needs a buffer to bind
+		SceneBuffer& light_list_buffer = scene_buffers[SceneBuffer_LightList];
+		light_list_buffer.Resize(std::max((uint32)light_index_list.size(), 1u));
+		light_list_buffer.Update(0, light_index_list.data(), (uint32)light_index_list.size());
+		light_list_buffer.Commit();
+	}
+
+	void Renderer::PickScene()
+	{
+		float const u = (viewport_data.mouse_position_x - viewport_data.scene_viewport_pos_x) / viewport_data.scene_viewport_size_x;
+		float const v = (viewport_data.mouse_position_y - viewport_data.scene_viewport_pos_y) / viewport_data.scene_viewport_size_y;
+		Matrix const inverse_view_projection = camera->ViewProj().Invert();
+		//reverse z, ndc depth 1 is the near plane
+		Vector3 const near_point = Vector3::Transform(Vector3(2.0f * u - 1.0f, 1.0f - 2.0f * v, 1.0f), inverse_view_projection);
+		Vector3 const far_point = Vector3::Transform(Vector3(2.0f * u - 1.0f, 1.0f - 2.0f * v, 0.0f), inverse_view_projection);
+		Vector3 direction = far_point - near_point;
+		direction.Normalize();
+
+		if (RayCastScene(reg, Ray(near_point, direction), FLT_MAX, picking_hit))
+		{
+			picking_data.position = Vector4(picking_hit.position.x, picking_hit.position.y, picking_hit.position.z, 1.0f);
+			picking_data.normal = Vector4(picking_hit.normal.x, picking_hit.normal.y, picking_hit.normal.z, 0.0f);
+		}
+		else picking_hit.entity = entt::null;
+		update_picking_data = false;
+	}
+
 	void Renderer::Render_Deferred(RenderGraph& render_graph)
 	{
 		if (update_picking_data)
@@ -470,7 +619,10 @@ namespace adria
 			{
 			case LightingPathType::Deferred:			deferred_lighting_pass.AddPass(render_graph); break;
 			case LightingPathType::TiledDeferred:		tiled_deferred_lighting_pass.AddPass(render_graph); break;
-			case LightingPathType::ClusteredDeferred:	clustered_deferred_lighting_pass.AddPass(render_graph, true); break;
+			case LightingPathType::ClusteredDeferred:
+				if (cpu_light_lists) clustered_deferred_lighting_pass.AddPass(render_graph, scene_buffers[SceneBuffer_LightGrid].GetSRV(), scene_buffers[SceneBuffer_LightList].GetSRV());
+				else clustered_deferred_lighting_pass.AddPass(render_graph, true);
+				break;
 			}
 
 			if (volumetric_lights > 0)
@@ -486,7 +638,7 @@ namespace adria
 			ocean_renderer.AddPasses(render_graph);
 			sky_pass.AddComputeSkyPass(render_graph, sun_direction);
 			sky_pass.AddDrawSkyPass(render_graph);
-			picking_pass.AddPass(render_graph);
+			if (!PickingCPU.Get()) picking_pass.AddPass(render_graph);
 			postprocessor.AddPasses(render_graph);
 			if (rain_pass.IsEnabled()) rain_pass.AddPass(render_graph);
 			g_DebugRenderer.Render(render_graph);
@@ -509,6 +661,24 @@ namespace adria
 		if (renderer_output == RendererOutput::Final)
 		{
 			if (lighting_path == LightingPathType::TiledDeferred) tiled_deferred_lighting_pass.GUI();
+			else if (lighting_path == LightingPathType::ClusteredDeferred)
+			{
+				QueueGUI([&]()
+					{
+						if (ImGui::TreeNode("Clustered Deferred"))
+						{
+							ImGui::Checkbox("CPU Light Binning", ClusteredLightingCPUBinning.GetPtr());
+							if (cpu_light_lists)
+							{
+								ClusteredLightBinningStats const& stats = light_binning.GetStats();
+								ImGui::Text("Lights: %u visible of %u", stats.visible_light_count, stats.light_count);
+								ImGui::Text("Light indices: %u, most in a cluster: %u", stats.light_index_count, stats.max_cluster_lights);
+								ImGui::Text("Binning: %.3f ms", stats.bin_time);
+							}
+							ImGui::TreePop();
+						}
+					}, GUICommandGroup_Renderer);
+			}
 			switch (volumetric_path)
 			{
 			case VolumetricPathType::Raymarching2D: volumetric_lighting_pass.GUI(); break;
@@ -517,6 +687,9 @@ namespace adria
 			ocean_renderer.GUI();
 			sky_pass.GUI();
 			rain_pass.GUI();
+			gbuffer_pass.GUI();
+			if (!gpu_driven_renderer.IsEnabled()) software_occlusion.GUI();
+			shadow_renderer.GUI();
 			QueueGUI([&]()
 				{
 					if (ImGui::TreeNode("Sun Settings"))
@@ -571,6 +744,10 @@ namespace adria
 						ImGui::SliderFloat3("Wind Direction", wind_dir, -1.0f, 1.0f);
 						ImGui::SliderFloat("Wind Speed", &wind_speed, 0.0f, 32.0f);
 						volumetric_path = static_cast<VolumetricPathType>(current_volumetric_path);
+						ImGui::Text("Scene Buffers Upload: %.2f KB", scene_buffers_upload_size / 1024.0f);
+						ImGui::Text("Render Proxies: %u (rebuilds: %u)", render_proxies.GetCount(), render_proxies.GetRebuildCount());
+						ImGui::Text("Scene BVH: %u nodes, SAH cost %.2f (x%.2f)%s", scene_bvh.GetNodeCount(), scene_bvh.GetCost(), scene_bvh.GetCostRatio(), scene_bvh.IsRebuilding() ? ", rebuilding" : "");
+						ImGui::Text("Scene BVH Build: %.2f ms, Refit: %.2f ms (rebuilds: %u)", scene_bvh.GetBuildTime(), scene_bvh.GetRefitTime(), scene_bvh.GetRebuildCount());
 						ImGui::TreePop();
 					}
 				}, GUICommandGroup_Renderer);
@@ -21,6 +21,12 @@
 #include "ShadowRenderer.h"
 #include "PathTracingPass.h"
 #include "RendererOutputPass.h"
+#include "SceneBuffer.h"
+#include "RenderProxyTable.h"
+#include "SceneBVH.h"
+#include "SceneRayQuery.h"
+#include "SoftwareOcclusion.h"
+#include "ClusteredLightBinning.h"
 #include "Graphics/GfxShaderCompiler.h"
 #include "Graphics/GfxConstantBuffer.h"
 #include "RenderGraph/RenderGraphResourcePool.h"
@@ -66,6 +72,7 @@ namespace adria
 		void OnTakeScreenshot(char const*);
 
 		PickingData const& GetPickingData() const { return picking_data; }
+		SceneRayHit const& GetPickingHit() const { return picking_hit; }
 		Vector2u GetDisplayResolution() const { return Vector2u(display_width, display_height); }
 
 		RendererOutput GetRendererOutput() const { return renderer_output; }
@@ -104,15 +111,20 @@ namespace adria
 			SceneBuffer_Mesh, 
 			SceneBuffer_Material, 
 			SceneBuffer_Instance, 
+			SceneBuffer_LightGrid, 
+			SceneBuffer_LightList, 
 			SceneBuffer_Count 
 		};
-		struct SceneBuffer
-		{
-			std::unique_ptr<GfxBuffer>  buffer;
-			GfxDescriptor				buffer_srv;
-			GfxDescriptor				buffer_srv_gpu;
-		};
 		std::array<SceneBuffer, SceneBuffer_Count> scene_buffers;
+		GfxDescriptor mesh_buffers_gpu;
+		uint64 scene_buffers_upload_size = 0;
+		RenderProxyTable& render_proxies;
+		uint32 render_proxies_mesh_count = 0;
+		uint32 render_proxies_instance_count = 0;
+		SceneBVH& scene_bvh;
+		SoftwareOcclusion software_occlusion;
+		ClusteredLightBinning light_binning;
+		bool cpu_light_lists = false;
 
 		//passes
 		GBufferPass  gbuffer_pass;
@@ -144,6 +156,7 @@ namespace adria
 		//picking
 		bool update_picking_data = false;
 		PickingData picking_data;
+		SceneRayHit picking_hit{ .entity = entt::null };
 
 		LightingPathType	 lighting_path = LightingPathType::Deferred;
 		RendererOutput		 renderer_output = RendererOutput::Final;
@@ -173,8 +186,12 @@ namespace adria
 
 		void GUI();
 		void UpdateSceneBuffers();
+		void UploadSceneBuffers();
 		void UpdateFrameConstants(float dt);
 		void CameraFrustumCulling();
+		void RequestTextureMips();
+		void BinLights();
+		void PickScene();
 
 		void Render_Deferred(RenderGraph& rg);
 		void Render_PathTracing(RenderGraph& rg);
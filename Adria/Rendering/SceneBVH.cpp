@@ -0,0 +1,252 @@
+#include <numeric>
+#include "SceneBVH.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Timer.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr uint32 SAH_BIN_COUNT = 12;
+		constexpr uint32 MAX_LEAF_SIZE = 4;
+		constexpr uint32 INVALID_NODE = uint32(-1);
+
+		float SurfaceArea(Vector3 const& min, Vector3 const& max)
+		{
+			Vector3 const d = max - min;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+
+		//SAH cost normalized by the root area, traversal and intersection costs are both 1
+		float ComputeCost(SceneBVHData const& data)
+		{
+			if (data.nodes.empty()) return 0.0f;
+			float const root_area = SurfaceArea(data.nodes[0].min, data.nodes[0].max);
+			if (root_area <= 0.0f) return 0.0f;
+
+			float cost = 0.0f;
+			for (SceneBVHNode const& node : data.nodes) cost += SurfaceArea(node.min, node.max) * (node.count == 0 ? 1.0f : (float)node.count);
+			return cost / root_area;
+		}
+
+		void GetBoxes(CullingBoxes const& boxes, std::vector<Vector3>& proxy_min, std::vector<Vector3>& proxy_max)
+		{
+			proxy_min.resize(boxes.count);
+			proxy_max.resize(boxes.count);
+			for (uint32 i = 0; i < boxes.count; ++i)
+			{
+				Vector3 const center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+				Vector3 const extents(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+				proxy_min[i] = center - extents;
+				proxy_max[i] = center + extents;
+			}
+		}
+	}
+
+	SceneBVHData BuildBVH(std::vector<Vector3> const& primitive_min, std::vector<Vector3> const& primitive_max)
+	{
+		Timer timer;
+		SceneBVHData data;
+		uint32 const primitive_count = (uint32)primitive_min.size();
+		if (primitive_count == 0) return data;
+
+		std::vector<Vector3> centroids(primitive_count);
+		for (uint32 i = 0; i < primitive_count; ++i) centroids[i] = (primitive_min[i] + primitive_max[i]) * 0.5f;
+		data.proxies.resize(primitive_count);
+		std::iota(data.proxies.begin(), data.proxies.end(), 0u);
+		data.nodes.reserve(2 * primitive_count);
+
+		struct BuildTask
+		{
+			uint32 begin;
+			uint32 end;
+			uint32 depth;
+			uint32 parent;
+		};
+		std::vector<BuildTask> tasks;
+		tasks.push_back(BuildTask{ 0, primitive_count, 0, INVALID_NODE });
+		while (!tasks.empty())
+		{
+			BuildTask const task = tasks.back();
+			tasks.pop_back();
+
+			uint32 const node_index = (uint32)data.nodes.size();
+			if (task.parent != INVALID_NODE) data.nodes[task.parent].offset = node_index;
+
+			Vector3 bounds_min(FLT_MAX), bounds_max(-FLT_MAX);
+			Vector3 centroid_min(FLT_MAX), centroid_max(-FLT_MAX);
+			for (uint32 i = task.begin; i < task.end; ++i)
+			{
+				uint32 const primitive = data.proxies[i];
+				bounds_min = Vector3::Min(bounds_min, primitive_min[primitive]);
+				bounds_max = Vector3::Max(bounds_max, primitive_max[primitive]);
+				centroid_min = Vector3::Min(centroid_min, centroids[primitive]);
+				centroid_max = Vector3::Max(centroid_max, centroids[primitive]);
+			}
+			SceneBVHNode& node = data.nodes.emplace_back();
+			node.min = bounds_min;
+			node.max = bounds_max;
+
+			uint32 const count = task.end - task.begin;
+			if (count <= MAX_LEAF_SIZE || task.depth >= SceneBVH::MAX_DEPTH)
+			{
+				node.offset = task.begin;
+				node.count = count;
+				continue;
+			}
+
+			uint32 best_axis = 3, best_bin = 0;
+			float best_cost = FLT_MAX;
+			for (uint32 axis = 0; axis < 3; ++axis)
+			{
+				float const axis_min = (&centroid_min.x)[axis];
+				float const axis_extent = (&centroid_max.x)[axis] - axis_min;
+				if (axis_extent <= 1e-6f) continue;
+
+				struct Bin
+				{
+					Vector3 min = Vector3(FLT_MAX);
+					Vector3 max = Vector3(-FLT_MAX);
+					uint32 count = 0;
+				};
+				Bin bins[SAH_BIN_COUNT];
+				float const scale = SAH_BIN_COUNT / axis_extent;
+				for (uint32 i = task.begin; i < task.end; ++i)
+				{
+					uint32 const primitive = data.proxies[i];
+					uint32 const bin_index = std::min((uint32)(((&centroids[primitive].x)[axis] - axis_min) * scale), SAH_BIN_COUNT - 1);
+					bins[bin_index].min = Vector3::Min(bins[bin_index].min, primitive_min[primitive]);
+					bins[bin_index].max = Vector3::Max(bins[bin_index].max, primitive_max[primitive]);
+					++bins[bin_index].count;
+				}
+
+				float right_costs[SAH_BIN_COUNT] = {};
+				Vector3 right_min(FLT_MAX), right_max(-FLT_MAX);
+				uint32 right_count = 0;
+				for (uint32 bin = SAH_BIN_COUNT - 1; bin > 0; --bin)
+				{
+					right_min = Vector3::Min(right_min, bins[bin].min);
+					right_max = Vector3::Max(right_max, bins[bin].max);
+					right_count += bins[bin].count;
+					right_costs[bin] = right_count > 0 ? right_count * SurfaceArea(right_min, right_max) : 0.0f;
+				}
+
+				Vector3 left_min(FLT_MAX), left_max(-FLT_MAX);
+				uint32 left_count = 0;
+				for (uint32 bin = 1; bin < SAH_BIN_COUNT; ++bin)
+				{
+					left_min = Vector3::Min(left_min, bins[bin - 1].min);
+					left_max = Vector3::Max(left_max, bins[bin - 1].max);
+					left_count += bins[bin - 1].count;
+					if (left_count == 0 || left_count == count) continue;
+
+					float const split_cost = left_count * SurfaceArea(left_min, left_max) + right_costs[bin];
+					if (split_cost < best_cost)
+					{
+						best_cost = split_cost;
+						best_axis = axis;
+						best_bin = bin;
+					}
+				}
+			}
+
+			uint32 middle = task.begin + count / 2;
+			if (best_axis < 3)
+			{
+				float const axis_min = (&centroid_min.x)[best_axis];
+				float const scale = SAH_BIN_COUNT / ((&centroid_max.x)[best_axis] - axis_min);
+				auto const split = std::partition(data.proxies.begin() + task.begin, data.proxies.begin() + task.end, [&](uint32 primitive)
+					{
+						return std::min((uint32)(((&centroids[primitive].x)[best_axis] - axis_min) * scale), SAH_BIN_COUNT - 1) < best_bin;
+					});
+				uint32 const split_index = (uint32)(split - data.proxies.begin());
+				if (split_index != task.begin && split_index != task.end) middle = split_index;
+			}
+
+			node.count = 0;
+			tasks.push_back(BuildTask{ middle, task.end, task.depth + 1, node_index });
+			tasks.push_back(BuildTask{ task.begin, middle, task.depth + 1, INVALID_NODE });
+		}
+
+		data.proxy_min.resize(primitive_count);
+		data.proxy_max.resize(primitive_count);
+		for (uint32 i = 0; i < primitive_count; ++i)
+		{
+			data.proxy_min[i] = primitive_min[data.proxies[i]];
+			data.proxy_max[i] = primitive_max[data.proxies[i]];
+		}
+		data.build_cost = ComputeCost(data);
+		data.build_time = timer.Elapsed() / 1000.0f;
+		return data;
+	}
+
+	void SceneBVH::Build(CullingBoxes const& boxes)
+	{
+		std::vector<Vector3> proxy_min, proxy_max;
+		GetBoxes(boxes, proxy_min, proxy_max);
+		data = BuildBVH(proxy_min, proxy_max);
+		cost = data.build_cost;
+		++rebuild_count;
+	}
+
+	void SceneBVH::Refit(CullingBoxes const& boxes)
+	{
+		ADRIA_ASSERT(boxes.count == data.proxies.size());
+		Timer timer;
+		for (uint32 i = 0; i < data.proxies.size(); ++i)
+		{
+			uint32 const proxy = data.proxies[i];
+			Vector3 const center(boxes.center_x[proxy], boxes.center_y[proxy], boxes.center_z[proxy]);
+			Vector3 const extents(boxes.extent_x[proxy], boxes.extent_y[proxy], boxes.extent_z[proxy]);
+			data.proxy_min[i] = center - extents;
+			data.proxy_max[i] = center + extents;
+		}
+
+		//children are always stored after their parent, so a reverse sweep refits bottom-up
+		for (uint32 node_index = (uint32)data.nodes.size(); node_index-- > 0;)
+		{
+			SceneBVHNode& node = data.nodes[node_index];
+			if (node.count == 0)
+			{
+				SceneBVHNode const& left = data.nodes[node_index + 1];
+				SceneBVHNode const& right = data.nodes[node.offset];
+				node.min = Vector3::Min(left.min, right.min);
+				node.max = Vector3::Max(left.max, right.max);
+				continue;
+			}
+			node.min = Vector3(FLT_MAX);
+			node.max = Vector3(-FLT_MAX);
+			for (uint32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				node.min = Vector3::Min(node.min, data.proxy_min[i]);
+				node.max = Vector3::Max(node.max, data.proxy_max[i]);
+			}
+		}
+		cost = ComputeCost(data);
+		refit_time = timer.Elapsed() / 1000.0f;
+	}
+
+	void SceneBVH::Update(CullingBoxes const& boxes, float rebuild_threshold)
+	{
+		if (pending_build.valid() && pending_build.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			SceneBVHData built_data = pending_build.get();
+			if (built_data.proxies.size() == boxes.count)
+			{
+				data = std::move(built_data);
+				++rebuild_count;
+				Refit(boxes);
+			}
+		}
+
+		if (!pending_build.valid() && boxes.count > 0 && GetCostRatio() > rebuild_threshold)
+		{
+			std::vector<Vector3> proxy_min, proxy_max;
+			GetBoxes(boxes, proxy_min, proxy_max);
+			pending_build = g_ThreadPool.Submit([proxy_min = std::move(proxy_min), proxy_max = std::move(proxy_max)]()
+				{
+					return BuildBVH(proxy_min, proxy_max);
+				});
+		}
+	}
+}
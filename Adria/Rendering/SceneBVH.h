@@ -0,0 +1,206 @@
+#pragma once
+#include <future>
+#include "FrustumCulling.h"
+
+namespace adria
+{
+	struct SceneBVHNode
+	{
+		Vector3 min;
+		uint32 offset;	//first proxy for leaves, right child for interior nodes, left child is always the next node
+		Vector3 max;
+		uint32 count;	//0 for interior nodes
+	};
+
+	struct SceneBVHData
+	{
+		std::vector<SceneBVHNode> nodes;
+		std::vector<uint32> proxies;
+		std::vector<Vector3> proxy_min;
+		std::vector<Vector3> proxy_max;
+		float build_cost = 0.0f;
+		float build_time = 0.0f;
+	};
+	SceneBVHData BuildBVH(std::vector<Vector3> const& primitive_min, std::vector<Vector3> const& primitive_max);
+
+	//distance along the ray to the box, FLT_MAX if the ray misses it
+	inline float RayBoxDistance(Vector3 const& origin, Vector3 const& inv_direction, Vector3 const& min, Vector3 const& max)
+	{
+		float const tx0 = (min.x - origin.x) * inv_direction.x, tx1 = (max.x - origin.x) * inv_direction.x;
+		float const ty0 = (min.y - origin.y) * inv_direction.y, ty1 = (max.y - origin.y) * inv_direction.y;
+		float const tz0 = (min.z - origin.z) * inv_direction.z, tz1 = (max.z - origin.z) * inv_direction.z;
+		float const t_enter = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), 0.0f });
+		float const t_exit = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1) });
+		return t_enter <= t_exit ? t_enter : FLT_MAX;
+	}
+
+	//SAH bounding volume hierarchy over render proxy bounding boxes, queries report proxy indices
+	class SceneBVH
+	{
+	public:
+		static constexpr uint32 MAX_DEPTH = 48;
+
+		SceneBVH() = default;
+		ADRIA_NONCOPYABLE(SceneBVH)
+		ADRIA_DEFAULT_MOVABLE(SceneBVH)
+		~SceneBVH() = default;
+
+		void Build(CullingBoxes const& boxes);
+		void Refit(CullingBoxes const& boxes);
+		void Update(CullingBoxes const& boxes, float rebuild_threshold);
+
+		uint32 GetProxyCount() const { return (uint32)data.proxies.size(); }
+		uint32 GetNodeCount() const { return (uint32)data.nodes.size(); }
+		float GetCost() const { return cost; }
+		float GetCostRatio() const { return data.build_cost > 0.0f ? cost / data.build_cost : 1.0f; }
+		float GetBuildTime() const { return data.build_time; }
+		float GetRefitTime() const { return refit_time; }
+		uint32 GetRebuildCount() const { return rebuild_count; }
+		bool IsRebuilding() const { return pending_build.valid(); }
+
+		template<typename F>
+		void QueryFrustum(CullingFrustum const& frustum, F&& visitor) const
+		{
+			if (data.nodes.empty()) return;
+			struct StackEntry
+			{
+				uint32 node;
+				bool inside;
+			};
+			StackEntry stack[MAX_DEPTH + 1];
+			uint32 stack_size = 0;
+			stack[stack_size++] = { 0, false };
+			while (stack_size > 0)
+			{
+				auto [node_index, inside] = stack[--stack_size];
+				SceneBVHNode const& node = data.nodes[node_index];
+				if (!inside)
+				{
+					FrustumTest const test = TestFrustum(frustum, node.min, node.max);
+					if (test == FrustumTest::Outside) continue;
+					inside = test == FrustumTest::Inside;
+				}
+				if (node.count == 0)
+				{
+					stack[stack_size++] = { node.offset, inside };
+					stack[stack_size++] = { node_index + 1, inside };
+					continue;
+				}
+				for (uint32 i = node.offset; i < node.offset + node.count; ++i)
+				{
+					if (inside || TestFrustum(frustum, data.proxy_min[i], data.proxy_max[i]) != FrustumTest::Outside) visitor(data.proxies[i]);
+				}
+			}
+		}
+
+		template<typename F>
+		void QuerySphere(Vector3 const& center, float radius, F&& visitor) const
+		{
+			Traverse([&](Vector3 const& min, Vector3 const& max)
+				{
+					Vector3 const closest = Vector3::Clamp(center, min, max);
+					return Vector3::DistanceSquared(closest, center) <= radius * radius;
+				}, std::forward<F>(visitor));
+		}
+
+		template<typename F>
+		void QueryBox(Vector3 const& box_min, Vector3 const& box_max, F&& visitor) const
+		{
+			Traverse([&](Vector3 const& min, Vector3 const& max)
+				{
+					return min.x <= box_max.x && max.x >= box_min.x &&
+						   min.y <= box_max.y && max.y >= box_min.y &&
+						   min.z <= box_max.z && max.z >= box_min.z;
+				}, std::forward<F>(visitor));
+		}
+
+		//visitor(proxy, box_distance) returns the new maximum distance, nodes are visited front to back
+		template<typename F>
+		void QueryRay(Vector3 const& origin, Vector3 const& direction, float max_distance, F&& visitor) const
+		{
+			if (data.nodes.empty()) return;
+			Vector3 const inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+			uint32 stack[MAX_DEPTH + 1];
+			uint32 stack_size = 0;
+			stack[stack_size++] = 0;
+			while (stack_size > 0)
+			{
+				SceneBVHNode const& node = data.nodes[stack[--stack_size]];
+				if (RayBoxDistance(origin, inv_direction, node.min, node.max) > max_distance) continue;
+				if (node.count == 0)
+				{
+					uint32 near_child = uint32(&node - data.nodes.data()) + 1;
+					uint32 far_child = node.offset;
+					float const near_distance = RayBoxDistance(origin, inv_direction, data.nodes[near_child].min, data.nodes[near_child].max);
+					float const far_distance = RayBoxDistance(origin, inv_direction, data.nodes[far_child].min, data.nodes[far_child].max);
+					if (far_distance < near_distance) std::swap(near_child, far_child);
+					stack[stack_size++] = far_child;
+					stack[stack_size++] = near_child;
+					continue;
+				}
+				for (uint32 i = node.offset; i < node.offset + node.count; ++i)
+				{
+					float const distance = RayBoxDistance(origin, inv_direction, data.proxy_min[i], data.proxy_max[i]);
+					if (distance <= max_distance) max_distance = visitor(data.proxies[i], distance);
+				}
+			}
+		}
+
+	private:
+		SceneBVHData data;
+		float cost = 0.0f;
+		float refit_time = 0.0f;
+		uint32 rebuild_count = 0;
+		std::future<SceneBVHData> pending_build;
+
+	private:
+		enum class FrustumTest : uint8
+		{
+			Outside,
+			Intersects,
+			Inside
+		};
+
+		static FrustumTest TestFrustum(CullingFrustum const& frustum, Vector3 const& min, Vector3 const& max)
+		{
+			Vector3 const center = (min + max) * 0.5f;
+			Vector3 const extents = (max - min) * 0.5f;
+			FrustumTest result = FrustumTest::Inside;
+			for (uint32 p = 0; p < frustum.plane_count; ++p)
+			{
+				Vector4 const& plane = frustum.planes[p];
+				float const distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+				float const radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+				if (distance > radius) return FrustumTest::Outside;
+				if (distance > -radius) result = FrustumTest::Intersects;
+			}
+			return result;
+		}
+
+		template<typename Overlap, typename F>
+		void Traverse(Overlap&& overlap, F&& visitor) const
+		{
+			if (data.nodes.empty()) return;
+			uint32 stack[MAX_DEPTH + 1];
+			uint32 stack_size = 0;
+			stack[stack_size++] = 0;
+			while (stack_size > 0)
+			{
+				uint32 const node_index = stack[--stack_size];
+				SceneBVHNode const& node = data.nodes[node_index];
+				if (!overlap(node.min, node.max)) continue;
+				if (node.count == 0)
+				{
+					stack[stack_size++] = node.offset;
+					stack[stack_size++] = node_index + 1;
+					continue;
+				}
+				for (uint32 i = node.offset; i < node.offset + node.count; ++i)
+				{
+					if (overlap(data.proxy_min[i], data.proxy_max[i])) visitor(data.proxies[i]);
+				}
+			}
+		}
+	};
+}
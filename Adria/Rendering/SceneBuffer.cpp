@@ -0,0 +1,131 @@
+#include <bit>
+#include "SceneBuffer.h"
+#include "Graphics/GfxDevice.h"
+#include "Graphics/GfxBuffer.h"
+#include "Graphics/GfxCommandList.h"
+#include "Graphics/GfxLinearDynamicAllocator.h"
+
+namespace adria
+{
+
+	SceneBuffer::SceneBuffer() = default;
+	SceneBuffer::~SceneBuffer() = default;
+
+	void SceneBuffer::Initialize(GfxDevice* _gfx, uint32 _stride)
+	{
+		gfx = _gfx;
+		stride = _stride;
+	}
+
+	void SceneBuffer::Resize(uint32 new_count)
+	{
+		if (new_count == count) return;
+		cpu_data.resize(uint64(new_count) * stride);
+		dirty_mask.resize((new_count + 63) / 64);
+		if (new_count < count)
+		{
+			if (new_count % 64) dirty_mask.back() &= (1ull << (new_count % 64)) - 1;
+			dirty_count = 0;
+			for (uint64 word : dirty_mask) dirty_count += std::popcount(word);
+		}
+		for (uint32 i = count; i < new_count; ++i) MarkDirty(i);
+		count = new_count;
+		if (count > capacity) Grow();
+	}
+
+	void SceneBuffer::Update(uint32 index, void const* data)
+	{
+		ADRIA_ASSERT(index < count);
+		uint8* element = cpu_data.data() + uint64(index) * stride;
+		if (memcmp(element, data, stride) == 0) return;
+		memcpy(element, data, stride);
+		MarkDirty(index);
+	}
+
+	void SceneBuffer::Update(uint32 first, void const* data, uint32 element_count)
+	{
+		ADRIA_ASSERT(first + element_count <= count);
+		uint8 const* elements = static_cast<uint8 const*>(data);
+		for (uint32 i = 0; i < element_count; ++i) Update(first + i, elements + uint64(i) * stride);
+	}
+
+	void SceneBuffer::Commit()
+	{
+		uint64 const frame_index = gfx->GetFrameIndex();
+		std::erase_if(retired_buffers, [frame_index](auto const& retired_buffer) { return retired_buffer.first + GFX_BACKBUFFER_COUNT < frame_index; });
+		if (!buffer) return;
+
+		buffer_srv_gpu = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, buffer_srv_gpu, buffer_srv);
+	}
+
+	uint64 SceneBuffer::Upload(GfxCommandList* cmd_list)
+	{
+		if (dirty_count == 0 || !buffer) return 0;
+
+		uint64 const upload_size = uint64(dirty_count) * stride;
+		GfxDynamicAllocation upload_allocation = gfx->GetDynamicAllocator()->Allocate(upload_size, 16);
+		//a new buffer starts in common and is promoted by the first copy, after that it has to leave AllSRV before it is written
+		if (buffer_readable)
+		{
+			cmd_list->BufferBarrier(*buffer, GfxResourceState::AllSRV, GfxResourceState::CopyDst);
+			cmd_list->FlushBarriers();
+		}
+
+		uint64 upload_offset = 0;
+		uint32 index = 0;
+		while (index < count)
+		{
+			if (!(dirty_mask[index / 64] & (1ull << (index % 64))))
+			{
+				++index;
+				continue;
+			}
+			uint32 const range_begin = index;
+			while (index < count && (dirty_mask[index / 64] & (1ull << (index % 64)))) ++index;
+
+			uint64 const range_size = uint64(index - range_begin) * stride;
+			upload_allocation.Update(cpu_data.data() + uint64(range_begin) * stride, range_size, upload_offset);
+			cmd_list->CopyBuffer(*buffer, uint64(range_begin) * stride, *upload_allocation.buffer, upload_allocation.offset + upload_offset, range_size);
+			upload_offset += range_size;
+		}
+		cmd_list->BufferBarrier(*buffer, GfxResourceState::CopyDst, GfxResourceState::AllSRV);
+		cmd_list->FlushBarriers();
+		buffer_readable = true;
+
+		std::fill(dirty_mask.begin(), dirty_mask.end(), 0ull);
+		dirty_count = 0;
+		return upload_size;
+	}
+
+	void SceneBuffer::MarkDirty(uint32 index)
+	{
+		uint64& word = dirty_mask[index / 64];
+		uint64 const bit = 1ull << (index % 64);
+		if (word & bit) return;
+		word |= bit;
+		++dirty_count;
+	}
+
+	void SceneBuffer::Grow()
+	{
+		capacity = std::max({ count, capacity * 2, MIN_CAPACITY });
+
+		GfxBufferDesc desc{};
+		desc.resource_usage = GfxResourceUsage::Default;
+		desc.bind_flags = GfxBindFlag::ShaderResource;
+		desc.misc_flags = GfxBufferMiscFlag::BufferStructured;
+		desc.stride = stride;
+		desc.size = uint64(capacity) * stride;
+
+		if (buffer)
+		{
+			retired_buffers.emplace_back(gfx->GetFrameIndex(), std::move(buffer));
+			gfx->FreeDescriptorCPU(buffer_srv, GfxDescriptorHeapType::CBV_SRV_UAV);
+		}
+		buffer = gfx->CreateBuffer(desc);
+		buffer_srv = gfx->CreateBufferSRV(buffer.get());
+		buffer_readable = false;
+		for (uint32 i = 0; i < count; ++i) MarkDirty(i);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Graphics/GfxDescriptor.h"
+
+namespace adria
+{
+	class GfxDevice;
+	class GfxBuffer;
+	class GfxCommandList;
+
+	class SceneBuffer
+	{
+		static constexpr uint32 MIN_CAPACITY = 64;
+
+	public:
+		SceneBuffer();
+		~SceneBuffer();
+
+		void Initialize(GfxDevice* gfx, uint32 stride);
+
+		void Resize(uint32 count);
+		void Update(uint32 index, void const* data);
+		void Update(uint32 first, void const* data, uint32 element_count);
+		template<typename T>
+		void Update(uint32 index, T const& data)
+		{
+			ADRIA_ASSERT(sizeof(T) == stride);
+			Update(index, &data);
+		}
+
+		void Commit();
+		uint64 Upload(GfxCommandList* cmd_list);
+
+		uint32 GetCount() const { return count; }
+		GfxDescriptor GetSRV() const { return buffer_srv_gpu; }
+
+	private:
+		GfxDevice* gfx = nullptr;
+		uint32 stride = 0;
+		uint32 count = 0;
+		uint32 capacity = 0;
+		std::vector<uint8> cpu_data;
+		std::vector<uint64> dirty_mask;
+		uint32 dirty_count = 0;
+
+		std::unique_ptr<GfxBuffer> buffer;
+		GfxDescriptor buffer_srv;
+		GfxDescriptor buffer_srv_gpu;
+		bool buffer_readable = false;
+		std::vector<std::pair<uint64, std::unique_ptr<GfxBuffer>>> retired_buffers;
+
+	private:
+		void MarkDirty(uint32 index);
+		void Grow();
+	};
+}
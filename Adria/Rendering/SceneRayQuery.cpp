@@ -0,0 +1,48 @@
+#include "SceneRayQuery.h"
+#include "SceneBVH.h"
+#include "TriangleBVH.h"
+#include "RenderProxyTable.h"
+#include "Components.h"
+#include "entt/entity/registry.hpp"
+
+namespace adria
+{
+	bool RayCastScene(entt::registry const& reg, Ray const& ray, float max_distance, SceneRayHit& hit)
+	{
+		RenderProxyTable const& render_proxies = reg.ctx().get<RenderProxyTable>();
+		SceneBVH const& scene_bvh = reg.ctx().get<SceneBVH>();
+		ADRIA_ASSERT(scene_bvh.GetProxyCount() == render_proxies.GetCount());
+
+		bool found = false;
+		scene_bvh.QueryRay(ray.position, ray.direction, max_distance, [&](uint32 proxy, float)
+			{
+				entt::entity const owner = render_proxies.GetOwner(proxy);
+				Mesh const& mesh = reg.get<Mesh>(owner);
+				uint32 const instance_id = render_proxies.GetInstanceId(proxy);
+				SubMeshInstance const& instance = mesh.instances[instance_id - mesh.instance_offset];
+				if (instance.submesh_index >= mesh.triangle_bvhs.size() || !mesh.triangle_bvhs[instance.submesh_index]) return max_distance;
+
+				//the object space ray keeps the world space parametrization, so hit distances stay comparable across instances
+				Matrix const inverse_world = instance.world_transform.Invert();
+				Vector3 const local_origin = Vector3::Transform(ray.position, inverse_world);
+				Vector3 const local_direction = Vector3::TransformNormal(ray.direction, inverse_world);
+
+				TriangleHit triangle_hit{};
+				if (!mesh.triangle_bvhs[instance.submesh_index]->RayCast(local_origin, local_direction, max_distance, triangle_hit)) return max_distance;
+
+				max_distance = triangle_hit.distance;
+				hit.entity = owner;
+				hit.submesh_index = instance.submesh_index;
+				hit.instance_id = instance_id;
+				hit.triangle = triangle_hit.triangle;
+				hit.distance = triangle_hit.distance;
+				hit.position = ray.position + ray.direction * triangle_hit.distance;
+				hit.normal = Vector3::TransformNormal(triangle_hit.normal, inverse_world.Transpose());
+				hit.normal.Normalize();
+				if (hit.normal.Dot(ray.direction) > 0.0f) hit.normal = -hit.normal;
+				found = true;
+				return max_distance;
+			});
+		return found;
+	}
+}
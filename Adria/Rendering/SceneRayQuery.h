@@ -0,0 +1,19 @@
+#pragma once
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	struct SceneRayHit
+	{
+		entt::entity entity;
+		uint32 submesh_index;
+		uint32 instance_id;
+		uint32 triangle;
+		float distance;
+		Vector3 position;
+		Vector3 normal;
+	};
+
+	//closest triangle hit against the scene BVH and the per submesh triangle BVHs, usable any time after the scene buffers were updated
+	bool RayCastScene(entt::registry const& reg, Ray const& ray, float max_distance, SceneRayHit& hit);
+}
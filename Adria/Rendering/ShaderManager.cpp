@@ -1,4 +1,6 @@
 #include <execution>
+#include <shared_mutex>
+#include <future>
 #include "GFSDK_Aftermath_GpuCrashDumpDecoding.h"
 #include "ShaderManager.h"
 #include "Core/Paths.h"
@@ -8,6 +10,7 @@
 #include "Logging/Logger.h"
 #include "Utilities/Timer.h"
 #include "Utilities/FileWatcher.h"
+#include "Utilities/ThreadPool.h"
 
 namespace fs = std::filesystem;
 
@@ -20,6 +23,19 @@ namespace adria
 		LibraryRecompiledEvent library_recompiled_event;
 		std::unordered_map<GfxShaderKey, GfxShader, GfxShaderKeyHash> shader_map;
 		std::unordered_map<GfxShaderKey, std::vector<fs::path>, GfxShaderKeyHash> dependent_files_map;
+		std::shared_mutex shader_map_mutex;
+
+		ShaderCompileFn compile_fn = GfxShaderCompiler::CompileShader;
+		constexpr float reload_debounce_time = 0.25f;
+		Timer<> reload_debounce_timer;
+		std::unordered_set<std::string> changed_files;
+
+		struct ShaderCompileJob
+		{
+			GfxShaderKey shader;
+			std::future<std::optional<GfxShaderCompileOutput>> output;
+		};
+		std::vector<ShaderCompileJob> compile_jobs;
 
 		constexpr GfxShaderStage GetShaderStage(ShaderID shader)
 		{
@@ -533,10 +549,8 @@ namespace adria
 			return SM_6_7;
 		}
 
-		void CompileShader(GfxShaderKey const& shader, bool bypass_cache = false)
+		GfxShaderDesc GetShaderDesc(GfxShaderKey const& shader)
 		{
-			if (!shader.IsValid()) return;
-
 			GfxShaderDesc shader_desc{};
 			shader_desc.entry_point = GetEntryPoint(shader);
 			shader_desc.stage = GetShaderStage(shader);
@@ -548,28 +562,95 @@ namespace adria
 			shader_desc.flags = ShaderCompilerFlag_None;
 #endif
 			shader_desc.defines = shader.GetDefines();
+			return shader_desc;
+		}
+		void CommitShader(GfxShaderKey const& shader, GfxShaderCompileOutput&& output)
+		{
+			std::unique_lock lock(shader_map_mutex);
+			shader_map[shader] = std::move(output.shader);
+			std::vector<fs::path>& dependent_files = dependent_files_map[shader];
+			dependent_files.clear();
+			for (auto const& include : output.includes) dependent_files.push_back(fs::path(include));
+		}
+		void BroadcastShaderRecompiled(GfxShaderKey const& shader)
+		{
+			GetShaderStage(shader) == GfxShaderStage::LIB ? library_recompiled_event.Broadcast(shader) : shader_recompiled_event.Broadcast(shader);
+		}
+
+		void CompileShader(GfxShaderKey const& shader)
+		{
+			if (!shader.IsValid()) return;
 
 			GfxShaderCompileOutput output;
-			bool compile_result = GfxShaderCompiler::CompileShader(shader_desc, output, bypass_cache);
+			bool compile_result = compile_fn(GetShaderDesc(shader), output, false);
 			ADRIA_ASSERT(compile_result);
 			if (!compile_result) return;
+			CommitShader(shader, std::move(output));
+		}
+		std::optional<GfxShaderCompileOutput> CompileShaderAsync(GfxShaderKey const& shader, bool bypass_cache)
+		{
+			GfxShaderDesc shader_desc = GetShaderDesc(shader);
+			shader_desc.flags |= ShaderCompilerFlag_NoErrorDialog;
+			GfxShaderCompileOutput output;
+			if (!compile_fn(shader_desc, output, bypass_cache)) return std::nullopt;
+			return output;
+		}
 
-			shader_map[shader] = std::move(output.shader);
+		void OnShaderFileChanged(std::string const& filename)
+		{
+			changed_files.insert(filename);
+			reload_debounce_timer.Mark();
+		}
+		void DispatchShaderCompileJobs()
+		{
+			std::unordered_map<GfxShaderKey, bool, GfxShaderKeyHash> shaders_to_compile;
+			for (std::string const& filename : changed_files)
+			{
+				for (auto const& [shader, files] : dependent_files_map)
+				{
+					for (uint64 i = 0; i < files.size(); ++i)
+					{
+						fs::path const& file = files[i];
+						if (!fs::equivalent(file, fs::path(filename))) continue;
+						bool const bypass_cache = i != 0;
+						if (auto it = shaders_to_compile.find(shader); it != shaders_to_compile.end()) it->second |= bypass_cache;
+						else shaders_to_compile.emplace(shader, bypass_cache);
+					}
+				}
+			}
+			changed_files.clear();
 
-			dependent_files_map[shader].clear();
-			for (auto const& include : output.includes) dependent_files_map[shader].push_back(fs::path(include));
-			shader_desc.stage == GfxShaderStage::LIB ? library_recompiled_event.Broadcast(shader) : shader_recompiled_event.Broadcast(shader);
+			compile_jobs.reserve(shaders_to_compile.size());
+			for (auto const& [shader, bypass_cache] : shaders_to_compile)
+			{
+				compile_jobs.emplace_back(shader, g_ThreadPool.Submit(CompileShaderAsync, shader, bypass_cache));
+			}
+			if (!compile_jobs.empty()) ADRIA_LOG(INFO, "Recompiling %llu shaders in the background...", compile_jobs.size());
 		}
-		void OnShaderFileChanged(std::string const& filename)
+		bool CompileJobsFinished()
 		{
-			for (auto const& [shader, files] : dependent_files_map)
+			for (ShaderCompileJob& job : compile_jobs)
 			{
-				for (uint64 i = 0; i < files.size(); ++i)
+				if (job.output.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+			}
+			return true;
+		}
+		void CommitCompileJobs()
+		{
+			std::vector<GfxShaderKey> recompiled_shaders;
+			for (ShaderCompileJob& job : compile_jobs)
+			{
+				std::optional<GfxShaderCompileOutput> output = job.output.get();
+				if (!output.has_value())
 				{
-					fs::path const& file = files[i];
-					if (fs::equivalent(file, fs::path(filename))) CompileShader(shader, i != 0);
+					ADRIA_LOG(WARNING, "Shader '%s' failed to compile, keeping the previous version!", GetShaderSource(job.shader).c_str());
+					continue;
 				}
+				CommitShader(job.shader, std::move(*output));
+				recompiled_shaders.push_back(job.shader);
 			}
+			compile_jobs.clear();
+			for (GfxShaderKey const& shader : recompiled_shaders) BroadcastShaderRecompiled(shader);
 		}
 	}
 
@@ -582,6 +663,9 @@ namespace adria
 	}
 	void ShaderManager::Destroy()
 	{
+		for (ShaderCompileJob& job : compile_jobs) job.output.wait();
+		compile_jobs.clear();
+		changed_files.clear();
 		file_watcher = nullptr;
 		shader_map.clear();
 		dependent_files_map.clear();
@@ -591,10 +675,42 @@ namespace adria
 		file_watcher->CheckWatchedFiles();
 	}
 
+	void ShaderManager::Update()
+	{
+		if (!compile_jobs.empty())
+		{
+			if (!CompileJobsFinished()) return;
+			CommitCompileJobs();
+		}
+		if (GfxPipelineState::HasPendingRebuilds())
+		{
+			GfxPipelineState::CommitPendingRebuilds();
+			return;
+		}
+		if (!changed_files.empty() && reload_debounce_timer.PeekInSeconds() >= reload_debounce_time)
+		{
+			DispatchShaderCompileJobs();
+		}
+	}
+
+	bool ShaderManager::IsReloadInProgress()
+	{
+		return !compile_jobs.empty() || !changed_files.empty() || GfxPipelineState::HasPendingRebuilds();
+	}
+
+	void ShaderManager::SetCompileFunction(ShaderCompileFn fn)
+	{
+		compile_fn = fn ? fn : GfxShaderCompiler::CompileShader;
+	}
+
 	GfxShader const& ShaderManager::GetGfxShader(GfxShaderKey const& shader_key)
 	{
-		if (shader_map.contains(shader_key)) return shader_map[shader_key];
+		{
+			std::shared_lock lock(shader_map_mutex);
+			if (auto it = shader_map.find(shader_key); it != shader_map.end()) return it->second;
+		}
 		CompileShader(shader_key);
+		std::unique_lock lock(shader_map_mutex);
 		return shader_map[shader_key];
 	}
 
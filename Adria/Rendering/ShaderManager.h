@@ -6,6 +6,8 @@ namespace adria
 	class GfxDevice;
 	class GfxShader;
 	class GfxShaderKey;
+	struct GfxShaderDesc;
+	struct GfxShaderCompileOutput;
 
 	enum ShaderID : uint8
 	{
@@ -119,12 +121,17 @@ namespace adria
 
 	DECLARE_MULTICAST_DELEGATE(ShaderRecompiledEvent, GfxShaderKey const&)
 	DECLARE_MULTICAST_DELEGATE(LibraryRecompiledEvent, GfxShaderKey const&)
+	using ShaderCompileFn = bool(*)(GfxShaderDesc const&, GfxShaderCompileOutput&, bool);
+
 	class ShaderManager
 	{
 	public:
 		static void Initialize();
 		static void Destroy();
 		static void CheckIfShadersHaveChanged();
+		static void Update();
+		static bool IsReloadInProgress();
+		static void SetCompileFunction(ShaderCompileFn fn);
 
 		static ShaderRecompiledEvent& GetShaderRecompiledEvent();
 		static LibraryRecompiledEvent& GetLibraryRecompiledEvent();
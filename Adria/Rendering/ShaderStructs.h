@@ -63,6 +63,9 @@ namespace adria
 		int32  rain_splash_bump_idx;
 		int32  rain_blocker_map_idx;
 		float  rain_total_time;
+
+		int32  mesh_buffers_idx;
+		int32  texture_mip_clamps_idx;
 	};
 
 	struct LightGPU
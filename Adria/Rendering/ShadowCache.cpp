@@ -0,0 +1,60 @@
+#include "ShadowCache.h"
+
+namespace adria
+{
+
+	void ShadowCache::BeginFrame(float _drift_threshold, uint32 _time_slice_period)
+	{
+		++frame;
+		drift_threshold = _drift_threshold;
+		time_slice_period = std::max(_time_slice_period, 1u);
+	}
+
+	void ShadowCache::EndFrame()
+	{
+		std::erase_if(entries, [this](auto const& entry) { return entry.second.last_frame != frame; });
+	}
+
+	Matrix const& ShadowCache::UpdateView(uint64 key, Matrix const& view_projection, int32 time_slice)
+	{
+		auto [it, inserted] = entries.try_emplace(key);
+		Entry& entry = it->second;
+		entry.last_frame = frame;
+		if (inserted || entry.dirty)
+		{
+			entry.view_projection = view_projection;
+			entry.dirty = true;
+			return entry.view_projection;
+		}
+
+		bool const time_slice_turn = time_slice < 0 || (frame % time_slice_period) == (uint64)time_slice % time_slice_period;
+		if (time_slice_turn && GetDrift(entry.view_projection, view_projection) > drift_threshold)
+		{
+			entry.view_projection = view_projection;
+			entry.dirty = true;
+		}
+		return entry.view_projection;
+	}
+
+	bool ShadowCache::NeedsRender(uint64 key, uint64 caster_hash)
+	{
+		auto it = entries.find(key);
+		if (it == entries.end()) return true;
+
+		Entry& entry = it->second;
+		bool const needs_render = entry.dirty || entry.caster_hash != caster_hash;
+		entry.caster_hash = caster_hash;
+		entry.dirty = false;
+		return needs_render;
+	}
+
+	float ShadowCache::GetDrift(Matrix const& a, Matrix const& b)
+	{
+		float drift = 0.0f;
+		for (uint32 row = 0; row < 4; ++row)
+		{
+			for (uint32 column = 0; column < 4; ++column) drift = std::max(drift, std::abs(a.m[row][column] - b.m[row][column]));
+		}
+		return drift;
+	}
+}
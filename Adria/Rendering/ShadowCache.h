@@ -0,0 +1,35 @@
+#pragma once
+#include <unordered_map>
+
+namespace adria
+{
+	//Decides which shadow views have to be re-rendered. It has no graphics dependencies so the invalidation rules can be exercised on the CPU alone.
+	class ShadowCache
+	{
+		struct Entry
+		{
+			Matrix view_projection;
+			uint64 caster_hash = 0;
+			uint64 last_frame = 0;
+			bool dirty = true;
+		};
+
+	public:
+		void BeginFrame(float drift_threshold, uint32 time_slice_period);
+		void EndFrame();
+		void Clear() { entries.clear(); }
+		void Invalidate(uint64 key) { entries.erase(key); }
+
+		//returns the matrix the view should be rendered and sampled with, which is the cached one unless the view changed beyond the threshold
+		Matrix const& UpdateView(uint64 key, Matrix const& view_projection, int32 time_slice = -1);
+		bool NeedsRender(uint64 key, uint64 caster_hash);
+
+		static float GetDrift(Matrix const& a, Matrix const& b);
+
+	private:
+		std::unordered_map<uint64, Entry> entries;
+		uint64 frame = 0;
+		float drift_threshold = 0.0f;
+		uint32 time_slice_period = 1;
+	};
+}
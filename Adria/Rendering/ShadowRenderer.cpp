@@ -1,9 +1,14 @@
+#include <bit>
 #include "ShadowRenderer.h"
 #include "Components.h"
 #include "Camera.h"
 #include "ShaderManager.h"
 #include "BlackboardData.h"
 #include "ShaderStructs.h"
+#include "IndirectDrawList.h"
+#include "DrawKeyList.h"
+#include "RenderProxyTable.h"
+#include "SceneBVH.h"
 #include "Graphics/GfxBuffer.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxDevice.h"
@@ -11,13 +16,72 @@
 #include "Graphics/GfxReflection.h"
 #include "Graphics/GfxPipelineStatePermutations.h"
 #include "RenderGraph/RenderGraph.h"
+#include "Editor/GUICommand.h"
+#include "Utilities/HashUtil.h"
+#include "Core/ConsoleManager.h"
 
 using namespace DirectX;
 
 namespace adria
 {
+	static TAutoConsoleVariable<bool>  ShadowCaching("r.Shadows.Caching", true, "Enable or Disable reusing shadow maps whose light, casters and bounds did not change");
+	static TAutoConsoleVariable<float> ShadowCacheThreshold("r.Shadows.Caching.Threshold", 0.05f, "Largest change of a shadow view-projection matrix element that still reuses the cached shadow map");
+	static TAutoConsoleVariable<float> ShadowMeshLODThreshold("r.Shadows.MeshLOD.ErrorThreshold", 2.0f, "Largest projected simplification error in shadow map texels for picking a coarser mesh LOD, 0 always draws the base mesh");
+	static TAutoConsoleVariable<int>   CascadeUpdatePeriod("r.Shadows.CascadeUpdatePeriod", 2, "Number of frames over which the far cascades are updated in round-robin order");
+
 	namespace
 	{
+		uint64 ShadowCacheKey(uint64 light_id, uint64 view_slot)
+		{
+			return (light_id << 8) | view_slot;
+		}
+
+		//maps the clip space of a shadow view into its atlas tile, keeping a one texel border for filtering
+		Matrix ShadowAtlasTileTransform(QuadTreeRect const& rect, uint32 atlas_size)
+		{
+			float const u0 = (rect.x + 1.0f) / atlas_size;
+			float const u1 = (rect.x + rect.size - 1.0f) / atlas_size;
+			float const v0 = (rect.y + 1.0f) / atlas_size;
+			float const v1 = (rect.y + rect.size - 1.0f) / atlas_size;
+
+			Matrix tile_transform = Matrix::Identity;
+			tile_transform._11 = u1 - u0;
+			tile_transform._22 = v1 - v0;
+			tile_transform._41 = u0 + u1 - 1.0f;
+			tile_transform._42 = 1.0f - v0 - v1;
+			return tile_transform;
+		}
+
+		float ShadowScreenCoverage(Light const& light, Camera const& camera)
+		{
+			float const distance = Vector3::Distance(Vector3(light.position), camera.Position());
+			if (distance <= light.range) return 1.0f;
+			return std::clamp(light.range / (distance * std::tan(camera.Fov() * 0.5f)), 0.0f, 1.0f);
+		}
+
+		//directional casters can be anywhere between the light and the shadow volume, so the near plane is not tested
+		CullingFrustum MakeCasterFrustum(Matrix const& view_projection, bool directional)
+		{
+			CullingFrustum frustum = MakeCullingFrustum(view_projection);
+			if (directional)
+			{
+				frustum.planes[4] = frustum.planes[5];
+				frustum.plane_count = CullingFrustum::MAX_PLANES - 1;
+			}
+			return frustum;
+		}
+
+		bool SphereIntersectsCone(Vector3 const& center, float radius, Vector3 const& apex, Vector3 const& direction, float range, float angle)
+		{
+			Vector3 const v = center - apex;
+			float const v_length_sq = v.LengthSquared();
+			float const v1_length = v.Dot(direction);
+			float const distance_to_cone = std::cos(angle) * std::sqrt(std::max(v_length_sq - v1_length * v1_length, 0.0f)) - v1_length * std::sin(angle);
+			bool const angle_cull = distance_to_cone > radius;
+			bool const front_cull = v1_length > radius + range;
+			bool const back_cull = v1_length < -radius;
+			return !(angle_cull || front_cull || back_cull);
+		}
 
 		std::pair<Matrix, Matrix> LightViewProjection_Directional(Light const& light, Camera const& camera, uint32 shadow_size)
 		{
@@ -186,9 +250,22 @@ namespace adria
 	}
 
 	ShadowRenderer::ShadowRenderer(entt::registry& reg, GfxDevice* gfx, uint32 width, uint32 height) : reg(reg), gfx(gfx), width(width), height(height),
-		ray_traced_shadows_pass(gfx, width, height) 
+		ray_traced_shadows_pass(gfx, width, height), shadow_atlas_allocator(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE_SIZE)
 	{
 		CreatePSOs();
+		shadow_draw_list = std::make_unique<IndirectDrawList>(0);
+		shadow_draw_keys = std::make_unique<DrawKeyList>();
+
+		GfxTextureDesc atlas_desc{};
+		atlas_desc.width = SHADOW_ATLAS_SIZE;
+		atlas_desc.height = SHADOW_ATLAS_SIZE;
+		atlas_desc.format = GfxFormat::R32_TYPELESS;
+		atlas_desc.clear_value = GfxClearValue(1.0f, 0);
+		atlas_desc.bind_flags = GfxBindFlag::DepthStencil | GfxBindFlag::ShaderResource;
+		atlas_desc.initial_state = GfxResourceState::DSV;
+		shadow_atlas = gfx->CreateTexture(atlas_desc);
+		shadow_atlas_srv = gfx->CreateTextureSRV(shadow_atlas.get());
+		shadow_atlas_dsv = gfx->CreateTextureDSV(shadow_atlas.get());
 	}
 	ShadowRenderer::~ShadowRenderer() {}
 
@@ -226,6 +303,7 @@ namespace adria
 		};
 		auto AddShadowMap  = [&](uint64 light_id, uint32 shadow_map_size)
 		{
+			shadow_cache.Invalidate(ShadowCacheKey(light_id, light_shadow_maps[light_id].size()));
 			GfxTextureDesc depth_desc{};
 			depth_desc.width = shadow_map_size;
 			depth_desc.height = shadow_map_size;
@@ -260,28 +338,6 @@ namespace adria
 				}
 			}
 			break;
-			case LightType::Point:
-			{
-				if (light_shadow_maps[light_id].size() != 6)
-				{
-					light_shadow_maps[light_id].clear();
-					light_shadow_map_srvs[light_id].clear();
-					light_shadow_map_dsvs[light_id].clear();
-					for (uint32 i = 0; i < 6; ++i) AddShadowMap(light_id, SHADOW_CUBE_SIZE);
-				}
-			}
-			break;
-			case LightType::Spot:
-			{
-				if (light_shadow_maps[light_id].size() != 1)
-				{
-					light_shadow_maps[light_id].clear();
-					light_shadow_map_srvs[light_id].clear();
-					light_shadow_map_dsvs[light_id].clear();
-					AddShadowMap(light_id, SHADOW_MAP_SIZE);
-				}
-			}
-			break;
 			}
 
 			for (uint64 j = 0; j < light_shadow_maps[light_id].size(); ++j)
@@ -293,6 +349,10 @@ namespace adria
 			}
 		};
 
+		AllocateShadowAtlas(*camera);
+		GfxDescriptor shadow_atlas_gpu = gfx->AllocateDescriptorsGPU();
+		gfx->CopyDescriptors(1, shadow_atlas_gpu, shadow_atlas_srv);
+
 		static uint64 light_matrices_count = 0;
 		uint64 current_light_matrices_count = 0;
 
@@ -300,8 +360,9 @@ namespace adria
 		for (auto e : light_view)
 		{
 			auto& light = light_view.get<Light>(e);
-			if (light.casts_shadows)
+			if (light.casts_shadows && !light.ray_traced_shadows)
 			{
+				if (light.type != LightType::Directional && !shadow_atlas_allocations.contains(entt::to_integral(e))) continue;
 				if (light.type == LightType::Directional && light.use_cascades) current_light_matrices_count += SHADOW_CASCADE_COUNT;
 				else if (light.type == LightType::Point) current_light_matrices_count += 6;
 				else current_light_matrices_count++;
@@ -327,6 +388,32 @@ namespace adria
 
 		std::vector<Matrix> _light_matrices;
 		_light_matrices.reserve(light_matrices_count);
+		shadow_views.clear();
+		if (!ShadowCaching.Get()) shadow_cache.Clear();
+		shadow_cache.BeginFrame(ShadowCacheThreshold.Get(), (uint32)std::max(CascadeUpdatePeriod.Get(), 1));
+		auto AddShadowView = [&](Light const& light, uint64 light_id, Matrix const& view, Matrix const& projection, uint32 resolution, int32 time_slice = -1, QuadTreeRect const* atlas_rect = nullptr)
+		{
+			Matrix const view_projection = view * projection;
+			uint64 const cache_key = ShadowCacheKey(light_id, _light_matrices.size() - light.shadow_matrix_index);
+			Matrix const& cached_view_projection = shadow_cache.UpdateView(cache_key, view_projection, time_slice);
+			Matrix const sampling_view_projection = atlas_rect ? cached_view_projection * ShadowAtlasTileTransform(*atlas_rect, SHADOW_ATLAS_SIZE) : cached_view_projection;
+			_light_matrices.push_back(XMMatrixTranspose(sampling_view_projection));
+			ShadowView& shadow_view = shadow_views.emplace_back();
+			shadow_view.cache_key = cache_key;
+			shadow_view.render = true;
+			shadow_view.in_atlas = atlas_rect != nullptr;
+			shadow_view.atlas_rect = atlas_rect ? *atlas_rect : QuadTreeRect{};
+			shadow_view.frustum = MakeCasterFrustum(cached_view_projection, light.type == LightType::Directional);
+			shadow_view.light_type = light.type;
+			shadow_view.light_position = Vector3(light.position);
+			shadow_view.light_direction = XMVector3Normalize(light.direction);
+			shadow_view.light_range = light.range;
+			shadow_view.light_cone_angle = std::acos(light.outer_cosine);
+			shadow_view.light_index = light.light_index;
+			shadow_view.caster_count = 0;
+			shadow_view.lod_pixel_scale = projection._22 * resolution * 0.5f;
+			shadow_view.lod_perspective = projection._44 == 0.0f;
+		};
 		for (auto e : light_view)
 		{
 			auto& light = light_view.get<Light>(e);
@@ -345,32 +432,30 @@ namespace adria
 						for (uint32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
 						{
 							auto const& [V, P] = LightViewProjection_Cascades(light, *camera, proj_matrices[i], SHADOW_CASCADE_MAP_SIZE);
-							_light_matrices.push_back(XMMatrixTranspose(V * P));
+							AddShadowView(light, entt::to_integral(e), V, P, SHADOW_CASCADE_MAP_SIZE, i >= SHADOW_FIRST_TIME_SLICED_CASCADE ? int32(i - SHADOW_FIRST_TIME_SLICED_CASCADE) : -1);
 						}
 					}
 					else
 					{
 						AddShadowMaps(light, entt::to_integral(e));
 						auto const& [V, P] = LightViewProjection_Directional(light, *camera, SHADOW_MAP_SIZE);
-						_light_matrices.push_back(XMMatrixTranspose(V * P));
+						AddShadowView(light, entt::to_integral(e), V, P, SHADOW_MAP_SIZE);
 					}
 
 				}
-				else if (light.type == LightType::Point)
+				else
 				{
-					AddShadowMaps(light, entt::to_integral(e));
-					for (uint32 i = 0; i < 6; ++i)
+					auto atlas_allocation = shadow_atlas_allocations.find(entt::to_integral(e));
+					if (atlas_allocation == shadow_atlas_allocations.end()) continue;
+
+					light.shadow_texture_index = (int32)shadow_atlas_gpu.GetIndex();
+					for (uint32 i = 0; i < atlas_allocation->second.node_count; ++i)
 					{
-						auto const& [V, P] = LightViewProjection_Point(light, i);
-						_light_matrices.push_back(XMMatrixTranspose(V * P));
+						QuadTreeRect const atlas_rect = shadow_atlas_allocator.GetRect(atlas_allocation->second.nodes[i]);
+						auto const& [V, P] = light.type == LightType::Point ? LightViewProjection_Point(light, i) : LightViewProjection_Spot(light);
+						AddShadowView(light, entt::to_integral(e), V, P, atlas_rect.size, -1, &atlas_rect);
 					}
 				}
-				else if (light.type == LightType::Spot)
-				{
-					AddShadowMaps(light, entt::to_integral(e));
-					auto const& [V, P] = LightViewProjection_Spot(light);
-					_light_matrices.push_back(XMMatrixTranspose(V * P));
-				}
 			}
 			else if (light.ray_traced_shadows)
 			{
@@ -385,16 +470,20 @@ namespace adria
 			light_matrices_gpu_index = (int32)dst_descriptor.GetIndex();
 		}
 		light_matrices = std::move(_light_matrices);
+		shadow_cache.EndFrame();
 	}
 
 	void ShadowRenderer::AddShadowMapPasses(RenderGraph& rg)
 	{
 		FrameBlackboardData const& frame_data = rg.GetBlackboard().Get<FrameBlackboardData>();
+		CullShadowCasters();
+		rg.ImportTexture(RG_NAME(ShadowAtlas), shadow_atlas.get());
+
 		auto light_view = reg.view<Light>();
 		for (auto e : light_view)
 		{
 			auto& light = light_view.get<Light>(e);
-			if (!light.casts_shadows) continue;
+			if (!light.casts_shadows || light.ray_traced_shadows || light.shadow_texture_index < 0) continue;
 			int32 light_index = light.light_index;
 			int32 light_matrix_index = light.shadow_matrix_index;
 			uint64 light_id = entt::to_integral(e);
@@ -406,81 +495,73 @@ namespace adria
 					for (uint32 i = 0; i < SHADOW_CASCADE_COUNT; ++i)
 					{
 						rg.ImportTexture(RG_NAME_IDX(ShadowMap, light_matrix_index + i), light_shadow_maps[light_id][i].get());
-						std::string name = "Cascade Shadow Pass" + std::to_string(i);
+						if (shadow_views[light_matrix_index + i].render)
+						{
+							std::string name = "Cascade Shadow Pass" + std::to_string(i);
+							rg.AddPass<void>(name.c_str(),
+								[=](RenderGraphBuilder& builder)
+								{
+									builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light_matrix_index + i), RGLoadStoreAccessOp::Clear_Preserve);
+									builder.SetViewport(SHADOW_CASCADE_MAP_SIZE, SHADOW_CASCADE_MAP_SIZE);
+								},
+								[=](RenderGraphContext& context, GfxCommandList* cmd_list)
+								{
+									cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
+									ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, i);
+								}, RGPassType::Graphics);
+						}
+
+						shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light_matrix_index + i));
+					}
+				}
+				else
+				{
+					rg.ImportTexture(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), light_shadow_maps[light_id][0].get());
+					if (shadow_views[light_matrix_index].render)
+					{
+						std::string name = "Directional Shadow Pass";
 						rg.AddPass<void>(name.c_str(),
 							[=](RenderGraphBuilder& builder)
 							{
-								builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light_matrix_index + i), RGLoadStoreAccessOp::Clear_Preserve);
-								builder.SetViewport(SHADOW_CASCADE_MAP_SIZE, SHADOW_CASCADE_MAP_SIZE);
+								builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), RGLoadStoreAccessOp::Clear_Preserve);
+								builder.SetViewport(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
 							},
 							[=](RenderGraphContext& context, GfxCommandList* cmd_list)
 							{
 								cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-								ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, i);
+								ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, 0);
 							}, RGPassType::Graphics);
-
-						shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light_matrix_index + i));
 					}
-				}
-				else
-				{
-					rg.ImportTexture(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), light_shadow_maps[light_id][0].get());
-					std::string name = "Directional Shadow Pass";
-					rg.AddPass<void>(name.c_str(),
-						[=](RenderGraphBuilder& builder)
-						{
-							builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index), RGLoadStoreAccessOp::Clear_Preserve);
-							builder.SetViewport(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
-						},
-						[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-						{
-							cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-							ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, 0);
-						}, RGPassType::Graphics);
 
 					shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index));
 				}
 			}
-			else if (light.type == LightType::Point)
+			else
 			{
-				for (uint32 i = 0; i < 6; ++i)
+				for (uint32 i = 0; i < shadow_atlas_allocations[light_id].node_count; ++i)
 				{
-					rg.ImportTexture(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i), light_shadow_maps[light_id][i].get());
-					std::string name = "Point Shadow Pass" + std::to_string(i);
+					ShadowView const& shadow_view = shadow_views[light_matrix_index + i];
+					if (!shadow_view.render) continue;
+
+					QuadTreeRect const atlas_rect = shadow_view.atlas_rect;
+					std::string name = (light.type == LightType::Point ? "Point Shadow Pass" : "Spot Shadow Pass") + std::to_string(i);
 					rg.AddPass<void>(name.c_str(),
 						[=](RenderGraphBuilder& builder)
 						{
-							builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i), RGLoadStoreAccessOp::Clear_Preserve);
-							builder.SetViewport(SHADOW_CUBE_SIZE, SHADOW_CUBE_SIZE);
+							builder.WriteDepthStencil(RG_NAME(ShadowAtlas), RGLoadStoreAccessOp::Preserve_Preserve);
+							builder.SetViewport(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
 						},
 						[=](RenderGraphContext& context, GfxCommandList* cmd_list)
 						{
+							cmd_list->ClearDepth(shadow_atlas_dsv, atlas_rect.x, atlas_rect.y, atlas_rect.size, atlas_rect.size);
+							cmd_list->SetScissorRect(atlas_rect.x, atlas_rect.y, atlas_rect.size, atlas_rect.size);
 							cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
 							ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, i);
-						}, RGPassType::Graphics);
-
-					shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light.shadow_matrix_index + i));
+						}, RGPassType::Graphics, RGPassFlags::LegacyRenderPass);
 				}
 			}
-			else if (light.type == LightType::Spot)
-			{
-				rg.ImportTexture(RG_NAME_IDX(ShadowMap, light_matrix_index), light_shadow_maps[light_id][0].get());
-				std::string name = "Spot Shadow Pass";
-				rg.AddPass<void>(name.c_str(),
-					[=](RenderGraphBuilder& builder)
-					{
-						builder.WriteDepthStencil(RG_NAME_IDX(ShadowMap, light_matrix_index), RGLoadStoreAccessOp::Clear_Preserve);
-						builder.SetViewport(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
-					},
-					[=](RenderGraphContext& context, GfxCommandList* cmd_list)
-					{
-						cmd_list->SetRootCBV(0, frame_data.frame_cbuffer_address);
-						ShadowMapPass_Common(gfx, cmd_list, light_index, light_matrix_index, 0);
-					}, RGPassType::Graphics);
-
-				shadow_rendered_event.Broadcast(RG_NAME_IDX(ShadowMap, light_matrix_index));
-			}
 		}
+		if (!shadow_atlas_allocations.empty()) shadow_rendered_event.Broadcast(RG_NAME(ShadowAtlas));
 	}
 	void ShadowRenderer::AddRayTracingShadowPasses(RenderGraph& rg)
 	{
@@ -521,48 +602,252 @@ namespace adria
 		shadow_psos->Finalize(gfx);
 	}
 
-	void ShadowRenderer::ShadowMapPass_Common(GfxDevice* gfx, GfxCommandList* cmd_list, uint64 light_index, uint64 matrix_index, uint64 matrix_offset)
+	void ShadowRenderer::GUI()
 	{
-		struct ShadowConstants
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNode("Shadow Casters"))
+				{
+					uint32 rendered_views = 0;
+					for (ShadowView const& shadow_view : shadow_views) rendered_views += shadow_view.render;
+					ImGui::Text("Rendered Views: %u / %u", rendered_views, (uint32)shadow_views.size());
+					QuadTreeAllocatorStats const atlas_stats = shadow_atlas_allocator.GetStats();
+					ImGui::Text("Atlas Tiles: %u", atlas_stats.allocation_count);
+					ImGui::Text("Atlas Usage: %.1f%%", 100.0f * atlas_stats.allocated_area / (atlas_stats.allocated_area + atlas_stats.free_area));
+					ImGui::Text("Atlas Fragmentation: %.2f", atlas_stats.fragmentation);
+					uint32 const draw_count = shadow_draw_list->GetTotalDrawCount();
+					uint32 const instance_count = shadow_draw_list->GetTotalInstanceCount();
+					ImGui::Text("Draws: %u, Instances: %u (draws saved: %u)", draw_count, instance_count, instance_count - draw_count);
+					ImGui::Text("Mesh LODs: %u / %u / %u / %u", shadow_lod_stats.GetInstanceCount(0), shadow_lod_stats.GetInstanceCount(1),
+						shadow_lod_stats.GetInstanceCount(2), shadow_lod_stats.GetInstanceCount(3));
+					ImGui::Text("Triangles: %llu (%.1f%% fewer than base LODs)", shadow_lod_stats.GetTriangleCount(), 100.0f * shadow_lod_stats.GetTriangleReduction());
+					for (uint32 i = 0; i < shadow_views.size(); ++i)
+					{
+						ImGui::Text("View %u (Light %u): %u casters%s", i, shadow_views[i].light_index, shadow_views[i].caster_count, shadow_views[i].render ? "" : " (cached)");
+					}
+					ImGui::TreePop();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void ShadowRenderer::AllocateShadowAtlas(Camera const& camera)
+	{
+		++shadow_atlas_frame;
+
+		struct ShadowAtlasRequest
 		{
-			uint32  light_index;
-			uint32  matrix_offset;
-		} constants =
+			uint64 light_id;
+			uint32 view_count;
+			uint32 tile_size;
+			float importance;
+		};
+		std::vector<ShadowAtlasRequest> requests;
+
+		auto light_view = reg.view<Light>();
+		for (auto e : light_view)
 		{
-			.light_index = (uint32)light_index,
-			.matrix_offset = (uint32)matrix_offset
+			Light const& light = light_view.get<Light>(e);
+			if (!light.casts_shadows || light.ray_traced_shadows || light.type == LightType::Directional) continue;
+
+			float const coverage = ShadowScreenCoverage(light, camera);
+			uint32 const max_tile_size = light.type == LightType::Point ? SHADOW_CUBE_SIZE : SHADOW_SPOT_TILE_SIZE;
+			uint32 const tile_size = std::clamp(std::bit_ceil(std::max((uint32)(coverage * max_tile_size), 1u)), SHADOW_ATLAS_MIN_TILE_SIZE, max_tile_size);
+			requests.push_back(ShadowAtlasRequest{ entt::to_integral(e), light.type == LightType::Point ? 6u : 1u, tile_size, coverage * light.intensity });
+
+			auto allocation = shadow_atlas_allocations.find(entt::to_integral(e));
+			if (allocation != shadow_atlas_allocations.end()) allocation->second.last_frame = shadow_atlas_frame;
+		}
+		std::sort(requests.begin(), requests.end(), [](ShadowAtlasRequest const& a, ShadowAtlasRequest const& b) { return a.importance > b.importance; });
+
+		auto FreeAllocation = [this](ShadowAtlasAllocation const& allocation)
+		{
+			for (uint32 i = 0; i < allocation.node_count; ++i) shadow_atlas_allocator.Free(allocation.nodes[i]);
 		};
-		auto view = reg.view<Batch>();
-		std::vector<Batch*> masked_batches, opaque_batches;
-		for (auto batch_entity : reg.view<Batch>())
+		auto TryAllocate = [this](uint32 view_count, uint32 max_tile_size, uint32 min_tile_size, ShadowAtlasAllocation& allocation)
 		{
-			Batch& batch = reg.get<Batch>(batch_entity);
-			if (batch.alpha_mode == MaterialAlphaMode::Opaque) opaque_batches.push_back(&batch);
-			else masked_batches.push_back(&batch);
+			for (uint32 tile_size = max_tile_size; tile_size >= min_tile_size; tile_size /= 2)
+			{
+				uint32 allocated = 0;
+				while (allocated < view_count)
+				{
+					allocation.nodes[allocated] = shadow_atlas_allocator.Allocate(tile_size);
+					if (allocation.nodes[allocated] == QuadTreeAllocator::INVALID_NODE) break;
+					++allocated;
+				}
+				if (allocated == view_count)
+				{
+					allocation.node_count = view_count;
+					allocation.tile_size = tile_size;
+					allocation.last_frame = shadow_atlas_frame;
+					return true;
+				}
+				for (uint32 i = 0; i < allocated; ++i) shadow_atlas_allocator.Free(allocation.nodes[i]);
+			}
+			return false;
+		};
+		auto InvalidateViews = [this](uint64 light_id, uint32 view_count)
+		{
+			for (uint32 i = 0; i < view_count; ++i) shadow_cache.Invalidate(ShadowCacheKey(light_id, i));
+		};
+
+		std::erase_if(shadow_atlas_allocations, [&](auto const& allocation)
+			{
+				if (allocation.second.last_frame == shadow_atlas_frame) return false;
+				FreeAllocation(allocation.second);
+				return true;
+			});
+
+		for (ShadowAtlasRequest const& request : requests)
+		{
+			auto it = shadow_atlas_allocations.find(request.light_id);
+			if (it != shadow_atlas_allocations.end() && it->second.node_count == request.view_count)
+			{
+				//tiles grow as soon as there is space, but only shrink once they are more than twice the needed size
+				ShadowAtlasAllocation& allocation = it->second;
+				if (allocation.tile_size < request.tile_size)
+				{
+					ShadowAtlasAllocation grown_allocation{};
+					if (TryAllocate(request.view_count, request.tile_size, allocation.tile_size * 2, grown_allocation))
+					{
+						FreeAllocation(allocation);
+						allocation = grown_allocation;
+						InvalidateViews(request.light_id, request.view_count);
+					}
+				}
+				else if (allocation.tile_size > 2 * request.tile_size)
+				{
+					FreeAllocation(allocation);
+					InvalidateViews(request.light_id, request.view_count);
+					if (!TryAllocate(request.view_count, request.tile_size, SHADOW_ATLAS_MIN_TILE_SIZE, allocation)) shadow_atlas_allocations.erase(it);
+				}
+				continue;
+			}
+
+			if (it != shadow_atlas_allocations.end())
+			{
+				FreeAllocation(it->second);
+				shadow_atlas_allocations.erase(it);
+			}
+			ShadowAtlasAllocation allocation{};
+			if (!TryAllocate(request.view_count, request.tile_size, SHADOW_ATLAS_MIN_TILE_SIZE, allocation)) continue;
+			InvalidateViews(request.light_id, request.view_count);
+			shadow_atlas_allocations[request.light_id] = allocation;
 		}
+	}
 
-		auto DrawBatch = [&](GfxCommandList* cmd_list, bool masked_batch)
+	void ShadowRenderer::CullShadowCasters()
+	{
+		RenderProxyTable const& render_proxies = reg.ctx().get<RenderProxyTable>();
+		uint32 const proxy_count = render_proxies.GetCount();
+		uint32 const word_count = (proxy_count + 63) / 64;
+
+		shadow_views_visibility.resize(shadow_views.size() * word_count);
+		CullingBoxes const boxes = render_proxies.GetCullingBoxes();
+		SceneBVH const& scene_bvh = reg.ctx().get<SceneBVH>();
+		ADRIA_ASSERT(scene_bvh.GetProxyCount() == proxy_count);
+		auto IntersectsLight = [&](ShadowView const& shadow_view, uint32 proxy)
 		{
-			std::vector<Batch*>& batches = masked_batch ? masked_batches : opaque_batches;
-			GfxPipelineState* pso = masked_batch ? shadow_psos->Get<1>() : shadow_psos->Get<0>();
-			cmd_list->SetRootConstants(1, constants);
-			cmd_list->SetPipelineState(pso);
-			for (Batch* batch : batches)
+			BoundingBox const bounding_box = render_proxies.GetBoundingBox(proxy);
+			Vector3 const center(bounding_box.Center);
+			float const radius = Vector3(bounding_box.Extents).Length();
+			return shadow_view.light_type == LightType::Point ?
+				Vector3::DistanceSquared(center, shadow_view.light_position) <= (shadow_view.light_range + radius) * (shadow_view.light_range + radius) :
+				SphereIntersectsCone(center, radius, shadow_view.light_position, shadow_view.light_direction, shadow_view.light_range, shadow_view.light_cone_angle);
+		};
+		for (uint32 view_index = 0; view_index < shadow_views.size(); ++view_index)
+		{
+			ShadowView const& shadow_view = shadow_views[view_index];
+			std::span<uint64> visibility(shadow_views_visibility.data() + view_index * word_count, word_count);
+			if (shadow_view.light_type == LightType::Directional)
+			{
+				CullBoxesParallel(shadow_view.frustum, boxes, visibility);
+				continue;
+			}
+
+			//local light views only touch a small part of the scene, so their casters come from the scene BVH
+			std::fill(visibility.begin(), visibility.end(), 0ull);
+			scene_bvh.QueryFrustum(shadow_view.frustum, [&](uint32 proxy)
+				{
+					if (IntersectsLight(shadow_view, proxy)) visibility[proxy / 64] |= 1ull << (proxy % 64);
+				});
+		}
+
+		shadow_draw_list->Reset((uint32)shadow_views.size() * 2);
+		shadow_lod_stats.Reset();
+		for (uint32 view_index = 0; view_index < shadow_views.size(); ++view_index)
+		{
+			ShadowView& shadow_view = shadow_views[view_index];
+			uint64 const* visibility = shadow_views_visibility.data() + view_index * word_count;
+
+			//casters that move without a proxy rebuild change the bounds version of their word
+			uint64 caster_hash = render_proxies.GetRebuildCount();
+			shadow_view.caster_count = 0;
+			for (uint32 word = 0; word < word_count; ++word)
+			{
+				HashCombine(caster_hash, visibility[word]);
+				if (visibility[word]) HashCombine(caster_hash, render_proxies.GetBoundsVersion(word));
+				shadow_view.caster_count += std::popcount(visibility[word]);
+			}
+			shadow_view.render = shadow_cache.NeedsRender(shadow_view.cache_key, caster_hash);
+			if (!shadow_view.render) continue;
+
+			//cascades have no meaningful light position, so their casters are only grouped by state
+			shadow_draw_keys->Clear();
+			for (uint32 word = 0; word < word_count; ++word)
 			{
-				struct ModelConstants
+				uint64 bits = visibility[word];
+				while (bits)
 				{
-					uint32 instance_id;
-				} model_constants{ .instance_id = batch->instance_id };
-				cmd_list->SetRootCBV(2, model_constants);
-				GfxIndexBufferView ibv(batch->submesh->buffer_address + batch->submesh->indices_offset, batch->submesh->indices_count);
-				cmd_list->SetTopology(batch->submesh->topology);
-				cmd_list->SetIndexBuffer(&ibv);
-				cmd_list->DrawIndexed(batch->submesh->indices_count);
+					uint32 const proxy = word * 64 + std::countr_zero(bits);
+					bits &= bits - 1;
+
+					float const light_distance = shadow_view.light_type == LightType::Directional ? 0.0f :
+						Vector3::Distance(Vector3(render_proxies.GetBoundingBox(proxy).Center), shadow_view.light_position);
+					uint32 const bucket = render_proxies.GetAlphaMode(proxy) == MaterialAlphaMode::Opaque ? 0 : 1;
+					shadow_draw_keys->Add(MakeDrawKey(bucket, render_proxies.GetSubMesh(proxy)->topology, light_distance, DrawKeyOrder::FrontToBack,
+						render_proxies.GetMaterialIndex(proxy), render_proxies.GetGeometryBufferSlot(proxy)), proxy);
+				}
+			}
+			shadow_draw_keys->Sort();
+
+			for (uint32 i = 0; i < shadow_draw_keys->GetCount(); ++i)
+			{
+				uint32 const proxy = shadow_draw_keys->GetProxy(i);
+				SubMeshGPU const& submesh = *render_proxies.GetSubMesh(proxy);
+				BoundingBox const bounding_box = render_proxies.GetBoundingBox(proxy);
+				float const light_distance = Vector3::Distance(Vector3(bounding_box.Center), shadow_view.light_position) - Vector3(bounding_box.Extents).Length();
+				float const lod_error_scale = MeshLODErrorScale(render_proxies.GetWorldScale(proxy), shadow_view.lod_pixel_scale, light_distance, shadow_view.lod_perspective);
+				uint32 const lod = SelectMeshLOD(std::span(submesh.lod_errors.data(), submesh.lod_count), lod_error_scale, ShadowMeshLODThreshold.Get());
+				shadow_lod_stats.Add(lod, submesh.lods[lod].indices_count / 3, submesh.indices_count / 3);
+				shadow_draw_list->Add(view_index * 2 + GetDrawKeyBucket(shadow_draw_keys->GetKey(i)), render_proxies.GetInstanceId(proxy), submesh, lod);
 			}
+		}
+		shadow_draw_list->Upload(gfx);
+	}
+
+	void ShadowRenderer::ShadowMapPass_Common(GfxDevice* gfx, GfxCommandList* cmd_list, uint64 light_index, uint64 matrix_index, uint64 matrix_offset)
+	{
+		struct ShadowConstants
+		{
+			uint32  light_index;
+			uint32  matrix_offset;
+			uint32  instance_ids_idx;
+		} constants =
+		{
+			.light_index = (uint32)light_index,
+			.matrix_offset = (uint32)matrix_offset,
+			.instance_ids_idx = shadow_draw_list->GetInstanceBufferIndex()
 		};
 
-		DrawBatch(cmd_list, false);
-		DrawBatch(cmd_list, true);
+		uint32 const view_index = (uint32)(matrix_index + matrix_offset);
+		for (uint32 masked = 0; masked < 2; ++masked)
+		{
+			uint32 const bucket = view_index * 2 + masked;
+			if (shadow_draw_list->GetDrawCount(bucket) == 0) continue;
+			cmd_list->SetPipelineState(masked ? shadow_psos->Get<1>() : shadow_psos->Get<0>());
+			cmd_list->SetRootConstants(1, &constants, sizeof(constants), 1);
+			shadow_draw_list->Draw(cmd_list, bucket);
+		}
 	}
 	std::array<Matrix, ShadowRenderer::SHADOW_CASCADE_COUNT> ShadowRenderer::RecalculateProjectionMatrices(Camera const& camera, float split_lambda, std::array<float, SHADOW_CASCADE_COUNT>& split_distances)
 	{
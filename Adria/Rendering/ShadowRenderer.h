@@ -1,6 +1,10 @@
 #pragma once
 #include <array>
 #include "RayTracedShadowsPass.h"
+#include "FrustumCulling.h"
+#include "ShadowCache.h"
+#include "MeshLOD.h"
+#include "Utilities/QuadTreeAllocator.h"
 #include "Graphics/GfxDefines.h"
 #include "Graphics/GfxDescriptor.h"
 #include "Graphics/GfxPipelineStatePermutationsFwd.h"
@@ -14,7 +18,10 @@ namespace adria
 	class GfxTexture;
 	class RenderGraph;
 	class Camera;
+	class IndirectDrawList;
+	class DrawKeyList;
 	struct FrameCBuffer;
+	enum class LightType : int32;
 
 
 	DECLARE_EVENT(ShadowTextureRenderedEvent, ShadowRenderer, RGResourceName)
@@ -22,9 +29,13 @@ namespace adria
 	class ShadowRenderer
 	{
 		static constexpr uint32 SHADOW_MAP_SIZE = 2048;
+		static constexpr uint32 SHADOW_SPOT_TILE_SIZE = 1024;
 		static constexpr uint32 SHADOW_CUBE_SIZE = 512;
+		static constexpr uint32 SHADOW_ATLAS_SIZE = 4096;
+		static constexpr uint32 SHADOW_ATLAS_MIN_TILE_SIZE = 128;
 		static constexpr uint32 SHADOW_CASCADE_MAP_SIZE = 1024;
 		static constexpr uint32 SHADOW_CASCADE_COUNT = 4;
+		static constexpr uint32 SHADOW_FIRST_TIME_SLICED_CASCADE = 2;
 
 	public:
 		ShadowRenderer(entt::registry& reg, GfxDevice* gfx, uint32 width, uint32 height);
@@ -45,6 +56,7 @@ namespace adria
 		void AddRayTracingShadowPasses(RenderGraph& rg);
 
 		void FillFrameCBuffer(FrameCBuffer& frame_cbuffer);
+		void GUI();
 
 		ShadowTextureRenderedEvent& GetShadowTextureRenderedEvent() { return shadow_rendered_event; }
 
@@ -55,6 +67,44 @@ namespace adria
 		uint32 height;
 		RayTracedShadowsPass ray_traced_shadows_pass;
 		std::unique_ptr<GfxGraphicsPipelineStatePermutations> shadow_psos;
+		std::unique_ptr<IndirectDrawList> shadow_draw_list;
+		std::unique_ptr<DrawKeyList> shadow_draw_keys;
+		MeshLODStats shadow_lod_stats;
+
+		struct ShadowView
+		{
+			CullingFrustum frustum;
+			LightType light_type;
+			Vector3 light_position;
+			Vector3 light_direction;
+			float light_range;
+			float light_cone_angle;
+			uint32 light_index;
+			uint32 caster_count;
+			uint64 cache_key;
+			float lod_pixel_scale;
+			bool lod_perspective;
+			bool render;
+			bool in_atlas;
+			QuadTreeRect atlas_rect;
+		};
+		std::vector<ShadowView>	shadow_views;
+		std::vector<uint64>		shadow_views_visibility;
+		ShadowCache				shadow_cache;
+
+		struct ShadowAtlasAllocation
+		{
+			std::array<uint32, 6> nodes;
+			uint32 node_count;
+			uint32 tile_size;
+			uint64 last_frame;
+		};
+		std::unique_ptr<GfxTexture>	shadow_atlas;
+		GfxDescriptor				shadow_atlas_srv;
+		GfxDescriptor				shadow_atlas_dsv;
+		QuadTreeAllocator			shadow_atlas_allocator;
+		std::unordered_map<uint64, ShadowAtlasAllocation> shadow_atlas_allocations;
+		uint64						shadow_atlas_frame = 0;
 
 		std::unique_ptr<GfxBuffer>  light_matrices_buffer;
 		GfxDescriptor				light_matrices_buffer_srvs[GFX_BACKBUFFER_COUNT];
@@ -74,6 +124,8 @@ namespace adria
 
 	private:
 		void CreatePSOs();
+		void CullShadowCasters();
+		void AllocateShadowAtlas(Camera const& camera);
 		void ShadowMapPass_Common(GfxDevice* gfx, GfxCommandList* cmd_list, uint64 light_index, uint64 matrix_index, uint64 matrix_offset);
 		static std::array<Matrix, SHADOW_CASCADE_COUNT> RecalculateProjectionMatrices(Camera const& camera, float split_lambda, std::array<float, SHADOW_CASCADE_COUNT>& split_distances);
 	};
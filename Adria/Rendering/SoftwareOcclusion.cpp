@@ -0,0 +1,382 @@
+#include <bit>
+#include <xmmintrin.h>
+#include "SoftwareOcclusion.h"
+#include "RenderProxyTable.h"
+#include "Components.h"
+#include "Editor/GUICommand.h"
+#include "Core/ConsoleManager.h"
+#include "Utilities/ThreadPool.h"
+#include "Utilities/Timer.h"
+#include "Utilities/AllocatorUtil.h"
+#include "meshoptimizer.h"
+#include "entt/entity/registry.hpp"
+
+using namespace DirectX;
+
+namespace adria
+{
+	static TAutoConsoleVariable<bool> SoftwareOcclusionCulling("r.SoftwareOcclusion", true, "Enable or disable CPU occlusion culling of the camera proxies");
+	static TAutoConsoleVariable<int>  SoftwareOcclusionWidth("r.SoftwareOcclusion.Width", 320, "Width of the software occlusion depth buffer, the height follows the camera aspect ratio");
+	static TAutoConsoleVariable<int>  SoftwareOcclusionMaxOccluders("r.SoftwareOcclusion.MaxOccluders", 96, "Largest number of occluders rasterized per frame, picked by their projected size");
+
+	namespace
+	{
+		constexpr uint32 OCCLUSION_TILE_SIZE = 8;
+		constexpr uint32 OCCLUSION_BAND_HEIGHT = 2 * OCCLUSION_TILE_SIZE;
+		constexpr uint32 OCCLUSION_TEST_CHUNK_SIZE = 1024;
+		//an occluder that deforms past the real surface culls visible geometry, so only near lossless simplifications are kept
+		constexpr float  OCCLUDER_SIMPLIFY_ERROR = 0.005f;
+		constexpr float  OCCLUDER_MIN_SIZE = 0.05f;
+		constexpr float  OCCLUSION_MIN_W = 1e-4f;
+	}
+
+	OccluderMesh BuildOccluderMesh(std::span<uint32 const> indices, std::span<Vector3 const> positions, uint32 max_triangles)
+	{
+		OccluderMesh occluder{};
+		if (indices.empty() || positions.empty()) return occluder;
+
+		float const* vertex_positions = &positions[0].x;
+		uint64 const target_index_count = std::min<uint64>(indices.size(), uint64(max_triangles) * 3);
+		occluder.indices.resize(indices.size());
+		float result_error = 0.0f;
+		uint64 index_count = meshopt_simplify(occluder.indices.data(), indices.data(), indices.size(), vertex_positions, positions.size(), sizeof(Vector3),
+			target_index_count, OCCLUDER_SIMPLIFY_ERROR, meshopt_SimplifyLockBorder, &result_error);
+		//meshes that can't get under the triangle budget within the error don't occlude
+		if (index_count > target_index_count || result_error > OCCLUDER_SIMPLIFY_ERROR) index_count = 0;
+		occluder.indices.resize(index_count);
+		if (index_count == 0) return occluder;
+
+		occluder.positions.resize(positions.size());
+		uint64 const vertex_count = meshopt_optimizeVertexFetch(occluder.positions.data(), occluder.indices.data(), index_count, positions.data(), positions.size(), sizeof(Vector3));
+		occluder.positions.resize(vertex_count);
+		return occluder;
+	}
+
+	bool SoftwareOcclusion::IsEnabled() const
+	{
+		return SoftwareOcclusionCulling.Get();
+	}
+
+	void SoftwareOcclusion::Cull(entt::registry const& reg, RenderProxyTable& render_proxies, Matrix const& view_projection, float aspect_ratio)
+	{
+		stats = {};
+		uint32 const proxy_count = render_proxies.GetCount();
+		if (!IsEnabled() || proxy_count == 0) return;
+
+		Timer timer;
+		Resize(aspect_ratio);
+		SelectOccluders(reg, render_proxies, view_projection);
+		SetupTriangles(reg, render_proxies, view_projection);
+		ParallelFor(height / OCCLUSION_BAND_HEIGHT, [this](uint64 band) { RasterizeBand((uint32)band); });
+		stats.occluder_count = (uint32)occluder_candidates.size();
+		stats.triangle_count = (uint32)triangles.size();
+		stats.raster_time = timer.Mark() / 1000.0f;
+
+		//a chunk owns whole visibility words, the occluders themselves are skipped since their boxes can only tie with their own depth
+		CullingBoxes const boxes = render_proxies.GetCullingBoxes();
+		std::span<uint64> visibility = render_proxies.GetVisibility();
+		uint32 const chunk_count = (proxy_count + OCCLUSION_TEST_CHUNK_SIZE - 1) / OCCLUSION_TEST_CHUNK_SIZE;
+		std::vector<std::pair<uint32, uint32>> chunk_counts(chunk_count);
+		ParallelFor(chunk_count, [&](uint64 chunk)
+			{
+				uint32 const word_begin = (uint32)chunk * OCCLUSION_TEST_CHUNK_SIZE / 64;
+				uint32 const word_end = std::min<uint32>(((uint32)chunk + 1) * OCCLUSION_TEST_CHUNK_SIZE / 64, (uint32)visibility.size());
+				auto& [tested_count, culled_count] = chunk_counts[chunk];
+				for (uint32 word_index = word_begin; word_index < word_end; ++word_index)
+				{
+					uint64 word = visibility[word_index];
+					uint64 candidates = word & ~occluder_mask[word_index];
+					while (candidates)
+					{
+						uint32 const bit = std::countr_zero(candidates);
+						candidates &= candidates - 1;
+						uint32 const proxy = word_index * 64 + bit;
+						Vector3 const center(boxes.center_x[proxy], boxes.center_y[proxy], boxes.center_z[proxy]);
+						Vector3 const extents(boxes.extent_x[proxy], boxes.extent_y[proxy], boxes.extent_z[proxy]);
+						++tested_count;
+						if (IsBoxOccluded(center, extents, view_projection))
+						{
+							word &= ~(1ull << bit);
+							++culled_count;
+						}
+					}
+					visibility[word_index] = word;
+				}
+			});
+		for (auto const& [tested_count, culled_count] : chunk_counts)
+		{
+			stats.tested_count += tested_count;
+			stats.culled_count += culled_count;
+		}
+		stats.test_time = timer.Mark() / 1000.0f;
+	}
+
+	void SoftwareOcclusion::GUI()
+	{
+		QueueGUI([&]()
+			{
+				if (ImGui::TreeNode("Software Occlusion"))
+				{
+					ImGui::Checkbox("Enable", SoftwareOcclusionCulling.GetPtr());
+					ImGui::SliderInt("Width", SoftwareOcclusionWidth.GetPtr(), 64, 1024);
+					ImGui::SliderInt("Max Occluders", SoftwareOcclusionMaxOccluders.GetPtr(), 0, 512);
+					ImGui::Text("Resolution: %ux%u", width, height);
+					ImGui::Text("Occluders: %u, Triangles: %u", stats.occluder_count, stats.triangle_count);
+					ImGui::Text("Culled: %u / %u", stats.culled_count, stats.tested_count);
+					ImGui::Text("Raster: %.3f ms, Test: %.3f ms", stats.raster_time, stats.test_time);
+					ImGui::TreePop();
+				}
+			}, GUICommandGroup_Renderer);
+	}
+
+	void SoftwareOcclusion::Resize(float aspect_ratio)
+	{
+		uint32 const new_width = (uint32)Align(std::clamp(SoftwareOcclusionWidth.Get(), 64, 1024), OCCLUSION_BAND_HEIGHT);
+		uint32 const new_height = (uint32)Align(std::max(uint32(new_width / std::max(aspect_ratio, 0.1f)), OCCLUSION_BAND_HEIGHT), OCCLUSION_BAND_HEIGHT);
+		if (new_width == width && new_height == height) return;
+
+		width = new_width;
+		height = new_height;
+		depth.resize(width * height);
+		tile_depth.resize((width / OCCLUSION_TILE_SIZE) * (height / OCCLUSION_TILE_SIZE));
+	}
+
+	void SoftwareOcclusion::SelectOccluders(entt::registry const& reg, RenderProxyTable const& render_proxies, Matrix const& view_projection)
+	{
+		occluder_candidates.clear();
+		occluder_mask.assign((render_proxies.GetCount() + 63) / 64, 0);
+
+		Mesh const* mesh = nullptr;
+		entt::entity mesh_owner = entt::null;
+		for (uint32 proxy = 0; proxy < render_proxies.GetCount(); ++proxy)
+		{
+			if (!render_proxies.IsVisible(proxy) || render_proxies.GetAlphaMode(proxy) != MaterialAlphaMode::Opaque) continue;
+
+			//projected size is the box radius over its view depth, boxes around the camera get the largest score
+			BoundingBox const box = render_proxies.GetBoundingBox(proxy);
+			float const radius = Vector3(box.Extents).Length();
+			float const w = box.Center.x * view_projection._14 + box.Center.y * view_projection._24 + box.Center.z * view_projection._34 + view_projection._44;
+			float const score = radius / std::max(w, radius);
+			if (score < OCCLUDER_MIN_SIZE) continue;
+
+			entt::entity const owner = render_proxies.GetOwner(proxy);
+			if (owner != mesh_owner)
+			{
+				mesh = &reg.get<Mesh>(owner);
+				mesh_owner = owner;
+			}
+			SubMeshInstance const& instance = mesh->instances[render_proxies.GetInstanceId(proxy) - mesh->instance_offset];
+			if (instance.submesh_index >= mesh->occluders.size() || !mesh->occluders[instance.submesh_index]) continue;
+			if (mesh->occluders[instance.submesh_index]->indices.empty()) continue;
+			occluder_candidates.emplace_back(score, proxy);
+		}
+
+		uint32 const max_occluders = (uint32)std::max(SoftwareOcclusionMaxOccluders.Get(), 0);
+		if (occluder_candidates.size() > max_occluders)
+		{
+			std::nth_element(occluder_candidates.begin(), occluder_candidates.begin() + max_occluders, occluder_candidates.end(),
+				[](auto const& a, auto const& b) { return a.first > b.first; });
+			occluder_candidates.resize(max_occluders);
+		}
+		for (auto const& [score, proxy] : occluder_candidates) occluder_mask[proxy / 64] |= 1ull << (proxy % 64);
+	}
+
+	void SoftwareOcclusion::SetupTriangles(entt::registry const& reg, RenderProxyTable const& render_proxies, Matrix const& view_projection)
+	{
+		triangles.clear();
+		float const half_width = 0.5f * width;
+		float const half_height = 0.5f * height;
+		for (auto const& [score, proxy] : occluder_candidates)
+		{
+			Mesh const& mesh = reg.get<Mesh>(render_proxies.GetOwner(proxy));
+			SubMeshInstance const& instance = mesh.instances[render_proxies.GetInstanceId(proxy) - mesh.instance_offset];
+			OccluderMesh const& occluder = *mesh.occluders[instance.submesh_index];
+
+			//x, y in pixels and 1/w, which is linear in screen space. w = 0 marks vertices behind the camera
+			XMMATRIX const world_view_projection = XMMatrixMultiply(instance.world_transform, view_projection);
+			screen_vertices.resize(occluder.positions.size());
+			for (uint64 i = 0; i < occluder.positions.size(); ++i)
+			{
+				Vector4 const clip = XMVector3Transform(XMLoadFloat3(&occluder.positions[i]), world_view_projection);
+				if (clip.w <= OCCLUSION_MIN_W)
+				{
+					screen_vertices[i] = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+					continue;
+				}
+				float const inv_w = 1.0f / clip.w;
+				screen_vertices[i] = Vector4((clip.x * inv_w + 1.0f) * half_width, (1.0f - clip.y * inv_w) * half_height, inv_w, 1.0f);
+			}
+
+			//triangles crossing the near plane are dropped rather than clipped, which only makes the occluder smaller
+			for (uint64 i = 0; i + 2 < occluder.indices.size(); i += 3)
+			{
+				Vector4 const& v0 = screen_vertices[occluder.indices[i + 0]];
+				Vector4 const& v1 = screen_vertices[occluder.indices[i + 1]];
+				Vector4 const& v2 = screen_vertices[occluder.indices[i + 2]];
+				if (v0.w == 0.0f || v1.w == 0.0f || v2.w == 0.0f) continue;
+
+				float const min_x = std::clamp(std::min({ v0.x, v1.x, v2.x }), -1.0f, width + 1.0f);
+				float const max_x = std::clamp(std::max({ v0.x, v1.x, v2.x }), -1.0f, width + 1.0f);
+				float const min_y = std::clamp(std::min({ v0.y, v1.y, v2.y }), -1.0f, height + 1.0f);
+				float const max_y = std::clamp(std::max({ v0.y, v1.y, v2.y }), -1.0f, height + 1.0f);
+
+				RasterTriangle triangle{};
+				triangle.min_x = std::max((int32)std::ceil(min_x - 0.5f), 0);
+				triangle.max_x = std::min((int32)std::floor(max_x - 0.5f), (int32)width - 1);
+				triangle.min_y = std::max((int32)std::ceil(min_y - 0.5f), 0);
+				triangle.max_y = std::min((int32)std::floor(max_y - 0.5f), (int32)height - 1);
+				if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) continue;
+
+				//edge k is opposite of vertex k, both windings are rasterized by flipping the edges of negative area triangles
+				Vector4 const* vertices[3] = { &v0, &v1, &v2 };
+				for (uint32 k = 0; k < 3; ++k)
+				{
+					Vector4 const& a = *vertices[(k + 1) % 3];
+					Vector4 const& b = *vertices[(k + 2) % 3];
+					triangle.edge_a[k] = a.y - b.y;
+					triangle.edge_b[k] = b.x - a.x;
+					triangle.edge_c[k] = a.x * b.y - b.x * a.y;
+				}
+				float area = triangle.edge_a[2] * v2.x + triangle.edge_b[2] * v2.y + triangle.edge_c[2];
+				if (std::abs(area) < 1e-6f) continue;
+				if (area < 0.0f)
+				{
+					for (uint32 k = 0; k < 3; ++k)
+					{
+						triangle.edge_a[k] = -triangle.edge_a[k];
+						triangle.edge_b[k] = -triangle.edge_b[k];
+						triangle.edge_c[k] = -triangle.edge_c[k];
+					}
+					area = -area;
+				}
+				float const inv_area = 1.0f / area;
+				triangle.depth_a = (triangle.edge_a[0] * v0.z + triangle.edge_a[1] * v1.z + triangle.edge_a[2] * v2.z) * inv_area;
+				triangle.depth_b = (triangle.edge_b[0] * v0.z + triangle.edge_b[1] * v1.z + triangle.edge_b[2] * v2.z) * inv_area;
+				triangle.depth_c = (triangle.edge_c[0] * v0.z + triangle.edge_c[1] * v1.z + triangle.edge_c[2] * v2.z) * inv_area;
+				triangles.push_back(triangle);
+			}
+		}
+	}
+
+	void SoftwareOcclusion::RasterizeBand(uint32 band)
+	{
+		int32 const band_begin = band * OCCLUSION_BAND_HEIGHT;
+		int32 const band_end = band_begin + OCCLUSION_BAND_HEIGHT;
+		std::fill(depth.begin() + band_begin * width, depth.begin() + band_end * width, 0.0f);
+
+		__m128 const lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 const zero = _mm_setzero_ps();
+		for (RasterTriangle const& triangle : triangles)
+		{
+			int32 const y_begin = std::max(triangle.min_y, band_begin);
+			int32 const y_end = std::min(triangle.max_y + 1, band_end);
+			if (y_begin >= y_end) continue;
+
+			int32 const x_begin = triangle.min_x & ~3;
+			__m128 const px = _mm_add_ps(_mm_set1_ps((float)x_begin), lane_offsets);
+			__m128 const a0 = _mm_set1_ps(triangle.edge_a[0]), a1 = _mm_set1_ps(triangle.edge_a[1]), a2 = _mm_set1_ps(triangle.edge_a[2]);
+			__m128 const da = _mm_set1_ps(triangle.depth_a);
+			__m128 const step0 = _mm_set1_ps(4.0f * triangle.edge_a[0]);
+			__m128 const step1 = _mm_set1_ps(4.0f * triangle.edge_a[1]);
+			__m128 const step2 = _mm_set1_ps(4.0f * triangle.edge_a[2]);
+			__m128 const depth_step = _mm_set1_ps(4.0f * triangle.depth_a);
+			for (int32 y = y_begin; y < y_end; ++y)
+			{
+				float const py = y + 0.5f;
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(triangle.edge_b[0] * py + triangle.edge_c[0]));
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(triangle.edge_b[1] * py + triangle.edge_c[1]));
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(triangle.edge_b[2] * py + triangle.edge_c[2]));
+				__m128 z = _mm_add_ps(_mm_mul_ps(da, px), _mm_set1_ps(triangle.depth_b * py + triangle.depth_c));
+
+				float* row = depth.data() + y * width;
+				for (int32 x = x_begin; x <= triangle.max_x; x += 4)
+				{
+					__m128 const inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside))
+					{
+						_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), _mm_and_ps(inside, z)));
+					}
+					e0 = _mm_add_ps(e0, step0);
+					e1 = _mm_add_ps(e1, step1);
+					e2 = _mm_add_ps(e2, step2);
+					z = _mm_add_ps(z, depth_step);
+				}
+			}
+		}
+
+		//farthest depth of each tile lets most box tests finish without touching pixels
+		uint32 const tiles_x = width / OCCLUSION_TILE_SIZE;
+		for (uint32 tile_y = band_begin / OCCLUSION_TILE_SIZE; tile_y < band_end / OCCLUSION_TILE_SIZE; ++tile_y)
+		{
+			for (uint32 tile_x = 0; tile_x < tiles_x; ++tile_x)
+			{
+				__m128 farthest = _mm_set1_ps(FLT_MAX);
+				for (uint32 y = 0; y < OCCLUSION_TILE_SIZE; ++y)
+				{
+					float const* row = depth.data() + (tile_y * OCCLUSION_TILE_SIZE + y) * width + tile_x * OCCLUSION_TILE_SIZE;
+					farthest = _mm_min_ps(farthest, _mm_min_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+				}
+				farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+				farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+				tile_depth[tile_y * tiles_x + tile_x] = _mm_cvtss_f32(farthest);
+			}
+		}
+	}
+
+	bool SoftwareOcclusion::IsBoxOccluded(Vector3 const& center, Vector3 const& extents, Matrix const& view_projection) const
+	{
+		//the nearest point of a box is one of its corners, so the largest corner 1/w bounds the whole box
+		float min_x = FLT_MAX, max_x = -FLT_MAX, min_y = FLT_MAX, max_y = -FLT_MAX;
+		float box_depth = 0.0f;
+		XMMATRIX const vp = view_projection;
+		for (uint32 corner = 0; corner < 8; ++corner)
+		{
+			Vector3 const position(
+				center.x + (corner & 1 ? extents.x : -extents.x),
+				center.y + (corner & 2 ? extents.y : -extents.y),
+				center.z + (corner & 4 ? extents.z : -extents.z));
+			Vector4 const clip = XMVector3Transform(position, vp);
+			if (clip.w <= OCCLUSION_MIN_W) return false;
+
+			float const inv_w = 1.0f / clip.w;
+			float const x = (clip.x * inv_w + 1.0f) * 0.5f * width;
+			float const y = (1.0f - clip.y * inv_w) * 0.5f * height;
+			min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+			min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+			box_depth = std::max(box_depth, inv_w);
+		}
+		if (max_x < 0.0f || max_y < 0.0f || min_x >= width || min_y >= height) return false;
+
+		int32 const x0 = (int32)std::max(min_x, 0.0f);
+		int32 const x1 = (int32)std::min(max_x, width - 1.0f);
+		int32 const y0 = (int32)std::max(min_y, 0.0f);
+		int32 const y1 = (int32)std::min(max_y, height - 1.0f);
+
+		uint32 const tiles_x = width / OCCLUSION_TILE_SIZE;
+		__m128 const box_depth4 = _mm_set1_ps(box_depth);
+		for (int32 tile_y = y0 / OCCLUSION_TILE_SIZE; tile_y <= y1 / (int32)OCCLUSION_TILE_SIZE; ++tile_y)
+		{
+			for (int32 tile_x = x0 / OCCLUSION_TILE_SIZE; tile_x <= x1 / (int32)OCCLUSION_TILE_SIZE; ++tile_x)
+			{
+				if (tile_depth[tile_y * tiles_x + tile_x] > box_depth) continue;
+
+				int32 const row_begin = std::max(y0, tile_y * (int32)OCCLUSION_TILE_SIZE);
+				int32 const row_end = std::min(y1, (tile_y + 1) * (int32)OCCLUSION_TILE_SIZE - 1);
+				int32 const column_begin = std::max(x0, tile_x * (int32)OCCLUSION_TILE_SIZE);
+				int32 const column_end = std::min(x1, (tile_x + 1) * (int32)OCCLUSION_TILE_SIZE - 1);
+				for (int32 y = row_begin; y <= row_end; ++y)
+				{
+					float const* row = depth.data() + y * width;
+					for (int32 x = column_begin & ~3; x <= column_end; x += 4)
+					{
+						int32 const first_lane = std::max(column_begin - x, 0);
+						int32 const last_lane = std::min(column_end - x, 3);
+						uint32 const lanes = ((1u << (last_lane + 1)) - 1) & ~((1u << first_lane) - 1);
+						if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), box_depth4)) & lanes) return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+}
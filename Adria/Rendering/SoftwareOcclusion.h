@@ -0,0 +1,67 @@
+#pragma once
+#include <span>
+#include "entt/entity/fwd.hpp"
+
+namespace adria
+{
+	class RenderProxyTable;
+
+	inline constexpr uint32 OCCLUDER_MAX_TRIANGLES = 256;
+
+	struct OccluderMesh
+	{
+		std::vector<Vector3> positions;
+		std::vector<uint32> indices;
+	};
+
+	//low poly stand in for occlusion culling that deviates from the source surface by at most a small fraction of its extents and keeps open borders.
+	//empty when the mesh can't be simplified to max_triangles that closely
+	OccluderMesh BuildOccluderMesh(std::span<uint32 const> indices, std::span<Vector3 const> positions, uint32 max_triangles = OCCLUDER_MAX_TRIANGLES);
+
+	struct SoftwareOcclusionStats
+	{
+		uint32 occluder_count;
+		uint32 triangle_count;
+		uint32 tested_count;
+		uint32 culled_count;
+		float raster_time;
+		float test_time;
+	};
+
+	//rasterizes the largest visible opaque occluders into a small 1/w buffer and clears the camera visibility of proxies whose boxes are behind it.
+	//runs after frustum culling, bands of the depth buffer and chunks of the visibility bitset are processed on the thread pool
+	class SoftwareOcclusion
+	{
+		struct RasterTriangle
+		{
+			float edge_a[3], edge_b[3], edge_c[3];
+			float depth_a, depth_b, depth_c;
+			int32 min_x, max_x, min_y, max_y;
+		};
+
+	public:
+		bool IsEnabled() const;
+		void Cull(entt::registry const& reg, RenderProxyTable& render_proxies, Matrix const& view_projection, float aspect_ratio);
+		void GUI();
+
+		SoftwareOcclusionStats const& GetStats() const { return stats; }
+
+	private:
+		uint32 width = 0;
+		uint32 height = 0;
+		std::vector<float> depth;
+		std::vector<float> tile_depth;
+		std::vector<RasterTriangle> triangles;
+		std::vector<Vector4> screen_vertices;
+		std::vector<std::pair<float, uint32>> occluder_candidates;
+		std::vector<uint64> occluder_mask;
+		SoftwareOcclusionStats stats{};
+
+	private:
+		void Resize(float aspect_ratio);
+		void SelectOccluders(entt::registry const& reg, RenderProxyTable const& render_proxies, Matrix const& view_projection);
+		void SetupTriangles(entt::registry const& reg, RenderProxyTable const& render_proxies, Matrix const& view_projection);
+		void RasterizeBand(uint32 band);
+		bool IsBoxOccluded(Vector3 const& center, Vector3 const& extents, Matrix const& view_projection) const;
+	};
+}
@@ -1,17 +1,163 @@
+#include <charconv>
 #include "d3dx12.h"
 
 #include "TextureManager.h"
+#include "SceneBuffer.h"
 #include "Graphics/GfxTexture.h"
 #include "Graphics/GfxDevice.h"
 #include "Graphics/GfxCommon.h"
 #include "Graphics/GfxCommandList.h"
 #include "Graphics/GfxShaderCompiler.h"
+#include "Core/ConsoleManager.h"
+#include "Core/Paths.h"
 #include "Logging/Logger.h"
 #include "Utilities/Image.h"
+#include "Utilities/FilesUtil.h"
+#include "Utilities/StringUtil.h"
+#include "Utilities/MappedFile.h"
+#include "Utilities/ThreadPool.h"
 
 
 namespace adria
 {
+	static TAutoConsoleVariable<int> TextureUploadBudget("r.TextureUploadBudget", 32, "Megabytes of texture data uploaded per frame by the texture manager, at least one texture is uploaded per frame");
+	static TAutoConsoleVariable<bool> TextureStreaming("r.TextureStreaming", true, "Load only the mip tail of DDS textures and stream the other mips by screen space texel density, applies to textures loaded afterwards");
+	static TAutoConsoleVariable<int> TextureStreamingBudget("r.TextureStreaming.Budget", 1024, "Megabytes of streamed textures, mips of the least recently requested textures are evicted to stay within it");
+	static TAutoConsoleVariable<int> TextureStreamingTailSize("r.TextureStreaming.TailSize", 128, "Largest mip dimension that is loaded at import and never evicted");
+	static TAutoConsoleVariable<float> TextureStreamingMipBias("r.TextureStreaming.MipBias", 0.0f, "Added to the mips requested from texel density, positive values trade sharpness for memory");
+	static TAutoConsoleVariable<int> TextureStreamingFadeFrames("r.TextureStreaming.FadeFrames", 8, "Frames over which the shader mip clamp fades in a newly streamed mip");
+
+	namespace
+	{
+		//bounds the memory held by decoded images that are waiting for upload
+		constexpr uint32 MAX_DECODES_IN_FLIGHT = 64;
+		constexpr uint32 MAX_STREAMING_LOADS_IN_FLIGHT = 16;
+		//textures that haven't been requested for this many frames only need their tail
+		constexpr uint64 STREAMING_IDLE_FRAMES = 60;
+
+		bool ParseEmbeddedTexturePath(std::string_view path, std::string_view& container_path, uint64& offset, uint64& size)
+		{
+			uint64 const separator = path.rfind('#');
+			if (separator == std::string_view::npos) return false;
+			std::string_view range = path.substr(separator + 1);
+			uint64 const comma = range.find(',');
+			if (comma == std::string_view::npos) return false;
+
+			char const* range_end = range.data() + range.size();
+			auto [offset_end, offset_error] = std::from_chars(range.data(), range.data() + comma, offset);
+			auto [size_end, size_error] = std::from_chars(range.data() + comma + 1, range_end, size);
+			if (offset_error != std::errc{} || size_error != std::errc{} || offset_end != range.data() + comma || size_end != range_end) return false;
+
+			container_path = path.substr(0, separator);
+			return true;
+		}
+
+		//first_mip and max_size skip the larger mips of DDS files, see Image
+		std::unique_ptr<Image> DecodeImage(std::string_view path, uint32 first_mip, uint32 max_size)
+		{
+			std::string_view container_path = path;
+			uint64 offset = 0, size = 0;
+			bool const embedded = ParseEmbeddedTexturePath(path, container_path, offset, size);
+			if (!embedded && first_mip == 0 && max_size == UINT32_MAX) return std::make_unique<Image>(path);
+
+			//embedded images are decoded straight from a mapping of their container, partial DDS loads only touch the pages of the mips they keep
+			MappedFile container;
+			if (!container.Open(container_path) || (embedded && (offset > container.GetSize() || size > container.GetSize() - offset)))
+			{
+				ADRIA_LOG(ERROR, "Failed to read texture %s", std::string(path).c_str());
+				return nullptr;
+			}
+			std::span<uint8 const> file_data = container.GetSpan();
+			if (embedded) file_data = file_data.subspan(offset, size);
+			return std::make_unique<Image>(file_data, first_mip, max_size);
+		}
+
+		//largest mip a texture is imported with, streamed textures load the rest on demand
+		uint32 GetImportMaxSize(std::string_view path, bool stream_mips)
+		{
+			if (!stream_mips || !TextureStreaming.Get() || ToLower(GetExtension(path)) != ".dds") return UINT32_MAX;
+			return (uint32)std::max(TextureStreamingTailSize.Get(), 1);
+		}
+
+		bool TextureSourceExists(std::string_view path)
+		{
+			std::string_view container_path;
+			uint64 offset = 0, size = 0;
+			return FileExists(ParseEmbeddedTexturePath(path, container_path, offset, size) ? container_path : path);
+		}
+
+		//default textures are 2D, volume, cube and array DDS files can't be sampled through them while they load
+		bool IsDDSTexture2D(std::string_view path)
+		{
+			if (ToLower(GetExtension(path)) != ".dds") return true;
+
+			MappedFile file;
+			if (!file.Open(path)) return true;
+			std::span<uint8 const> file_data = file.GetSpan();
+			auto ReadUint32 = [&](uint64 offset)
+			{
+				uint32 value = 0;
+				if (offset + sizeof(uint32) <= file_data.size()) memcpy(&value, file_data.data() + offset, sizeof(uint32));
+				return value;
+			};
+
+			constexpr uint64 DEPTH_OFFSET = 24, FOURCC_OFFSET = 84, CAPS2_OFFSET = 112;
+			constexpr uint64 DIMENSION_OFFSET = 132, MISC_FLAG_OFFSET = 136, ARRAY_SIZE_OFFSET = 140;
+			if (ReadUint32(DEPTH_OFFSET) > 1 || (ReadUint32(CAPS2_OFFSET) & 0x0000FC00U) != 0) return false;
+			if (ReadUint32(FOURCC_OFFSET) == ('D' | ('X' << 8) | ('1' << 16) | ('0' << 24)))
+			{
+				return ReadUint32(DIMENSION_OFFSET) != D3D12_RESOURCE_DIMENSION_TEXTURE3D && (ReadUint32(MISC_FLAG_OFFSET) & 0x4) == 0 && ReadUint32(ARRAY_SIZE_OFFSET) <= 1;
+			}
+			return true;
+		}
+
+		GfxCommonViewType GetDefaultTextureView(TextureHandle default_texture)
+		{
+			switch (default_texture)
+			{
+			case DEFAULT_BLACK_TEXTURE_HANDLE:				return GfxCommonViewType::BlackTexture2D_SRV;
+			case DEFAULT_NORMAL_TEXTURE_HANDLE:				return GfxCommonViewType::DefaultNormal2D_SRV;
+			case DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE: return GfxCommonViewType::MetallicRoughness2D_SRV;
+			case DEFAULT_WHITE_TEXTURE_HANDLE:
+			default:
+				return GfxCommonViewType::WhiteTexture2D_SRV;
+			}
+		}
+	}
+
+	std::string MakeEmbeddedTexturePath(std::string_view container_path, uint64 offset, uint64 size)
+	{
+		char range[64];
+		sprintf_s(range, "#%llu,%llu", offset, size);
+		return std::string(container_path) + range;
+	}
+
+	std::string FindCookedTexture(std::string_view path, TextureCookParameters const& params, bool cook_missing)
+	{
+		std::string_view container_path = path;
+		uint64 offset = 0, size = 0;
+		bool const embedded = ParseEmbeddedTexturePath(path, container_path, offset, size);
+		if (!embedded && ToLower(GetExtension(path)) == ".dds") return {};
+
+		MappedFile source;
+		if (!source.Open(container_path)) return {};
+		std::span<uint8 const> source_data = source.GetSpan();
+		if (embedded)
+		{
+			if (offset > source_data.size() || size > source_data.size() - offset) return {};
+			source_data = source_data.subspan(offset, size);
+		}
+
+		uint64 const key = ComputeCookedTextureKey(source_data, params);
+		std::string cooked_path = GetCookedTexturePath(paths::TextureCacheDir, path, params, key);
+		if (FileExists(cooked_path)) return cooked_path;
+		if (cook_missing)
+		{
+			if (CookTexture(source_data, params, cooked_path)) return cooked_path;
+			ADRIA_LOG(WARNING, "Failed to cook texture %s", std::string(path).c_str());
+		}
+		return {};
+	}
 
     TextureManager::TextureManager() {}
     TextureManager::~TextureManager() = default;
@@ -19,63 +165,57 @@ namespace adria
 	void TextureManager::Initialize(GfxDevice* _gfx, uint32 max_textures)
 	{
         gfx = _gfx;
+		mip_clamps = std::make_unique<SceneBuffer>();
+		mip_clamps->Initialize(gfx, sizeof(float));
 	}
 	void TextureManager::Destroy()
 	{
+		queued_decodes.clear();
+		for (auto& [_, pending] : pending_textures)
+		{
+			if (pending.image.valid()) pending.image.wait();
+		}
+		pending_textures.clear();
+		decodes_in_flight = 0;
+		for (uint32 index : streaming_loads) streamed_textures[index].load.wait();
+		streaming_loads.clear();
+		streamed_texture_swaps.clear();
+		streamed_textures.clear();
+		streaming_states.clear();
+		streamed_texture_indices.clear();
+		residency_evictions.clear();
+		mip_clamps.reset();
         texture_map.clear();
         loaded_textures.clear();
         gfx = nullptr;
 	}
 
-    TextureHandle TextureManager::LoadTexture(std::string_view path)
+    TextureHandle TextureManager::LoadTexture(std::string_view path, TextureHandle default_texture)
     {
-        std::string texture_name(path);
-        if (auto it = loaded_textures.find(texture_name); it == loaded_textures.end())
-        {
-            ++handle;
-            loaded_textures.insert({ texture_name, handle });
-            Image img(path);
-
-			GfxTextureDesc desc{};
-			desc.type = img.Depth() > 1 ? GfxTextureType_3D : GfxTextureType_2D;
-			desc.misc_flags = GfxTextureMiscFlag::None;
-			desc.width = img.Width();
-			desc.height = img.Height();
-			desc.array_size = img.IsCubemap() ? 6 : 1;
-			desc.depth = img.Depth();
-			desc.bind_flags = GfxBindFlag::ShaderResource;
-			desc.format = img.Format();
-			desc.initial_state = GfxResourceState::AllSRV; 
-			desc.heap_type = GfxResourceUsage::Default;
-			desc.mip_levels = img.MipLevels();
-            desc.misc_flags = img.IsCubemap() ? GfxTextureMiscFlag::TextureCube : GfxTextureMiscFlag::None;
-
-            std::vector<GfxTextureSubData> tex_data;
-			const Image* curr_img = &img;
-			while (curr_img)
-			{
-				for (uint32 i = 0; i < desc.mip_levels; ++i)
-				{
-                    GfxTextureSubData& data = tex_data.emplace_back();
-					data.data = curr_img->MipData(i);
-					data.row_pitch = GetRowPitch(curr_img->Format(), desc.width, i);
-					data.slice_pitch = GetSlicePitch(img.Format(), desc.width, desc.height, i);
-				}
-                curr_img = curr_img->NextImage();
-			}
-
-			GfxTextureData init_data{};
-			init_data.sub_data = tex_data.data();
-			init_data.sub_count = (uint32)tex_data.size();
-            std::unique_ptr<GfxTexture> tex = gfx->CreateTexture(desc, init_data);
+        if (auto it = loaded_textures.find(std::string(path)); it != loaded_textures.end()) return it->second;
 
-            texture_map[handle] = std::move(tex);
-			CreateViewForTexture(handle);
-			return handle;
-        }
-	    else return it->second;
+        TextureHandle tex_handle = QueueTexture(path, default_texture);
+        SubmitDecodes();
+        if (tex_handle != INVALID_TEXTURE_HANDLE && !IsDDSTexture2D(path)) WaitForTexture(tex_handle);
+        return tex_handle;
     }
 
+	std::vector<TextureHandle> TextureManager::LoadTextures(std::span<std::string const> paths, std::span<TextureHandle const> default_textures, bool stream_mips)
+	{
+		ADRIA_ASSERT(default_textures.empty() || default_textures.size() == paths.size());
+
+		//handles are assigned in request order so they don't depend on which decode finishes first
+		std::vector<TextureHandle> handles(paths.size(), INVALID_TEXTURE_HANDLE);
+		for (uint64 i = 0; i < paths.size(); ++i)
+		{
+			if (paths[i].empty()) continue;
+			if (auto it = loaded_textures.find(paths[i]); it != loaded_textures.end()) handles[i] = it->second;
+			else handles[i] = QueueTexture(paths[i], default_textures.empty() ? DEFAULT_WHITE_TEXTURE_HANDLE : default_textures[i], stream_mips);
+		}
+		SubmitDecodes();
+		return handles;
+	}
+
 	TextureHandle TextureManager::LoadCubemap(std::array<std::string, 6> const& cubemap_textures)
 	{
 		++handle;
@@ -103,6 +243,8 @@ namespace adria
 		GfxTextureData init_data{};
 		init_data.sub_data = subresources.data();
 		std::unique_ptr<GfxTexture> cubemap = gfx->CreateTexture(desc, init_data);
+		g_GfxResidencyManager.SetCategory(cubemap->GetResidencyHandle(), GfxMemoryCategory::Texture);
+		g_GfxResidencyManager.SetPriority(cubemap->GetResidencyHandle(), GfxResidencyPriority::High);
 
 		texture_map.insert({ handle, std::move(cubemap) });
 		CreateViewForTexture(handle);
@@ -111,6 +253,10 @@ namespace adria
 
 	GfxDescriptor TextureManager::GetSRV(TextureHandle tex_handle)
 	{
+		if (auto it = pending_textures.find(tex_handle); it != pending_textures.end())
+		{
+			return gfxcommon::GetCommonView(GetDefaultTextureView(it->second.default_texture));
+		}
 		return texture_srv_map[tex_handle];
 	}
 
@@ -121,6 +267,84 @@ namespace adria
 		else return nullptr;
 	}
 
+	bool TextureManager::IsTextureLoaded(TextureHandle tex_handle) const
+	{
+		return GetTexture(tex_handle) != nullptr;
+	}
+
+	void TextureManager::WaitForTexture(TextureHandle tex_handle)
+	{
+		auto it = pending_textures.find(tex_handle);
+		if (it == pending_textures.end()) return;
+
+		if (!it->second.image.valid())
+		{
+			std::erase(queued_decodes, tex_handle);
+			it->second.image = g_ThreadPool.Submit(DecodeImage, it->second.path, 0u, GetImportMaxSize(it->second.path, it->second.stream_mips));
+			++decodes_in_flight;
+		}
+		FinishTexture(tex_handle, it->second);
+		pending_textures.erase(it);
+		SubmitDecodes();
+	}
+
+	void TextureManager::WaitForPendingTextures()
+	{
+		while (!pending_textures.empty())
+		{
+			SubmitDecodes();
+			auto it = std::find_if(pending_textures.begin(), pending_textures.end(), [](auto const& pending) { return pending.second.image.valid(); });
+			ADRIA_ASSERT(it != pending_textures.end());
+			FinishTexture(it->first, it->second);
+			pending_textures.erase(it);
+		}
+	}
+
+	void TextureManager::Update()
+	{
+		uint64 const upload_budget = (uint64)std::max(TextureUploadBudget.Get(), 0) << 20;
+		uint64 uploaded_bytes = 0;
+		for (auto it = pending_textures.begin(); it != pending_textures.end() && (uploaded_bytes == 0 || uploaded_bytes < upload_budget);)
+		{
+			PendingTexture& pending = it->second;
+			if (pending.image.valid() && pending.image.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				uploaded_bytes += FinishTexture(it->first, pending);
+				it = pending_textures.erase(it);
+			}
+			else ++it;
+		}
+		SubmitDecodes();
+		//streaming gets what import left of the budget but always finishes at least one load
+		UpdateStreaming(std::max<uint64>(upload_budget - std::min(uploaded_bytes, upload_budget), 1));
+	}
+
+	void TextureManager::RequestTextureMip(TextureHandle tex_handle, float pixels_per_uv)
+	{
+		auto it = streamed_texture_indices.find(tex_handle);
+		if (it == streamed_texture_indices.end()) return;
+
+		TextureStreamingState& state = streaming_states[it->second];
+		uint32 const mip = std::min(ComputeStreamingMip(streamed_textures[it->second].size, pixels_per_uv, TextureStreamingMipBias.Get()), state.tail_mip);
+		if (state.last_request_frame != streaming_frame)
+		{
+			state.last_request_frame = streaming_frame;
+			state.requested_mip = mip;
+		}
+		else state.requested_mip = std::min(state.requested_mip, mip);
+		state.evict = false;
+	}
+
+	bool TextureManager::HasStreamedTextures() const
+	{
+		return !streamed_textures.empty();
+	}
+
+	int32 TextureManager::GetMipClampsIndex() const
+	{
+		return mip_clamps && mip_clamps->GetCount() > 0 ? (int32)mip_clamps->GetSRV().GetIndex() : -1;
+	}
+
 	void TextureManager::EnableMipMaps(bool mips)
     {
         mipmaps = mips;
@@ -129,10 +353,10 @@ namespace adria
 	void TextureManager::OnSceneInitialized()
 	{
 		gfx->InitShaderVisibleAllocator(1024);
-		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)DEFAULT_BLACK_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::BlackTexture2D_SRV));
-		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)DEFAULT_WHITE_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::WhiteTexture2D_SRV));
-		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)DEFAULT_NORMAL_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::DefaultNormal2D_SRV));
-		gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE), gfxcommon::GetCommonView(GfxCommonViewType::MetallicRoughness2D_SRV));
+		for (TextureHandle default_texture : { DEFAULT_BLACK_TEXTURE_HANDLE, DEFAULT_WHITE_TEXTURE_HANDLE, DEFAULT_NORMAL_TEXTURE_HANDLE, DEFAULT_METALLIC_ROUGHNESS_TEXTURE_HANDLE })
+		{
+			gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)default_texture), gfxcommon::GetCommonView(GetDefaultTextureView(default_texture)));
+		}
 		for (uint64 i = TEXTURE_MANAGER_START_HANDLE; i <= handle; ++i)
         {
             GfxTexture* texture = texture_map[TextureHandle(i)].get();
@@ -140,10 +364,106 @@ namespace adria
             {
                 CreateViewForTexture(TextureHandle(i), true);
             }
+            else if (auto it = pending_textures.find(TextureHandle(i)); it != pending_textures.end())
+            {
+                gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)i), gfxcommon::GetCommonView(GetDefaultTextureView(it->second.default_texture)));
+            }
+            else if (auto it = texture_srv_map.find(TextureHandle(i)); it != texture_srv_map.end())
+            {
+                //textures that failed to load before the scene was initialized point at their default view
+                gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)i), it->second);
+            }
         }
         is_scene_initialized = true;
 	}
 
+	TextureHandle TextureManager::QueueTexture(std::string_view path, TextureHandle default_texture, bool stream_mips)
+	{
+		if (!TextureSourceExists(path))
+		{
+			ADRIA_LOG(ERROR, "Texture %s doesn't exist", std::string(path).c_str());
+			return INVALID_TEXTURE_HANDLE;
+		}
+
+		++handle;
+		loaded_textures.insert({ std::string(path), handle });
+		pending_textures[handle] = PendingTexture{ .path = std::string(path), .default_texture = default_texture, .stream_mips = stream_mips };
+		queued_decodes.push_back(handle);
+		if (is_scene_initialized)
+		{
+			gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)handle), gfxcommon::GetCommonView(GetDefaultTextureView(default_texture)));
+		}
+		return handle;
+	}
+
+	void TextureManager::SubmitDecodes()
+	{
+		while (!queued_decodes.empty() && decodes_in_flight < MAX_DECODES_IN_FLIGHT)
+		{
+			PendingTexture& pending = pending_textures[queued_decodes.front()];
+			queued_decodes.pop_front();
+			pending.image = g_ThreadPool.Submit(DecodeImage, pending.path, 0u, GetImportMaxSize(pending.path, pending.stream_mips));
+			++decodes_in_flight;
+		}
+	}
+
+	uint64 TextureManager::FinishTexture(TextureHandle tex_handle, PendingTexture& pending)
+	{
+		std::unique_ptr<Image> img = pending.image.get();
+		--decodes_in_flight;
+		if (!img)
+		{
+			ADRIA_LOG(WARNING, "Texture %s failed to load, its handle keeps pointing at the default texture", pending.path.c_str());
+			texture_srv_map[tex_handle] = gfxcommon::GetCommonView(GetDefaultTextureView(pending.default_texture));
+			return 0;
+		}
+		uint64 const upload_size = CreateTexture(tex_handle, *img);
+		if (img->FirstMip() > 0) AddStreamedTexture(tex_handle, pending.path, *img);
+		return upload_size;
+	}
+
+	uint64 TextureManager::CreateTexture(TextureHandle tex_handle, Image const& img)
+	{
+		GfxTextureDesc desc{};
+		desc.type = img.Depth() > 1 ? GfxTextureType_3D : GfxTextureType_2D;
+		desc.width = img.Width();
+		desc.height = img.Height();
+		desc.array_size = img.IsCubemap() ? 6 : 1;
+		desc.depth = img.Depth();
+		desc.bind_flags = GfxBindFlag::ShaderResource;
+		desc.format = img.Format();
+		desc.initial_state = GfxResourceState::AllSRV;
+		desc.heap_type = GfxResourceUsage::Default;
+		desc.mip_levels = img.MipLevels();
+		desc.misc_flags = img.IsCubemap() ? GfxTextureMiscFlag::TextureCube : GfxTextureMiscFlag::None;
+
+		std::vector<GfxTextureSubData> tex_data;
+		uint64 upload_size = 0;
+		Image const* curr_img = &img;
+		while (curr_img)
+		{
+			for (uint32 i = 0; i < desc.mip_levels; ++i)
+			{
+				upload_size += GetTextureMipByteSize(curr_img->Format(), desc.width, desc.height, desc.depth, i);
+				GfxTextureSubData& data = tex_data.emplace_back();
+				data.data = curr_img->MipData(i);
+				data.row_pitch = GetRowPitch(curr_img->Format(), desc.width, i);
+				data.slice_pitch = GetSlicePitch(img.Format(), desc.width, desc.height, i);
+			}
+			curr_img = curr_img->NextImage();
+		}
+
+		GfxTextureData init_data{};
+		init_data.sub_data = tex_data.data();
+		init_data.sub_count = (uint32)tex_data.size();
+		std::unique_ptr<GfxTexture> tex = gfx->CreateTexture(desc, init_data);
+		g_GfxResidencyManager.SetCategory(tex->GetResidencyHandle(), GfxMemoryCategory::Texture);
+
+		texture_map[tex_handle] = std::move(tex);
+		CreateViewForTexture(tex_handle);
+		return upload_size;
+	}
+
 	void TextureManager::CreateViewForTexture(TextureHandle handle, bool flag)
 	{
         if (!is_scene_initialized && !flag) return;
@@ -154,4 +474,199 @@ namespace adria
         gfx->CopyDescriptors(1, gfx->GetDescriptorGPU((uint32)handle), texture_srv_map[handle]);
 	}
 
-}
\ No newline at end of file
+	void TextureManager::AddStreamedTexture(TextureHandle tex_handle, std::string const& path, Image const& img)
+	{
+		uint32 const mip_count = img.FirstMip() + img.MipLevels();
+		if (mip_count > TEXTURE_STREAMING_MAX_MIPS)
+		{
+			ADRIA_LOG(WARNING, "Texture %s has more mips than can be streamed, only its tail is loaded", path.c_str());
+			return;
+		}
+
+		uint32 const width = img.SourceWidth();
+		uint32 const height = img.SourceHeight();
+
+		streamed_texture_indices[tex_handle] = (uint32)streamed_textures.size();
+		StreamedTexture& streamed_texture = streamed_textures.emplace_back();
+		streamed_texture.handle = tex_handle;
+		streamed_texture.path = path;
+		streamed_texture.size = std::max(width, height);
+		streamed_texture.resident_mip = img.FirstMip();
+
+		TextureStreamingState& state = streaming_states.emplace_back();
+		state.mip_count = mip_count;
+		state.tail_mip = img.FirstMip();
+		state.resident_mip = img.FirstMip();
+		state.requested_mip = img.FirstMip();
+		uint32 const block_size = GetGfxFormatBlockSize(img.Format());
+		for (uint32 mip = 0; mip < mip_count; ++mip)
+		{
+			state.mip_sizes[mip] = GetTextureMipByteSize(img.Format(), width, height, 1, mip);
+			//D3D12 requires the top mip of a block compressed texture to be a whole number of blocks
+			if (std::max(width >> mip, 1u) % block_size != 0 || std::max(height >> mip, 1u) % block_size != 0) state.streamable_mips &= ~(1u << mip);
+		}
+	}
+
+	uint64 TextureManager::UpdateStreaming(uint64 upload_budget)
+	{
+		if (!is_scene_initialized) return 0;
+
+		uint64 uploaded_bytes = 0;
+		for (auto it = streaming_loads.begin(); it != streaming_loads.end() && uploaded_bytes < upload_budget;)
+		{
+			if (streamed_textures[*it].load.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				uploaded_bytes += FinishStreamingLoad(*it);
+				it = streaming_loads.erase(it);
+			}
+			else ++it;
+		}
+
+		uint64 const frame_index = gfx->GetFrameIndex();
+		for (StreamedTextureSwap& swap : streamed_texture_swaps)
+		{
+			if (swap.frame + GFX_BACKBUFFER_COUNT <= frame_index) SwapStreamedTexture(swap);
+		}
+		std::erase_if(streamed_texture_swaps, [](StreamedTextureSwap const& swap) { return swap.texture == nullptr; });
+
+		for (TextureHandle evicted_handle : residency_evictions)
+		{
+			if (auto it = streamed_texture_indices.find(evicted_handle); it != streamed_texture_indices.end()) streaming_states[it->second].evict = true;
+		}
+		residency_evictions.clear();
+
+		TextureStreamingSettings const settings
+		{
+			.budget = (uint64)std::max(TextureStreamingBudget.Get(), 0) << 20,
+			.max_loads = MAX_STREAMING_LOADS_IN_FLIGHT - (uint32)streaming_loads.size(),
+			.idle_frames = STREAMING_IDLE_FRAMES
+		};
+		PlanTextureStreaming(streaming_states, settings, streaming_frame, streaming_plan);
+		for (TextureMipChange const& eviction : streaming_plan.evictions) EvictMips(eviction.texture, eviction.mip);
+		for (TextureMipChange const& load : streaming_plan.loads)
+		{
+			StreamedTexture& streamed_texture = streamed_textures[load.texture];
+			TextureStreamingState& state = streaming_states[load.texture];
+			state.resident_mip = load.mip;
+			state.loading = true;
+			streamed_texture.load = g_ThreadPool.Submit(DecodeImage, streamed_texture.path, load.mip, UINT32_MAX);
+			streaming_loads.push_back(load.texture);
+		}
+
+		float const fade_step = 1.0f / std::max(TextureStreamingFadeFrames.Get(), 1);
+		for (uint32 i = 0; i < streamed_textures.size(); ++i)
+		{
+			StreamedTexture& streamed_texture = streamed_textures[i];
+			streamed_texture.mip_clamp = std::max(streamed_texture.mip_clamp - fade_step, 0.0f);
+			//keeps the residency manager from asking for textures that are on screen
+			if (streaming_states[i].last_request_frame == streaming_frame) g_GfxResidencyManager.Touch(GetTexture(streamed_texture.handle)->GetResidencyHandle());
+		}
+		mip_clamps->Resize((uint32)handle + 1);
+		for (StreamedTexture const& streamed_texture : streamed_textures) mip_clamps->Update((uint32)streamed_texture.handle, streamed_texture.mip_clamp);
+		mip_clamps->Commit();
+		mip_clamps->Upload(gfx->GetCommandList());
+		++streaming_frame;
+		return uploaded_bytes;
+	}
+
+	uint64 TextureManager::FinishStreamingLoad(uint32 index)
+	{
+		StreamedTexture& streamed_texture = streamed_textures[index];
+		TextureStreamingState& state = streaming_states[index];
+		std::unique_ptr<Image> img = streamed_texture.load.get();
+		state.loading = false;
+
+		uint32 const load_mip = state.resident_mip;
+		if (!img || img->FirstMip() != load_mip || img->FirstMip() + img->MipLevels() != state.mip_count || load_mip >= streamed_texture.resident_mip)
+		{
+			ADRIA_LOG(WARNING, "Failed to stream mip %u of texture %s", load_mip, streamed_texture.path.c_str());
+			state.resident_mip = streamed_texture.resident_mip;
+			return 0;
+		}
+
+		GfxTextureDesc desc = GetTexture(streamed_texture.handle)->GetDesc();
+		desc.width = img->Width();
+		desc.height = img->Height();
+		desc.mip_levels = img->MipLevels();
+		desc.initial_state = GfxResourceState::CopyDst;
+
+		//only the new mips are uploaded, the resident ones are copied from the current texture
+		uint32 const new_mip_count = streamed_texture.resident_mip - load_mip;
+		std::vector<GfxTextureSubData> tex_data(new_mip_count);
+		uint64 upload_size = 0;
+		for (uint32 i = 0; i < new_mip_count; ++i)
+		{
+			upload_size += GetTextureMipByteSize(img->Format(), desc.width, desc.height, 1, i);
+			tex_data[i].data = img->MipData(i);
+			tex_data[i].row_pitch = GetRowPitch(img->Format(), desc.width, i);
+			tex_data[i].slice_pitch = GetSlicePitch(img->Format(), desc.width, desc.height, i);
+		}
+		GfxTextureData init_data{};
+		init_data.sub_data = tex_data.data();
+		init_data.sub_count = new_mip_count;
+		SetStreamedTexture(index, gfx->CreateTexture(desc, init_data), load_mip, new_mip_count);
+		return upload_size;
+	}
+
+	void TextureManager::EvictMips(uint32 index, uint32 mip)
+	{
+		StreamedTexture& streamed_texture = streamed_textures[index];
+		streaming_states[index].resident_mip = mip;
+		streaming_states[index].evict = false;
+		if (mip <= streamed_texture.resident_mip) return;
+
+		GfxTexture const* texture = GetTexture(streamed_texture.handle);
+		uint32 const evicted_mips = mip - streamed_texture.resident_mip;
+		GfxTextureDesc desc = texture->GetDesc();
+		desc.width = std::max(desc.width >> evicted_mips, 1u);
+		desc.height = std::max(desc.height >> evicted_mips, 1u);
+		desc.mip_levels -= evicted_mips;
+		desc.initial_state = GfxResourceState::CopyDst;
+		SetStreamedTexture(index, gfx->CreateTexture(desc), mip, 0);
+	}
+
+	void TextureManager::SetStreamedTexture(uint32 index, std::unique_ptr<GfxTexture>&& texture, uint32 resident_mip, uint32 uploaded_mips)
+	{
+		StreamedTexture const& streamed_texture = streamed_textures[index];
+		GfxTexture& old_texture = *texture_map[streamed_texture.handle];
+
+		//mips past the uploaded ones come from the old texture, which stays in the bindless slot until the swap
+		GfxCommandList* cmd_list = gfx->GetCommandList();
+		cmd_list->TextureBarrier(old_texture, GfxResourceState::AllSRV, GfxResourceState::CopySrc);
+		cmd_list->FlushBarriers();
+		uint32 const old_mip_offset = resident_mip + uploaded_mips - streamed_texture.resident_mip;
+		for (uint32 mip = uploaded_mips; mip < texture->GetDesc().mip_levels; ++mip)
+		{
+			cmd_list->CopyTexture(*texture, mip, 0, old_texture, old_mip_offset + mip - uploaded_mips, 0);
+		}
+		cmd_list->TextureBarrier(old_texture, GfxResourceState::CopySrc, GfxResourceState::AllSRV);
+		cmd_list->TextureBarrier(*texture, GfxResourceState::CopyDst, GfxResourceState::AllSRV);
+		cmd_list->FlushBarriers();
+
+		g_GfxResidencyManager.SetCategory(texture->GetResidencyHandle(), GfxMemoryCategory::Texture);
+		if (resident_mip < streaming_states[index].tail_mip)
+		{
+			g_GfxResidencyManager.SetEvictionCallback(texture->GetResidencyHandle(), [this, tex_handle = streamed_texture.handle]() { residency_evictions.push_back(tex_handle); });
+		}
+
+		//the policy leaves the texture alone until it is swapped in
+		streaming_states[index].loading = true;
+		streamed_texture_swaps.push_back(StreamedTextureSwap{ .frame = gfx->GetFrameIndex(), .index = index, .resident_mip = resident_mip, .texture = std::move(texture) });
+	}
+
+	void TextureManager::SwapStreamedTexture(StreamedTextureSwap& swap)
+	{
+		StreamedTexture& streamed_texture = streamed_textures[swap.index];
+
+		//the clamp stays on the mip that was sampled before and fades from there
+		if (swap.resident_mip < streamed_texture.resident_mip) streamed_texture.mip_clamp += float(streamed_texture.resident_mip - swap.resident_mip);
+		else streamed_texture.mip_clamp = std::max(streamed_texture.mip_clamp - float(swap.resident_mip - streamed_texture.resident_mip), 0.0f);
+		streamed_texture.resident_mip = swap.resident_mip;
+		streaming_states[swap.index].loading = false;
+
+		//the old texture is released once the frames that can still sample it are done
+		texture_map[streamed_texture.handle] = std::move(swap.texture);
+		gfx->FreeDescriptorCPU(texture_srv_map[streamed_texture.handle], GfxDescriptorHeapType::CBV_SRV_UAV);
+		CreateViewForTexture(streamed_texture.handle);
+	}
+}
@@ -1,13 +1,25 @@
 #pragma once
+#include <span>
+#include <future>
+#include <deque>
 #include "TextureHandle.h"
+#include "TextureStreamingPolicy.h"
 #include "Graphics/GfxDescriptor.h"
 #include "Utilities/Singleton.h"
 #include "Utilities/Ref.h"
+#include "Utilities/TextureCooker.h"
 
 namespace adria
 {
 	class GfxDevice;
 	class GfxTexture;
+	class Image;
+	class SceneBuffer;
+
+	//path that loads bytes [offset, offset + size) of a container file as a texture, like an image embedded in a .glb
+	std::string MakeEmbeddedTexturePath(std::string_view container_path, uint64 offset, uint64 size);
+	//path of the DDS cooked from the texture at path in Saved/TextureCache, empty if there is none. cook_missing cooks it when it's missing
+	std::string FindCookedTexture(std::string_view path, TextureCookParameters const& params, bool cook_missing);
 
 	class TextureManager : public Singleton<TextureManager>
 	{
@@ -19,12 +31,59 @@ namespace adria
 		void Initialize(GfxDevice* gfx, uint32 max_textures);
 		void Destroy();
 
-		ADRIA_NODISCARD TextureHandle LoadTexture(std::string_view path);
+		//textures load in the background, until the load completes the handle's bindless slot points at default_texture
+		ADRIA_NODISCARD TextureHandle LoadTexture(std::string_view path, TextureHandle default_texture = DEFAULT_WHITE_TEXTURE_HANDLE);
+		//handles are returned in the order of paths, empty paths and missing files map to INVALID_TEXTURE_HANDLE.
+		//default_textures is either empty or has an entry per path. stream_mips streams the DDS textures among them, see RequestTextureMip
+		ADRIA_NODISCARD std::vector<TextureHandle> LoadTextures(std::span<std::string const> paths, std::span<TextureHandle const> default_textures = {}, bool stream_mips = false);
 		ADRIA_NODISCARD TextureHandle LoadCubemap(std::array<std::string, 6> const& cubemap_textures);
 		ADRIA_NODISCARD GfxDescriptor GetSRV(TextureHandle handle);
 		ADRIA_NODISCARD GfxTexture* GetTexture(TextureHandle handle) const;
+		ADRIA_NODISCARD bool IsTextureLoaded(TextureHandle handle) const;
+		ADRIA_NODISCARD uint64 GetPendingTextureCount() const { return pending_textures.size(); }
+		void WaitForTexture(TextureHandle handle);
+		void WaitForPendingTextures();
 		void EnableMipMaps(bool);
 		void OnSceneInitialized();
+		//uploads the textures whose decode finished and patches their bindless slots, then streams mips in and out. call once per frame
+		void Update();
+
+		//streamed textures with mips above r.TextureStreaming.TailSize load only their tail, the rest is loaded once some instance asks for it.
+		//pixels_per_uv is how many pixels one uv unit of the texture covers on screen, 0 asks for mip 0
+		void RequestTextureMip(TextureHandle handle, float pixels_per_uv);
+		ADRIA_NODISCARD bool HasStreamedTextures() const;
+		//float per texture handle with the mip the shaders should clamp sampling to, it fades newly streamed mips in
+		ADRIA_NODISCARD int32 GetMipClampsIndex() const;
+		ADRIA_NODISCARD uint64 GetStreamingResidentSize() const { return streaming_plan.resident_size; }
+		ADRIA_NODISCARD uint64 GetStreamingRequestedSize() const { return streaming_plan.requested_size; }
+
+	private:
+		struct PendingTexture
+		{
+			std::string path;
+			TextureHandle default_texture = DEFAULT_WHITE_TEXTURE_HANDLE;
+			bool stream_mips = false;
+			std::future<std::unique_ptr<Image>> image;
+		};
+
+		//streaming_states has the matching policy state
+		struct StreamedTexture
+		{
+			TextureHandle handle;
+			std::string path;
+			uint32 size = 0;				//larger dimension of mip 0
+			uint32 resident_mip = 0;		//of the texture in the bindless slot, the policy state already counts loads and swaps in flight
+			float mip_clamp = 0.0f;
+			std::future<std::unique_ptr<Image>> load;
+		};
+		//a recreated texture replaces the one in the bindless slot once the frames in flight that sample the slot are done
+		struct StreamedTextureSwap
+		{
+			uint64 frame;
+			uint32 index;
+			uint32 resident_mip;
+			std::unique_ptr<GfxTexture> texture;
+		};
 
 	private:
 		GfxDevice* gfx = nullptr;
@@ -32,6 +91,19 @@ namespace adria
 		std::unordered_map<TextureName, TextureHandle> loaded_textures;
 		std::unordered_map<TextureHandle, std::unique_ptr<GfxTexture>> texture_map;
 		std::unordered_map<TextureHandle, GfxDescriptor> texture_srv_map;
+		std::unordered_map<TextureHandle, PendingTexture> pending_textures;
+		std::deque<TextureHandle> queued_decodes;
+		uint32 decodes_in_flight = 0;
+
+		std::vector<StreamedTexture> streamed_textures;
+		std::vector<TextureStreamingState> streaming_states;
+		std::unordered_map<TextureHandle, uint32> streamed_texture_indices;
+		std::vector<uint32> streaming_loads;
+		std::vector<StreamedTextureSwap> streamed_texture_swaps;
+		std::vector<TextureHandle> residency_evictions;
+		TextureStreamingPlan streaming_plan;
+		uint64 streaming_frame = 1;
+		std::unique_ptr<SceneBuffer> mip_clamps;
 		TextureHandle handle = TEXTURE_MANAGER_START_HANDLE;
 		bool mipmaps = true;
 		bool is_scene_initialized = false;
@@ -40,6 +112,16 @@ namespace adria
 		TextureManager();
 		~TextureManager();
 
+		TextureHandle QueueTexture(std::string_view path, TextureHandle default_texture, bool stream_mips = false);
+		void SubmitDecodes();
+		uint64 FinishTexture(TextureHandle handle, PendingTexture& pending);
+		uint64 CreateTexture(TextureHandle handle, Image const& img);
+		void AddStreamedTexture(TextureHandle handle, std::string const& path, Image const& img);
+		uint64 UpdateStreaming(uint64 upload_budget);
+		uint64 FinishStreamingLoad(uint32 index);
+		void EvictMips(uint32 index, uint32 mip);
+		void SetStreamedTexture(uint32 index, std::unique_ptr<GfxTexture>&& texture, uint32 resident_mip, uint32 uploaded_mips);
+		void SwapStreamedTexture(StreamedTextureSwap& swap);
 		void CreateViewForTexture(TextureHandle handle, bool flag = false);
 	};
 	#define g_TextureManager TextureManager::Get()
@@ -0,0 +1,97 @@
+#include "TextureStreamingPolicy.h"
+
+namespace adria
+{
+	namespace
+	{
+		//mips that can't be streamed are rounded to a more detailed one, mip 0 always can
+		uint32 GetStreamableMip(TextureStreamingState const& texture, uint32 mip)
+		{
+			while (mip > 0 && !(texture.streamable_mips & (1u << mip))) --mip;
+			return mip;
+		}
+	}
+
+	uint64 GetStreamingResidentSize(TextureStreamingState const& texture, uint32 first_mip)
+	{
+		uint64 size = 0;
+		for (uint32 mip = first_mip; mip < texture.mip_count; ++mip) size += texture.mip_sizes[mip];
+		return size;
+	}
+
+	void PlanTextureStreaming(std::span<TextureStreamingState const> textures, TextureStreamingSettings const& settings, uint64 frame, TextureStreamingPlan& plan)
+	{
+		plan.evictions.clear();
+		plan.loads.clear();
+		plan.resident_size = 0;
+		plan.requested_size = 0;
+
+		uint32 const texture_count = (uint32)textures.size();
+		std::vector<uint32> wanted_mips(texture_count);
+		std::vector<uint32> eviction_candidates;
+		std::vector<uint32> load_candidates;
+		for (uint32 i = 0; i < texture_count; ++i)
+		{
+			TextureStreamingState const& texture = textures[i];
+			bool const requested = !texture.evict && texture.last_request_frame + settings.idle_frames >= frame;
+			wanted_mips[i] = GetStreamableMip(texture, requested ? std::min(texture.requested_mip, texture.tail_mip) : texture.tail_mip);
+			plan.resident_size += GetStreamingResidentSize(texture, texture.resident_mip);
+			plan.requested_size += GetStreamingResidentSize(texture, wanted_mips[i]);
+
+			if (texture.loading) continue;
+			if (texture.resident_mip < wanted_mips[i]) eviction_candidates.push_back(i);
+			else if (texture.resident_mip > wanted_mips[i]) load_candidates.push_back(i);
+		}
+
+		std::sort(eviction_candidates.begin(), eviction_candidates.end(), [&](uint32 a, uint32 b)
+			{
+				if (textures[a].evict != textures[b].evict) return textures[a].evict;
+				if (textures[a].last_request_frame != textures[b].last_request_frame) return textures[a].last_request_frame < textures[b].last_request_frame;
+				return textures[a].resident_mip < textures[b].resident_mip;
+			});
+		std::sort(load_candidates.begin(), load_candidates.end(), [&](uint32 a, uint32 b)
+			{
+				uint32 const missing_a = textures[a].resident_mip - wanted_mips[a];
+				uint32 const missing_b = textures[b].resident_mip - wanted_mips[b];
+				if (missing_a != missing_b) return missing_a > missing_b;
+				if (textures[a].last_request_frame != textures[b].last_request_frame) return textures[a].last_request_frame > textures[b].last_request_frame;
+				return a < b;
+			});
+
+		uint64 next_eviction = 0;
+		auto EvictNext = [&]()
+		{
+			if (next_eviction == eviction_candidates.size()) return false;
+			uint32 const i = eviction_candidates[next_eviction++];
+			TextureStreamingState const& texture = textures[i];
+			plan.resident_size -= GetStreamingResidentSize(texture, texture.resident_mip) - GetStreamingResidentSize(texture, wanted_mips[i]);
+			plan.evictions.push_back(TextureMipChange{ .texture = i, .mip = wanted_mips[i] });
+			return true;
+		};
+
+		//textures the residency manager asked for are sorted first, the rest is only evicted for the budget
+		while (next_eviction < eviction_candidates.size() && textures[eviction_candidates[next_eviction]].evict) EvictNext();
+		while (plan.resident_size > settings.budget && EvictNext());
+
+		for (uint32 i : load_candidates)
+		{
+			if (plan.loads.size() >= settings.max_loads) break;
+			TextureStreamingState const& texture = textures[i];
+			uint64 const resident_size = GetStreamingResidentSize(texture, texture.resident_mip);
+
+			//settle for a blurrier mip when the requested one doesn't fit
+			uint32 mip = wanted_mips[i];
+			for (; mip < texture.resident_mip; ++mip)
+			{
+				if (!(texture.streamable_mips & (1u << mip))) continue;
+				uint64 const load_size = GetStreamingResidentSize(texture, mip) - resident_size;
+				while (plan.resident_size + load_size > settings.budget && EvictNext());
+				if (plan.resident_size + load_size <= settings.budget) break;
+			}
+			if (mip == texture.resident_mip) continue;
+
+			plan.resident_size += GetStreamingResidentSize(texture, mip) - resident_size;
+			plan.loads.push_back(TextureMipChange{ .texture = i, .mip = mip });
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	inline constexpr uint32 TEXTURE_STREAMING_MAX_MIPS = 16;
+
+	//most detailed mip of a texture whose larger mip 0 dimension is texture_size when one uv unit covers pixels_per_uv pixels on screen.
+	//pixels_per_uv of 0 means the density is unknown and asks for mip 0
+	inline uint32 ComputeStreamingMip(uint32 texture_size, float pixels_per_uv, float mip_bias)
+	{
+		if (pixels_per_uv <= 0.0f) return 0;
+		float const mip = std::log2(float(texture_size) / pixels_per_uv) + mip_bias;
+		return mip > 0.0f ? uint32(std::min(mip, float(TEXTURE_STREAMING_MAX_MIPS - 1))) : 0;
+	}
+
+	//mips [resident_mip, mip_count) of a texture are resident or being loaded
+	struct TextureStreamingState
+	{
+		std::array<uint64, TEXTURE_STREAMING_MAX_MIPS> mip_sizes{};
+		uint32 mip_count = 1;
+		uint32 tail_mip = 0;			//first mip of the tail that is loaded at import and never evicted
+		uint32 resident_mip = 0;
+		uint32 requested_mip = 0;		//most detailed mip asked for in last_request_frame
+		uint32 streamable_mips = ~0u;	//mask of the mips that can be the most detailed resident one, block compressed ones have to be a whole number of blocks
+		uint64 last_request_frame = 0;
+		bool loading = false;			//textures with a load in flight are left alone until it finishes
+		bool evict = false;				//the residency manager wants the memory back, the texture drops to its tail
+	};
+
+	struct TextureStreamingSettings
+	{
+		uint64 budget = 0;				//bytes of all streamed textures including their tails
+		uint32 max_loads = 0;
+		uint64 idle_frames = 0;			//frames without requests after which a texture only needs its tail
+	};
+
+	//the most detailed resident mip of texture becomes mip
+	struct TextureMipChange
+	{
+		uint32 texture;
+		uint32 mip;
+	};
+
+	struct TextureStreamingPlan
+	{
+		std::vector<TextureMipChange> evictions;
+		std::vector<TextureMipChange> loads;
+		uint64 resident_size = 0;		//after the plan is applied
+		uint64 requested_size = 0;		//if every texture had the mips it asks for
+	};
+
+	uint64 GetStreamingResidentSize(TextureStreamingState const& texture, uint32 first_mip);
+
+	//loads go to the blurriest textures first, the mips they need beyond the budget are taken from textures that hold more detail than they ask for,
+	//least recently requested first. only depends on its arguments so it can be exercised without a device
+	void PlanTextureStreaming(std::span<TextureStreamingState const> textures, TextureStreamingSettings const& settings, uint64 frame, TextureStreamingPlan& plan);
+}
@@ -127,6 +127,8 @@ namespace adria
 	{
 		lens_dirt_handle		   = g_TextureManager.LoadTexture(paths::TexturesDir + "LensDirt.dds");
 		tony_mc_mapface_lut_handle = g_TextureManager.LoadTexture(paths::TexturesDir + "tony_mc_mapface.dds");
+		//the lut is a 3D texture, the default texture can't stand in for it
+		g_TextureManager.WaitForTexture(tony_mc_mapface_lut_handle);
 	}
 
 	void ToneMapPass::CreatePSO()
@@ -0,0 +1,89 @@
+#include "TransformHierarchy.h"
+#include "Utilities/ThreadPool.h"
+
+using namespace DirectX;
+
+namespace adria
+{
+	namespace
+	{
+		constexpr uint32 TRANSFORM_CHUNK_SIZE = 1024;
+	}
+
+	uint32 TransformHierarchy::AddNode(uint32 parent, Matrix const& local_transform)
+	{
+		ADRIA_ASSERT(parent == INVALID_NODE || parent < GetNodeCount());
+		uint32 const node = GetNodeCount();
+		uint32 const level = parent == INVALID_NODE ? 0 : levels[parent] + 1;
+		ADRIA_ASSERT(level + 2 >= level_offsets.size());
+
+		if (level + 1 == level_offsets.size()) level_offsets.push_back(node);
+		++level_offsets.back();
+
+		parents.push_back(parent);
+		local_transforms.push_back(local_transform);
+		world_transforms.push_back(local_transform);
+		dirty.push_back(1);
+		updated.push_back(0);
+		levels.push_back(level);
+		first_dirty_level = std::min(first_dirty_level, level);
+		return node;
+	}
+
+	void TransformHierarchy::SetLocalTransform(uint32 node, Matrix const& local_transform)
+	{
+		ADRIA_ASSERT(node < GetNodeCount());
+		local_transforms[node] = local_transform;
+		dirty[node] = 1;
+		first_dirty_level = std::min(first_dirty_level, levels[node]);
+	}
+
+	bool TransformHierarchy::Update()
+	{
+		if (updated_count > 0)
+		{
+			std::fill(updated.begin(), updated.end(), uint8(0));
+			updated_count = 0;
+		}
+		if (first_dirty_level >= GetLevelCount()) return false;
+
+		//parents live on the previous level, so their updated flags are final before a level starts
+		for (uint32 level = first_dirty_level; level < GetLevelCount(); ++level)
+		{
+			uint32 const level_begin = level_offsets[level];
+			uint32 const level_end = level_offsets[level + 1];
+			uint32 const chunk_count = (level_end - level_begin + TRANSFORM_CHUNK_SIZE - 1) / TRANSFORM_CHUNK_SIZE;
+			if (chunk_count <= 1)
+			{
+				UpdateNodes(level_begin, level_end);
+				continue;
+			}
+
+			ParallelFor(chunk_count, [this, level_begin, level_end](uint64 chunk)
+				{
+					uint32 const begin = level_begin + uint32(chunk) * TRANSFORM_CHUNK_SIZE;
+					UpdateNodes(begin, std::min(begin + TRANSFORM_CHUNK_SIZE, level_end));
+				});
+		}
+		first_dirty_level = uint32(-1);
+
+		for (uint8 node_updated : updated) updated_count += node_updated;
+		return updated_count > 0;
+	}
+
+	void TransformHierarchy::UpdateNodes(uint32 begin, uint32 end)
+	{
+		for (uint32 node = begin; node < end; ++node)
+		{
+			uint32 const parent = parents[node];
+			bool const parent_updated = parent != INVALID_NODE && updated[parent];
+			if (!dirty[node] && !parent_updated) continue;
+
+			XMMATRIX world = XMLoadFloat4x4(&local_transforms[node]);
+			if (parent != INVALID_NODE) world = XMMatrixMultiply(world, XMLoadFloat4x4(&world_transforms[parent]));
+			XMStoreFloat4x4(&world_transforms[node], world);
+			dirty[node] = 0;
+			updated[node] = 1;
+		}
+	}
+}
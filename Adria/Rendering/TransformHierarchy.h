@@ -0,0 +1,41 @@
+#pragma once
+
+namespace adria
+{
+	//local and world transforms of a node hierarchy stored as parallel arrays. Nodes are kept in level order, every node comes after
+	//its parent and all nodes of a level are contiguous, so a level only depends on the one before it and can be updated in parallel
+	class TransformHierarchy
+	{
+	public:
+		static constexpr uint32 INVALID_NODE = uint32(-1);
+
+		//parent has to be INVALID_NODE or an existing node, and the new node can not be shallower than the last added one
+		uint32 AddNode(uint32 parent, Matrix const& local_transform);
+		void SetLocalTransform(uint32 node, Matrix const& local_transform);
+
+		//recomputes world transforms of the dirty subtrees, returns false if nothing moved
+		bool Update();
+
+		uint32 GetNodeCount() const { return (uint32)parents.size(); }
+		uint32 GetLevelCount() const { return (uint32)level_offsets.size() - 1; }
+		uint32 GetParent(uint32 node) const { return parents[node]; }
+		Matrix const& GetLocalTransform(uint32 node) const { return local_transforms[node]; }
+		Matrix const& GetWorldTransform(uint32 node) const { return world_transforms[node]; }
+		bool HasUpdates() const { return updated_count > 0; }
+		bool WasUpdated(uint32 node) const { return updated[node] != 0; }
+
+	private:
+		std::vector<uint32> parents;
+		std::vector<Matrix> local_transforms;
+		std::vector<Matrix> world_transforms;
+		std::vector<uint8> dirty;
+		std::vector<uint8> updated;
+		std::vector<uint32> levels;
+		std::vector<uint32> level_offsets = { 0 };
+		uint32 first_dirty_level = uint32(-1);
+		uint32 updated_count = 0;
+
+	private:
+		void UpdateNodes(uint32 begin, uint32 end);
+	};
+}
@@ -0,0 +1,91 @@
+#include "TriangleBVH.h"
+
+namespace adria
+{
+	namespace
+	{
+		bool RayTriangle(Vector3 const& origin, Vector3 const& direction, Vector3 const& v0, Vector3 const& v1, Vector3 const& v2, float& t, float& u, float& v)
+		{
+			Vector3 const e1 = v1 - v0;
+			Vector3 const e2 = v2 - v0;
+			Vector3 const p = direction.Cross(e2);
+			float const det = e1.Dot(p);
+			if (std::abs(det) < 1e-12f) return false;
+
+			float const inv_det = 1.0f / det;
+			Vector3 const s = origin - v0;
+			u = s.Dot(p) * inv_det;
+			if (u < 0.0f || u > 1.0f) return false;
+
+			Vector3 const q = s.Cross(e1);
+			v = direction.Dot(q) * inv_det;
+			if (v < 0.0f || u + v > 1.0f) return false;
+
+			t = e2.Dot(q) * inv_det;
+			return t >= 0.0f;
+		}
+	}
+
+	TriangleBVH::TriangleBVH(std::vector<Vector3> const& positions, std::vector<uint32> const& indices)
+	{
+		uint32 const triangle_count = (uint32)indices.size() / 3;
+		std::vector<Vector3> triangle_min(triangle_count), triangle_max(triangle_count);
+		for (uint32 i = 0; i < triangle_count; ++i)
+		{
+			Vector3 const& v0 = positions[indices[3 * i + 0]];
+			Vector3 const& v1 = positions[indices[3 * i + 1]];
+			Vector3 const& v2 = positions[indices[3 * i + 2]];
+			triangle_min[i] = Vector3::Min(v0, Vector3::Min(v1, v2));
+			triangle_max[i] = Vector3::Max(v0, Vector3::Max(v1, v2));
+		}
+
+		SceneBVHData data = BuildBVH(triangle_min, triangle_max);
+		nodes = std::move(data.nodes);
+		triangles = std::move(data.proxies);
+		vertices.resize(triangles.size() * 3);
+		for (uint64 i = 0; i < triangles.size(); ++i)
+		{
+			for (uint32 j = 0; j < 3; ++j) vertices[3 * i + j] = positions[indices[3 * triangles[i] + j]];
+		}
+	}
+
+	bool TriangleBVH::RayCast(Vector3 const& origin, Vector3 const& direction, float max_distance, TriangleHit& hit) const
+	{
+		if (nodes.empty()) return false;
+		Vector3 const inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+		uint32 hit_slot = uint32(-1);
+		uint32 stack[SceneBVH::MAX_DEPTH + 1];
+		uint32 stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0)
+		{
+			uint32 const node_index = stack[--stack_size];
+			SceneBVHNode const& node = nodes[node_index];
+			if (RayBoxDistance(origin, inv_direction, node.min, node.max) > max_distance) continue;
+			if (node.count == 0)
+			{
+				uint32 near_child = node_index + 1;
+				uint32 far_child = node.offset;
+				if (RayBoxDistance(origin, inv_direction, nodes[far_child].min, nodes[far_child].max) <
+					RayBoxDistance(origin, inv_direction, nodes[near_child].min, nodes[near_child].max)) std::swap(near_child, far_child);
+				stack[stack_size++] = far_child;
+				stack[stack_size++] = near_child;
+				continue;
+			}
+			for (uint32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				float t, u, v;
+				if (!RayTriangle(origin, direction, vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2], t, u, v) || t > max_distance) continue;
+				max_distance = t;
+				hit = TriangleHit{ .distance = t, .triangle = triangles[i], .barycentric_u = u, .barycentric_v = v };
+				hit_slot = i;
+			}
+		}
+		if (hit_slot == uint32(-1)) return false;
+
+		hit.normal = (vertices[3 * hit_slot + 1] - vertices[3 * hit_slot]).Cross(vertices[3 * hit_slot + 2] - vertices[3 * hit_slot]);
+		hit.normal.Normalize();
+		return true;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <span>
+#include "SceneBVH.h"
+
+namespace adria
+{
+	struct TriangleHit
+	{
+		float distance;
+		uint32 triangle;
+		float barycentric_u;
+		float barycentric_v;
+		Vector3 normal;
+	};
+
+	//SAH bounding volume hierarchy over the triangles of a submesh, in object space
+	class TriangleBVH
+	{
+	public:
+		TriangleBVH(std::vector<Vector3> const& positions, std::vector<uint32> const& indices);
+		//restores a hierarchy previously built by the constructor above
+		TriangleBVH(std::span<SceneBVHNode const> _nodes, std::span<Vector3 const> _vertices, std::span<uint32 const> _triangles)
+			: nodes(_nodes.begin(), _nodes.end()), vertices(_vertices.begin(), _vertices.end()), triangles(_triangles.begin(), _triangles.end()) {}
+
+		bool RayCast(Vector3 const& origin, Vector3 const& direction, float max_distance, TriangleHit& hit) const;
+		uint32 GetTriangleCount() const { return (uint32)triangles.size(); }
+
+		std::span<SceneBVHNode const> GetNodes() const { return nodes; }
+		std::span<Vector3 const> GetVertices() const { return vertices; }
+		std::span<uint32 const> GetTriangles() const { return triangles; }
+
+	private:
+		std::vector<SceneBVHNode> nodes;
+		std::vector<Vector3> vertices;		//three vertices per triangle, in leaf order
+		std::vector<uint32> triangles;		//original triangle index, in leaf order
+	};
+}
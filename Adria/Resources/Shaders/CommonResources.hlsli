@@ -48,6 +48,9 @@ struct FrameCBuffer
 	int	   rainSplashBumpIdx;
 	int	   rainBlockerMapIdx;
 	float  rainTotalTime;
+
+	int    meshBuffersIdx;
+	int    textureMipClampsIdx;
 };
 ConstantBuffer<FrameCBuffer> FrameCB  : register(b0);
 
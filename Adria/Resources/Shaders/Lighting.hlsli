@@ -11,6 +11,8 @@
 #define POINT_LIGHT 1
 #define SPOT_LIGHT 2
 
+#define SHADOW_ATLAS_SIZE 4096
+
 struct Light
 {
 	float4	position;
@@ -113,8 +115,8 @@ float GetShadowMapFactorWS(Light light, float3 worldPosition)
 			float3 UVD = shadowMapPosition.xyz / shadowMapPosition.w;
 			UVD.xy = 0.5 * UVD.xy + 0.5;
 			UVD.y = 1.0 - UVD.y;
-			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex + cubeFaceIndex)];
-			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, 512);
+			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex)];
+			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, SHADOW_ATLAS_SIZE);
 		}
 		break;
 		case SPOT_LIGHT:
@@ -125,7 +127,7 @@ float GetShadowMapFactorWS(Light light, float3 worldPosition)
 			UVD.xy = 0.5 * UVD.xy + 0.5;
 			UVD.y = 1.0 - UVD.y;
 			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex)];
-			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, 1024);
+			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, SHADOW_ATLAS_SIZE);
 		}
 		break;
 		}
@@ -190,8 +192,8 @@ float GetShadowMapFactor(Light light, float3 viewPosition)
 			float3 UVD = shadowMapPosition.xyz / shadowMapPosition.w;
 			UVD.xy = 0.5 * UVD.xy + 0.5;
 			UVD.y = 1.0 - UVD.y;
-			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex + cubeFaceIndex)];
-			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, 512);
+			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex)];
+			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, SHADOW_ATLAS_SIZE);
 		}
 		break;
 		case SPOT_LIGHT:
@@ -204,7 +206,7 @@ float GetShadowMapFactor(Light light, float3 viewPosition)
 			UVD.xy = 0.5 * UVD.xy + 0.5;
 			UVD.y = 1.0 - UVD.y;
 			Texture2D<float> shadowMap = ResourceDescriptorHeap[NonUniformResourceIndex(light.shadowTextureIndex)];
-			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, 1024);
+			shadowFactor = CalcShadowFactor_PCF3x3(ShadowWrapSampler, shadowMap, UVD, SHADOW_ATLAS_SIZE);
 		}
 		break;
 		}
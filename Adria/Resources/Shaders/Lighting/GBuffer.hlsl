@@ -1,11 +1,13 @@
 #include "Scene.hlsli"
+#include "Packing.hlsli"
 #if RAIN
 #include "Weather/RainUtil.hlsli"
 #endif
 
 struct GBufferConstants
 {
-    uint instanceId;
+    uint instanceOffset;
+    uint instanceIdsIdx;
 };
 ConstantBuffer<GBufferConstants> GBufferPassCB : register(b1);
 
@@ -17,6 +19,7 @@ struct VSToPS
 	float3 TangentWS    : TANGENT;
 	float3 BitangentWS  : BITANGENT;
 	float3 NormalWS     : NORMAL1;
+	nointerpolation uint InstanceId : INSTANCE_ID;
 };
 
 struct PSOutput
@@ -26,11 +29,12 @@ struct PSOutput
 	float4 Emissive : SV_TARGET2;
 };
 
-VSToPS GBufferVS(uint vertexId : SV_VertexID)
+VSToPS GBufferVS(uint vertexId : SV_VertexID, uint instanceIndex : SV_InstanceID)
 {
 	VSToPS output = (VSToPS)0;
 
-    Instance instanceData = GetInstanceData(GBufferPassCB.instanceId);
+    uint instanceId = GetDrawInstanceId(GBufferPassCB.instanceIdsIdx, GBufferPassCB.instanceOffset, instanceIndex);
+    Instance instanceData = GetInstanceData(instanceId);
     Mesh meshData = GetMeshData(instanceData.meshIndex);
 
 	float3 pos = LoadMeshBuffer<float3>(meshData.bufferIdx, meshData.positionsOffset, vertexId);
@@ -47,6 +51,7 @@ VSToPS GBufferVS(uint vertexId : SV_VertexID)
 	output.NormalWS =  mul(nor, (float3x3) transpose(instanceData.inverseWorldMatrix));
 	output.TangentWS = mul(tan.xyz, (float3x3) instanceData.worldMatrix);
 	output.BitangentWS = normalize(cross(output.NormalWS, output.TangentWS) * tan.w);
+	output.InstanceId = instanceId;
 	
 	return output;
 }
@@ -62,31 +67,26 @@ PSOutput PackGBuffer(float3 BaseColor, float3 NormalVS, float4 emissive, float r
 
 PSOutput GBufferPS(VSToPS input)
 {
-    Instance instanceData = GetInstanceData(GBufferPassCB.instanceId);
+    Instance instanceData = GetInstanceData(input.InstanceId);
     Material materialData = GetMaterialData(instanceData.materialIdx);
 
-	Texture2D albedoTexture = ResourceDescriptorHeap[materialData.diffuseIdx];
-	Texture2D normalTexture = ResourceDescriptorHeap[materialData.normalIdx];
-	Texture2D metallicRoughnessTexture = ResourceDescriptorHeap[materialData.roughnessMetallicIdx];
-	Texture2D emissiveTexture = ResourceDescriptorHeap[materialData.emissiveIdx];
-
-	float4 albedoColor = albedoTexture.Sample(LinearWrapSampler, input.Uvs) * float4(materialData.baseColorFactor, 1.0f);
+	float4 albedoColor = SampleMaterialTexture(materialData.diffuseIdx, LinearWrapSampler, input.Uvs) * float4(materialData.baseColorFactor, 1.0f);
 	if (albedoColor.a < materialData.alphaCutoff) discard;
 
 	float3 normal = normalize(input.NormalWS);
 	float3 tangent = normalize(input.TangentWS);
 	float3 bitangent = normalize(input.BitangentWS);
-    float3 normalTS = normalize(normalTexture.Sample(LinearWrapSampler, input.Uvs).xyz * 2.0f - 1.0f);
+    float3 normalTS = normalize(UnpackNormalMap(SampleMaterialTexture(materialData.normalIdx, LinearWrapSampler, input.Uvs).xy));
     float3x3 TBN = float3x3(tangent, bitangent, normal); 
     normal = normalize(mul(normalTS, TBN));
 
-	float3 aoRoughnessMetallic = metallicRoughnessTexture.Sample(LinearWrapSampler, input.Uvs).rgb;
+	float3 aoRoughnessMetallic = SampleMaterialTexture(materialData.roughnessMetallicIdx, LinearWrapSampler, input.Uvs).rgb;
 #if RAIN
 	ApplyRain(input.PositionWS.xyz, albedoColor.rgb, aoRoughnessMetallic.g, normal, tangent, bitangent);
 #endif
 	float3 normalVS = normalize(mul(normal, (float3x3) FrameCB.view));
 
-	float3 emissiveColor = emissiveTexture.Sample(LinearWrapSampler, input.Uvs).rgb;
+	float3 emissiveColor = SampleMaterialTexture(materialData.emissiveIdx, LinearWrapSampler, input.Uvs).rgb;
 	return PackGBuffer(albedoColor.xyz, normalVS, float4(emissiveColor, materialData.emissiveFactor),
 		aoRoughnessMetallic.g * materialData.roughnessFactor, aoRoughnessMetallic.b * materialData.metallicFactor);
 }
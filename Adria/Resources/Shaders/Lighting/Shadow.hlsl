@@ -3,27 +3,24 @@
 
 struct ShadowConstants
 {
+	uint  instanceOffset;
 	uint  lightIndex;
 	uint  matrixIndex;
+	uint  instanceIdsIdx;
 };
 ConstantBuffer<ShadowConstants> ShadowPassCB : register(b1);
 
-struct ModelConstants
-{
-	uint instanceId;
-};
-ConstantBuffer<ModelConstants> ModelCB : register(b2);
-
 
 struct VSToPS
 {
 	float4 Pos : SV_POSITION;
 #if TRANSPARENT
 	float2 TexCoords : TEX;
+	nointerpolation uint InstanceId : INSTANCE_ID;
 #endif
 };
 
-VSToPS ShadowVS(uint VertexId : SV_VertexID)
+VSToPS ShadowVS(uint VertexId : SV_VertexID, uint InstanceIndex : SV_InstanceID)
 {
 	StructuredBuffer<Light> lightBuffer = ResourceDescriptorHeap[FrameCB.lightsIdx];
 	StructuredBuffer<float4x4> lightViewProjections = ResourceDescriptorHeap[FrameCB.lightsMatricesIdx];
@@ -31,7 +28,8 @@ VSToPS ShadowVS(uint VertexId : SV_VertexID)
 	float4x4 lightViewProjection = lightViewProjections[light.shadowMatrixIndex + ShadowPassCB.matrixIndex];
 
 	VSToPS output = (VSToPS)0;
-	Instance instanceData = GetInstanceData(ModelCB.instanceId);
+	uint instanceId = GetDrawInstanceId(ShadowPassCB.instanceIdsIdx, ShadowPassCB.instanceOffset, InstanceIndex);
+	Instance instanceData = GetInstanceData(instanceId);
 	Mesh meshData = GetMeshData(instanceData.meshIndex);
 
 	float3 pos = LoadMeshBuffer<float3>(meshData.bufferIdx, meshData.positionsOffset, VertexId);
@@ -42,6 +40,7 @@ VSToPS ShadowVS(uint VertexId : SV_VertexID)
 #if TRANSPARENT
 	float2 uv = LoadMeshBuffer<float2>(meshData.bufferIdx, meshData.uvsOffset, VertexId);
 	output.TexCoords = uv;
+	output.InstanceId = instanceId;
 #endif
 	return output;
 }
@@ -49,7 +48,7 @@ VSToPS ShadowVS(uint VertexId : SV_VertexID)
 void ShadowPS(VSToPS input)
 {
 #if TRANSPARENT 
-	Instance instanceData = GetInstanceData(ModelCB.instanceId);
+	Instance instanceData = GetInstanceData(input.InstanceId);
 	Material materialData = GetMaterialData(instanceData.materialIdx);
 
 	Texture2D albedoTexture = ResourceDescriptorHeap[materialData.diffuseIdx];
@@ -1,5 +1,6 @@
 #include "GpuDrivenRendering.hlsli"
 #include "Scene.hlsli"
+#include "Packing.hlsli"
 #if RAIN
 #include "Weather/RainUtil.hlsli"
 #endif
@@ -99,28 +100,23 @@ PSOutput DrawMeshletsPS(MSToPS input)
 	Instance instance = GetInstanceData(candidate.instanceID);
 	Material material = GetMaterialData(instance.materialIdx);
 
-	Texture2D albedoTexture = ResourceDescriptorHeap[material.diffuseIdx];
-	Texture2D normalTexture = ResourceDescriptorHeap[material.normalIdx];
-	Texture2D metallicRoughnessTexture = ResourceDescriptorHeap[material.roughnessMetallicIdx];
-	Texture2D emissiveTexture = ResourceDescriptorHeap[material.emissiveIdx];
-
-	float4 albedoColor = albedoTexture.Sample(LinearWrapSampler, input.Uvs) * float4(material.baseColorFactor, 1.0f);
+	float4 albedoColor = SampleMaterialTexture(material.diffuseIdx, LinearWrapSampler, input.Uvs) * float4(material.baseColorFactor, 1.0f);
 	if (albedoColor.a < material.alphaCutoff) discard;
 
 	float3 normal = normalize(input.NormalWS);
 	float3 tangent = normalize(input.TangentWS);
 	float3 bitangent = normalize(input.BitangentWS);
-    float3 normalTS = normalize(normalTexture.Sample(LinearWrapSampler, input.Uvs).xyz * 2.0f - 1.0f);
+    float3 normalTS = normalize(UnpackNormalMap(SampleMaterialTexture(material.normalIdx, LinearWrapSampler, input.Uvs).xy));
     float3x3 TBN = float3x3(tangent, bitangent, normal); 
     normal = normalize(mul(normalTS, TBN));
 
-	float3 aoRoughnessMetallic = metallicRoughnessTexture.Sample(LinearWrapSampler, input.Uvs).rgb;
+	float3 aoRoughnessMetallic = SampleMaterialTexture(material.roughnessMetallicIdx, LinearWrapSampler, input.Uvs).rgb;
 #if RAIN
 	ApplyRain(input.PositionWS.xyz, albedoColor.rgb, aoRoughnessMetallic.g, normal, tangent, bitangent);
 #endif
 	float3 normalVS = normalize(mul(normal, (float3x3) FrameCB.view));
 
-	float3 emissiveColor = emissiveTexture.Sample(LinearWrapSampler, input.Uvs).rgb;
+	float3 emissiveColor = SampleMaterialTexture(material.emissiveIdx, LinearWrapSampler, input.Uvs).rgb;
 	return PackGBuffer(albedoColor.xyz, normalVS, float4(emissiveColor, material.emissiveFactor),
 		aoRoughnessMetallic.g * material.roughnessFactor, aoRoughnessMetallic.b * material.metallicFactor);
 }
@@ -79,4 +79,13 @@ float3 DecodeNormal16x2(uint f)
     return DecodeNormalOctahedron(n * 2.0 - 1.0);
 }
 
+//tangent space normal from the xy channels of a normal map, z is reconstructed so two channel (BC5) normal maps work too
+float3 UnpackNormalMap(in float2 normalXY)
+{
+    float3 normal;
+    normal.xy = normalXY * 2.0f - 1.0f;
+    normal.z = sqrt(saturate(1.0f - dot(normal.xy, normal.xy)));
+    return normal;
+}
+
 #endif
\ No newline at end of file
@@ -49,10 +49,18 @@ Instance GetInstanceData(uint instanceId)
 	return instances[instanceId];
 }
 
+uint GetDrawInstanceId(uint instanceIdsIdx, uint instanceOffset, uint instanceIndex)
+{
+	ByteAddressBuffer instanceIds = ResourceDescriptorHeap[instanceIdsIdx];
+	return instanceIds.Load((instanceOffset + instanceIndex) * 4);
+}
+
 Mesh GetMeshData(uint meshIdx)
 {
 	StructuredBuffer<Mesh> meshes = ResourceDescriptorHeap[FrameCB.meshesIdx];
-	return meshes[meshIdx];
+	Mesh mesh = meshes[meshIdx];
+	mesh.bufferIdx += FrameCB.meshBuffersIdx;
+	return mesh;
 }
 
 Material GetMaterialData(uint materialIdx)
@@ -61,6 +69,18 @@ Material GetMaterialData(uint materialIdx)
 	return materials[materialIdx];
 }
 
+//streamed textures fade new mips in through a per texture mip clamp, the sampler clamp keeps the hardware lod and anisotropy
+float4 SampleMaterialTexture(uint textureIdx, SamplerState textureSampler, float2 uv)
+{
+	Texture2D materialTexture = ResourceDescriptorHeap[textureIdx];
+	if (FrameCB.textureMipClampsIdx >= 0)
+	{
+		StructuredBuffer<float> mipClamps = ResourceDescriptorHeap[FrameCB.textureMipClampsIdx];
+		return materialTexture.Sample(textureSampler, uv, int2(0, 0), mipClamps[textureIdx]);
+	}
+	return materialTexture.Sample(textureSampler, uv);
+}
+
 template<typename T>
 T LoadMeshBuffer(uint bufferIdx, uint bufferOffset, uint vertexId)
 {
@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "Rendering/SceneBVH.h"
+#include "Utilities/AllocatorUtil.h"
+#include "Utilities/ThreadPool.h"
+#include "BenchmarkUtil.h"
+
+using namespace adria;
+using namespace DirectX;
+
+//build, refit and query times of the scene BVH on random instances scattered through a cube. Refits move a tenth of the
+//instances per step to show how the SAH cost drifts away from a fresh build, frustum queries are compared with the brute force culling kernel
+namespace
+{
+	constexpr float SCENE_SIZE = 2000.0f;
+	constexpr uint32 QUERY_COUNT = 10000;
+	constexpr uint32 REFIT_STEPS = 10;
+
+	struct InstanceBoxes
+	{
+		std::vector<float> center_x, center_y, center_z;
+		std::vector<float> extent_x, extent_y, extent_z;
+
+		uint32 GetCount() const { return (uint32)center_x.size(); }
+		CullingBoxes GetCullingBoxes() const
+		{
+			return CullingBoxes{ center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), GetCount() };
+		}
+	};
+
+	InstanceBoxes MakeInstances(uint32 count, std::mt19937& rng)
+	{
+		std::uniform_real_distribution<float> position(-SCENE_SIZE * 0.5f, SCENE_SIZE * 0.5f);
+		std::uniform_real_distribution<float> extent(0.5f, 5.0f);
+
+		InstanceBoxes instances;
+		for (std::vector<float>* soa : { &instances.center_x, &instances.center_y, &instances.center_z, &instances.extent_x, &instances.extent_y, &instances.extent_z })
+		{
+			soa->resize(count);
+		}
+		for (uint32 i = 0; i < count; ++i)
+		{
+			instances.center_x[i] = position(rng); instances.center_y[i] = position(rng); instances.center_z[i] = position(rng);
+			instances.extent_x[i] = extent(rng); instances.extent_y[i] = extent(rng); instances.extent_z[i] = extent(rng);
+		}
+		return instances;
+	}
+
+	void MoveInstances(InstanceBoxes& instances, std::mt19937& rng)
+	{
+		std::uniform_int_distribution<uint32> instance(0, instances.GetCount() - 1);
+		std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+		for (uint32 i = 0; i < instances.GetCount() / 10; ++i)
+		{
+			uint32 const moved = instance(rng);
+			instances.center_x[moved] += offset(rng);
+			instances.center_y[moved] += offset(rng);
+			instances.center_z[moved] += offset(rng);
+		}
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: BVHBenchmark [-n <instance count>]... [-r <runs>]\n"
+			   "  -n  instance count to measure, can be repeated. 100k, 250k and 1M by default\n"
+			   "  -r  runs averaged per measurement, 10 by default\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32> instance_counts;
+	uint32 runs = 10;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) instance_counts.push_back(std::max((uint32)std::stoul(argv[++i]), 1u));
+		else if (arg == "-r" && i + 1 < argc) runs = std::max((uint32)std::stoul(argv[++i]), 1u);
+		else
+		{
+			PrintUsage();
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+	}
+	if (instance_counts.empty()) instance_counts = { 100000, 250000, 1000000 };
+
+	g_ThreadPool.Initialize();
+
+	Matrix const view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -SCENE_SIZE * 0.5f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	Matrix const projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, SCENE_SIZE);
+	BoundingFrustum frustum(projection);
+	frustum.Transform(frustum, view.Invert());
+	CullingFrustum const culling_frustum = MakeCullingFrustum(frustum);
+
+	for (uint32 instance_count : instance_counts)
+	{
+		std::mt19937 rng(instance_count);
+		InstanceBoxes instances = MakeInstances(instance_count, rng);
+		CullingBoxes const boxes = instances.GetCullingBoxes();
+
+		SceneBVH bvh;
+		float const build_ms = Measure(runs, [&]() { bvh.Build(boxes); });
+		float const refit_ms = Measure(runs, [&]() { bvh.Refit(boxes); });
+		printf("%u instances, %u nodes\n", instance_count, bvh.GetNodeCount());
+		printf("  build                %10.3f ms\n", build_ms);
+		printf("  refit                %10.3f ms\n", refit_ms);
+
+		std::vector<uint64, AlignedAllocator<uint64, 64>> visibility((instance_count + 63) / 64);
+		uint32 frustum_visible = 0;
+		float const frustum_ms = Measure(runs, [&]()
+			{
+				frustum_visible = 0;
+				bvh.QueryFrustum(culling_frustum, [&](uint32) { ++frustum_visible; });
+			});
+		float const brute_force_ms = Measure(runs, [&]() { CullBoxesParallel(culling_frustum, boxes, visibility); });
+		printf("  frustum query        %10.3f ms, %u visible, brute force parallel culling %.3f ms\n", frustum_ms, frustum_visible, brute_force_ms);
+
+		std::uniform_real_distribution<float> position(-SCENE_SIZE * 0.5f, SCENE_SIZE * 0.5f);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::vector<Vector3> query_points(QUERY_COUNT), ray_directions(QUERY_COUNT);
+		for (uint32 i = 0; i < QUERY_COUNT; ++i)
+		{
+			query_points[i] = Vector3(position(rng), position(rng), position(rng));
+			ray_directions[i] = Vector3(direction(rng), direction(rng), direction(rng));
+			ray_directions[i].Normalize();
+		}
+
+		uint64 sphere_hits = 0, box_hits = 0, ray_hits = 0;
+		float const sphere_ms = Measure(runs, [&]()
+			{
+				sphere_hits = 0;
+				for (Vector3 const& center : query_points) bvh.QuerySphere(center, 50.0f, [&](uint32) { ++sphere_hits; });
+			});
+		float const box_ms = Measure(runs, [&]()
+			{
+				box_hits = 0;
+				for (Vector3 const& center : query_points) bvh.QueryBox(center - Vector3(50.0f), center + Vector3(50.0f), [&](uint32) { ++box_hits; });
+			});
+		float const ray_ms = Measure(runs, [&]()
+			{
+				ray_hits = 0;
+				for (uint32 i = 0; i < QUERY_COUNT; ++i)
+				{
+					bool hit = false;
+					bvh.QueryRay(query_points[i], ray_directions[i], SCENE_SIZE, [&](uint32, float distance) { hit = true; return distance; });
+					ray_hits += hit;
+				}
+			});
+		printf("  sphere queries       %10.3f us/query, %.1f hits/query\n", sphere_ms * 1000.0f / QUERY_COUNT, double(sphere_hits) / QUERY_COUNT);
+		printf("  box queries          %10.3f us/query, %.1f hits/query\n", box_ms * 1000.0f / QUERY_COUNT, double(box_hits) / QUERY_COUNT);
+		printf("  ray queries          %10.3f us/ray, %.1f%% hit\n", ray_ms * 1000.0f / QUERY_COUNT, 100.0 * ray_hits / QUERY_COUNT);
+
+		bvh.Build(boxes);
+		for (uint32 step = 1; step <= REFIT_STEPS; ++step)
+		{
+			MoveInstances(instances, rng);
+			bvh.Refit(boxes);
+			printf("  refit step %2u        %10.3f ms, cost %.2fx of a fresh build\n", step, bvh.GetRefitTime(), bvh.GetCostRatio());
+		}
+	}
+	g_ThreadPool.Destroy();
+	return 0;
+}
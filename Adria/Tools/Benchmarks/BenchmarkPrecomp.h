@@ -0,0 +1,19 @@
+#pragma once
+
+//standard headers of the engine's precompiled header, engine sources rely on them without including them
+#include <vector>
+#include <memory>
+#include <string>
+#include <array>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <functional>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <map>
+#include <unordered_set>
+#include <fstream>
+#include <algorithm>
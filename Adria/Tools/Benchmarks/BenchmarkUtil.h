@@ -0,0 +1,16 @@
+#pragma once
+#include <chrono>
+#include "Utilities/Timer.h"
+
+namespace adria
+{
+	//average milliseconds of a run, after one warm up run
+	template<typename F>
+	float Measure(uint32 runs, F&& f)
+	{
+		f();
+		Timer<std::chrono::nanoseconds> timer;
+		for (uint32 run = 0; run < runs; ++run) f();
+		return timer.Elapsed() / (runs * 1e6f);
+	}
+}
@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <bit>
+#include <algorithm>
+#include "Rendering/FrustumCulling.h"
+#include "Utilities/AllocatorUtil.h"
+#include "Utilities/ThreadPool.h"
+#include "BenchmarkUtil.h"
+
+using namespace adria;
+using namespace DirectX;
+
+//compares the SoA culling kernel, on one thread and on the thread pool, with the BoundingFrustum test per box it replaced.
+//boxes are scattered uniformly through a cube the camera looks into from one side. The kernel only tests the box against each plane,
+//so it can keep boxes near frustum corners that BoundingFrustum::Intersects rejects and the visible count can be above the reference count
+namespace
+{
+	constexpr float SCENE_SIZE = 2000.0f;
+
+	struct BoxSet
+	{
+		std::vector<float> center_x, center_y, center_z;
+		std::vector<float> extent_x, extent_y, extent_z;
+		std::vector<BoundingBox> boxes;
+
+		CullingBoxes GetCullingBoxes() const
+		{
+			return CullingBoxes{ center_x.data(), center_y.data(), center_z.data(), extent_x.data(), extent_y.data(), extent_z.data(), (uint32)boxes.size() };
+		}
+	};
+
+	BoxSet MakeBoxes(uint32 count, uint32 seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-SCENE_SIZE * 0.5f, SCENE_SIZE * 0.5f);
+		std::uniform_real_distribution<float> extent(0.5f, 10.0f);
+
+		BoxSet set;
+		for (std::vector<float>* soa : { &set.center_x, &set.center_y, &set.center_z, &set.extent_x, &set.extent_y, &set.extent_z }) soa->reserve(count);
+		set.boxes.reserve(count);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			Vector3 const center(position(rng), position(rng), position(rng));
+			Vector3 const extents(extent(rng), extent(rng), extent(rng));
+			set.center_x.push_back(center.x); set.center_y.push_back(center.y); set.center_z.push_back(center.z);
+			set.extent_x.push_back(extents.x); set.extent_y.push_back(extents.y); set.extent_z.push_back(extents.z);
+			set.boxes.emplace_back(center, extents);
+		}
+		return set;
+	}
+
+	uint64 CountVisible(std::span<uint64 const> visibility)
+	{
+		uint64 visible = 0;
+		for (uint64 word : visibility) visible += std::popcount(word);
+		return visible;
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: CullingBenchmark [-n <box count>]... [-r <runs>]\n"
+			   "  -n  box count to measure, can be repeated. 10k, 100k and 1M by default\n"
+			   "  -r  runs averaged per measurement, 20 by default\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32> box_counts;
+	uint32 runs = 20;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) box_counts.push_back((uint32)std::stoul(argv[++i]));
+		else if (arg == "-r" && i + 1 < argc) runs = std::max((uint32)std::stoul(argv[++i]), 1u);
+		else
+		{
+			PrintUsage();
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+	}
+	if (box_counts.empty()) box_counts = { 10000, 100000, 1000000 };
+
+	g_ThreadPool.Initialize();
+
+	//same frustum setup as Renderer::CameraFrustumCulling
+	Matrix const view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -SCENE_SIZE * 0.5f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	Matrix const projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, SCENE_SIZE);
+	BoundingFrustum frustum(projection);
+	frustum.Transform(frustum, view.Invert());
+	CullingFrustum const culling_frustum = MakeCullingFrustum(frustum);
+
+	printf("%10s %10s %10s %14s %14s %14s %10s\n", "boxes", "visible", "reference", "intersects ms", "cull ms", "parallel ms", "speedup");
+	bool mismatch = false;
+	for (uint32 box_count : box_counts)
+	{
+		BoxSet const set = MakeBoxes(box_count, box_count);
+		CullingBoxes const boxes = set.GetCullingBoxes();
+		std::vector<uint64, AlignedAllocator<uint64, 64>> visibility((box_count + 63) / 64);
+		std::vector<uint8> reference(box_count);
+
+		float const intersects_ms = Measure(runs, [&]()
+			{
+				for (uint32 i = 0; i < box_count; ++i) reference[i] = frustum.Intersects(set.boxes[i]);
+			});
+		uint64 reference_visible = 0;
+		for (uint8 visible : reference) reference_visible += visible;
+
+		float const cull_ms = Measure(runs, [&]() { CullBoxes(culling_frustum, boxes, 0, box_count, visibility.data()); });
+		uint64 const visible = CountVisible(visibility);
+		std::vector<uint64> const serial_visibility(visibility.begin(), visibility.end());
+		float const parallel_ms = Measure(runs, [&]() { CullBoxesParallel(culling_frustum, boxes, visibility); });
+		if (!std::equal(visibility.begin(), visibility.end(), serial_visibility.begin()))
+		{
+			fprintf(stderr, "CullBoxesParallel disagrees with CullBoxes for %u boxes\n", box_count);
+			mismatch = true;
+		}
+
+		printf("%10u %10llu %10llu %14.3f %14.3f %14.3f %9.1fx\n", box_count, (unsigned long long)visible, (unsigned long long)reference_visible,
+			intersects_ms, cull_ms, parallel_ms, intersects_ms / std::max(parallel_ms, 1e-6f));
+	}
+	g_ThreadPool.Destroy();
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "entt/entity/registry.hpp"
+#include "Rendering/DrawKeyList.h"
+#include "Utilities/ThreadPool.h"
+#include "BenchmarkUtil.h"
+
+using namespace adria;
+
+//draw key sorting throughput. The radix sorted DrawKeyList is compared with std::stable_sort over the same keys and with reg.sort on a
+//component like the Batch the G-buffer pass used to sort by alpha mode every frame. Every run refills the keys from the same unsorted input
+namespace
+{
+	struct Batch
+	{
+		uint64 key;
+		uint32 proxy;
+		uint8 alpha_mode;
+	};
+
+	struct DrawInput
+	{
+		std::vector<uint64> keys;
+		std::vector<uint8> alpha_modes;
+	};
+
+	//mostly opaque draws with some masked and a few blended ones, like the sample scenes
+	DrawInput MakeDraws(uint32 count, uint32 seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<uint32> alpha_mode(0, 99);
+		std::uniform_real_distribution<float> view_distance(1.0f, 2000.0f);
+		std::uniform_int_distribution<uint32> material(0, 1023);
+		std::uniform_int_distribution<uint32> geometry_buffer(0, 4095);
+
+		DrawInput input;
+		input.keys.reserve(count);
+		input.alpha_modes.reserve(count);
+		for (uint32 i = 0; i < count; ++i)
+		{
+			uint32 const alpha = alpha_mode(rng);
+			uint8 const mode = alpha < 80 ? 0 : alpha < 95 ? 1 : 2;
+			uint32 const bucket = mode == 2 ? 3 : mode;
+			input.keys.push_back(MakeDrawKey(bucket, GfxPrimitiveTopology{}, view_distance(rng),
+				mode == 2 ? DrawKeyOrder::BackToFront : DrawKeyOrder::FrontToBack, material(rng), geometry_buffer(rng)));
+			input.alpha_modes.push_back(mode);
+		}
+		return input;
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: DrawSortBenchmark [-n <draw count>]... [-r <runs>]\n"
+			   "  -n  draw count to measure, can be repeated. 10k, 50k, 100k, 250k and 500k by default\n"
+			   "  -r  runs averaged per measurement, 20 by default\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32> draw_counts;
+	uint32 runs = 20;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) draw_counts.push_back((uint32)std::stoul(argv[++i]));
+		else if (arg == "-r" && i + 1 < argc) runs = std::max((uint32)std::stoul(argv[++i]), 1u);
+		else
+		{
+			PrintUsage();
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+	}
+	if (draw_counts.empty()) draw_counts = { 10000, 50000, 100000, 250000, 500000 };
+
+	g_ThreadPool.Initialize();
+	printf("%10s %16s %16s %16s %16s %10s\n", "draws", "reg.sort alpha", "reg.sort key", "stable_sort", "radix sort", "speedup");
+	bool mismatch = false;
+	for (uint32 draw_count : draw_counts)
+	{
+		DrawInput const input = MakeDraws(draw_count, draw_count);
+
+		entt::registry reg;
+		for (uint32 i = 0; i < draw_count; ++i) reg.emplace<Batch>(reg.create(), input.keys[i], i, input.alpha_modes[i]);
+		//the storage stays grouped between runs, like it did between frames
+		float const reg_alpha_ms = Measure(runs, [&]()
+			{
+				reg.sort<Batch>([](Batch const& a, Batch const& b) { return a.alpha_mode < b.alpha_mode; });
+			});
+		//keys are rotated between runs so the storage isn't already sorted by the previous run
+		uint32 rotation = 0;
+		float const reg_key_ms = Measure(runs, [&]()
+			{
+				rotation = (rotation + 7919) % draw_count;
+				for (auto&& [entity, batch] : reg.view<Batch>().each()) batch.key = input.keys[(batch.proxy + rotation) % draw_count];
+				reg.sort<Batch>([](Batch const& a, Batch const& b) { return a.key < b.key; });
+			});
+
+		std::vector<std::pair<uint64, uint32>> pairs(draw_count);
+		float const stable_sort_ms = Measure(runs, [&]()
+			{
+				for (uint32 i = 0; i < draw_count; ++i) pairs[i] = { input.keys[i], i };
+				std::stable_sort(pairs.begin(), pairs.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+			});
+
+		DrawKeyList draw_keys;
+		float const radix_sort_ms = Measure(runs, [&]()
+			{
+				draw_keys.Clear();
+				for (uint32 i = 0; i < draw_count; ++i) draw_keys.Add(input.keys[i], i);
+				draw_keys.Sort();
+			});
+
+		//both sorts are stable, so the proxies have to come out in the same order too
+		for (uint32 i = 0; i < draw_count; ++i)
+		{
+			if (draw_keys.GetKey(i) != pairs[i].first || draw_keys.GetProxy(i) != pairs[i].second)
+			{
+				fprintf(stderr, "Radix sort disagrees with std::stable_sort at draw %u of %u\n", i, draw_count);
+				mismatch = true;
+				break;
+			}
+		}
+
+		printf("%10u %13.3f ms %13.3f ms %13.3f ms %13.3f ms %9.1fx\n", draw_count, reg_alpha_ms, reg_key_ms, stable_sort_ms, radix_sort_ms,
+			reg_key_ms / std::max(radix_sort_ms, 1e-6f));
+	}
+	g_ThreadPool.Destroy();
+	return mismatch ? 1 : 0;
+}
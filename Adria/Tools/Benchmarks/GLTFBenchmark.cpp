@@ -0,0 +1,228 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <filesystem>
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#define TINYGLTF_NOEXCEPTION
+#include "tiny_gltf.h"
+#include "Rendering/GLBFile.h"
+#if defined(_WIN32)
+#include "Utilities/MappedFile.h"
+#endif
+#include "BenchmarkUtil.h"
+
+namespace fs = std::filesystem;
+using namespace adria;
+
+//load time and heap usage of the model read path of EntityLoader for binary and text glTF. A .glb is mapped once and its accessors
+//read from the mapping, a .gltf has its buffers loaded into tinygltf's vectors. Every index and position accessor is read once
+namespace
+{
+	std::atomic<uint64> heap_bytes = 0;
+	std::atomic<uint64> heap_peak_bytes = 0;
+
+	//heap allocations carry their size in front of them so the benchmark can track the current and peak heap usage
+	constexpr uint64 ALLOCATION_HEADER_SIZE = alignof(std::max_align_t);
+
+	void* TrackedAllocate(std::size_t size)
+	{
+		uint8* allocation = static_cast<uint8*>(std::malloc(size + ALLOCATION_HEADER_SIZE));
+		if (!allocation) throw std::bad_alloc();
+		*reinterpret_cast<uint64*>(allocation) = size;
+		uint64 const current = heap_bytes.fetch_add(size) + size;
+		uint64 peak = heap_peak_bytes.load();
+		while (current > peak && !heap_peak_bytes.compare_exchange_weak(peak, current));
+		return allocation + ALLOCATION_HEADER_SIZE;
+	}
+
+	void TrackedFree(void* ptr)
+	{
+		if (!ptr) return;
+		uint8* allocation = static_cast<uint8*>(ptr) - ALLOCATION_HEADER_SIZE;
+		heap_bytes.fetch_sub(*reinterpret_cast<uint64*>(allocation));
+		std::free(allocation);
+	}
+
+#if defined(_WIN32)
+	using ModelFile = MappedFile;
+#else
+	//MappedFile is Windows only, elsewhere the file is read into memory and counts towards the heap usage of the .glb path
+	class ModelFile
+	{
+	public:
+		bool Open(std::string const& path)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file) return false;
+			data.resize((uint64)file.tellg());
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(data.data()), data.size());
+			return (bool)file && !data.empty();
+		}
+		uint8 const* GetData() const { return data.data(); }
+		uint64 GetSize() const { return data.size(); }
+		std::span<uint8 const> GetSpan() const { return data; }
+
+	private:
+		std::vector<uint8> data;
+	};
+#endif
+
+	struct LoadedModel
+	{
+		ModelFile source_file;
+		tinygltf::Model model;
+		std::vector<std::span<uint8 const>> buffers;
+	};
+
+	//same steps as ReadModel_GLTF, tinygltf's copy of the glb binary chunk is dropped and replaced by the mapping
+	bool LoadModel(std::string const& model_path, LoadedModel& loaded_model)
+	{
+		tinygltf::TinyGLTF loader;
+		loader.SetImageLoader([](tinygltf::Image*, int, std::string*, std::string*, int, int, unsigned char const*, int, void*) { return true; }, nullptr);
+		tinygltf::Model& model = loaded_model.model;
+		std::string err, warn;
+
+		std::string base_path = fs::path(model_path).parent_path().generic_string();
+		if (!base_path.empty()) base_path += "/";
+
+		bool const is_binary = fs::path(model_path).extension() == ".glb";
+		GLBChunks glb_chunks{};
+		bool loaded = false;
+		if (is_binary)
+		{
+			loaded = loaded_model.source_file.Open(model_path) && ParseGLB(loaded_model.source_file.GetSpan(), glb_chunks) &&
+					 loader.LoadBinaryFromMemory(&model, &err, &warn, loaded_model.source_file.GetData(), (uint32)loaded_model.source_file.GetSize(), base_path);
+		}
+		else loaded = loader.LoadASCIIFromFile(&model, &err, &warn, model_path);
+		if (!loaded)
+		{
+			fprintf(stderr, "Failed to load %s %s\n", model_path.c_str(), err.c_str());
+			return false;
+		}
+
+		loaded_model.buffers.resize(model.buffers.size());
+		for (uint64 i = 0; i < model.buffers.size(); ++i)
+		{
+			tinygltf::Buffer& buffer = model.buffers[i];
+			if (is_binary && i == 0 && buffer.uri.empty())
+			{
+				loaded_model.buffers[i] = glb_chunks.bin.first(std::min<uint64>(glb_chunks.bin.size(), buffer.data.size()));
+				std::vector<unsigned char>().swap(buffer.data);
+			}
+			else loaded_model.buffers[i] = buffer.data;
+		}
+		return true;
+	}
+
+	uint64 ReadAccessor(LoadedModel const& loaded_model, int accessor_index)
+	{
+		if (accessor_index < 0) return 0;
+		tinygltf::Accessor const& accessor = loaded_model.model.accessors[accessor_index];
+		if (accessor.bufferView < 0) return 0;
+		tinygltf::BufferView const& buffer_view = loaded_model.model.bufferViews[accessor.bufferView];
+		std::span<uint8 const> buffer = loaded_model.buffers[buffer_view.buffer];
+
+		uint64 const element_size = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+		uint64 const stride = buffer_view.byteStride != 0 ? buffer_view.byteStride : element_size;
+		uint64 const offset = buffer_view.byteOffset + accessor.byteOffset;
+		if (accessor.count == 0 || offset + (accessor.count - 1) * stride + element_size > buffer.size()) return 0;
+
+		uint64 checksum = 0;
+		for (uint64 element = 0; element < accessor.count; ++element)
+		{
+			uint8 const* data = buffer.data() + offset + element * stride;
+			for (uint64 byte = 0; byte < element_size; ++byte) checksum += data[byte];
+		}
+		return checksum;
+	}
+
+	uint64 ReadAccessors(LoadedModel const& loaded_model)
+	{
+		uint64 checksum = 0;
+		for (tinygltf::Mesh const& mesh : loaded_model.model.meshes)
+		{
+			for (tinygltf::Primitive const& primitive : mesh.primitives)
+			{
+				checksum += ReadAccessor(loaded_model, primitive.indices);
+				if (auto position = primitive.attributes.find("POSITION"); position != primitive.attributes.end()) checksum += ReadAccessor(loaded_model, position->second);
+			}
+		}
+		return checksum;
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: GLTFBenchmark [-r <runs>] [<.gltf or .glb files>...]\n"
+			   "  -r  runs averaged per measurement, 20 by default\n"
+			   "  the text and binary DamagedHelmet sample models by default, run it from the engine's working directory\n");
+	}
+}
+
+void* operator new(std::size_t size) { return TrackedAllocate(size); }
+void* operator new[](std::size_t size) { return TrackedAllocate(size); }
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { TrackedFree(ptr); }
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> model_paths;
+	uint32 runs = 20;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-r" && i + 1 < argc) runs = std::max((uint32)std::stoul(argv[++i]), 1u);
+		else if (arg == "-h" || arg == "--help" || arg.starts_with("-"))
+		{
+			PrintUsage();
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+		else model_paths.push_back(arg);
+	}
+	if (model_paths.empty())
+	{
+		model_paths = { "Resources/Models/DamagedHelmet/glTF/DamagedHelmet.gltf", "Resources/Models/DamagedHelmet/glTF-Binary/DamagedHelmet.glb" };
+	}
+
+	printf("%-48s %10s %14s %14s %14s\n", "model", "load ms", "peak heap KB", "model heap KB", "file KB");
+	bool failed = false;
+	for (std::string const& model_path : model_paths)
+	{
+		uint64 const baseline_bytes = heap_bytes.load();
+		heap_peak_bytes = baseline_bytes;
+		uint64 model_bytes = 0, file_bytes = 0, checksum = 0;
+		{
+			LoadedModel loaded_model;
+			if (!LoadModel(model_path, loaded_model))
+			{
+				failed = true;
+				continue;
+			}
+			checksum = ReadAccessors(loaded_model);
+			model_bytes = heap_bytes.load() - baseline_bytes;
+			file_bytes = fs::file_size(model_path);
+			for (tinygltf::Buffer const& buffer : loaded_model.model.buffers)
+			{
+				if (!buffer.uri.empty() && buffer.uri.rfind("data:", 0) != 0) file_bytes += fs::file_size(fs::path(model_path).parent_path() / buffer.uri);
+			}
+		}
+		uint64 const peak_bytes = heap_peak_bytes.load() - baseline_bytes;
+
+		float const load_ms = Measure(runs, [&]()
+			{
+				LoadedModel loaded_model;
+				if (!LoadModel(model_path, loaded_model) || ReadAccessors(loaded_model) != checksum) failed = true;
+			});
+		printf("%-48s %10.3f %14llu %14llu %14llu\n", fs::path(model_path).filename().string().c_str(), load_ms,
+			(unsigned long long)(peak_bytes / 1024), (unsigned long long)(model_bytes / 1024), (unsigned long long)(file_bytes / 1024));
+	}
+	return failed ? 1 : 0;
+}
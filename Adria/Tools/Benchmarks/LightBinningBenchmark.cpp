@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <random>
+#include "Rendering/ClusteredLightBinning.h"
+#include "Rendering/Components.h"
+#include "Utilities/ThreadPool.h"
+#include "BenchmarkUtil.h"
+
+using namespace adria;
+using namespace DirectX;
+
+//CPU clustered light binning of point and spot lights scattered around the camera at 1080p, a tenth of them are spot lights.
+//a quarter of the lights are behind the camera so the frustum culling in front of the binning is measured too
+namespace
+{
+	constexpr float SCENE_SIZE = 400.0f;
+	constexpr float CAMERA_NEAR = 0.1f;
+	constexpr float CAMERA_FAR = 500.0f;
+	constexpr uint32 WIDTH = 1920;
+	constexpr uint32 HEIGHT = 1080;
+
+	void AddLights(entt::registry& reg, uint32 count, uint32 seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-SCENE_SIZE * 0.5f, SCENE_SIZE * 0.5f);
+		std::uniform_real_distribution<float> depth(-SCENE_SIZE * 0.25f, SCENE_SIZE * 0.75f);
+		std::uniform_real_distribution<float> range(5.0f, 30.0f);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> cone_cosine(0.5f, 0.95f);
+		std::uniform_int_distribution<uint32> type(0, 9);
+
+		for (uint32 i = 0; i < count; ++i)
+		{
+			Light light{};
+			light.type = type(rng) == 0 ? LightType::Spot : LightType::Point;
+			light.position = Vector4(position(rng), position(rng), depth(rng), 1.0f);
+			Vector3 light_direction(direction(rng), direction(rng), direction(rng));
+			light_direction.Normalize();
+			light.direction = Vector4(light_direction.x, light_direction.y, light_direction.z, 0.0f);
+			light.range = range(rng);
+			light.outer_cosine = cone_cosine(rng);
+			light.light_index = i;
+			reg.emplace<Light>(reg.create(), light);
+		}
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: LightBinningBenchmark [-n <light count>]... [-r <runs>]\n"
+			   "  -n  light count to measure, can be repeated. 1k, 4k, 16k and 64k by default\n"
+			   "  -r  runs averaged per measurement, 20 by default\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<uint32> light_counts;
+	uint32 runs = 20;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) light_counts.push_back((uint32)std::stoul(argv[++i]));
+		else if (arg == "-r" && i + 1 < argc) runs = std::max((uint32)std::stoul(argv[++i]), 1u);
+		else
+		{
+			PrintUsage();
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+	}
+	if (light_counts.empty()) light_counts = { 1000, 4000, 16000, 64000 };
+
+	g_ThreadPool.Initialize();
+
+	Matrix const view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	Matrix const projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, float(WIDTH) / HEIGHT, CAMERA_NEAR, CAMERA_FAR);
+
+	printf("%10s %10s %14s %18s %12s %10s\n", "lights", "visible", "light indices", "max cluster lights", "ms", "us/light");
+	for (uint32 light_count : light_counts)
+	{
+		entt::registry reg;
+		AddLights(reg, light_count, light_count);
+
+		ClusteredLightBinning light_binning;
+		float const bin_ms = Measure(runs, [&]() { light_binning.Bin(reg, view, projection, CAMERA_NEAR, CAMERA_FAR, WIDTH, HEIGHT); });
+		ClusteredLightBinningStats const& stats = light_binning.GetStats();
+		printf("%10u %10u %14u %18u %12.3f %10.3f\n", stats.light_count, stats.visible_light_count, stats.light_index_count, stats.max_cluster_lights,
+			bin_ms, bin_ms * 1000.0f / light_count);
+	}
+	g_ThreadPool.Destroy();
+	return 0;
+}
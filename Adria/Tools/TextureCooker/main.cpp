@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#define TINYGLTF_NOEXCEPTION
+#include "tiny_gltf.h"
+#include "Utilities/TextureCooker.h"
+#include "Utilities/ThreadPool.h"
+#include "Rendering/GLBFile.h"
+
+namespace fs = std::filesystem;
+using namespace adria;
+
+//offline texture cooker, writes the same DDS files the engine looks up in Saved/TextureCache when r.TextureCache is enabled.
+//run it from the engine's working directory or pass the cache directory with -o
+namespace
+{
+	struct CookJob
+	{
+		std::string source_path;	//the path the engine loads the texture with
+		std::string file_path;
+		uint64 offset = 0;
+		uint64 size = 0;			//0 for the whole file
+		TextureCookParameters params;
+	};
+
+	bool ReadFile(std::string const& path, uint64 offset, uint64 size, std::vector<uint8>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+		uint64 const file_size = (uint64)file.tellg();
+		if (size == 0) size = file_size - std::min(offset, file_size);
+		if (offset > file_size || size > file_size - offset) return false;
+		data.resize(size);
+		file.seekg(offset);
+		file.read(reinterpret_cast<char*>(data.data()), size);
+		return (bool)file;
+	}
+
+	//same path as MakeEmbeddedTexturePath in the engine
+	std::string MakeEmbeddedTexturePath(std::string const& container_path, uint64 offset, uint64 size)
+	{
+		char range[64];
+		snprintf(range, sizeof(range), "#%llu,%llu", (unsigned long long)offset, (unsigned long long)size);
+		return container_path + range;
+	}
+
+	//material textures of a glTF model with the usage of their material slot, the paths match the ones the engine imports them with
+	bool AddModelJobs(std::string const& model_path, bool fast, std::vector<CookJob>& jobs)
+	{
+		tinygltf::TinyGLTF loader;
+		loader.SetImageLoader([](tinygltf::Image*, int, std::string*, std::string*, int, int, unsigned char const*, int, void*) { return true; }, nullptr);
+		tinygltf::Model model;
+		std::string err, warn;
+
+		std::string base_path = fs::path(model_path).parent_path().generic_string();
+		if (!base_path.empty()) base_path += "/";
+
+		std::vector<uint8> file_data;
+		GLBChunks glb_chunks{};
+		bool const is_binary = fs::path(model_path).extension() == ".glb";
+		bool loaded = false;
+		if (is_binary)
+		{
+			loaded = ReadFile(model_path, 0, 0, file_data) && ParseGLB(file_data, glb_chunks) &&
+					 loader.LoadBinaryFromMemory(&model, &err, &warn, file_data.data(), (uint32)file_data.size(), base_path);
+		}
+		else loaded = loader.LoadASCIIFromFile(&model, &err, &warn, model_path);
+		if (!loaded)
+		{
+			fprintf(stderr, "Failed to load %s %s\n", model_path.c_str(), err.c_str());
+			return false;
+		}
+
+		auto AddJob = [&](int texture_index, TextureUsage usage)
+		{
+			if (texture_index < 0 || model.textures[texture_index].source < 0) return;
+			tinygltf::Image const& image = model.images[model.textures[texture_index].source];
+
+			CookJob job{ .source_path = {}, .file_path = {}, .offset = 0, .size = 0, .params = { .usage = usage, .fast = fast } };
+			if (image.bufferView >= 0)
+			{
+				tinygltf::BufferView const& buffer_view = model.bufferViews[image.bufferView];
+				tinygltf::Buffer const& buffer = model.buffers[buffer_view.buffer];
+				if (is_binary && buffer_view.buffer == 0 && buffer.uri.empty())
+				{
+					job.file_path = model_path;
+					job.offset = (glb_chunks.bin.data() - file_data.data()) + buffer_view.byteOffset;
+				}
+				else if (!buffer.uri.empty() && buffer.uri.rfind("data:", 0) != 0)
+				{
+					job.file_path = base_path + buffer.uri;
+					job.offset = buffer_view.byteOffset;
+				}
+				else return;
+				job.size = buffer_view.byteLength;
+				job.source_path = MakeEmbeddedTexturePath(job.file_path, job.offset, job.size);
+			}
+			else if (!image.uri.empty() && image.uri.rfind("data:", 0) != 0)
+			{
+				job.file_path = base_path + image.uri;
+				job.source_path = job.file_path;
+			}
+			else return;
+			jobs.push_back(std::move(job));
+		};
+		for (tinygltf::Material const& material : model.materials)
+		{
+			AddJob(material.pbrMetallicRoughness.baseColorTexture.index, TextureUsage::Albedo);
+			AddJob(material.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureUsage::MetallicRoughness);
+			AddJob(material.normalTexture.index, TextureUsage::Normal);
+			AddJob(material.emissiveTexture.index, TextureUsage::Emissive);
+		}
+		return true;
+	}
+
+	void PrintUsage()
+	{
+		printf("usage: TextureCooker [-o <cache dir>] [--fast] [--force] [-u <usage>] <image or .gltf/.glb files>...\n"
+			   "  -o       output directory, Saved/TextureCache/ by default\n"
+			   "  -u       usage of the image files that follow: albedo, normal, metallic_roughness, emissive or mask\n"
+			   "  --fast   BC1/BC3 instead of BC7\n"
+			   "  --force  cook textures that are already in the cache\n"
+			   "  material textures of glTF models are cooked with the usage of their material slot\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string cache_dir = "Saved/TextureCache/";
+	TextureCookParameters params{};
+	bool force = false;
+	std::vector<CookJob> jobs;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string const arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+		{
+			cache_dir = argv[++i];
+			if (!cache_dir.empty() && cache_dir.back() != '/') cache_dir += '/';
+		}
+		else if (arg == "-u" && i + 1 < argc)
+		{
+			std::string const usage = argv[++i];
+			uint32 u = 0;
+			while (u < (uint32)TextureUsage::Count && usage != TextureUsageToString((TextureUsage)u)) ++u;
+			if (u == (uint32)TextureUsage::Count)
+			{
+				fprintf(stderr, "Unknown usage %s\n", usage.c_str());
+				return 1;
+			}
+			params.usage = (TextureUsage)u;
+		}
+		else if (arg == "--fast") params.fast = true;
+		else if (arg == "--force") force = true;
+		else if (arg == "-h" || arg == "--help")
+		{
+			PrintUsage();
+			return 0;
+		}
+		else
+		{
+			std::string const extension = fs::path(arg).extension().string();
+			if (extension == ".gltf" || extension == ".glb")
+			{
+				if (!AddModelJobs(arg, params.fast, jobs)) return 1;
+			}
+			else jobs.push_back(CookJob{ .source_path = arg, .file_path = arg, .params = params });
+		}
+	}
+	if (jobs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	g_ThreadPool.Initialize();
+	uint32 cooked = 0, cached = 0, failed = 0;
+	std::vector<std::string> done_paths;
+	std::vector<uint8> source;
+	for (CookJob const& job : jobs)
+	{
+		if (!ReadFile(job.file_path, job.offset, job.size, source))
+		{
+			fprintf(stderr, "Failed to read %s\n", job.source_path.c_str());
+			++failed;
+			continue;
+		}
+		uint64 const key = ComputeCookedTextureKey(source, job.params);
+		std::string const cooked_path = GetCookedTexturePath(cache_dir, job.source_path, job.params, key);
+		if (std::find(done_paths.begin(), done_paths.end(), cooked_path) != done_paths.end()) continue;
+		done_paths.push_back(cooked_path);
+
+		if (!force && fs::exists(cooked_path))
+		{
+			++cached;
+			continue;
+		}
+		if (CookTexture(source, job.params, cooked_path))
+		{
+			printf("%s (%s) -> %s\n", job.source_path.c_str(), TextureUsageToString(job.params.usage), cooked_path.c_str());
+			++cooked;
+		}
+		else
+		{
+			fprintf(stderr, "Failed to cook %s\n", job.source_path.c_str());
+			++failed;
+		}
+	}
+	g_ThreadPool.Destroy();
+	printf("%u cooked, %u up to date, %u failed\n", cooked, cached, failed);
+	return failed == 0 ? 0 : 1;
+}
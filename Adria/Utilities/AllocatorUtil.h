@@ -1,4 +1,5 @@
 #pragma once
+#include <new>
 
 namespace adria
 {
@@ -26,4 +27,29 @@ namespace adria
 		void lock() {}
 		void unlock() {}
 	};
+
+	//std allocator whose allocations start at a multiple of Alignment, e.g. a cache line for data written by several threads
+	template<typename T, uint64 Alignment>
+	struct AlignedAllocator
+	{
+		using value_type = T;
+		template<typename U>
+		struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+		AlignedAllocator() = default;
+		template<typename U>
+		AlignedAllocator(AlignedAllocator<U, Alignment> const&) {}
+
+		T* allocate(uint64 count)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{ Alignment }));
+		}
+		void deallocate(T* ptr, uint64)
+		{
+			::operator delete(ptr, std::align_val_t{ Alignment });
+		}
+
+		template<typename U>
+		bool operator==(AlignedAllocator<U, Alignment> const&) const { return true; }
+	};
 }
\ No newline at end of file
@@ -77,6 +77,12 @@ namespace adria
 		ADRIA_ASSERT(result);
 	}
 
+	Image::Image(std::span<uint8 const> file_data, uint32 first_mip, uint32 max_size)
+	{
+		bool result = file_data.size() >= 4 && memcmp(file_data.data(), "DDS ", 4) == 0 ? LoadDDS(file_data, first_mip, max_size) : LoadSTB(file_data);
+		ADRIA_ASSERT(result);
+	}
+
 	uint64 Image::SetData(uint32 _width, uint32 _height, uint32 _depth, uint32 _mip_levels, void const* _data)
 	{
 		width = std::max(_width, 1u);
@@ -99,11 +105,17 @@ namespace adria
 			return false;
 
 		fseek(file, 0, SEEK_END);
-		std::vector<char> data((uint64)ftell(file));
+		std::vector<uint8> data((uint64)ftell(file));
 		fseek(file, 0, SEEK_SET);
 		fread(data.data(), data.size(), 1, file);
+		fclose(file);
+
+		return LoadDDS(data);
+	}
 
-		char* bytes = data.data();
+	bool Image::LoadDDS(std::span<uint8 const> file_data, uint32 _first_mip, uint32 max_size)
+	{
+		uint8 const* bytes = file_data.data();
 #pragma pack(push,1)
 		struct PixelFormatHeader
 		{
@@ -163,10 +175,10 @@ namespace adria
 		auto MakeFourCC = [](uint32 a, uint32 b, uint32 c, uint32 d) { return a | (b << 8u) | (c << 16u) | (d << 24u); };
 
 		constexpr const char magic[] = "DDS ";
-		if (memcmp(magic, bytes, 4) != 0) return false;
+		if (file_data.size() < 4 + sizeof(FileHeader) || memcmp(magic, bytes, 4) != 0) return false;
 		bytes += 4;
 
-		const FileHeader* dds_header = (FileHeader*)bytes;
+		const FileHeader* dds_header = (FileHeader const*)bytes;
 		bytes += sizeof(FileHeader);
 
 		if (dds_header->dwSize == sizeof(FileHeader) &&
@@ -181,7 +193,7 @@ namespace adria
 
 			if (has_dxgi)
 			{
-				pDx10Header = (DX10FileHeader*)bytes;
+				pDx10Header = (DX10FileHeader const*)bytes;
 				bytes += sizeof(DX10FileHeader);
 
 				auto ConvertDX10Format = [](DXGI_FORMAT format, GfxFormat& outFormat, bool& outSRGB)
@@ -191,12 +203,15 @@ namespace adria
 					if (format == DXGI_FORMAT_BC2_UNORM) { outFormat = GfxFormat::BC2_UNORM;			 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_BC2_UNORM_SRGB) { outFormat = GfxFormat::BC2_UNORM;		 outSRGB = true;	return; }
 					if (format == DXGI_FORMAT_BC3_UNORM) { outFormat = GfxFormat::BC3_UNORM;			 outSRGB = false;	return; }
+					if (format == DXGI_FORMAT_BC3_UNORM_SRGB) { outFormat = GfxFormat::BC3_UNORM;		 outSRGB = true;	return; }
 					if (format == DXGI_FORMAT_BC4_UNORM) { outFormat = GfxFormat::BC4_UNORM;			 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_BC5_UNORM) { outFormat = GfxFormat::BC5_UNORM;			 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_BC6H_UF16) { outFormat = GfxFormat::BC6H_UF16;			 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_BC7_UNORM) { outFormat = GfxFormat::BC7_UNORM;			 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_BC7_UNORM_SRGB) { outFormat = GfxFormat::BC7_UNORM;		 outSRGB = true;	return; }
 					if (format == DXGI_FORMAT_R32G32B32A32_FLOAT) { outFormat = GfxFormat::R32G32B32A32_FLOAT; outSRGB = false;	return; }
+					if (format == DXGI_FORMAT_R8G8B8A8_UNORM) { outFormat = GfxFormat::R8G8B8A8_UNORM;	 outSRGB = false;	return; }
+					if (format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB) { outFormat = GfxFormat::R8G8B8A8_UNORM; outSRGB = true;	return; }
 					if (format == DXGI_FORMAT_R32G32_FLOAT) { outFormat = GfxFormat::R32G32_FLOAT;		 outSRGB = false;	return; }
 					if (format == DXGI_FORMAT_R9G9B9E5_SHAREDEXP) { outFormat = GfxFormat::R9G9B9E5_SHAREDEXP;	outSRGB = false;	return; }
 				};
@@ -245,10 +260,31 @@ namespace adria
 				image_chain_count = pDx10Header->arraySize;
 			}
 
+			source_width = dds_header->dwWidth;
+			source_height = dds_header->dwHeight;
+			//only single 2D images skip mips, the skipped ones precede the kept ones in the file
+			uint32 const file_mip_levels = std::max(dds_header->dwMipMapCount, 1u);
+			if (image_chain_count == 1 && dds_header->dwDepth <= 1)
+			{
+				//D3D12 requires the top mip of a block compressed texture to be a whole number of blocks
+				uint32 const block_size = GetGfxFormatBlockSize(format);
+				auto IsWholeBlocks = [&](uint32 mip) { return std::max(dds_header->dwWidth >> mip, 1u) % block_size == 0 && std::max(dds_header->dwHeight >> mip, 1u) % block_size == 0; };
+
+				first_mip = std::min(_first_mip, file_mip_levels - 1);
+				while (first_mip > 0 && !IsWholeBlocks(first_mip)) --first_mip;
+				for (uint32 mip = first_mip + 1; mip < file_mip_levels && std::max(dds_header->dwWidth >> first_mip, dds_header->dwHeight >> first_mip) > max_size; ++mip)
+				{
+					if (IsWholeBlocks(mip)) first_mip = mip;
+				}
+				for (uint32 mip = 0; mip < first_mip; ++mip) bytes += GetTextureMipByteSize(format, dds_header->dwWidth, dds_header->dwHeight, 1, mip);
+			}
+			if (bytes + GetTextureByteSize(format, std::max(dds_header->dwWidth >> first_mip, 1u), std::max(dds_header->dwHeight >> first_mip, 1u),
+				std::max(dds_header->dwDepth, 1u), file_mip_levels - first_mip) * image_chain_count > file_data.data() + file_data.size()) return false;
+
 			Image* current_image = this;
 			for (uint32 image_idx = 0; image_idx < image_chain_count; ++image_idx)
 			{
-				uint64 offset = current_image->SetData(dds_header->dwWidth, dds_header->dwHeight, dds_header->dwDepth, dds_header->dwMipMapCount, bytes);
+				uint64 offset = current_image->SetData(dds_header->dwWidth >> first_mip, dds_header->dwHeight >> first_mip, dds_header->dwDepth, file_mip_levels - first_mip, bytes);
 				bytes += offset;
 				if (image_idx < image_chain_count - 1)
 				{
@@ -296,4 +332,41 @@ namespace adria
 			return true;
 		}
 	}
+
+	bool Image::LoadSTB(std::span<uint8 const> file_data)
+	{
+		int32 components = 0;
+		int32 const data_size = (int32)file_data.size();
+		is_hdr = stbi_is_hdr_from_memory(file_data.data(), data_size);
+		if (is_hdr)
+		{
+			int32 _width, _height;
+			float* _pixels = stbi_loadf_from_memory(file_data.data(), data_size, &_width, &_height, &components, 4);
+			if (_pixels == nullptr) return false;
+			width = (uint32)_width;
+			height = (uint32)_height;
+			depth = 1;
+			mip_levels = 1;
+			format = GfxFormat::R32G32B32A32_FLOAT;
+			pixels.resize(width * height * 4 * sizeof(float));
+			memcpy(pixels.data(), _pixels, pixels.size());
+			stbi_image_free(_pixels);
+			return true;
+		}
+		else
+		{
+			int _width, _height;
+			stbi_uc* _pixels = stbi_load_from_memory(file_data.data(), data_size, &_width, &_height, &components, 4);
+			if (_pixels == nullptr) return false;
+			width = (uint32)_width;
+			height = (uint32)_height;
+			depth = 1;
+			mip_levels = 1;
+			format = GfxFormat::R8G8B8A8_UNORM;
+			pixels.resize(width * height * 4);
+			memcpy(pixels.data(), _pixels, pixels.size());
+			stbi_image_free(_pixels);
+			return true;
+		}
+	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <string_view>
+#include <span>
 #include <memory>
 #include "Graphics/GfxFormat.h"
 
@@ -10,6 +11,10 @@ namespace adria
 	public:
 		explicit Image(GfxFormat format) : format(format) {}
 		explicit Image(std::string_view file_path);
+		//encoded file contents, DDS or any format stb_image reads.
+		//2D DDS files skip the mips above first_mip and the ones larger than max_size, the last mip is always kept.
+		//block compressed files only start at mips that are a whole number of blocks, which can be a larger one
+		explicit Image(std::span<uint8 const> file_data, uint32 first_mip = 0, uint32 max_size = UINT32_MAX);
 
 		uint32 Width() const
 		{
@@ -27,6 +32,20 @@ namespace adria
 		{
 			return mip_levels;
 		}
+		//mip of the source file that mip 0 of the image is
+		uint32 FirstMip() const
+		{
+			return first_mip;
+		}
+		//mip 0 dimensions of the source file, differ from the ones of the image when it skips mips
+		uint32 SourceWidth() const
+		{
+			return source_width;
+		}
+		uint32 SourceHeight() const
+		{
+			return source_height;
+		}
 		GfxFormat Format() const { return format; }
 		bool IsHDR() const { return is_hdr; }
 		bool IsCubemap() const { return is_cubemap; }
@@ -43,6 +62,9 @@ namespace adria
 		uint32 height = 0;
 		uint32 depth = 0;
 		uint32 mip_levels = 0;
+		uint32 first_mip = 0;
+		uint32 source_width = 0;
+		uint32 source_height = 0;
 		std::vector<uint8> pixels;
 		bool is_hdr = false;
 		bool is_cubemap = false;
@@ -54,7 +76,9 @@ namespace adria
 		uint64 SetData(uint32 width, uint32 height, uint32 depth, uint32 mip_levels, void const* data);
 
 		bool LoadDDS(std::string_view texture_path);
+		bool LoadDDS(std::span<uint8 const> file_data, uint32 first_mip = 0, uint32 max_size = UINT32_MAX);
 		bool LoadSTB(std::string_view texture_path);
+		bool LoadSTB(std::span<uint8 const> file_data);
 	};
 
 	template<typename T>
@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+
+namespace adria
+{
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: file(std::exchange(other.file, INVALID_HANDLE_VALUE)), mapping(std::exchange(other.mapping, nullptr)),
+		  data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+			mapping = std::exchange(other.mapping, nullptr);
+			data = std::exchange(other.data, nullptr);
+			size = std::exchange(other.size, 0);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(std::string_view path)
+	{
+		Close();
+		std::string file_path(path);
+		file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			Close();
+			return false;
+		}
+		data = static_cast<uint8 const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!data)
+		{
+			Close();
+			return false;
+		}
+		size = (uint64)file_size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+		mapping = nullptr;
+		data = nullptr;
+		size = 0;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <span>
+
+namespace adria
+{
+	//read only view of a whole file, the pages are loaded by the OS on first access
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		ADRIA_NONCOPYABLE(MappedFile)
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		bool Open(std::string_view path);
+		void Close();
+
+		bool IsOpen() const { return data != nullptr; }
+		uint8 const* GetData() const { return data; }
+		uint64 GetSize() const { return size; }
+		std::span<uint8 const> GetSpan() const { return std::span<uint8 const>(data, size); }
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		uint8 const* data = nullptr;
+		uint64 size = 0;
+	};
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <bit>
+#include "AllocatorUtil.h"
+
+namespace adria
+{
+	struct QuadTreeRect
+	{
+		uint32 x;
+		uint32 y;
+		uint32 size;
+	};
+
+	struct QuadTreeAllocatorStats
+	{
+		uint64 allocated_area;
+		uint64 free_area;
+		uint64 largest_free_area;
+		uint32 allocation_count;
+		float  fragmentation;
+	};
+
+	//Allocates square power of two tiles from a square power of two atlas. Existing tiles never move.
+	class QuadTreeAllocator
+	{
+		enum class NodeState : uint8
+		{
+			Free,
+			Split,
+			Allocated
+		};
+
+	public:
+		static constexpr uint32 INVALID_NODE = uint32(-1);
+
+		QuadTreeAllocator(uint32 atlas_size, uint32 min_tile_size) : atlas_size(atlas_size), min_tile_size(min_tile_size)
+		{
+			ADRIA_ASSERT(std::has_single_bit(atlas_size) && std::has_single_bit(min_tile_size) && min_tile_size <= atlas_size);
+			level_count = std::countr_zero(atlas_size / min_tile_size) + 1;
+			uint64 node_count = 0;
+			for (uint32 level = 0; level < level_count; ++level) node_count += 1ull << (2 * level);
+			nodes.resize(node_count, NodeState::Free);
+		}
+		ADRIA_DEFAULT_COPYABLE_MOVABLE(QuadTreeAllocator)
+		~QuadTreeAllocator() = default;
+
+		uint32 Allocate(uint32 tile_size)
+		{
+			tile_size = std::clamp(std::bit_ceil(tile_size), min_tile_size, atlas_size);
+			uint32 const level = std::countr_zero(atlas_size / tile_size);
+			//prefer space inside already split nodes before splitting free ones
+			uint32 node = AllocateNode(0, 0, level, false);
+			if (node == INVALID_NODE) node = AllocateNode(0, 0, level, true);
+			if (node != INVALID_NODE)
+			{
+				allocated_area += uint64(tile_size) * tile_size;
+				++allocation_count;
+			}
+			return node;
+		}
+
+		void Free(uint32 node)
+		{
+			ADRIA_ASSERT(node < nodes.size() && nodes[node] == NodeState::Allocated);
+			uint32 const tile_size = GetRect(node).size;
+			allocated_area -= uint64(tile_size) * tile_size;
+			--allocation_count;
+
+			nodes[node] = NodeState::Free;
+			while (node != 0)
+			{
+				uint32 const parent = (node - 1) / 4;
+				uint32 const first_child = 4 * parent + 1;
+				for (uint32 i = 0; i < 4; ++i) if (nodes[first_child + i] != NodeState::Free) return;
+				nodes[parent] = NodeState::Free;
+				node = parent;
+			}
+		}
+
+		void Clear()
+		{
+			std::fill(nodes.begin(), nodes.end(), NodeState::Free);
+			allocated_area = 0;
+			allocation_count = 0;
+		}
+
+		QuadTreeRect GetRect(uint32 node) const
+		{
+			uint32 path[32];
+			uint32 depth = 0;
+			while (node != 0)
+			{
+				path[depth++] = (node - 1) % 4;
+				node = (node - 1) / 4;
+			}
+
+			QuadTreeRect rect{ 0, 0, atlas_size };
+			while (depth > 0)
+			{
+				uint32 const child = path[--depth];
+				rect.size /= 2;
+				rect.x += (child & 1) * rect.size;
+				rect.y += (child >> 1) * rect.size;
+			}
+			return rect;
+		}
+
+		QuadTreeAllocatorStats GetStats() const
+		{
+			QuadTreeAllocatorStats stats{};
+			stats.allocated_area = allocated_area;
+			stats.free_area = uint64(atlas_size) * atlas_size - allocated_area;
+			stats.largest_free_area = LargestFreeArea(0, atlas_size);
+			stats.allocation_count = allocation_count;
+			stats.fragmentation = stats.free_area > 0 ? 1.0f - float(stats.largest_free_area) / stats.free_area : 0.0f;
+			return stats;
+		}
+
+		uint32 GetAtlasSize() const { return atlas_size; }
+		uint32 GetMinTileSize() const { return min_tile_size; }
+
+	private:
+		uint32 atlas_size;
+		uint32 min_tile_size;
+		uint32 level_count;
+		std::vector<NodeState> nodes;
+		uint64 allocated_area = 0;
+		uint32 allocation_count = 0;
+
+	private:
+		uint32 AllocateNode(uint32 node, uint32 level, uint32 target_level, bool allow_split)
+		{
+			NodeState& state = nodes[node];
+			if (state == NodeState::Allocated) return INVALID_NODE;
+			if (level == target_level)
+			{
+				if (state != NodeState::Free) return INVALID_NODE;
+				state = NodeState::Allocated;
+				return node;
+			}
+			if (state == NodeState::Free)
+			{
+				if (!allow_split) return INVALID_NODE;
+				state = NodeState::Split;
+			}
+
+			uint32 const first_child = 4 * node + 1;
+			for (uint32 i = 0; i < 4; ++i)
+			{
+				uint32 const allocated = AllocateNode(first_child + i, level + 1, target_level, allow_split);
+				if (allocated != INVALID_NODE) return allocated;
+			}
+			return INVALID_NODE;
+		}
+
+		uint64 LargestFreeArea(uint32 node, uint32 size) const
+		{
+			switch (nodes[node])
+			{
+			case NodeState::Free: return uint64(size) * size;
+			case NodeState::Allocated: return 0;
+			}
+			uint64 largest = 0;
+			uint32 const first_child = 4 * node + 1;
+			for (uint32 i = 0; i < 4; ++i) largest = std::max(largest, LargestFreeArea(first_child + i, size / 2));
+			return largest;
+		}
+	};
+}
@@ -0,0 +1,89 @@
+#include "RadixSort.h"
+#include "ThreadPool.h"
+
+namespace adria
+{
+	namespace
+	{
+		constexpr uint32 RADIX_BITS = 8;
+		constexpr uint32 RADIX_SIZE = 1 << RADIX_BITS;
+		constexpr uint32 RADIX_PASSES = 64 / RADIX_BITS;
+		constexpr uint32 RADIX_PARALLEL_THRESHOLD = 1 << 15;
+		constexpr uint32 RADIX_MIN_CHUNK_SIZE = 1 << 14;
+
+		using RadixHistogram = std::array<uint32, RADIX_SIZE>;
+	}
+
+	void RadixSort(std::span<uint64> keys, std::span<uint32> values, std::span<uint64> scratch_keys, std::span<uint32> scratch_values)
+	{
+		ADRIA_ASSERT(keys.size() == values.size());
+		ADRIA_ASSERT(scratch_keys.size() >= keys.size() && scratch_values.size() >= values.size());
+		uint32 const count = (uint32)keys.size();
+		if (count <= 1) return;
+
+		uint64 differing_bits = 0;
+		for (uint64 key : keys) differing_bits |= key ^ keys[0];
+		if (differing_bits == 0) return;
+
+		uint32 chunk_count = 1;
+		if (count >= RADIX_PARALLEL_THRESHOLD)
+		{
+			uint32 const max_chunks = std::max(std::thread::hardware_concurrency(), 1u);
+			chunk_count = std::clamp(count / RADIX_MIN_CHUNK_SIZE, 1u, max_chunks);
+		}
+		uint32 const chunk_size = (count + chunk_count - 1) / chunk_count;
+		std::vector<RadixHistogram> histograms(chunk_count);
+
+		uint64* src_keys = keys.data();
+		uint32* src_values = values.data();
+		uint64* dst_keys = scratch_keys.data();
+		uint32* dst_values = scratch_values.data();
+		for (uint32 pass = 0; pass < RADIX_PASSES; ++pass)
+		{
+			uint32 const shift = pass * RADIX_BITS;
+			if (((differing_bits >> shift) & (RADIX_SIZE - 1)) == 0) continue;
+
+			ParallelFor(chunk_count, [&](uint64 chunk_index)
+				{
+					uint32 const chunk = (uint32)chunk_index;
+					RadixHistogram& histogram = histograms[chunk];
+					histogram.fill(0);
+					uint32 const end = std::min(count, (chunk + 1) * chunk_size);
+					for (uint32 i = chunk * chunk_size; i < end; ++i) ++histogram[(src_keys[i] >> shift) & (RADIX_SIZE - 1)];
+				});
+
+			//exclusive prefix sum ordered by digit first and chunk second keeps the sort stable
+			uint32 offset = 0;
+			for (uint32 digit = 0; digit < RADIX_SIZE; ++digit)
+			{
+				for (uint32 chunk = 0; chunk < chunk_count; ++chunk)
+				{
+					uint32 const digit_count = histograms[chunk][digit];
+					histograms[chunk][digit] = offset;
+					offset += digit_count;
+				}
+			}
+
+			ParallelFor(chunk_count, [&](uint64 chunk_index)
+				{
+					uint32 const chunk = (uint32)chunk_index;
+					RadixHistogram& offsets = histograms[chunk];
+					uint32 const end = std::min(count, (chunk + 1) * chunk_size);
+					for (uint32 i = chunk * chunk_size; i < end; ++i)
+					{
+						uint32 const destination = offsets[(src_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+						dst_keys[destination] = src_keys[i];
+						dst_values[destination] = src_values[i];
+					}
+				});
+			std::swap(src_keys, dst_keys);
+			std::swap(src_values, dst_values);
+		}
+
+		if (src_keys != keys.data())
+		{
+			std::copy_n(src_keys, count, keys.data());
+			std::copy_n(src_values, count, values.data());
+		}
+	}
+}
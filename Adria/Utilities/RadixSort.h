@@ -0,0 +1,9 @@
+#pragma once
+#include <span>
+
+namespace adria
+{
+	//stable LSD radix sort of 64 bit keys with 32 bit payloads, 8 bits per pass. Passes over bytes that are equal in all keys are skipped.
+	//large inputs are histogrammed and scattered on the thread pool. Scratch spans need at least as many elements as the keys.
+	void RadixSort(std::span<uint64> keys, std::span<uint32> values, std::span<uint64> scratch_keys, std::span<uint32> scratch_values);
+}
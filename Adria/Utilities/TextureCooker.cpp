@@ -0,0 +1,845 @@
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stb_image.h>
+#include "TextureCooker.h"
+#include "ThreadPool.h"
+#include "HashUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace adria
+{
+	namespace
+	{
+		//values of the DXGI_FORMAT enum, the cooker doesn't depend on the D3D headers so it also builds on Linux
+		enum class DDSFormat : uint32
+		{
+			R32G32B32A32_FLOAT = 2,
+			R8G8B8A8_UNORM = 28,
+			R8G8B8A8_UNORM_SRGB = 29,
+			BC1_UNORM = 71,
+			BC1_UNORM_SRGB = 72,
+			BC3_UNORM = 77,
+			BC3_UNORM_SRGB = 78,
+			BC4_UNORM = 80,
+			BC5_UNORM = 83,
+			BC6H_UF16 = 95,
+			BC7_UNORM = 98,
+			BC7_UNORM_SRGB = 99
+		};
+
+		struct Texel
+		{
+			float r, g, b, a;
+		};
+
+		struct MipLevel
+		{
+			uint32 width;
+			uint32 height;
+			std::vector<Texel> texels;
+		};
+
+		bool IsSRGBUsage(TextureUsage usage)
+		{
+			return usage == TextureUsage::Albedo || usage == TextureUsage::Emissive;
+		}
+
+		float SRGBToLinear(float c)
+		{
+			return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		float LinearToSRGB(float c)
+		{
+			return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		}
+
+		uint8 ToUnorm8(float c)
+		{
+			return (uint8)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+		}
+
+		uint16 FloatToHalf(float f)
+		{
+			if (!(f > 0.0f)) return 0;
+			if (f >= 65504.0f) return 0x7BFF;
+			if (f < 6.103515625e-05f) return (uint16)std::lround(f * 16777216.0f);
+
+			uint32 bits;
+			memcpy(&bits, &f, sizeof(float));
+			uint32 const exponent = ((bits >> 23) & 0xFF) - 127 + 15;
+			uint32 const mantissa = bits & 0x7FFFFF;
+			uint32 half = (exponent << 10) | (mantissa >> 13);
+			if (mantissa & 0x1000) ++half;
+			return (uint16)std::min(half, 0x7BFFu);
+		}
+
+		//level 0 in linear space, normals are unpacked to [-1, 1]
+		bool DecodeSource(std::span<uint8 const> source, TextureUsage usage, MipLevel& level, bool& is_hdr)
+		{
+			int32 width = 0, height = 0, components = 0;
+			int32 const source_size = (int32)source.size();
+			is_hdr = stbi_is_hdr_from_memory(source.data(), source_size);
+			if (is_hdr)
+			{
+				float* pixels = stbi_loadf_from_memory(source.data(), source_size, &width, &height, &components, 4);
+				if (!pixels) return false;
+				level.width = (uint32)width;
+				level.height = (uint32)height;
+				level.texels.resize((uint64)width * height);
+				memcpy(level.texels.data(), pixels, level.texels.size() * sizeof(Texel));
+				stbi_image_free(pixels);
+				return true;
+			}
+
+			stbi_uc* pixels = stbi_load_from_memory(source.data(), source_size, &width, &height, &components, 4);
+			if (!pixels) return false;
+			level.width = (uint32)width;
+			level.height = (uint32)height;
+			level.texels.resize((uint64)width * height);
+
+			float srgb_to_linear[256];
+			for (uint32 i = 0; i < 256; ++i) srgb_to_linear[i] = SRGBToLinear(i / 255.0f);
+			ParallelFor(level.height, [&](uint64 y)
+			{
+				for (uint64 i = y * level.width; i < (y + 1) * level.width; ++i)
+				{
+					stbi_uc const* p = pixels + i * 4;
+					Texel& texel = level.texels[i];
+					if (IsSRGBUsage(usage)) texel = { srgb_to_linear[p[0]], srgb_to_linear[p[1]], srgb_to_linear[p[2]], p[3] / 255.0f };
+					else if (usage == TextureUsage::Normal) texel = { p[0] / 127.5f - 1.0f, p[1] / 127.5f - 1.0f, p[2] / 127.5f - 1.0f, p[3] / 255.0f };
+					else texel = { p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f };
+				}
+			});
+			stbi_image_free(pixels);
+			return true;
+		}
+
+		//2x2 box filter in linear space, normals are renormalized
+		void Downsample(MipLevel const& src, MipLevel& dst, TextureUsage usage)
+		{
+			dst.width = std::max(src.width / 2, 1u);
+			dst.height = std::max(src.height / 2, 1u);
+			dst.texels.resize((uint64)dst.width * dst.height);
+			ParallelFor(dst.height, [&](uint64 y)
+			{
+				uint64 const y0 = std::min<uint64>(y * 2, src.height - 1), y1 = std::min<uint64>(y * 2 + 1, src.height - 1);
+				for (uint64 x = 0; x < dst.width; ++x)
+				{
+					uint64 const x0 = std::min<uint64>(x * 2, src.width - 1), x1 = std::min<uint64>(x * 2 + 1, src.width - 1);
+					Texel const& t00 = src.texels[y0 * src.width + x0];
+					Texel const& t01 = src.texels[y0 * src.width + x1];
+					Texel const& t10 = src.texels[y1 * src.width + x0];
+					Texel const& t11 = src.texels[y1 * src.width + x1];
+					Texel texel{ (t00.r + t01.r + t10.r + t11.r) * 0.25f, (t00.g + t01.g + t10.g + t11.g) * 0.25f,
+								 (t00.b + t01.b + t10.b + t11.b) * 0.25f, (t00.a + t01.a + t10.a + t11.a) * 0.25f };
+					if (usage == TextureUsage::Normal)
+					{
+						float const length = std::sqrt(texel.r * texel.r + texel.g * texel.g + texel.b * texel.b);
+						if (length > 1e-6f) texel = { texel.r / length, texel.g / length, texel.b / length, texel.a };
+					}
+					dst.texels[y * dst.width + x] = texel;
+				}
+			});
+		}
+
+		void EncodeTexel(Texel const& texel, TextureUsage usage, uint8 rgba[4])
+		{
+			if (IsSRGBUsage(usage))
+			{
+				rgba[0] = ToUnorm8(LinearToSRGB(texel.r));
+				rgba[1] = ToUnorm8(LinearToSRGB(texel.g));
+				rgba[2] = ToUnorm8(LinearToSRGB(texel.b));
+			}
+			else if (usage == TextureUsage::Normal)
+			{
+				rgba[0] = ToUnorm8(texel.r * 0.5f + 0.5f);
+				rgba[1] = ToUnorm8(texel.g * 0.5f + 0.5f);
+				rgba[2] = ToUnorm8(texel.b * 0.5f + 0.5f);
+			}
+			else
+			{
+				rgba[0] = ToUnorm8(texel.r);
+				rgba[1] = ToUnorm8(texel.g);
+				rgba[2] = ToUnorm8(texel.b);
+			}
+			rgba[3] = ToUnorm8(texel.a);
+		}
+
+		class BlockWriter
+		{
+		public:
+			explicit BlockWriter(uint8* block) : block(block) { memset(block, 0, 16); }
+			void Write(uint32 value, uint32 bit_count)
+			{
+				for (uint32 i = 0; i < bit_count; ++i, ++position)
+				{
+					if (value & (1u << i)) block[position / 8] |= uint8(1u << (position % 8));
+				}
+			}
+		private:
+			uint8* block;
+			uint32 position = 0;
+		};
+
+		//principal axis of the points by power iteration, zero if the points are all the same
+		template<uint32 N>
+		void PrincipalAxis(float const (&points)[16][N], float (&mean)[N], float (&axis)[N])
+		{
+			for (uint32 c = 0; c < N; ++c)
+			{
+				mean[c] = 0.0f;
+				for (uint32 i = 0; i < 16; ++i) mean[c] += points[i][c];
+				mean[c] /= 16.0f;
+			}
+			float covariance[N][N]{};
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				for (uint32 a = 0; a < N; ++a)
+				{
+					for (uint32 b = 0; b < N; ++b) covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+				}
+			}
+			//starting from the channel with the largest variance, a fixed start vector can be orthogonal to the axis
+			uint32 start_channel = 0;
+			for (uint32 c = 1; c < N; ++c) if (covariance[c][c] > covariance[start_channel][start_channel]) start_channel = c;
+			for (uint32 c = 0; c < N; ++c) axis[c] = covariance[c][start_channel];
+			for (uint32 iteration = 0; iteration < 8; ++iteration)
+			{
+				float next[N]{};
+				float length = 0.0f;
+				for (uint32 a = 0; a < N; ++a)
+				{
+					for (uint32 b = 0; b < N; ++b) next[a] += covariance[a][b] * axis[b];
+					length += next[a] * next[a];
+				}
+				length = std::sqrt(length);
+				if (length < 1e-8f)
+				{
+					for (uint32 c = 0; c < N; ++c) axis[c] = 0.0f;
+					return;
+				}
+				for (uint32 c = 0; c < N; ++c) axis[c] = next[c] / length;
+			}
+		}
+
+		//endpoints at the extremes of the points projected on their principal axis
+		template<uint32 N>
+		void AxisEndpoints(float const (&points)[16][N], float max_value, float inset, float (&e0)[N], float (&e1)[N])
+		{
+			float mean[N], axis[N];
+			PrincipalAxis(points, mean, axis);
+			float t_min = 0.0f, t_max = 0.0f;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				float t = 0.0f;
+				for (uint32 c = 0; c < N; ++c) t += (points[i][c] - mean[c]) * axis[c];
+				t_min = std::min(t_min, t);
+				t_max = std::max(t_max, t);
+			}
+			float const t_inset = (t_max - t_min) * inset;
+			for (uint32 c = 0; c < N; ++c)
+			{
+				e0[c] = std::clamp(mean[c] + axis[c] * (t_max - t_inset), 0.0f, max_value);
+				e1[c] = std::clamp(mean[c] + axis[c] * (t_min + t_inset), 0.0f, max_value);
+			}
+		}
+
+		//endpoints minimizing the squared error for fixed interpolation weights, weights[i] is the weight of e1 for point i
+		template<uint32 N>
+		bool LeastSquaresEndpoints(float const (&points)[16][N], float const (&weights)[16], float max_value, float (&e0)[N], float (&e1)[N])
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[N]{}, bx[N]{};
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				float const b = weights[i], a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (uint32 c = 0; c < N; ++c)
+				{
+					ax[c] += a * points[i][c];
+					bx[c] += b * points[i][c];
+				}
+			}
+			float const det = aa * bb - ab * ab;
+			if (std::abs(det) < 1e-6f) return false;
+			for (uint32 c = 0; c < N; ++c)
+			{
+				e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, max_value);
+				e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, max_value);
+			}
+			return true;
+		}
+
+		uint16 EncodeRGB565(float const (&color)[3])
+		{
+			uint32 const r = (uint32)std::lround(color[0] * 31.0f / 255.0f);
+			uint32 const g = (uint32)std::lround(color[1] * 63.0f / 255.0f);
+			uint32 const b = (uint32)std::lround(color[2] * 31.0f / 255.0f);
+			return uint16((r << 11) | (g << 5) | b);
+		}
+		void DecodeRGB565(uint16 color, int32 (&rgb)[3])
+		{
+			uint32 const r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+			rgb[0] = int32((r << 3) | (r >> 2));
+			rgb[1] = int32((g << 2) | (g >> 4));
+			rgb[2] = int32((b << 3) | (b >> 2));
+		}
+
+		//four color mode only, which is also how BC3 interprets its color block
+		uint64 BC1Indices(float const (&points)[16][3], uint16 c0, uint16 c1, uint8 (&indices)[16])
+		{
+			int32 palette[4][3];
+			DecodeRGB565(c0, palette[0]);
+			DecodeRGB565(c1, palette[1]);
+			for (uint32 c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			uint64 error = 0;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				uint64 best_error = UINT64_MAX;
+				for (uint8 index = 0; index < 4; ++index)
+				{
+					uint64 index_error = 0;
+					for (uint32 c = 0; c < 3; ++c)
+					{
+						int64 const d = (int64)std::lround(points[i][c]) - palette[index][c];
+						index_error += d * d;
+					}
+					if (index_error < best_error)
+					{
+						best_error = index_error;
+						indices[i] = index;
+					}
+				}
+				error += best_error;
+			}
+			return error;
+		}
+
+		void EncodeBC1(uint8 const (&block)[16][4], uint8* output)
+		{
+			float points[16][3];
+			for (uint32 i = 0; i < 16; ++i) for (uint32 c = 0; c < 3; ++c) points[i][c] = block[i][c];
+
+			float e0[3], e1[3];
+			AxisEndpoints(points, 255.0f, 1.0f / 16.0f, e0, e1);
+			auto OrderedEndpoints = [](float const (&a)[3], float const (&b)[3], uint16& c0, uint16& c1)
+			{
+				c0 = EncodeRGB565(a);
+				c1 = EncodeRGB565(b);
+				if (c0 < c1) std::swap(c0, c1);
+			};
+			uint16 c0, c1;
+			OrderedEndpoints(e0, e1, c0, c1);
+			uint8 indices[16];
+			uint64 error = BC1Indices(points, c0, c1, indices);
+
+			static constexpr float index_weights[] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			for (uint32 iteration = 0; iteration < 2 && error > 0 && c0 != c1; ++iteration)
+			{
+				float weights[16];
+				for (uint32 i = 0; i < 16; ++i) weights[i] = index_weights[indices[i]];
+				if (!LeastSquaresEndpoints(points, weights, 255.0f, e0, e1)) break;
+
+				uint16 refined_c0, refined_c1;
+				OrderedEndpoints(e0, e1, refined_c0, refined_c1);
+				uint8 refined_indices[16];
+				uint64 const refined_error = BC1Indices(points, refined_c0, refined_c1, refined_indices);
+				if (refined_error >= error) break;
+				error = refined_error;
+				c0 = refined_c0, c1 = refined_c1;
+				memcpy(indices, refined_indices, sizeof(indices));
+			}
+			//equal endpoints select the three color mode, where only index 0 is safe
+			if (c0 == c1) memset(indices, 0, sizeof(indices));
+
+			uint32 index_bits = 0;
+			for (uint32 i = 0; i < 16; ++i) index_bits |= uint32(indices[i]) << (i * 2);
+			memcpy(output, &c0, 2);
+			memcpy(output + 2, &c1, 2);
+			memcpy(output + 4, &index_bits, 4);
+		}
+
+		void EncodeBC4(uint8 const (&values)[16], uint8* output)
+		{
+			uint8 const e0 = *std::max_element(values, values + 16);
+			uint8 const e1 = *std::min_element(values, values + 16);
+			int32 palette[8] = { e0, e1 };
+			for (int32 i = 2; i < 8; ++i) palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+
+			uint64 index_bits = 0;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				uint64 best_index = 0;
+				int32 best_error = INT32_MAX;
+				for (uint64 index = 0; index < 8; ++index)
+				{
+					int32 const error = std::abs(values[i] - palette[index]);
+					if (error < best_error)
+					{
+						best_error = error;
+						best_index = index;
+					}
+				}
+				index_bits |= best_index << (i * 3);
+			}
+			output[0] = e0;
+			output[1] = e1;
+			memcpy(output + 2, &index_bits, 6);
+		}
+
+		void EncodeBC4Channel(uint8 const (&block)[16][4], uint32 channel, uint8* output)
+		{
+			uint8 values[16];
+			for (uint32 i = 0; i < 16; ++i) values[i] = block[i][channel];
+			EncodeBC4(values, output);
+		}
+
+		//BC6H and BC7 share the 4 bit index weights
+		static constexpr int32 INDEX_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		struct BC7Endpoint
+		{
+			uint8 color[4];	//7 bits per channel
+			uint8 pbit;
+			int32 Value(uint32 c) const { return (color[c] << 1) | pbit; }
+		};
+
+		BC7Endpoint QuantizeBC7Endpoint(float const (&endpoint)[4])
+		{
+			BC7Endpoint best{};
+			float best_error = FLT_MAX;
+			for (uint8 pbit = 0; pbit < 2; ++pbit)
+			{
+				BC7Endpoint quantized{ .color = {}, .pbit = pbit };
+				float error = 0.0f;
+				for (uint32 c = 0; c < 4; ++c)
+				{
+					quantized.color[c] = (uint8)std::clamp<long>(std::lround((endpoint[c] - pbit) * 0.5f), 0, 127);
+					float const d = quantized.Value(c) - endpoint[c];
+					error += d * d;
+				}
+				if (error < best_error)
+				{
+					best_error = error;
+					best = quantized;
+				}
+			}
+			return best;
+		}
+
+		uint64 BC7Indices(float const (&points)[16][4], BC7Endpoint const& e0, BC7Endpoint const& e1, uint8 (&indices)[16])
+		{
+			int32 palette[16][4];
+			for (uint32 index = 0; index < 16; ++index)
+			{
+				for (uint32 c = 0; c < 4; ++c) palette[index][c] = ((64 - INDEX_WEIGHTS_4[index]) * e0.Value(c) + INDEX_WEIGHTS_4[index] * e1.Value(c) + 32) >> 6;
+			}
+			uint64 error = 0;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				uint64 best_error = UINT64_MAX;
+				for (uint8 index = 0; index < 16; ++index)
+				{
+					uint64 index_error = 0;
+					for (uint32 c = 0; c < 4; ++c)
+					{
+						int64 const d = (int64)std::lround(points[i][c]) - palette[index][c];
+						index_error += d * d;
+					}
+					if (index_error < best_error)
+					{
+						best_error = index_error;
+						indices[i] = index;
+					}
+				}
+				error += best_error;
+			}
+			return error;
+		}
+
+		//mode 6: one subset, 7.7.7.7 endpoints with a p-bit each and 4 bit indices
+		void EncodeBC7(uint8 const (&block)[16][4], uint8* output)
+		{
+			float points[16][4];
+			for (uint32 i = 0; i < 16; ++i) for (uint32 c = 0; c < 4; ++c) points[i][c] = block[i][c];
+
+			float e0[4], e1[4];
+			AxisEndpoints(points, 255.0f, 0.0f, e0, e1);
+			BC7Endpoint q0 = QuantizeBC7Endpoint(e0), q1 = QuantizeBC7Endpoint(e1);
+			uint8 indices[16];
+			uint64 error = BC7Indices(points, q0, q1, indices);
+			for (uint32 iteration = 0; iteration < 2 && error > 0; ++iteration)
+			{
+				float weights[16];
+				for (uint32 i = 0; i < 16; ++i) weights[i] = INDEX_WEIGHTS_4[indices[i]] / 64.0f;
+				if (!LeastSquaresEndpoints(points, weights, 255.0f, e0, e1)) break;
+
+				BC7Endpoint const refined_q0 = QuantizeBC7Endpoint(e0), refined_q1 = QuantizeBC7Endpoint(e1);
+				uint8 refined_indices[16];
+				uint64 const refined_error = BC7Indices(points, refined_q0, refined_q1, refined_indices);
+				if (refined_error >= error) break;
+				error = refined_error;
+				q0 = refined_q0, q1 = refined_q1;
+				memcpy(indices, refined_indices, sizeof(indices));
+			}
+			//the anchor index is stored without its top bit
+			if (indices[0] & 8)
+			{
+				std::swap(q0, q1);
+				for (uint8& index : indices) index = 15 - index;
+			}
+
+			BlockWriter writer(output);
+			writer.Write(1u << 6, 7);
+			for (uint32 c = 0; c < 4; ++c)
+			{
+				writer.Write(q0.color[c], 7);
+				writer.Write(q1.color[c], 7);
+			}
+			writer.Write(q0.pbit, 1);
+			writer.Write(q1.pbit, 1);
+			for (uint32 i = 0; i < 16; ++i) writer.Write(indices[i], i == 0 ? 3 : 4);
+		}
+
+		int32 UnquantizeBC6H(int32 value)
+		{
+			if (value == 0) return 0;
+			if (value == 1023) return 0xFFFF;
+			return ((value << 16) + 0x8000) >> 10;
+		}
+
+		int32 QuantizeBC6H(float value)
+		{
+			int32 const estimate = std::clamp((int32)(value / 64.0f), 0, 1023);
+			int32 best = estimate;
+			for (int32 candidate = std::max(estimate - 1, 0); candidate <= std::min(estimate + 1, 1023); ++candidate)
+			{
+				if (std::abs(UnquantizeBC6H(candidate) - value) < std::abs(UnquantizeBC6H(best) - value)) best = candidate;
+			}
+			return best;
+		}
+
+		uint64 BC6HIndices(float const (&points)[16][3], int32 const (&q0)[3], int32 const (&q1)[3], uint8 (&indices)[16])
+		{
+			float palette[16][3];
+			for (uint32 index = 0; index < 16; ++index)
+			{
+				for (uint32 c = 0; c < 3; ++c) palette[index][c] = float((UnquantizeBC6H(q0[c]) * (64 - INDEX_WEIGHTS_4[index]) + UnquantizeBC6H(q1[c]) * INDEX_WEIGHTS_4[index] + 32) >> 6);
+			}
+			double error = 0.0;
+			for (uint32 i = 0; i < 16; ++i)
+			{
+				float best_error = FLT_MAX;
+				for (uint8 index = 0; index < 16; ++index)
+				{
+					float index_error = 0.0f;
+					for (uint32 c = 0; c < 3; ++c)
+					{
+						float const d = points[i][c] - palette[index][c];
+						index_error += d * d;
+					}
+					if (index_error < best_error)
+					{
+						best_error = index_error;
+						indices[i] = index;
+					}
+				}
+				error += best_error;
+			}
+			return (uint64)error;
+		}
+
+		//mode 11: one region, 10 bit endpoints without delta encoding and 4 bit indices. unsigned only
+		void EncodeBC6H(uint16 const (&block)[16][3], uint8* output)
+		{
+			//the decoder scales the interpolated value by 31/64 to get the half float bits, the endpoints are fit before that scale
+			float points[16][3];
+			for (uint32 i = 0; i < 16; ++i) for (uint32 c = 0; c < 3; ++c) points[i][c] = block[i][c] * 64.0f / 31.0f;
+
+			float e0[3], e1[3];
+			AxisEndpoints(points, 65535.0f, 0.0f, e0, e1);
+			auto Quantize = [](float const (&e)[3], int32 (&q)[3]) { for (uint32 c = 0; c < 3; ++c) q[c] = QuantizeBC6H(e[c]); };
+			int32 q0[3], q1[3];
+			Quantize(e0, q0);
+			Quantize(e1, q1);
+			uint8 indices[16];
+			uint64 error = BC6HIndices(points, q0, q1, indices);
+			for (uint32 iteration = 0; iteration < 2 && error > 0; ++iteration)
+			{
+				float weights[16];
+				for (uint32 i = 0; i < 16; ++i) weights[i] = INDEX_WEIGHTS_4[indices[i]] / 64.0f;
+				if (!LeastSquaresEndpoints(points, weights, 65535.0f, e0, e1)) break;
+
+				int32 refined_q0[3], refined_q1[3];
+				Quantize(e0, refined_q0);
+				Quantize(e1, refined_q1);
+				uint8 refined_indices[16];
+				uint64 const refined_error = BC6HIndices(points, refined_q0, refined_q1, refined_indices);
+				if (refined_error >= error) break;
+				error = refined_error;
+				memcpy(q0, refined_q0, sizeof(q0));
+				memcpy(q1, refined_q1, sizeof(q1));
+				memcpy(indices, refined_indices, sizeof(indices));
+			}
+			if (indices[0] & 8)
+			{
+				std::swap(q0, q1);
+				for (uint8& index : indices) index = 15 - index;
+			}
+
+			BlockWriter writer(output);
+			writer.Write(0x03, 5);
+			for (uint32 c = 0; c < 3; ++c) writer.Write((uint32)q0[c], 10);
+			for (uint32 c = 0; c < 3; ++c) writer.Write((uint32)q1[c], 10);
+			for (uint32 i = 0; i < 16; ++i) writer.Write(indices[i], i == 0 ? 3 : 4);
+		}
+
+		uint32 GetBlockSize(DDSFormat format)
+		{
+			switch (format)
+			{
+			case DDSFormat::BC1_UNORM:
+			case DDSFormat::BC1_UNORM_SRGB:
+			case DDSFormat::BC4_UNORM:
+				return 8;
+			case DDSFormat::BC3_UNORM:
+			case DDSFormat::BC3_UNORM_SRGB:
+			case DDSFormat::BC5_UNORM:
+			case DDSFormat::BC6H_UF16:
+			case DDSFormat::BC7_UNORM:
+			case DDSFormat::BC7_UNORM_SRGB:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+
+		DDSFormat SelectFormat(TextureCookParameters const& params, MipLevel const& level, bool is_hdr)
+		{
+			//D3D12 requires the top mip of a block compressed texture to be a whole number of blocks
+			bool const compressible = level.width % 4 == 0 && level.height % 4 == 0;
+			if (is_hdr) return compressible ? DDSFormat::BC6H_UF16 : DDSFormat::R32G32B32A32_FLOAT;
+			if (!compressible) return IsSRGBUsage(params.usage) ? DDSFormat::R8G8B8A8_UNORM_SRGB : DDSFormat::R8G8B8A8_UNORM;
+
+			switch (params.usage)
+			{
+			case TextureUsage::Albedo:
+			{
+				if (!params.fast) return DDSFormat::BC7_UNORM_SRGB;
+				bool const has_alpha = std::any_of(level.texels.begin(), level.texels.end(), [](Texel const& texel) { return ToUnorm8(texel.a) < 255; });
+				return has_alpha ? DDSFormat::BC3_UNORM_SRGB : DDSFormat::BC1_UNORM_SRGB;
+			}
+			case TextureUsage::Normal:				return DDSFormat::BC5_UNORM;
+			case TextureUsage::MetallicRoughness:	return params.fast ? DDSFormat::BC1_UNORM : DDSFormat::BC7_UNORM;
+			case TextureUsage::Emissive:			return DDSFormat::BC1_UNORM_SRGB;
+			case TextureUsage::Mask:				return DDSFormat::BC4_UNORM;
+			default:								return DDSFormat::R8G8B8A8_UNORM;
+			}
+		}
+
+		void EncodeLevel(MipLevel const& level, TextureUsage usage, DDSFormat format, std::vector<uint8>& output)
+		{
+			uint64 const offset = output.size();
+			uint32 const block_size = GetBlockSize(format);
+			if (block_size == 0)
+			{
+				if (format == DDSFormat::R32G32B32A32_FLOAT)
+				{
+					output.resize(offset + level.texels.size() * sizeof(Texel));
+					memcpy(output.data() + offset, level.texels.data(), level.texels.size() * sizeof(Texel));
+				}
+				else
+				{
+					output.resize(offset + level.texels.size() * 4);
+					ParallelFor(level.height, [&](uint64 y)
+					{
+						for (uint64 i = y * level.width; i < (y + 1) * level.width; ++i) EncodeTexel(level.texels[i], usage, output.data() + offset + i * 4);
+					});
+				}
+				return;
+			}
+
+			uint32 const blocks_x = (level.width + 3) / 4, blocks_y = (level.height + 3) / 4;
+			output.resize(offset + (uint64)blocks_x * blocks_y * block_size);
+			ParallelFor(blocks_y, [&](uint64 block_y)
+			{
+				for (uint32 block_x = 0; block_x < blocks_x; ++block_x)
+				{
+					//mips smaller than a block repeat their edge texels
+					Texel const* block_texels[16];
+					for (uint32 i = 0; i < 16; ++i)
+					{
+						uint32 const x = std::min(block_x * 4 + i % 4, level.width - 1);
+						uint32 const y = std::min((uint32)block_y * 4 + i / 4, level.height - 1);
+						block_texels[i] = &level.texels[(uint64)y * level.width + x];
+					}
+
+					uint8* block_output = output.data() + offset + (block_y * blocks_x + block_x) * block_size;
+					if (format == DDSFormat::BC6H_UF16)
+					{
+						uint16 block[16][3];
+						for (uint32 i = 0; i < 16; ++i)
+						{
+							block[i][0] = FloatToHalf(block_texels[i]->r);
+							block[i][1] = FloatToHalf(block_texels[i]->g);
+							block[i][2] = FloatToHalf(block_texels[i]->b);
+						}
+						EncodeBC6H(block, block_output);
+						continue;
+					}
+
+					uint8 block[16][4];
+					for (uint32 i = 0; i < 16; ++i) EncodeTexel(*block_texels[i], usage, block[i]);
+					switch (format)
+					{
+					case DDSFormat::BC1_UNORM:
+					case DDSFormat::BC1_UNORM_SRGB:
+						EncodeBC1(block, block_output);
+						break;
+					case DDSFormat::BC3_UNORM:
+					case DDSFormat::BC3_UNORM_SRGB:
+						EncodeBC4Channel(block, 3, block_output);
+						EncodeBC1(block, block_output + 8);
+						break;
+					case DDSFormat::BC4_UNORM:
+						EncodeBC4Channel(block, 0, block_output);
+						break;
+					case DDSFormat::BC5_UNORM:
+						EncodeBC4Channel(block, 0, block_output);
+						EncodeBC4Channel(block, 1, block_output + 8);
+						break;
+					case DDSFormat::BC7_UNORM:
+					case DDSFormat::BC7_UNORM_SRGB:
+						EncodeBC7(block, block_output);
+						break;
+					default:
+						break;
+					}
+				}
+			});
+		}
+
+		bool WriteDDS(std::string const& path, DDSFormat format, uint32 width, uint32 height, uint32 mip_count, std::vector<uint8> const& data)
+		{
+#pragma pack(push,1)
+			struct DDSHeader
+			{
+				uint32 magic;
+				uint32 size;
+				uint32 flags;
+				uint32 height;
+				uint32 width;
+				uint32 pitch_or_linear_size;
+				uint32 depth;
+				uint32 mip_map_count;
+				uint32 reserved1[11];
+				uint32 pf_size;
+				uint32 pf_flags;
+				uint32 pf_four_cc;
+				uint32 pf_rgb_bit_count;
+				uint32 pf_bit_masks[4];
+				uint32 caps;
+				uint32 caps2;
+				uint32 caps3;
+				uint32 caps4;
+				uint32 reserved2;
+				uint32 dxgi_format;
+				uint32 resource_dimension;
+				uint32 misc_flag;
+				uint32 array_size;
+				uint32 misc_flags2;
+			};
+#pragma pack(pop)
+			static_assert(sizeof(DDSHeader) == 4 + 124 + 20);
+
+			DDSHeader header{};
+			header.magic = 0x20534444;					//"DDS "
+			header.size = 124;
+			header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; //caps, height, width, pixel format, mip count, linear size
+			header.height = height;
+			header.width = width;
+			uint32 const block_size = GetBlockSize(format);
+			header.pitch_or_linear_size = block_size ? ((width + 3) / 4) * ((height + 3) / 4) * block_size : width * height * (format == DDSFormat::R32G32B32A32_FLOAT ? 16 : 4);
+			header.mip_map_count = mip_count;
+			header.pf_size = 32;
+			header.pf_flags = 0x4;						//four cc
+			header.pf_four_cc = 0x30315844;				//"DX10"
+			header.caps = 0x1000 | (mip_count > 1 ? 0x8 | 0x400000 : 0);
+			header.dxgi_format = (uint32)format;
+			header.resource_dimension = 3;				//texture 2D
+			header.array_size = 1;
+
+			std::error_code error;
+			fs::create_directories(fs::path(path).parent_path(), error);
+			std::string const temporary_path = path + ".tmp";
+			{
+				std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+				if (!file) return false;
+				file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+				file.write(reinterpret_cast<char const*>(data.data()), data.size());
+				if (!file) return false;
+			}
+			fs::rename(temporary_path, path, error);
+			return !error;
+		}
+	}
+
+	char const* TextureUsageToString(TextureUsage usage)
+	{
+		switch (usage)
+		{
+		case TextureUsage::Albedo:				return "albedo";
+		case TextureUsage::Normal:				return "normal";
+		case TextureUsage::MetallicRoughness:	return "metallic_roughness";
+		case TextureUsage::Emissive:			return "emissive";
+		case TextureUsage::Mask:				return "mask";
+		default:								return "unknown";
+		}
+	}
+
+	uint64 ComputeCookedTextureKey(std::span<uint8 const> source, TextureCookParameters const& params)
+	{
+		uint64 key = crc64(reinterpret_cast<char const*>(source.data()), source.size());
+		HashCombine(key, TEXTURE_COOKER_VERSION);
+		HashCombine(key, (uint32)params.usage);
+		HashCombine(key, params.fast);
+		return key;
+	}
+
+	std::string GetCookedTexturePath(std::string_view cache_dir, std::string_view source_path, TextureCookParameters const& params, uint64 key)
+	{
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), "_%llx.dds", (unsigned long long)key);
+		return std::string(cache_dir) + fs::path(source_path).stem().string() + "_" + TextureUsageToString(params.usage) + suffix;
+	}
+
+	bool CookTexture(std::span<uint8 const> source, TextureCookParameters const& params, std::string const& output_path)
+	{
+		std::vector<MipLevel> mips(1);
+		bool is_hdr = false;
+		if (!DecodeSource(source, params.usage, mips[0], is_hdr) || mips[0].texels.empty()) return false;
+
+		while (mips.back().width > 1 || mips.back().height > 1)
+		{
+			MipLevel& mip = mips.emplace_back();
+			Downsample(mips[mips.size() - 2], mip, params.usage);
+		}
+
+		DDSFormat const format = SelectFormat(params, mips[0], is_hdr);
+		std::vector<uint8> data;
+		for (MipLevel const& mip : mips) EncodeLevel(mip, params.usage, format, data);
+		return WriteDDS(output_path, format, mips[0].width, mips[0].height, (uint32)mips.size(), data);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace adria
+{
+	inline constexpr uint32 TEXTURE_COOKER_VERSION = 1;
+
+	//decides the filtering and the block compression format of a cooked texture, HDR images are always encoded to BC6H
+	enum class TextureUsage : uint8
+	{
+		Albedo,				//sRGB, BC7 or BC1/BC3 when fast
+		Normal,				//tangent space normal, BC5 with z reconstructed in the shader
+		MetallicRoughness,	//linear, BC7 or BC1 when fast
+		Emissive,			//sRGB, BC1
+		Mask,				//single channel in red, BC4
+		Count
+	};
+	char const* TextureUsageToString(TextureUsage usage);
+
+	struct TextureCookParameters
+	{
+		TextureUsage usage = TextureUsage::Albedo;
+		bool fast = false;
+	};
+
+	//hash of the source image bytes and the parameters that change the cooked result
+	uint64 ComputeCookedTextureKey(std::span<uint8 const> source, TextureCookParameters const& params);
+	//<cache_dir><source file name>_<usage>_<key>.dds
+	std::string GetCookedTexturePath(std::string_view cache_dir, std::string_view source_path, TextureCookParameters const& params, uint64 key);
+
+	//decodes an image file, generates its mip chain and writes it block compressed to a DDS file.
+	//mips and blocks are processed on the thread pool so don't call it from inside a pool task
+	bool CookTexture(std::span<uint8 const> source, TextureCookParameters const& params, std::string const& output_path);
+}
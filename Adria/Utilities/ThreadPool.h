@@ -1,6 +1,9 @@
 #pragma once
 #include <thread>
+#include <functional>
 #include <future>
+#include <memory>
+#include <atomic>
 #include <type_traits>
 #include "ConcurrentQueue.h"
 #include "Singleton.h"
@@ -84,4 +87,41 @@ namespace adria
 		}
 	};
 	#define g_ThreadPool ThreadPool::Get()
+
+	//runs f(i) for every i in [0, count) on the pool and the calling thread, items are handed out one at a time so uneven items balance out.
+	//the caller keeps taking items until none are left and then only waits for items a pool thread already started,
+	//so tasks still queued behind long running work (texture decodes, shader compiles) never hold up the caller. they find no items left and return
+	template<typename F>
+	void ParallelFor(uint64 count, F&& f)
+	{
+		uint64 const thread_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+		uint64 const task_count = (std::min)(count, thread_count);
+		if (task_count <= 1)
+		{
+			for (uint64 i = 0; i < count; ++i) f(i);
+			return;
+		}
+
+		struct ParallelForState
+		{
+			std::atomic<uint64> next_item = 0;
+			std::atomic<uint64> finished_items = 0;
+		};
+		//late tasks can run after the caller returned, they only touch the shared state and never f unless they claimed an item
+		auto state = std::make_shared<ParallelForState>();
+		auto Work = [&f, state, count]()
+		{
+			for (uint64 i = state->next_item++; i < count; i = state->next_item++)
+			{
+				f(i);
+				if (state->finished_items.fetch_add(1) + 1 == count) state->finished_items.notify_all();
+			}
+		};
+		for (uint64 task = 1; task < task_count; ++task) g_ThreadPool.Submit(Work);
+		Work();
+		for (uint64 finished = state->finished_items.load(); finished < count; finished = state->finished_items.load())
+		{
+			state->finished_items.wait(finished);
+		}
+	}
 }
\ No newline at end of file